@@ -11,21 +11,298 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <iostream>
 
 namespace shannon {
 
+LRUHandleTable::LRUHandleTable() : length_(0), elems_(0), list_(NULL) {
+  Resize();
+}
+
+LRUHandleTable::~LRUHandleTable() { delete[] list_; }
+
+LRUHandle* LRUHandleTable::Lookup(const Slice& key, uint32_t hash) {
+  return *FindPointer(key, hash);
+}
+
+LRUHandle* LRUHandleTable::Insert(LRUHandle* h) {
+  LRUHandle** ptr = FindPointer(h->key(), h->hash);
+  LRUHandle* old = *ptr;
+  h->next_hash = (old == NULL ? NULL : old->next_hash);
+  *ptr = h;
+  if (old == NULL) {
+    ++elems_;
+    if (elems_ > length_) {
+      // Since each cache entry is fairly large, we aim for a small
+      // average linked list length (<= 1).
+      Resize();
+    }
+  }
+  return old;
+}
+
+LRUHandle* LRUHandleTable::Remove(const Slice& key, uint32_t hash) {
+  LRUHandle** ptr = FindPointer(key, hash);
+  LRUHandle* result = *ptr;
+  if (result != NULL) {
+    *ptr = result->next_hash;
+    --elems_;
+  }
+  return result;
+}
+
+LRUHandle** LRUHandleTable::FindPointer(const Slice& key, uint32_t hash) {
+  LRUHandle** ptr = &list_[hash & (length_ - 1)];
+  while (*ptr != NULL && ((*ptr)->hash != hash || key != (*ptr)->key())) {
+    ptr = &(*ptr)->next_hash;
+  }
+  return ptr;
+}
+
+void LRUHandleTable::Resize() {
+  uint32_t new_length = 4;
+  while (new_length < elems_) {
+    new_length *= 2;
+  }
+  LRUHandle** new_list = new LRUHandle*[new_length];
+  memset(new_list, 0, sizeof(new_list[0]) * new_length);
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < length_; i++) {
+    LRUHandle* h = list_[i];
+    while (h != NULL) {
+      LRUHandle* next = h->next_hash;
+      uint32_t hash = h->hash;
+      LRUHandle** ptr = &new_list[hash & (new_length - 1)];
+      h->next_hash = *ptr;
+      *ptr = h;
+      h = next;
+      count++;
+    }
+  }
+  assert(elems_ == count);
+  delete[] list_;
+  list_ = new_list;
+  length_ = new_length;
+}
+
+LRUCacheShard::LRUCacheShard()
+    : capacity_(0), strict_capacity_limit_(false), usage_(0),
+      pinned_usage_(0) {
+  // Make empty circular linked lists.
+  lru_.next = &lru_;
+  lru_.prev = &lru_;
+  in_use_.next = &in_use_;
+  in_use_.prev = &in_use_;
+}
+
+LRUCacheShard::~LRUCacheShard() {
+  assert(in_use_.next == &in_use_);  // Error if caller has an unreleased handle
+  for (LRUHandle* e = lru_.next; e != &lru_;) {
+    LRUHandle* next = e->next;
+    assert(e->in_cache);
+    e->in_cache = false;
+    assert(e->refs == 1);  // Invariant of lru_ list.
+    Unref(e);
+    e = next;
+  }
+}
+
+void LRUCacheShard::Ref(LRUHandle* e) {
+  if (e->refs == 1 && e->in_cache) {  // If on lru_ list, move to in_use_ list.
+    LRU_Remove(e);
+    LRU_Append(&in_use_, e);
+    pinned_usage_ += e->charge;
+  }
+  e->refs++;
+}
+
+bool LRUCacheShard::Unref(LRUHandle* e) {
+  assert(e->refs > 0);
+  e->refs--;
+  if (e->refs == 0) {  // Deallocate.
+    assert(!e->in_cache);
+    (*e->deleter)(e->key(), e->value);
+    free(e);
+    return true;
+  } else if (e->in_cache && e->refs == 1) {
+    // No longer in use; move to lru_ list.
+    LRU_Remove(e);
+    LRU_Append(&lru_, e);
+    pinned_usage_ -= e->charge;
+  }
+  return false;
+}
+
+void LRUCacheShard::LRU_Remove(LRUHandle* e) {
+  e->next->prev = e->prev;
+  e->prev->next = e->next;
+}
+
+void LRUCacheShard::LRU_Append(LRUHandle* list, LRUHandle* e) {
+  // Make "e" newest entry by inserting just before *list
+  e->next = list;
+  e->prev = list->prev;
+  e->prev->next = e;
+  e->next->prev = e;
+}
+
+// If e != NULL, finish removing *e from the cache; it has already been
+// removed from the hash table.  Return whether e != NULL.
+bool LRUCacheShard::FinishErase(LRUHandle* e) {
+  if (e != NULL) {
+    assert(e->in_cache);
+    LRU_Remove(e);
+    e->in_cache = false;
+    usage_ -= e->charge;
+    if (e->refs > 1) {
+      pinned_usage_ -= e->charge;
+    }
+    Unref(e);
+  }
+  return e != NULL;
+}
+
+void LRUCacheShard::EvictFor(size_t charge) {
+  while (usage_ + charge > capacity_ && lru_.next != &lru_) {
+    LRUHandle* old = lru_.next;
+    assert(old->refs == 1);
+    bool erased = FinishErase(table_.Remove(old->key(), old->hash));
+    if (!erased) {  // to avoid unused variable when compiled NDEBUG
+      assert(erased);
+    }
+  }
+}
+
+Status LRUCacheShard::Insert(const Slice& key, uint32_t hash, void* value,
+                             size_t charge,
+                             void (*deleter)(const Slice& key, void* value),
+                             Cache::Handle** handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  EvictFor(charge);
+  if (usage_ + charge > capacity_ &&
+      (strict_capacity_limit_ || handle == NULL)) {
+    // Nothing left to evict.  Without a handle the entry would be evicted
+    // right away, so it is not inserted and that is not an error.
+    (*deleter)(key, value);
+    if (handle == NULL) {
+      return Status::OK();
+    }
+    *handle = NULL;
+    return Status::Incomplete("Insert failed due to LRU cache being full.");
+  }
+
+  LRUHandle* e =
+      reinterpret_cast<LRUHandle*>(malloc(sizeof(LRUHandle) - 1 + key.size()));
+  e->value = value;
+  e->deleter = deleter;
+  e->charge = charge;
+  e->key_length = key.size();
+  e->hash = hash;
+  e->refs = 2;  // One for the cache, one for the returned handle.
+  e->in_cache = true;
+  memcpy(e->key_data, key.data(), key.size());
+  LRU_Append(&in_use_, e);
+  usage_ += charge;
+  pinned_usage_ += charge;
+  FinishErase(table_.Insert(e));
+  if (handle == NULL) {
+    Unref(e);
+  } else {
+    *handle = reinterpret_cast<Cache::Handle*>(e);
+  }
+  return Status::OK();
+}
+
+Cache::Handle* LRUCacheShard::Lookup(const Slice& key, uint32_t hash) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LRUHandle* e = table_.Lookup(key, hash);
+  if (e != NULL) {
+    Ref(e);
+  }
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+bool LRUCacheShard::Release(Cache::Handle* handle) {
+  if (handle == NULL) {
+    return false;
+  }
+  LRUHandle* e = reinterpret_cast<LRUHandle*>(handle);
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool last_reference = Unref(e);
+  if (!last_reference && e->in_cache && e->refs == 1 && usage_ > capacity_) {
+    // Inserted over the capacity while pinned, drop it now that it is not.
+    last_reference = FinishErase(table_.Remove(e->key(), e->hash));
+  }
+  return last_reference;
+}
+
+void LRUCacheShard::Erase(const Slice& key, uint32_t hash) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FinishErase(table_.Remove(key, hash));
+}
+
+void LRUCacheShard::SetCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = capacity;
+  EvictFor(0);
+}
+
+void LRUCacheShard::SetStrictCapacityLimit(bool strict_capacity_limit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  strict_capacity_limit_ = strict_capacity_limit;
+}
+
+size_t LRUCacheShard::GetUsage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return usage_;
+}
+
+size_t LRUCacheShard::GetPinnedUsage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pinned_usage_;
+}
+
 std::shared_ptr<Cache> NewLRUCache(size_t capacity, int num_shard_bits,
                 bool strict_capacity_limit,
                 double high_pri_pool_ratio) {
-    return std::make_shared<LRUCache>(capacity, num_shard_bits,
+  if (num_shard_bits >= 20) {
+    return nullptr;  // the cache cannot be sharded into too many fine pieces
+  }
+  if (num_shard_bits < 0) {
+    num_shard_bits = GetDefaultCacheShardBits(capacity);
+  }
+  return std::make_shared<LRUCache>(capacity, num_shard_bits,
                                     strict_capacity_limit, high_pri_pool_ratio);
 }
 
 LRUCache::LRUCache(size_t capacity, int num_shard_bits,
                    bool strict_capacity_limit, double high_pri_pool_ratio)
     : ShardedCache(capacity, num_shard_bits, strict_capacity_limit) {
-    }
+  int num_shards = 1 << num_shard_bits;
+  shards_ = new LRUCacheShard[num_shards];
+  size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
+  for (int i = 0; i < num_shards; i++) {
+    shards_[i].SetCapacity(per_shard);
+    shards_[i].SetStrictCapacityLimit(strict_capacity_limit);
+  }
+}
+
+LRUCache::~LRUCache() { delete[] shards_; }
+
+CacheShard* LRUCache::GetShard(int shard) { return &shards_[shard]; }
+
+const CacheShard* LRUCache::GetShard(int shard) const {
+  return &shards_[shard];
+}
+
+void* LRUCache::Value(Handle* handle) {
+  return reinterpret_cast<const LRUHandle*>(handle)->value;
+}
+
+uint32_t LRUCache::GetHash(Handle* handle) const {
+  return reinterpret_cast<const LRUHandle*>(handle)->hash;
+}
 
 }  // namespace shannon
@@ -4,15 +4,108 @@
 
 #pragma once
 
+#include <mutex>
 #include <string>
 #include "cache/sharded_cache.h"
 
 namespace shannon {
 
+// An entry is a variable length heap-allocated structure.  Entries are
+// kept in a circular doubly linked list ordered by access time: the lru
+// list holds the entries only the cache refers to, in_use the entries
+// clients hold a handle of, in no particular order.
+struct LRUHandle {
+  void* value;
+  void (*deleter)(const Slice&, void* value);
+  LRUHandle* next_hash;
+  LRUHandle* next;
+  LRUHandle* prev;
+  size_t charge;
+  size_t key_length;
+  uint32_t refs;     // References, including the cache's if in_cache
+  bool in_cache;     // Whether the entry is in the cache
+  uint32_t hash;     // Hash of key(); used for fast sharding and comparisons
+  char key_data[1];  // Beginning of key
+
+  Slice key() const { return Slice(key_data, key_length); }
+};
+
+// A simple hash table of the entries of a shard, resized to keep about one
+// entry per bucket.
+class LRUHandleTable {
+ public:
+  LRUHandleTable();
+  ~LRUHandleTable();
+
+  LRUHandle* Lookup(const Slice& key, uint32_t hash);
+  // Returns the entry replaced by h, if any.
+  LRUHandle* Insert(LRUHandle* h);
+  LRUHandle* Remove(const Slice& key, uint32_t hash);
+
+ private:
+  // A pointer to the slot that points to a cache entry that matches
+  // key/hash, or to the trailing slot of the bucket if there is none.
+  LRUHandle** FindPointer(const Slice& key, uint32_t hash);
+  void Resize();
+
+  uint32_t length_;
+  uint32_t elems_;
+  LRUHandle** list_;
+};
+
+class LRUCacheShard : public CacheShard {
+ public:
+  LRUCacheShard();
+  virtual ~LRUCacheShard();
+
+  virtual Status Insert(const Slice& key, uint32_t hash, void* value,
+                        size_t charge,
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Handle** handle);
+  virtual Cache::Handle* Lookup(const Slice& key, uint32_t hash);
+  virtual bool Release(Cache::Handle* handle);
+  virtual void Erase(const Slice& key, uint32_t hash);
+  virtual void SetCapacity(size_t capacity);
+  virtual void SetStrictCapacityLimit(bool strict_capacity_limit);
+  virtual size_t GetUsage() const;
+  virtual size_t GetPinnedUsage() const;
+
+ private:
+  void LRU_Remove(LRUHandle* e);
+  void LRU_Append(LRUHandle* list, LRUHandle* e);
+  void Ref(LRUHandle* e);
+  // Returns true if the entry was deleted.
+  bool Unref(LRUHandle* e);
+  bool FinishErase(LRUHandle* e);
+  // Evict unpinned entries until "charge" more fits, or none is left.
+  void EvictFor(size_t charge);
+
+  size_t capacity_;
+  bool strict_capacity_limit_;
+
+  mutable std::mutex mutex_;
+  size_t usage_;
+  size_t pinned_usage_;
+  // Dummy heads of the lists, lru_.prev is the newest entry.
+  LRUHandle lru_;
+  LRUHandle in_use_;
+  LRUHandleTable table_;
+};
+
 class LRUCache : public ShardedCache {
  public:
   LRUCache(size_t capacity, int num_shard_bits, bool strict_capacity_limit,
            double high_pri_pool_ratio);
+  virtual ~LRUCache();
+
+  virtual const char* Name() const { return "LRUCache"; }
+  virtual CacheShard* GetShard(int shard);
+  virtual const CacheShard* GetShard(int shard) const;
+  virtual void* Value(Handle* handle);
+  virtual uint32_t GetHash(Handle* handle) const;
+
+ private:
+  LRUCacheShard* shards_;
 };
 
 } // namespace shannon
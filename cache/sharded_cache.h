@@ -12,11 +12,70 @@
 
 namespace shannon {
 
+// One shard of a ShardedCache, with its own lock and a share of the
+// capacity.  "hash" is the hash of the key the shard was chosen with.
+class CacheShard {
+ public:
+  CacheShard() {}
+  virtual ~CacheShard() {}
+
+  virtual Status Insert(const Slice& key, uint32_t hash, void* value,
+                        size_t charge,
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Handle** handle) = 0;
+  virtual Cache::Handle* Lookup(const Slice& key, uint32_t hash) = 0;
+  virtual bool Release(Cache::Handle* handle) = 0;
+  virtual void Erase(const Slice& key, uint32_t hash) = 0;
+  virtual void SetCapacity(size_t capacity) = 0;
+  virtual void SetStrictCapacityLimit(bool strict_capacity_limit) = 0;
+  virtual size_t GetUsage() const = 0;
+  virtual size_t GetPinnedUsage() const = 0;
+};
+
+// A cache split into 2^num_shard_bits shards by the top bits of the hash
+// of the key, so threads looking up different keys rarely share a lock.
 class ShardedCache : public Cache {
  public:
   ShardedCache(size_t capacity, int num_shard_bits, bool strict_capacity_limit);
+  virtual ~ShardedCache() {}
+
+  virtual CacheShard* GetShard(int shard) = 0;
+  virtual const CacheShard* GetShard(int shard) const = 0;
+  virtual void* Value(Handle* handle) = 0;
+  virtual uint32_t GetHash(Handle* handle) const = 0;
+
+  virtual Status Insert(const Slice& key, void* value, size_t charge,
+                        void (*deleter)(const Slice& key, void* value),
+                        Handle** handle = NULL);
+  virtual Handle* Lookup(const Slice& key);
+  virtual bool Release(Handle* handle);
+  virtual void Erase(const Slice& key);
+  virtual uint64_t NewId();
+  virtual size_t GetCapacity() const { return capacity_; }
+  virtual size_t GetUsage() const;
+  virtual size_t GetPinnedUsage() const;
+
+  int GetNumShardBits() const { return num_shard_bits_; }
+
+ private:
+  static inline uint32_t HashSlice(const Slice& s) {
+    return Hash(s.data(), s.size(), 0);
+  }
+
+  uint32_t Shard(uint32_t hash) const {
+    // Note, hash >> 32 yields hash in gcc, not the zero we expect!
+    return (num_shard_bits_ > 0) ? (hash >> (32 - num_shard_bits_)) : 0;
+  }
+
+  const int num_shard_bits_;
+  const size_t capacity_;
+  std::atomic<uint64_t> last_id_;
 };
 
+// Shard bits for a cache of "capacity" bytes: shards of at least 512KB,
+// at most 64 of them.
+extern int GetDefaultCacheShardBits(size_t capacity);
+
 }  // namespace shannon
 
 #endif  // SHARDED_CACHE_H_
@@ -14,16 +14,73 @@
 namespace shannon {
 
 class Cache;
+
+// Create a cache of "capacity" bytes with least-recently-used eviction.
+// The cache is split into 2^num_shard_bits shards by key hash, each with
+// its own lock; -1 picks a shard of at least 512KB, up to 64 shards.  With
+// strict_capacity_limit, Insert() fails when the pinned entries fill the
+// cache.  high_pri_pool_ratio is accepted for compatibility and ignored.
 extern std::shared_ptr<Cache> NewLRUCache(size_t capacity,
                                           int num_shard_bits = -1,
                                           bool strict_capacity_limit = false,
                                           double high_pri_pool_ratio = 0.0);
 
+// A map from keys to values with a bounded total charge, safe to use from
+// several threads.  Entries are pinned by the handles returned from
+// Insert() and Lookup() until they are released, evicted entries are
+// deleted when their last handle is released.  A custom cache is plugged
+// in by implementing this interface.
 class Cache {
  public:
-  Cache(size_t capacity) : cache_size_(capacity) {  }
+  // Opaque handle to an entry stored in the cache.
+  struct Handle {};
+
+  Cache() {}
+  virtual ~Cache() {}
+
+  virtual const char* Name() const = 0;
+
+  // Insert a mapping from key->value into the cache, charging "charge"
+  // against the capacity, and replacing an existing entry for key.  When
+  // the entry is no longer needed, deleter is passed the key and value.
+  // If handle is not NULL, it is set to a handle of the entry, which the
+  // caller must Release(); otherwise the entry is not pinned.  On failure,
+  // the deleter is called on the value at once.
+  virtual Status Insert(const Slice& key, void* value, size_t charge,
+                        void (*deleter)(const Slice& key, void* value),
+                        Handle** handle = NULL) = 0;
+
+  // A handle of the entry for key, which the caller must Release(), or
+  // NULL if there is none.
+  virtual Handle* Lookup(const Slice& key) = 0;
+
+  // Release a handle returned by Insert() or Lookup().  Returns true if
+  // the entry was deleted because it was the last reference to it.
+  virtual bool Release(Handle* handle) = 0;
+
+  // The value of the entry of a handle that is not released.
+  virtual void* Value(Handle* handle) = 0;
+
+  // Remove the entry for key, it is deleted once all its handles are
+  // released.
+  virtual void Erase(const Slice& key) = 0;
+
+  // A new numeric id, for clients sharing the cache to partition the key
+  // space, typically by prefixing their keys with it.
+  virtual uint64_t NewId() = 0;
+
+  virtual size_t GetCapacity() const = 0;
+
+  // Total charge of the entries in the cache.
+  virtual size_t GetUsage() const = 0;
+
+  // Total charge of the entries pinned by a handle.
+  virtual size_t GetPinnedUsage() const = 0;
+
  private:
-  size_t cache_size_;
+  // No copying allowed
+  Cache(const Cache&);
+  void operator=(const Cache&);
 };
 
 }  // namespace shannon
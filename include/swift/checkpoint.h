@@ -0,0 +1,65 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A checkpoint is a consistent point-in-time image of a database that is
+// kept by the device itself, so creating one is a metadata operation and
+// does not copy any data.  It is identified by the device timestamp it
+// was taken at, and it stays alive until it is released, also across a
+// reopen of the database.
+
+#ifndef SHANNON_DB_INCLUDE_CHECKPOINT_H_
+#define SHANNON_DB_INCLUDE_CHECKPOINT_H_
+
+#include <stdint.h>
+#include <vector>
+#include "swift/shannon_db.h"
+
+namespace shannon {
+
+class Checkpoint {
+ public:
+  // Creates a Checkpoint object to be used for managing the checkpoints
+  // of "db".  The caller owns *checkpoint_ptr, "db" must outlive it.
+  static Status Create(DB* db, Checkpoint** checkpoint_ptr);
+
+  // Take a new checkpoint of the whole database and store its timestamp
+  // in *timestamp.  Fails with Status::Busy() once the device limit of
+  // checkpoints per database is reached.
+  virtual Status CreateCheckpoint(uint64_t* timestamp);
+
+  // Store the timestamps of the live checkpoints in *timestamps,
+  // oldest first.
+  virtual Status ListCheckpoints(std::vector<uint64_t>* timestamps);
+
+  // Release the checkpoint taken at "timestamp".
+  virtual Status ReleaseCheckpoint(uint64_t timestamp);
+
+  // Return a read-only view of the database as of the checkpoint taken at
+  // "timestamp".  Set it as ReadOptions::snapshot to Get(), Read() or
+  // iterate the checkpoint.  Release it with ReleaseView(); it must not be
+  // passed to DB::ReleaseSnapshot().  The view does not pin the checkpoint.
+  virtual Status GetView(uint64_t timestamp, const Snapshot** view);
+  virtual void ReleaseView(const Snapshot* view);
+
+  // Return an iterator over "column_family" as of the checkpoint taken at
+  // "timestamp".  options.snapshot is ignored.
+  virtual Status NewIterator(const ReadOptions& options,
+                             ColumnFamilyHandle* column_family,
+                             uint64_t timestamp, Iterator** iterator);
+
+  virtual ~Checkpoint() {}
+
+ protected:
+  explicit Checkpoint(DB* db) : db_(db) {}
+  DB* db_;
+
+ private:
+  // No copying allowed
+  Checkpoint(const Checkpoint&);
+  void operator=(const Checkpoint&);
+};
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_INCLUDE_CHECKPOINT_H_
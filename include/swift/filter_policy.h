@@ -8,6 +8,26 @@ namespace shannon {
 
 class Slice;
 
+// Builds a filter over all the keys of a table, stored in a RocksDB
+// "fullfilter." block.
+class FilterBitsBuilder {
+public:
+  virtual ~FilterBitsBuilder() {}
+
+  virtual void AddKey(const Slice &key) = 0;
+
+  // Append the filter of the keys added so far to *dst.
+  virtual void Finish(std::string *dst) = 0;
+};
+
+// Reads a filter made by a FilterBitsBuilder.
+class FilterBitsReader {
+public:
+  virtual ~FilterBitsReader() {}
+
+  virtual bool MayMatch(const Slice &key) = 0;
+};
+
 class FilterPolicy {
 public:
   virtual ~FilterPolicy();
@@ -18,8 +38,23 @@ public:
                             std::string *dst) const = 0;
 
   virtual bool KeyMayMatch(const Slice &key, const Slice &filter) const = 0;
+
+  // A policy that builds one filter for the whole table returns a new
+  // builder here; the table then stores no per-block filters.  NULL means
+  // CreateFilter() is called for every 2KB of data.
+  virtual FilterBitsBuilder *GetFilterBitsBuilder() const { return NULL; }
+
+  // A new reader of "contents", a filter made by GetFilterBitsBuilder().
+  // "contents" must outlive the reader.
+  virtual FilterBitsReader *GetFilterBitsReader(const Slice &) const {
+    return NULL;
+  }
 };
 
+// With use_block_based_builder = false the filter covers the whole table
+// and every probe of a key falls in one 64-byte cache line, as RocksDB's
+// full filter of format_version < 5, which RocksDB reads under the name
+// "rocksdb.BuiltinBloomFilter".
 const FilterPolicy *NewBloomFilterPolicy(int bits_per_key,
                                         bool use_block_based_builder = true);
 }
@@ -1,5 +1,7 @@
 #ifndef _BINLOG_ITER_H_
 #define _BINLOG_ITER_H_
+#include <string>
+#include <vector>
 #include "swift/shannon_db.h"
 
 namespace shannon {
@@ -12,6 +14,46 @@ enum LogOpType {
   DB_DELETE     = 4
 };
 
+struct LogRecord {
+  LogOpType optype;
+  int32_t db;
+  int32_t cf;
+  uint64_t timestamp;
+  Slice key;
+  Slice value;
+};
+
+// Log records read by LogIterator::NextBatch(), one after the other in a
+// single buffer, which the next NextBatch() reuses.
+class LogRecordBatch {
+ public:
+  LogRecordBatch() : data_size_(0) {}
+
+  size_t Count() const { return offsets_.size(); }
+  // Bytes of the keys and values of the records.
+  size_t DataSize() const { return data_size_; }
+  // The encoded records: per record one byte of optype, one of db, one of
+  // cf, a fixed64 timestamp, a varint32 key length and the key, and a
+  // varint32 value length and the value.
+  const std::string& Data() const { return rep_; }
+
+  // REQUIRES: i < Count().  key and value point into Data(), they are
+  // valid until the batch is cleared or refilled.
+  LogRecord Get(size_t i) const;
+
+  // Empty the batch, keeping its memory.
+  void Clear();
+
+ private:
+  friend class LogIteratorImpl;
+  void Add(LogOpType optype, int32_t db, int32_t cf, uint64_t timestamp,
+           const Slice& key, const Slice& value);
+
+  std::string rep_;
+  std::vector<size_t> offsets_;
+  size_t data_size_;
+};
+
 class LogIterator {
  public:
   LogIterator() {};
@@ -32,9 +74,26 @@ class LogIterator {
   virtual uint64_t timestamp() = 0;
   virtual int32_t db() = 0;
   virtual int32_t cf() = 0;
+
+  // Replace the contents of batch with up to max_records records, and up
+  // to max_bytes of keys and values though always one record if there is
+  // any, read from the one Next() would move to.  The iterator is left at
+  // the last record of the batch, unless the batch stopped short of a
+  // record it read already, for max_bytes or an error: then it is left at
+  // that record and the next NextBatch() starts with it.  Reaching the end
+  // of the log is not an error, the batch holds the records up to it,
+  // maybe none, and the next call looks for new ones.  Returns the error
+  // that stopped the batch only if it holds no record, status() has it in
+  // any case.
+  virtual Status NextBatch(size_t max_records, size_t max_bytes,
+                           LogRecordBatch* batch) = 0;
 };
 
 Status NewLogIterator(std::string& device, uint64_t timestamp, LogIterator **);
+// Same as above, and record log iterator metrics into "statistics"
+// (may be NULL).
+Status NewLogIterator(std::string& device, uint64_t timestamp, LogIterator **,
+                      Statistics* statistics);
 
 } // namespace shannon
 
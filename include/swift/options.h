@@ -10,6 +10,7 @@
 #include "swift/comparator.h"
 #include "swift/table.h"
 #include "swift/advanced_options.h"
+#include "swift/statistics.h"
 
 namespace shannon {
 
@@ -43,9 +44,45 @@ struct DBOptions {
 //build_sst
   size_t block_size = 4096;
   int block_restart_interval = 16;
+  // Index of a built SST file.  kTwoLevelIndexSearch splits it into
+  // partitions of about metadata_block_size bytes under a top level index,
+  // so a reader walking the file holds one partition at a time.
+  // kHashSearch writes the binary search index and marks it as a hash
+  // index; without a prefix extractor there are no prefix meta blocks and
+  // RocksDB searches it as a binary search index.
+  IndexType index_type = kBinarySearch;
+  size_t metadata_block_size = 4096;
+  // Restart interval of index blocks.  Above 1, with
+  // index_value_delta_encoding, the entries between restart points only
+  // store the size difference with the previous block handle, as RocksDB
+  // format_version 4 does.  SstFileReader reads neither these nor
+  // partitioned indexes.
+  int index_block_restart_interval = 1;
+  bool index_value_delta_encoding = false;
   size_t max_file_size = 2 * 1024 * 1024;
+  // Number of threads compressing the data blocks of an SST file while it
+  // is built.  1 compresses each block inline before writing it.
+  int compression_parallel_threads = 1;
+  // Maximum number of data blocks waiting to be compressed or written when
+  // compression_parallel_threads > 1; caps the memory used by the builder.
+  // 0 means twice compression_parallel_threads.
+  int compression_max_pending_blocks = 0;
+  // With kZSTD compression, the first compression_dict_sample_blocks data
+  // blocks of an SST file are held back to train a dictionary of up to
+  // compression_max_dict_bytes, which is stored in the file as RocksDB
+  // does and used for all its data blocks.  Pays off for small, similar
+  // values.  0 disables dictionaries.
+  uint32_t compression_max_dict_bytes = 0;
+  int compression_dict_sample_blocks = 64;
+  // Checksum of the blocks of a built SST file: kCRC32c, kxxHash or kXXH3,
+  // which is the cheapest to compute.  Readers find it in the footer.
+  ChecksumType checksum = kCRC32c;
 //NULL
   FilterPolicy* filter_policy = NULL;
+  // Cache of the uncompressed blocks SstFileReader reads, which may be
+  // shared by several readers.  If NULL, blocks are read from the file
+  // each time.
+  std::shared_ptr<Cache> block_cache = nullptr;
 
   size_t target_file_size_base = 64 * 1048576;
   int max_background_flushes = -1;
@@ -56,6 +93,9 @@ struct DBOptions {
   int level_compaction_dynamic_level_bytes = -1;
   CompressionType compression = kNoCompression;
   Env* env = Env::Default();
+  // If non-null, then we should collect metrics about database operations
+  // Default: nullptr
+  std::shared_ptr<Statistics> statistics = nullptr;
   DBOptions(){}
 };
 struct AdvancedColumnFamilyOptions {
@@ -66,6 +106,24 @@ struct AdvancedColumnFamilyOptions {
 struct ColumnFamilyOptions : public AdvancedColumnFamilyOptions {
   const Comparator* inner_comparator = BytewiseComparator();
   std::shared_ptr<CompactionFilterFactory> compaction_filter_factory = nullptr;
+  // If not 0, the Puts and Deletes of the column family with sync == false
+  // are kept in a write-back buffer in memory, and written to the device
+  // in WriteBatchNonatomic batches once the buffer holds
+  // write_back_buffer_size bytes of keys and values.  Get(), KeyExist() and
+  // iterators without a snapshot read the buffer before the device.
+  //
+  // Durability: buffered writes are lost if the process dies before they
+  // are written to the device, and a batch of them is not written
+  // atomically.  They are written before a write with sync == true to the
+  // column family, by FlushWriteBackBuffer(), GetSnapshot() and
+  // Checkpoint::CreateCheckpoint(), before the writes and reads that do not
+  // use the buffer, e.g. Write(), Read() or GetAsync(), before an ingest of
+  // external files, and when the DB is deleted.
+  size_t write_back_buffer_size = 0;
+  // Buffered writes older than this are written by the next buffered
+  // write to the column family.  There is no background flush, so an idle
+  // buffer is only written as described above.  0 disables the age check.
+  uint64_t write_back_flush_interval_ms = 100;
   ColumnFamilyOptions() { }
 };
 
@@ -121,6 +179,34 @@ struct WriteOptions {
         fill_cache(true) {
   }
 };
+// Options that control the ingestion of external SST files
+struct IngestExternalFileOptions {
+  // Number of threads verifying, decompressing and decoding the data
+  // blocks of a file, ahead of the batches written to the device.
+  // 0 uses one thread per core, 1 decodes on the calling thread.
+  int decode_threads = 0;
+  // Maximum number of decoded data blocks waiting to be written; caps the
+  // memory used by a file.  0 means 4 per decode thread.
+  int max_pending_blocks = 0;
+  // Check the checksum of every block read from the files.
+  bool verify_checksums = true;
+  // Number of files IngestExternalFiles() ingests at the same time.
+  // 0 uses one thread per core.  When decode_threads is 0, the cores are
+  // shared among the files being ingested.
+  int max_files_in_parallel = 0;
+  // Stop ingesting the files not started yet after the first failure.
+  // Otherwise every file is tried and the failures are reported per file.
+  bool fail_fast = true;
+  // Merge the files of each column family by internal key and write only
+  // the newest version or tombstone of every user key, instead of writing
+  // every file in full.  For overlapping files, e.g. from several levels.
+  // Each column family is merged by one thread, max_files_in_parallel
+  // column families at a time, and decode_threads is not used.  The keys
+  // must be ordered bytewise: files whose properties name another
+  // comparator are NotSupported.
+  bool merge_files = false;
+};
+
 struct CompactRangeOptions {
   bool exclusive_manual_compaction = true;
   bool change_level = false;
@@ -0,0 +1,98 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef SHANNON_DB_INCLUDE_PERF_CONTEXT_H_
+#define SHANNON_DB_INCLUDE_PERF_CONTEXT_H_
+
+#include <stdint.h>
+#include <string>
+
+namespace shannon {
+
+// How much per-thread cost accounting is collected.  The level is a
+// thread-local setting, so a caller can turn it on around a single
+// request and off again without affecting other threads.
+enum PerfLevel : unsigned char {
+  kUninitialized = 0,  // unknown setting
+  kDisable = 1,        // disable perf stats
+  kEnableCount = 2,    // enable only counters
+  kEnableTime = 3,     // enable counters and kernel wall time
+  kOutOfBounds = 4     // N.B. Must always be the last value!
+};
+
+// Set the perf stats level for the current thread.
+void SetPerfLevel(PerfLevel level);
+
+// Get the perf stats level of the current thread.
+PerfLevel GetPerfLevel();
+
+// The ioctl commands accounted separately in PerfContext.
+enum PerfIoctlType : unsigned char {
+  kPerfIoctlGet = 0,
+  kPerfIoctlPut,
+  kPerfIoctlDelete,
+  kPerfIoctlKeyStatus,
+  kPerfIoctlReadBatch,
+  kPerfIoctlWriteBatch,
+  kPerfIoctlWriteBatchNonatomic,
+  kPerfIoctlSnapshot,
+  kPerfIoctlIterCreate,
+  kPerfIoctlIterDestroy,
+  kPerfIoctlIterSeek,
+  kPerfIoctlIterMove,
+  kPerfIoctlIterGet,
+  kPerfIoctlLogIterMove,
+  kPerfIoctlLogIterGet,
+  kPerfIoctlStatus,
+  kPerfIoctlAioEvents,
+  kPerfIoctlOther,
+  kPerfIoctlMax  // N.B. Must always be the last value!
+};
+
+// A thread local context for gathering performance counters efficiently
+// and transparently.  Use SetPerfLevel(kEnableTime) to enable time stats.
+struct PerfContext {
+  PerfContext() { Reset(); }
+
+  void Reset();  // reset all performance counters to zero
+
+  std::string ToString(bool exclude_zero_counters = false) const;
+
+  // number of ioctls issued, per command
+  uint64_t ioctl_count[kPerfIoctlMax];
+  // wall time spent inside the kernel, per command (kEnableTime only)
+  uint64_t ioctl_nanos[kPerfIoctlMax];
+  // total wall time spent inside ioctl, all commands (kEnableTime only)
+  uint64_t ioctl_time;
+
+  // bytes copied from kernel buffers into caller visible memory
+  uint64_t bytes_copied;
+  // number and total size of heap allocations made on the request path
+  uint64_t heap_alloc_count;
+  uint64_t heap_alloc_bytes;
+
+  // number of extra READ_BATCH rounds issued by Read() for values that
+  // did not fit the first buffer, and how many keys those rounds fetched
+  uint64_t read_reread_count;
+  uint64_t read_reread_keys;
+
+  // iterator steps
+  uint64_t iter_seek_count;
+  uint64_t iter_next_count;
+  uint64_t iter_prev_count;
+  uint64_t iter_get_key_count;
+  uint64_t iter_get_value_count;
+  uint64_t log_iter_next_count;
+};
+
+// Get the thread-local PerfContext object pointer.
+// If defined(NPERF_CONTEXT), then the pointer is not thread-local.
+PerfContext* get_perf_context();
+
+// Name of a PerfIoctlType, as printed by PerfContext::ToString().
+const char* PerfIoctlName(PerfIoctlType type);
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_INCLUDE_PERF_CONTEXT_H_
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <map>
 #include "swift/options.h"
 #include "swift/write_batch.h"
 #include "swift/read_batch.h"
@@ -31,6 +32,22 @@ public:
 struct Options;
 struct DBOptions;
 
+// Outcome of ingesting one file with IngestExternalFiles().
+struct IngestExternalFileReport {
+  std::string filename;
+  // Column family the keys were written to.
+  std::string cf_name;
+  Status status;
+  uint64_t keys_put = 0;
+  uint64_t keys_deleted = 0;
+  // Versions not written because a newer version or tombstone of the same
+  // key was found, with IngestExternalFileOptions::merge_files.
+  uint64_t keys_dropped = 0;
+  // Size of the file.
+  uint64_t bytes = 0;
+  uint64_t micros = 0;
+};
+
 class DB {
  public:
   // Open the database with the specified "name".
@@ -102,6 +119,18 @@ class DB {
   // Analyze sst file and write kv to SSD
   // kvs will be writen to the column family name of "default".
   virtual Status IngestExternFile(char *sst_filename, int verify) = 0;
+  // Ingest several sst files, up to options.max_files_in_parallel at a
+  // time.  Each file goes to the column family named in its properties
+  // block, looked up in handles; if handles is NULL every file goes to
+  // "default".  One report per file is stored in *reports, in the order
+  // of files, if reports is not NULL.  Returns the first failure in the
+  // order of files, files skipped after it under fail_fast are Aborted.
+  // With options.merge_files overlapping files are merged and only the
+  // newest version of each key is written, see IngestExternalFileOptions.
+  virtual Status IngestExternalFiles(const std::vector<std::string>& files,
+                   const IngestExternalFileOptions& options,
+                   std::vector<ColumnFamilyHandle*>* handles,
+                   std::vector<IngestExternalFileReport>* reports) = 0;
 
   virtual Status BuildTable(const std::string& dirname, std::vector<ColumnFamilyHandle*> &handles, std::vector<Iterator*> &iterators) = 0;
   virtual Status BuildSstFile(const std::string& dirname, const std::string& filename, ColumnFamilyHandle *handle, Iterator *iter, uint64_t file_size) = 0;
@@ -165,6 +194,11 @@ class DB {
                const std::vector<ColumnFamilyHandle*>& column_families,
                std::vector<Iterator*>* iterators) = 0;
 
+  // Write the Puts and Deletes held in the write-back buffer of
+  // column_family to the device, see
+  // ColumnFamilyOptions::write_back_buffer_size.  OK if it has no buffer.
+  virtual Status FlushWriteBackBuffer(ColumnFamilyHandle* column_family) = 0;
+
   virtual ColumnFamilyHandle* DefaultColumnFamily() const = 0;
 
   virtual Status GetAsync(const ReadOptions& options, const Slice& key,
@@ -187,6 +221,48 @@ class DB {
   virtual Status PollCompletion(int32_t* num_events,
                                 const uint64_t timeout_us) = 0;
 
+  // Partial value access.  The device transfers only the requested part of
+  // the value instead of the whole value.
+  //
+  // GetRange() reads up to "len" bytes of the value of "key" starting at
+  // byte "offset" into "buf", and stores the number of bytes read in
+  // "*read_len"; it is less than "len" when the value ends earlier.  Any
+  // offset is accepted, but offsets that are a multiple of 4KB avoid a
+  // bounce buffer.
+  virtual Status GetRange(const ReadOptions& options, const Slice& key,
+                          uint64_t offset, size_t len, char* buf,
+                          size_t* read_len) {
+    return GetRange(options, DefaultColumnFamily(), key, offset, len, buf,
+                    read_len);
+  }
+  virtual Status GetRange(const ReadOptions& options,
+                          ColumnFamilyHandle* column_family, const Slice& key,
+                          uint64_t offset, size_t len, char* buf,
+                          size_t* read_len) = 0;
+
+  // PutRange() overwrites the value of "key" from byte "offset" with
+  // "data", growing the value if needed.  "offset" must be a multiple of
+  // 4KB, since the device cannot update part of a 4KB unit in place.
+  virtual Status PutRange(const WriteOptions& options, const Slice& key,
+                          uint64_t offset, const Slice& data) {
+    return PutRange(options, DefaultColumnFamily(), key, offset, data);
+  }
+  virtual Status PutRange(const WriteOptions& options,
+                          ColumnFamilyHandle* column_family, const Slice& key,
+                          uint64_t offset, const Slice& data) = 0;
+
+  // Async variants of GetRange()/PutRange(), completed by PollCompletion().
+  // Both require "offset" to be a multiple of 4KB.
+  virtual Status GetRangeAsync(const ReadOptions& options,
+                               ColumnFamilyHandle* column_family,
+                               const Slice& key, uint64_t offset,
+                               char* val_buf, const int32_t buf_len,
+                               int32_t* val_len, CallBackPtr* cb) = 0;
+  virtual Status PutRangeAsync(const WriteOptions& options,
+                               ColumnFamilyHandle* column_family,
+                               const Slice& key, uint64_t offset,
+                               const Slice& data, CallBackPtr* cb) = 0;
+
   static Status ListColumnFamilies(const DBOptions& db_options,
             const std::string& name,
             const std::string& device,
@@ -200,10 +276,55 @@ class DB {
           const Slice* begin, const Slice* end) {
       return CompactRange(options, DefaultColumnFamily(), begin, end);
   }
+  // Valid property names include:
+  struct Properties {
+    //  "shannon.stats" - returns a multi-line string of the tickers and
+    //      histograms collected by DBOptions::statistics.
+    static const std::string kStats;
+
+    //  "shannon.cur-size-all-mem-tables" - returns the cache size of the
+    //      column family.
+    static const std::string kCurSizeAllMemTables;
+
+    //  "shannon.estimate-num-keys" - returns the number of keys in the
+    //      column family.
+    static const std::string kEstimateNumKeys;
+
+    //  "shannon.total-disk-usage" / "shannon.estimate-disk-usage" - return
+    //      the (estimated) disk space used by the column family, in bytes.
+    static const std::string kTotalDiskUsage;
+    static const std::string kEstimateDiskUsage;
+
+    //  "shannon.cache-usage" - returns the cache in use by the column family.
+    static const std::string kCacheUsage;
+
+    //  "shannon.num-checkpoints" - returns the number of checkpoints of the
+    //      database.
+    static const std::string kNumCheckpoints;
+
+    //  "shannon.device-status" - map property with the device counters:
+    //      host read/write bandwidth (KB/s), IOPS and latency (us), write
+    //      amplification, GC/WL bandwidth, capacity and disk usage.  Each
+    //      entry "<name>" is also a property "shannon.device.<name>".
+    static const std::string kDeviceStatus;
+
+    //  "shannon.db-status" - map property with the database key count,
+    //      disk and cache usage.  Each entry "<name>" is also a property
+    //      "shannon.db.<name>".
+    static const std::string kDBStatus;
+
+    //  "shannon.cf-status" - map property with the same counters for one
+    //      column family.  Each entry "<name>" is also a property
+    //      "shannon.cf.<name>".
+    static const std::string kCFStatus;
+  };
+
   // DB implementations can export properties about their state via this method.
   // If "property" is a valid property understood by this DB implementation (see
   // Properties struct above for valid options), fills "*value" with its current
   // value and returns true. Otherwise, returns false.
+  // Names not listed above are passed to the device, which answers e.g.
+  // "shannon.name", "shannon.version" and "shannon.capacity".
   virtual bool GetProperty(ColumnFamilyHandle* column_family,
                             const Slice& property, std::string* value) = 0;
 
@@ -211,6 +332,27 @@ class DB {
       return GetProperty(DefaultColumnFamily(), property, value);
   }
 
+  // Same as GetProperty(), but for the map properties "shannon.device-status",
+  // "shannon.db-status" and "shannon.cf-status".  All counters are read with
+  // one ioctl, so the values are consistent with each other.
+  virtual bool GetMapProperty(ColumnFamilyHandle* column_family,
+                              const Slice& property,
+                              std::map<std::string, std::string>* value) = 0;
+
+  virtual bool GetMapProperty(const Slice& property,
+                              std::map<std::string, std::string>* value) {
+      return GetMapProperty(DefaultColumnFamily(), property, value);
+  }
+
+  // Similar to GetProperty(), but only works for properties whose value is
+  // an integer, and returns it as uint64_t.
+  virtual bool GetIntProperty(ColumnFamilyHandle* column_family,
+                              const Slice& property, uint64_t* value) = 0;
+
+  virtual bool GetIntProperty(const Slice& property, uint64_t* value) {
+      return GetIntProperty(DefaultColumnFamily(), property, value);
+  }
+
   virtual SequenceNumber GetLatestSequenceNumber() const = 0;
 
   virtual Status DisableFileDeletions() = 0;
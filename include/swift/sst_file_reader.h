@@ -0,0 +1,64 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef SHANNON_DB_INCLUDE_SST_FILE_READER_H_
+#define SHANNON_DB_INCLUDE_SST_FILE_READER_H_
+
+#include <stdint.h>
+#include <string>
+#include "swift/iterator.h"
+#include "swift/options.h"
+#include "swift/slice.h"
+#include "swift/status.h"
+
+namespace shannon {
+
+// Reads an SST file in the block based format, as BuildSstFile() and
+// BuildTable() write it or RocksDB does, without a DB.  Keys are user keys
+// with the newest version in the file of each: deleted keys are not found
+// and the sequence number of a key is its timestamp.
+//
+// Options used: inner_comparator, the order of the user keys;
+// filter_policy, to skip the blocks without the key when the file has a
+// filter of that policy; block_cache, to keep uncompressed blocks across
+// reads, which may be shared with other readers.
+//
+// A reader may be used by several threads at once after Open().
+class SstFileReader {
+ public:
+  explicit SstFileReader(const Options& options);
+  ~SstFileReader();
+
+  // Open the file at file_path and read its footer, index and filter.
+  // Partitioned indexes are not supported, a hash index is binary searched.
+  Status Open(const std::string& file_path);
+
+  // Store the value of the newest version of key in *value.  Returns
+  // NotFound if the file has no version of key or the newest one is a
+  // deletion.  If timestamp is not NULL, the sequence number of the
+  // version is stored in it.
+  Status Get(const ReadOptions& options, const Slice& key, std::string* value,
+             uint64_t* timestamp = NULL);
+
+  // An iterator over the live keys of the file, which must be deleted
+  // before the reader.  SetPrefix() limits it to the keys starting with
+  // the prefix.
+  Iterator* NewIterator(const ReadOptions& options);
+
+  // Verify the checksums of all the blocks of the file.
+  Status VerifyChecksum();
+
+ private:
+  friend class SstFileIterator;
+  struct Rep;
+  Rep* rep_;
+
+  // No copying allowed
+  SstFileReader(const SstFileReader&);
+  void operator=(const SstFileReader&);
+};
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_INCLUDE_SST_FILE_READER_H_
@@ -0,0 +1,148 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef SHANNON_DB_INCLUDE_STATISTICS_H_
+#define SHANNON_DB_INCLUDE_STATISTICS_H_
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace shannon {
+
+/**
+ * Keep adding ticker's here.
+ *  1. Any ticker should be added before TICKER_ENUM_MAX.
+ *  2. Add a readable string in TickersNameMap below for the newly added ticker.
+ */
+enum Tickers : uint32_t {
+  // Number of keys written to the database via Put()/PutAsync().
+  NUMBER_KEYS_WRITTEN = 0,
+  // Number of keys deleted via Delete()/DeleteAsync().
+  NUMBER_KEYS_DELETED,
+  // Number of keys found by Get().
+  NUMBER_KEYS_READ,
+  // Number of keys Get() or Read() did not find.
+  NUMBER_KEYS_NOT_FOUND,
+  // Bytes of keys and values handed to Put().
+  BYTES_WRITTEN,
+  // Bytes of values returned by Get() and Read().
+  BYTES_READ,
+  // Number of Write()/WriteNonatomic() calls and the keys they carried.
+  NUMBER_WRITE_BATCH,
+  NUMBER_WRITE_BATCH_NONATOMIC,
+  NUMBER_WRITE_BATCH_KEYS,
+  // Number of Read() calls, keys requested and extra re-read rounds.
+  NUMBER_READ_BATCH,
+  NUMBER_READ_BATCH_KEYS,
+  NUMBER_READ_BATCH_REREAD,
+  // Iterator calls and bytes returned by key()/value().
+  NUMBER_DB_SEEK,
+  NUMBER_DB_NEXT,
+  NUMBER_DB_PREV,
+  ITER_BYTES_READ,
+  // Log iterator calls and bytes returned by key()/value().
+  NUMBER_LOG_ITER_NEXT,
+  LOG_ITER_BYTES_READ,
+  // Asynchronous requests submitted, completed and completed with error.
+  NUMBER_AIO_SUBMITTED,
+  NUMBER_AIO_COMPLETED,
+  NUMBER_AIO_FAILED,
+  // Number of ioctls that returned an error other than "not found".
+  NUMBER_IOCTL_ERRORS,
+  // SST export: entries and files written, bytes read from the device and
+  // written to the files, and the busy time of each pipeline stage.
+  SST_EXPORT_KEYS,
+  SST_EXPORT_FILES,
+  SST_EXPORT_READ_BYTES,
+  SST_EXPORT_WRITE_BYTES,
+  SST_EXPORT_READ_MICROS,
+  SST_EXPORT_ENCODE_MICROS,
+  SST_EXPORT_WRITE_MICROS,
+  TICKER_ENUM_MAX
+};
+
+// The order of items listed in Tickers should be the same as
+// the order listed in TickersNameMap
+extern const std::vector<std::pair<Tickers, std::string>> TickersNameMap;
+
+/**
+ * Keep adding histogram's here.
+ * Any histogram should have value less than HISTOGRAM_ENUM_MAX
+ * Add a new Histogram by assigning it the current value of HISTOGRAM_ENUM_MAX
+ * Add a string representation in HistogramsNameMap below
+ */
+enum Histograms : uint32_t {
+  // Latencies, in microseconds.
+  DB_GET = 0,
+  DB_PUT,
+  DB_DELETE_KEY,
+  DB_WRITE,
+  DB_WRITE_NONATOMIC,
+  DB_READ,
+  DB_KEY_EXIST,
+  DB_ITER_SEEK,
+  DB_ITER_NEXT,
+  DB_ITER_PREV,
+  DB_ITER_GET,
+  LOG_ITER_NEXT,
+  LOG_ITER_GET,
+  // Time from an async submit to its callback, in microseconds.
+  AIO_SUBMIT_TO_COMPLETION,
+  // Number of events reaped by one PollCompletion() call.
+  POLL_COMPLETION_BATCH_SIZE,
+  // Partial value access latencies, in microseconds.
+  DB_GET_RANGE,
+  DB_PUT_RANGE,
+  HISTOGRAM_ENUM_MAX
+};
+
+extern const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap;
+
+struct HistogramData {
+  double median;
+  double percentile95;
+  double percentile99;
+  double percentile999;
+  double average;
+  double standard_deviation;
+  double max = 0.0;
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  double min = 0.0;
+};
+
+// Analyze the performance of a db by setting DBOptions::statistics.
+// All methods are thread safe.
+class Statistics {
+ public:
+  virtual ~Statistics() {}
+
+  virtual uint64_t getTickerCount(uint32_t tickerType) const = 0;
+  virtual void histogramData(uint32_t type,
+                             HistogramData* const data) const = 0;
+  virtual std::string getHistogramString(uint32_t) const { return ""; }
+  virtual void recordTick(uint32_t tickerType, uint64_t count = 1) = 0;
+  virtual void setTickerCount(uint32_t tickerType, uint64_t count) = 0;
+  virtual uint64_t getAndResetTickerCount(uint32_t tickerType) = 0;
+  virtual void measureTime(uint32_t histogramType, uint64_t time) = 0;
+
+  // Resets all ticker and histogram stats
+  virtual void Reset() = 0;
+
+  // String representation of the statistic object.
+  virtual std::string ToString() const {
+    // Do nothing by default
+    return std::string("ToString(): not implemented");
+  }
+};
+
+// Create a concrete DBStatistics object
+std::shared_ptr<Statistics> CreateDBStatistics();
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_INCLUDE_STATISTICS_H_
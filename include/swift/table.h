@@ -25,6 +25,8 @@ enum ChecksumType : char {
   kNoChecksum = 0x0,
   kCRC32c = 0x1,
   kxxHash = 0x2,
+  // 0x3 is xxHash64 in RocksDB, not supported here.
+  kXXH3 = 0x4,
 };
 
 // The index type that will be used for this table.
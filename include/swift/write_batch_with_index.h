@@ -7,6 +7,7 @@
 #include <string>
 #include <linux/types.h>
 #include <list>
+#include <string.h>
 #include "swift/comparator.h"
 #include "swift/iterator.h"
 #include "swift/slice.h"
@@ -90,6 +91,8 @@ class WriteBatchWithIndex : public WriteBatch {
   using WriteBatch::Clear;
   void Clear();
   int Count() const;
+  // Memory used by the index of the batch, not counting the batch itself.
+  size_t GetIndexMemoryUsage() const;
   WBWIIterator* NewIterator();
   WBWIIterator* NewIterator(ColumnFamilyHandle* column_family);
 
@@ -97,6 +100,23 @@ class WriteBatchWithIndex : public WriteBatch {
                                 Iterator* base_iterator);
   // default column family
   Iterator* NewIteratorWithBase(Iterator* base_iterator);
+
+  // Read the newest write of key in the batch, without the DB.  Returns
+  // OK and the value if it is a Put, NotFound if it is a Delete or the
+  // batch has no write of key.
+  Status GetFromBatch(ColumnFamilyHandle* column_family, const Slice& key,
+                      std::string* value);
+  // default column family
+  Status GetFromBatch(const Slice& key, std::string* value);
+
+  // Read key as db would after the batch is written: from the batch if it
+  // has a write of key, deletes included, else with a single db->Get().
+  Status GetFromBatchAndDB(DB* db, const ReadOptions& read_options,
+                           ColumnFamilyHandle* column_family,
+                           const Slice& key, std::string* value);
+  // default column family
+  Status GetFromBatchAndDB(DB* db, const ReadOptions& read_options,
+                           const Slice& key, std::string* value);
  private:
   size_t SubBatchCnt();
   struct Rep;
@@ -105,11 +125,13 @@ class WriteBatchWithIndex : public WriteBatch {
 
 const size_t kMaxSizet = UINT64_MAX;
 struct WriteBatchIndexEntry {
-  WriteBatchIndexEntry(size_t o, uint32_t c, size_t ko, size_t ksz)
+  WriteBatchIndexEntry(size_t o, uint32_t c, size_t ko, size_t ksz,
+                       uint64_t kp)
       : offset(o),
         column_family(c),
         key_offset(ko),
         key_size(ksz),
+        key_prefix(kp),
         search_key(nullptr) {}
   WriteBatchIndexEntry(const Slice* _search_key, uint32_t _column_family,
                        bool is_forward_direction, bool is_seek_to_first)
@@ -117,12 +139,25 @@ struct WriteBatchIndexEntry {
         column_family(_column_family),
         key_offset(0),
         key_size(is_seek_to_first ? kFlagMinInCf : 0),
+        key_prefix(_search_key != nullptr ? KeyPrefix(*_search_key) : 0),
         search_key(_search_key) {
     assert(_search_key != nullptr || is_seek_to_first);
   }
 
   static const size_t kFlagMinInCf = kMaxSizet;
 
+  // The first 8 bytes of key, zero padded, as a big-endian integer: two
+  // prefixes compare as the bytewise order of the keys does, keys with an
+  // equal prefix need their whole key compared.
+  static uint64_t KeyPrefix(const Slice& key) {
+    uint64_t prefix = 0;
+    memcpy(&prefix, key.data(), key.size() < 8 ? key.size() : 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    prefix = __builtin_bswap64(prefix);
+#endif
+    return prefix;
+  }
+
   bool is_min_in_cf() const {
     assert(key_size != kFlagMinInCf ||
            (key_offset == 0 && search_key == nullptr));
@@ -132,6 +167,8 @@ struct WriteBatchIndexEntry {
   uint32_t column_family;  // c1olumn family of the entry.
   size_t key_offset;       // offset of the key in write batch's string buffer.
   size_t key_size;         // size of the key. kFlagMinInCf indicates
+  uint64_t key_prefix;     // KeyPrefix() of the key, kept with the entry so
+                           // most compares do not read the write batch.
   const Slice* search_key;  // if not null, instead of reading keys from
 };
 
@@ -146,7 +183,9 @@ class WriteBatchEntryComparator {
  public:
   WriteBatchEntryComparator(const Comparator* _default_comparator,
                             WriteBatch* write_batch)
-      : default_comparator_(_default_comparator), write_batch_(write_batch) {}
+      : default_comparator_(_default_comparator),
+        bytewise_(_default_comparator == BytewiseComparator()),
+        write_batch_(write_batch) {}
   int operator()(const WriteBatchIndexEntry* entry1,
                  const WriteBatchIndexEntry* entry2) const;
 
@@ -159,12 +198,18 @@ class WriteBatchEntryComparator {
       cf_comparators_.resize(column_family_id + 1, nullptr);
     }
     cf_comparators_[column_family_id] = comparator;
+    if (comparator != BytewiseComparator()) {
+      bytewise_ = false;
+    }
   }
 
   const Comparator* default_comparator() { return default_comparator_; }
 
  private:
   const Comparator* default_comparator_;
+  // Every column family orders its keys bytewise, so key prefixes and
+  // memcmp() compare entries without a virtual call.
+  bool bytewise_;
   std::vector<const Comparator*> cf_comparators_;
   const WriteBatch* write_batch_;
 };
@@ -173,6 +218,11 @@ extern Status ReadEntryFromDataOffset(Slice* input, WriteType *type, Slice *key,
                                                   Slice *xid);
 extern bool ReadKeyFromWriteBatchEntry(Slice* input, Slice* key,
                                        bool cf_record);
+// An iterator over base_iterator with the entries of delta_iterator, at
+// most one per key, applied on top.  Takes ownership of both.
+extern Iterator* NewBaseDeltaIterator(Iterator* base_iterator,
+                                      WBWIIterator* delta_iterator,
+                                      const Comparator* comparator);
 
 }  // namespace SHANNON
 
@@ -9,17 +9,6 @@
 extern int little_endian;
 extern char* const kvdb_err_msg[];
 
-static void kv_node_destroy(kv_node_t* kv)
-{
-	if (kv) {
-		if (kv->key)
-			free(kv->key);
-		if (kv->value)
-			free(kv->value);
-		free(kv);
-	}
-}
-
 int block_handle_decode_from(block_handle_t *dst, slice_t *input)
 {
 	if (get_varint64(input, &dst->offset) &&
@@ -264,20 +253,49 @@ free_restart_offset:
 	return ret;
 }
 
+// grow the scratch buffer to hold size bytes, keeping its content
+static int reserve_key_scratch(key_scratch_t *scratch, uint32_t size)
+{
+	uint32_t capacity;
+	char *data;
+
+	if (size <= scratch->capacity)
+		return KOK;
+	capacity = scratch->capacity ? scratch->capacity : 64;
+	while (capacity < size)
+		capacity *= 2;
+	data = (char *)realloc(scratch->data, capacity);
+	if (data == NULL) {
+		DEBUG("corrupted malloc key scratch\n");
+		return KCORRUPTION;
+	}
+	scratch->data = data;
+	scratch->capacity = capacity;
+	return KOK;
+}
+
+// decode one record into kv without copying: the value and a key that
+// shares nothing with the previous one point into the block, a key with
+// a shared prefix is expanded in scratch, where the previous key, if it
+// was expanded, already is. kv is valid until the next record is decoded.
 static int decode_data_block_one_record(kv_node_t *kv, slice_t *input,
-             kv_node_t *last_kv, int key_is_user_key)
+             kv_node_t *last_kv, int key_is_user_key, key_scratch_t *scratch)
 {
 	uint32_t internal_shared_key_len, internal_non_shared_key_len;
 	uint32_t internal_key_len, value_len;
 	char *last_key = (last_kv) ? last_kv->key : NULL;
-	size_t last_key_len = (last_kv) ? last_kv->key_len : 0;
+	size_t last_key_len = (last_kv) ? last_kv->internal_key_len : 0;
 	char *internal_key = NULL;
+	int last_key_in_scratch;
 	uint64_t sequence;
 	int ret = KOK;
 
-	get_varint32(input, &internal_shared_key_len);
-	get_varint32(input, &internal_non_shared_key_len);
-	get_varint32(input, &value_len);
+	if (!get_varint32(input, &internal_shared_key_len) ||
+		!get_varint32(input, &internal_non_shared_key_len) ||
+		!get_varint32(input, &value_len)) {
+		DEBUG("bad record header\n");
+		return KCORRUPTION;
+	}
 
 	// get internal key
 	if (internal_shared_key_len > last_key_len) {
@@ -290,27 +308,35 @@ static int decode_data_block_one_record(kv_node_t *kv, slice_t *input,
 		DEBUG("key len is too small, key_len=%u\n", (uint32_t)internal_key_len);
 		return KCORRUPTION;
 	}
-
-	internal_key = (char *)malloc(internal_key_len);
-	if (internal_key == NULL) {
-		DEBUG("corrupted malloc internal key\n");
+	if (internal_non_shared_key_len > input->size) {
+		DEBUG("non_shared_key_len overstep the boundary\n");
 		return KCORRUPTION;
 	}
-	if (internal_shared_key_len > 0) {
-		if (last_key == NULL) {
+
+	if (internal_shared_key_len == 0) {
+		internal_key = input->data;
+	} else {
+		if (last_key == NULL || scratch == NULL) {
 			DEBUG("here shared_key_len must be zero\n");
-			ret = KCORRUPTION;
-			goto free_internal_key;
+			return KCORRUPTION;
 		}
-		memcpy(internal_key, last_key, internal_shared_key_len);
+		last_key_in_scratch = (last_key == scratch->data);
+		ret = reserve_key_scratch(scratch, internal_key_len);
+		if (ret != KOK)
+			return ret;
+		if (!last_key_in_scratch)
+			memcpy(scratch->data, last_key, internal_shared_key_len);
+		memcpy(scratch->data + internal_shared_key_len, input->data,
+			internal_non_shared_key_len);
+		internal_key = scratch->data;
 	}
-	memcpy(internal_key + internal_shared_key_len, input->data, internal_non_shared_key_len);
 
 	// update input
 	input->data += internal_non_shared_key_len;
 	input->size -= internal_non_shared_key_len;
 
 	// decode internal key
+	kv->internal_key_len = internal_key_len;
 	if (!key_is_user_key) {
 		kv->key_len = internal_key_len - 8;
 		sequence = decode_fixed64(internal_key + kv->key_len);
@@ -318,18 +344,7 @@ static int decode_data_block_one_record(kv_node_t *kv, slice_t *input,
 		kv->sequence = sequence >> 8;
 	} else
 		kv->key_len = internal_key_len;
-	kv->key = (char *)malloc(kv->key_len + 1);
-	if (kv->key == NULL) {
-		DEBUG("corrupted malloc kv->key\n");
-		ret = KCORRUPTION;
-		goto free_internal_key;
-	}
-	memcpy(kv->key, internal_key, kv->key_len);
-	kv->key[kv->key_len] = '\0';
-	if (internal_key) {
-		free(internal_key);
-		internal_key = NULL;
-	}
+	kv->key = internal_key;
 
 	// get value
 	kv->value_len = value_len;
@@ -337,39 +352,19 @@ static int decode_data_block_one_record(kv_node_t *kv, slice_t *input,
 		kv->value = NULL;
 		if (kv->value_len != 0) { //FIXME
 			DEBUG("value_len must be zero for delete type\n");
-			ret = KCORRUPTION;
-			goto free_kv_key;
+			return KCORRUPTION;
 		}
 	} else {
-		if (kv->value_len < 0 || kv->value_len > input->size) {
+		if (kv->value_len > input->size) {
 			DEBUG("value_len overstep the boundary for value type\n");
-			ret = KCORRUPTION;
-			goto free_kv_key;
-		}
-		kv->value = (char *)malloc(kv->value_len + 1);
-		if (kv->value == NULL) {
-			DEBUG("corrupted malloc kv->value\n");
-			ret = KCORRUPTION;
-			goto free_kv_key;
+			return KCORRUPTION;
 		}
-		memcpy(kv->value, input->data, kv->value_len);
-		kv->value[kv->value_len] = '\0';
+		kv->value = input->data;
 		// update input
 		input->data += kv->value_len;
 		input->size -= kv->value_len;
 	}
 	return ret;
-
-free_kv_key:
-	if (kv->key) {
-		free(kv->key);
-		kv->key = NULL;
-	}
-free_internal_key:
-	if (internal_key)
-		free(internal_key);
-out:
-	return ret;
 }
 
 static int batch_write_and_clear_nonatomic(database_options_t *opt, char **err)
@@ -463,24 +458,13 @@ out:
 int decode_data_block_restart_interval(block_rep_t *rep, int index)
 {
 	slice_t interval;
-	kv_node_t *kv, *last_kv, *tmp_kv;
+	kv_node_t kv_nodes[2];
+	kv_node_t *kv = &kv_nodes[0], *last_kv = &kv_nodes[1], *tmp_kv;
 	int ret = KOK;
 
-	kv = (kv_node_t *)malloc(sizeof(kv_node_t));
-	if (kv == NULL) {
-		DEBUG("corrupted malloc kv_node_t *kv\n");
-		return KCORRUPTION;
-	}
-	memset((void *)kv, 0, sizeof(kv_node_t));
-
-	last_kv = (kv_node_t *)malloc(sizeof(kv_node_t));
-	if (last_kv == NULL) {
-		DEBUG("corrupted malloc kv_node_t *last_kv\n");
-		ret = KCORRUPTION;
-		goto free_kv;
-	}
-	memset((void *)last_kv, 0, sizeof(kv_node_t));
-
+	// keys and values point into the block or rep->key_scratch,
+	// nothing is allocated per record
+	memset(kv_nodes, 0, sizeof(kv_nodes));
 	interval.data = rep->block.data + rep->restart_offset[index];
 	if (index + 1 < rep->restart_nums) {
 		interval.size = rep->restart_offset[index+1] - rep->restart_offset[index];
@@ -489,27 +473,20 @@ int decode_data_block_restart_interval(block_rep_t *rep, int index)
 	}
 
 	while (interval.size > 0) {
-		ret = decode_data_block_one_record(kv, &interval, last_kv, 0);
+		ret = decode_data_block_one_record(kv, &interval, last_kv, 0,
+				&rep->key_scratch);
 		if (ret != KOK)
-			goto free_last_kv;
-		ret = process_one_kv(rep, kv);
-		if (ret != KOK) {
-			goto free_last_kv;
-		}
+			break;
+		if (rep->kv_handler)
+			ret = rep->kv_handler(rep->kv_handler_arg, kv);
+		else
+			ret = process_one_kv(rep, kv);
+		if (ret != KOK)
+			break;
 		tmp_kv = last_kv;
 		last_kv = kv;
 		kv = tmp_kv;
-		if (kv->key)
-			free(kv->key);
-		if (kv->value)
-			free(kv->value);
-		memset(kv, 0, sizeof(kv_node_t));
 	}
-
-free_last_kv:
-	kv_node_destroy(last_kv);
-free_kv:
-	kv_node_destroy(kv);
 	return ret;
 }
 
@@ -530,7 +507,7 @@ int decode_data_block(block_rep_t *rep)
 			return ret;
 		}
 	}
-	if (rep->last_data_block) {
+	if (rep->last_data_block && rep->kv_handler == NULL) {
 		rep->opt->end = 1; // write kvs in writebatch to SSD
 		process_one_kv(rep, NULL);
 	}
@@ -545,7 +522,7 @@ int get_index_block_restart_offset(block_rep_t *rep)
 static int decode_index_block_one_record(kv_node_t *kv, slice_t *input) {
 	// if key is not user key, we do not use sequence
 	// so can force key_is_user_key=1
-	return decode_data_block_one_record(kv, input, NULL, 1);
+	return decode_data_block_one_record(kv, input, NULL, 1, NULL);
 }
 
 int process_one_block_handle(block_rep_t *rep, kv_node_t *kv)
@@ -570,8 +547,11 @@ int process_one_block_handle(block_rep_t *rep, kv_node_t *kv)
 	memset(data_block_rep, 0, sizeof(block_rep_t));
 	data_block_rep->filename = rep->filename;
 	data_block_rep->opt = rep->opt;
+	data_block_rep->kv_handler = rep->kv_handler;
+	data_block_rep->kv_handler_arg = rep->kv_handler_arg;
 	data_block_rep->checksum_type = rep->checksum_type;
 	data_block_rep->last_data_block = rep->last_data_block;
+	data_block_rep->key_scratch = rep->data_key_scratch;
 	ret = read_block(&data_block_rep->block, data_block_rep->filename,
 			&block_handle, data_block_rep->checksum_type);
 	if (ret != KOK) {
@@ -594,6 +574,7 @@ free_block_rep_restart:
 		free(data_block_rep->restart_offset);
 	}
 free_data_block_rep:
+	rep->data_key_scratch = data_block_rep->key_scratch;
 	if (data_block_rep)
 		free(data_block_rep);
 	return ret;
@@ -602,14 +583,10 @@ free_data_block_rep:
 int decode_index_block_restart_interval(block_rep_t *rep, int index)
 {
 	slice_t interval;
-	kv_node_t *kv = (kv_node_t *)malloc(sizeof(kv_node_t));
+	kv_node_t kv;
 	int ret = KOK;
 
-	if (kv == NULL) {
-		DEBUG("corrupted malloc kv\n");
-		return KCORRUPTION;
-	}
-	memset(kv, 0, sizeof(kv_node_t));
+	memset(&kv, 0, sizeof(kv_node_t));
 	interval.data = rep->block.data + rep->restart_offset[index];
 	if (index + 1 < rep->restart_nums) {
 		interval.size = rep->restart_offset[index+1] - rep->restart_offset[index];
@@ -618,25 +595,13 @@ int decode_index_block_restart_interval(block_rep_t *rep, int index)
 	}
 
 	if (interval.size > 0) {
-		ret = decode_index_block_one_record(kv, &interval);
-		if (ret != KOK)
-			goto free_kv;
-		ret = process_one_block_handle(rep, kv);
-		if (ret != KOK)
-			goto free_kv;
+		ret = decode_index_block_one_record(&kv, &interval);
+		if (ret == KOK)
+			ret = process_one_block_handle(rep, &kv);
 	} else {
 		DEBUG("Error decode index block\n");
 		ret = KCORRUPTION;
 	}
-
-free_kv:
-	if (kv) {
-		if (kv->key)
-			free(kv->key);
-		if (kv->value)
-			free(kv->value);
-		free(kv);
-	}
 	return ret;
 }
 
@@ -667,9 +632,10 @@ static int get_property_block_restart_offset(block_rep_t *rep)
 	return get_data_block_restart_offset(rep);
 }
 
-static int decode_property_block_one_record(kv_node_t *kv, slice_t *input, kv_node_t *last_kv)
+static int decode_property_block_one_record(kv_node_t *kv, slice_t *input, kv_node_t *last_kv,
+		key_scratch_t *scratch)
 {
-	return decode_data_block_one_record(kv, input, last_kv, 1);
+	return decode_data_block_one_record(kv, input, last_kv, 1, scratch);
 }
 
 static int process_one_property_kv(block_rep_t *rep, kv_node_t *kv, int *find)
@@ -699,48 +665,32 @@ static int process_one_property_kv(block_rep_t *rep, kv_node_t *kv, int *find)
 int decode_property_block(block_rep_t *rep)
 {
 	slice_t my_block;
-	kv_node_t *kv, *last_kv, *tmp_kv;
+	kv_node_t kv_nodes[2];
+	kv_node_t *kv = &kv_nodes[0], *last_kv = &kv_nodes[1], *tmp_kv;
+	key_scratch_t scratch;
 	int ret = KOK;
 	int find = 0;
 
 	set_slice(&my_block, rep->block.data, rep->block.size);
-	kv = (kv_node_t *)malloc(sizeof(kv_node_t));
-	if (kv == NULL) {
-		DEBUG("corrupted malloc kv_node_t *kv\n");
-		return KCORRUPTION;
-	}
-	memset((void *)kv, 0, sizeof(kv_node_t));
-
-	last_kv = (kv_node_t *)malloc(sizeof(kv_node_t));
-	if (last_kv == NULL) {
-		DEBUG("corrupted malloc kv_node_t *last_kv\n");
-		ret = KCORRUPTION;
-		goto free_kv;
-	}
-	memset((void *)last_kv, 0, sizeof(kv_node_t));
-
+	memset(kv_nodes, 0, sizeof(kv_nodes));
+	memset(&scratch, 0, sizeof(key_scratch_t));
 	ret = get_property_block_restart_offset(rep);
 	if (ret != KOK)
-		goto free_last_kv;
+		goto free_scratch;
 	set_slice(&my_block, rep->block.data, rep->data_size);
 
 	while (my_block.size > 0) {
-		ret = decode_property_block_one_record(kv, &my_block, last_kv);
+		ret = decode_property_block_one_record(kv, &my_block, last_kv, &scratch);
 		if (ret != KOK)
-			goto free_last_kv;
+			goto free_scratch;
 		ret = process_one_property_kv(rep, kv, &find);
 		if (ret != KOK)
-			goto free_last_kv;
+			goto free_scratch;
 		if (find >= KPROPERTIES)
 			break;
 		tmp_kv = last_kv;
 		last_kv = kv;
 		kv = tmp_kv;
-		if (kv->key)
-			free(kv->key);
-		if (kv->value)
-			free(kv->value);
-		memset(kv, 0, sizeof(kv_node_t));
 	}
 
 	if (ret == KOK && find < KPROPERTIES && strlen(rep->props->cf_name) == 0) {
@@ -748,10 +698,9 @@ int decode_property_block(block_rep_t *rep)
 		ret = KNOT_FOUND;
 	}
 
-free_last_kv:
-	kv_node_destroy(last_kv);
-free_kv:
-	kv_node_destroy(kv);
+free_scratch:
+	if (scratch.data)
+		free(scratch.data);
 	return ret;
 }
 
@@ -760,9 +709,10 @@ static int get_meta_index_block_restart_offset(block_rep_t *rep)
 	return get_data_block_restart_offset(rep);
 }
 
-static int decode_meta_index_block_one_record(kv_node_t *kv, slice_t *input, kv_node_t *last_kv)
+static int decode_meta_index_block_one_record(kv_node_t *kv, slice_t *input, kv_node_t *last_kv,
+		key_scratch_t *scratch)
 {
-	return decode_data_block_one_record(kv, input, last_kv, 1);
+	return decode_data_block_one_record(kv, input, last_kv, 1, scratch);
 }
 
 static int is_property_block(char *key, int len)
@@ -825,47 +775,31 @@ free_meta_block_rep:
 int decode_meta_index_block(block_rep_t *rep)
 {
 	slice_t my_block;
-	kv_node_t *kv, *last_kv, *tmp_kv;
+	kv_node_t kv_nodes[2];
+	kv_node_t *kv = &kv_nodes[0], *last_kv = &kv_nodes[1], *tmp_kv;
+	key_scratch_t scratch;
 	int ret = KOK, find = 0;
 
 	set_slice(&my_block, rep->block.data, rep->block.size);
-	kv = (kv_node_t *)malloc(sizeof(kv_node_t));
-	if (kv == NULL) {
-		DEBUG("corrupted malloc kv_node_t *kv\n");
-		return KCORRUPTION;
-	}
-	memset((void *)kv, 0, sizeof(kv_node_t));
-
-	last_kv = (kv_node_t *)malloc(sizeof(kv_node_t));
-	if (last_kv == NULL) {
-		DEBUG("corrupted malloc kv_node_t *last_kv\n");
-		ret = KCORRUPTION;
-		goto free_kv;
-	}
-	memset((void *)last_kv, 0, sizeof(kv_node_t));
-
+	memset(kv_nodes, 0, sizeof(kv_nodes));
+	memset(&scratch, 0, sizeof(key_scratch_t));
 	ret = get_meta_index_block_restart_offset(rep);
 	if (ret != KOK)
-		goto free_last_kv;
+		goto free_scratch;
 	set_slice(&my_block, rep->block.data, rep->data_size);
 
 	while (my_block.size > 0) {
-		ret = decode_meta_index_block_one_record(kv, &my_block, last_kv);
+		ret = decode_meta_index_block_one_record(kv, &my_block, last_kv, &scratch);
 		if (ret != KOK)
-			goto free_last_kv;
+			goto free_scratch;
 		ret = process_one_meta_index_kv(rep, kv, &find);
 		if (ret != KOK)
-			goto free_last_kv;
+			goto free_scratch;
 		if (find >= KMETA_NUMS)
 			break;
 		tmp_kv = last_kv;
 		last_kv = kv;
 		kv = tmp_kv;
-		if (kv->key)
-			free(kv->key);
-		if (kv->value)
-			free(kv->value);
-		memset(kv, 0, sizeof(kv_node_t));
 	}
 
 	if (ret == KOK && find < KMETA_NUMS) {
@@ -873,10 +807,9 @@ int decode_meta_index_block(block_rep_t *rep)
 		ret = KNOT_FOUND;
 	}
 
-free_last_kv:
-	kv_node_destroy(last_kv);
-free_kv:
-	kv_node_destroy(kv);
+free_scratch:
+	if (scratch.data)
+		free(scratch.data);
 	return ret;
 }
 
@@ -886,6 +819,7 @@ int process_meta_index(char *filename, meta_block_properties_t *props, foot_t *f
 	block_rep_t meta_index_block_rep;
 	int ret = KOK;
 
+	memset((void *)&meta_index_block_rep, 0, sizeof(block_rep_t));
 	meta_index_block_rep.filename = filename;
 	meta_index_block_rep.props = props;
 	meta_index_block_rep.checksum_type = foot->checksum_type;
@@ -1053,6 +987,8 @@ int shannondb_analyze_sst(char *filename, int verify, char *dev_name, char *db_n
 free_rep_restart_offset:
 	if (index_block_rep.restart_offset)
 		free(index_block_rep.restart_offset);
+	if (index_block_rep.data_key_scratch.data)
+		free(index_block_rep.data_key_scratch.data);
 free_rep_block_data:
 	if (index_block_rep.block.data)
 		free(index_block_rep.block.data);
@@ -11,16 +11,26 @@ struct status {
 };
 typedef struct status status_t;
 
+// a decoded record, key and value point into the block or a key_scratch,
+// they are not owned
 struct kv_node {
 	char *key;
 	char *value;
 	uint32_t key_len;
 	uint32_t value_len;
+	uint32_t internal_key_len; // key_len plus sequence and type, if any
 	uint64_t sequence;
 	uint32_t type;
 };
 typedef struct kv_node kv_node_t;
 
+// space to expand keys that share a prefix with the previous key
+struct key_scratch {
+	char *data;
+	uint32_t capacity;
+};
+typedef struct key_scratch key_scratch_t;
+
 
 /*** footer ***/
 // (64 + (7 - 1)) / 7 = 10
@@ -87,9 +97,15 @@ struct block_rep {
 	meta_block_properties_t *props; // for property meta block
 
 	database_options_t *opt; // write kv to ssd
+	// if set, decoded kvs of data blocks are handed to it with
+	// kv_handler_arg instead of being written to ssd
+	int (*kv_handler)(void *arg, kv_node_t *kv);
+	void *kv_handler_arg;
 	uint32_t kv_put_count;
 	uint32_t kv_del_count;
 	uint32_t data_block_count; // used by index_block
+	key_scratch_t key_scratch; // keys of this block
+	key_scratch_t data_key_scratch; // keys of data blocks, reused from block to block
 };
 typedef struct block_rep block_rep_t;
 
@@ -0,0 +1,138 @@
+// Copyright (c) 2018 Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include "swift/checkpoint.h"
+#include "src/kv_impl.h"
+#include "src/snapshot.h"
+#include "src/venice_kv.h"
+#include "src/venice_ioctl.h"
+#include "src/perf_context_imp.h"
+
+namespace shannon {
+
+Status Checkpoint::Create(DB* db, Checkpoint** checkpoint_ptr) {
+  if (db == NULL || checkpoint_ptr == NULL) {
+    return Status::InvalidArgument("db or checkpoint_ptr is null");
+  }
+  *checkpoint_ptr = new Checkpoint(db);
+  return Status::OK();
+}
+
+Status Checkpoint::CreateCheckpoint(uint64_t* timestamp) {
+  KVImpl* impl = reinterpret_cast<KVImpl*>(db_);
+  struct uapi_checkpoint checkpoint;
+
+  if (timestamp == NULL) {
+    return Status::InvalidArgument("timestamp is null");
+  }
+  // The checkpoint holds what is on the device, buffered writes included.
+  Status s = impl->FlushWriteBackBuffers();
+  if (!s.ok()) {
+    return s;
+  }
+  memset(&checkpoint, 0, sizeof(checkpoint));
+  checkpoint.db = impl->db_;
+  int ret = PerfIoctl(kPerfIoctlSnapshot, impl->fd_, CREATE_CHECKPOINT,
+                      &checkpoint);
+  if (ret < 0) {
+    if (errno == ENOSPC || errno == EBUSY || errno == EMLINK) {
+      return Status::Busy("too many checkpoints", strerror(errno));
+    }
+    return Status::IOError("ioctl create_checkpoint failed", strerror(errno));
+  }
+  *timestamp = checkpoint.timestamp;
+  return Status::OK();
+}
+
+Status Checkpoint::ListCheckpoints(std::vector<uint64_t>* timestamps) {
+  KVImpl* impl = reinterpret_cast<KVImpl*>(db_);
+  struct uapi_checkpoint_list list;
+
+  if (timestamps == NULL) {
+    return Status::InvalidArgument("timestamps is null");
+  }
+  memset(&list, 0, sizeof(list));
+  list.db = impl->db_;
+  int ret = PerfIoctl(kPerfIoctlSnapshot, impl->fd_, CHECKPOINT_LIST, &list);
+  if (ret < 0) {
+    return Status::IOError("ioctl checkpoint_list failed", strerror(errno));
+  }
+  if (list.count < 0 || list.count > MAX_CHECKPOINT_COUNT) {
+    return Status::Corruption("invalid checkpoint count");
+  }
+  timestamps->assign(list.timestamp, list.timestamp + list.count);
+  std::sort(timestamps->begin(), timestamps->end());
+  return Status::OK();
+}
+
+Status Checkpoint::ReleaseCheckpoint(uint64_t timestamp) {
+  KVImpl* impl = reinterpret_cast<KVImpl*>(db_);
+  struct uapi_checkpoint checkpoint;
+
+  memset(&checkpoint, 0, sizeof(checkpoint));
+  checkpoint.db = impl->db_;
+  checkpoint.timestamp = timestamp;
+  int ret = PerfIoctl(kPerfIoctlSnapshot, impl->fd_, RELEASE_CHECKPOINT,
+                      &checkpoint);
+  if (ret < 0) {
+    if (errno == ENOENT || errno == ENXIO) {
+      return Status::NotFound("checkpoint not found");
+    }
+    return Status::IOError("ioctl release_checkpoint failed", strerror(errno));
+  }
+  return Status::OK();
+}
+
+Status Checkpoint::GetView(uint64_t timestamp, const Snapshot** view) {
+  std::vector<uint64_t> timestamps;
+
+  if (view == NULL) {
+    return Status::InvalidArgument("view is null");
+  }
+  *view = NULL;
+  Status s = ListCheckpoints(&timestamps);
+  if (!s.ok()) {
+    return s;
+  }
+  if (!std::binary_search(timestamps.begin(), timestamps.end(), timestamp)) {
+    return Status::NotFound("checkpoint not found");
+  }
+  // Reads at a checkpoint use its timestamp as the snapshot id.
+  SnapshotImpl* snapshot = new SnapshotImpl;
+  snapshot->SetSequenceNumber(timestamp);
+  *view = snapshot;
+  return s;
+}
+
+void Checkpoint::ReleaseView(const Snapshot* view) {
+  delete view;
+}
+
+Status Checkpoint::NewIterator(const ReadOptions& options,
+                               ColumnFamilyHandle* column_family,
+                               uint64_t timestamp, Iterator** iterator) {
+  const Snapshot* view = NULL;
+
+  if (iterator == NULL || column_family == NULL) {
+    return Status::InvalidArgument("iterator or column family is null");
+  }
+  *iterator = NULL;
+  Status s = GetView(timestamp, &view);
+  if (!s.ok()) {
+    return s;
+  }
+  ReadOptions read_options(options);
+  read_options.snapshot = view;
+  *iterator = db_->NewIterator(read_options, column_family);
+  ReleaseView(view);
+  if (*iterator == NULL) {
+    return reinterpret_cast<KVImpl*>(db_)->status();
+  }
+  return s;
+}
+
+}  // namespace shannon
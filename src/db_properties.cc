@@ -0,0 +1,106 @@
+// Copyright (c) 2018 Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+#include <string.h>
+#include <sstream>
+#include "src/db_properties.h"
+#include "swift/shannon_db.h"
+
+namespace shannon {
+
+const std::string DB::Properties::kStats = "shannon.stats";
+const std::string DB::Properties::kCurSizeAllMemTables =
+    "shannon.cur-size-all-mem-tables";
+const std::string DB::Properties::kEstimateNumKeys =
+    "shannon.estimate-num-keys";
+const std::string DB::Properties::kTotalDiskUsage = "shannon.total-disk-usage";
+const std::string DB::Properties::kEstimateDiskUsage =
+    "shannon.estimate-disk-usage";
+const std::string DB::Properties::kCacheUsage = "shannon.cache-usage";
+const std::string DB::Properties::kNumCheckpoints = "shannon.num-checkpoints";
+const std::string DB::Properties::kDeviceStatus = "shannon.device-status";
+const std::string DB::Properties::kDBStatus = "shannon.db-status";
+const std::string DB::Properties::kCFStatus = "shannon.cf-status";
+
+const std::string kDevicePropertyPrefix = "shannon.device.";
+const std::string kDBPropertyPrefix = "shannon.db.";
+const std::string kCFPropertyPrefix = "shannon.cf.";
+
+template <typename T>
+static void AddProperty(std::map<std::string, std::string>* value,
+                        const char* name, T v) {
+  std::stringstream ss;
+  ss << v;
+  (*value)[name] = ss.str();
+}
+
+static std::string FixedString(const char* buf, size_t size) {
+  return std::string(buf, strnlen(buf, size));
+}
+
+void DeviceStatusToMap(const struct uapi_dev_status& status,
+                       std::map<std::string, std::string>* value) {
+  (*value)["target-type"] = FixedString(status.tgttype, sizeof(status.tgttype));
+  (*value)["target-name"] = FixedString(status.tgtname, sizeof(status.tgtname));
+  AddProperty(value, "total-write-bytes", status.total_write_bytes);
+  AddProperty(value, "host-read-bytes", status.host_read_bytes);
+  AddProperty(value, "host-write-bytes", status.host_write_bytes);
+  AddProperty(value, "cache-read-bytes", status.cache_read_bytes);
+  AddProperty(value, "power-on-seconds", status.power_on_seconds);
+  AddProperty(value, "power-cycle-count", status.power_cycle_count);
+  AddProperty(value, "host-write-bandwidth", status.host_write_bandwidth);
+  AddProperty(value, "host-write-iops", status.host_write_iops);
+  AddProperty(value, "host-write-latency", status.host_write_latency);
+  AddProperty(value, "total-write-bandwidth", status.total_write_bandwidth);
+  AddProperty(value, "host-read-bandwidth", status.host_read_bandwidth);
+  AddProperty(value, "host-read-iops", status.host_read_iops);
+  AddProperty(value, "host-read-latency", status.host_read_latency);
+  AddProperty(value, "write-amplifier", status.write_amplifier);
+  AddProperty(value, "write-amplifier-lifetime",
+              status.write_amplifier_lifetime);
+  AddProperty(value, "total-gc-sectors", status.total_gc_sectors);
+  AddProperty(value, "total-wl-sectors", status.total_wl_sectors);
+  AddProperty(value, "total-err-recover-sectors",
+              status.total_err_recover_sectors);
+  AddProperty(value, "gc-write-bandwidth", status.gc_write_bandwidth);
+  AddProperty(value, "gc-read-bandwidth", status.gc_read_bandwidth);
+  AddProperty(value, "wl-bandwidth", status.wl_bandwidth);
+  AddProperty(value, "err-recover-bandwidth", status.err_recover_bandwidth);
+  AddProperty(value, "overprovision", status.overprovision);
+  AddProperty(value, "capacity", status.capacity);
+  AddProperty(value, "physical-capacity", status.physical_capacity);
+  AddProperty(value, "disk-usage", status.disk_usage);
+  AddProperty(value, "est-disk-usage", status.est_disk_usage);
+  AddProperty(value, "dynamic-bad-block-count", status.dynamic_bad_blkcnt);
+  AddProperty(value, "wear-level-norm", status.wear_level_norm);
+  AddProperty(value, "wear-level-min", status.wear_level_min);
+  AddProperty(value, "wear-level-max", status.wear_level_max);
+  AddProperty(value, "wear-level-avg", status.wear_level_avg);
+}
+
+void DBStatusToMap(const struct uapi_db_status& status,
+                   std::map<std::string, std::string>* value) {
+  AddProperty(value, "db-index", status.db_index);
+  AddProperty(value, "cf-count", status.cf_count);
+  AddProperty(value, "num-checkpoints", status.checkpoint_count);
+  AddProperty(value, "total-kv-count", status.total_kv_count);
+  AddProperty(value, "total-disk-usage", status.total_disk_usage);
+  AddProperty(value, "est-total-disk-usage", status.est_total_disk_usage);
+  AddProperty(value, "total-cache-size", status.total_cache_size);
+  AddProperty(value, "use-cache-size", status.use_cache_size);
+}
+
+void CFStatusToMap(const struct uapi_cf_status& status,
+                   std::map<std::string, std::string>* value) {
+  AddProperty(value, "db-index", status.db_index);
+  AddProperty(value, "cf-index", status.cf_index);
+  AddProperty(value, "num-checkpoints", status.checkpoint_count);
+  AddProperty(value, "total-kv-count", status.total_kv_count);
+  AddProperty(value, "total-disk-usage", status.total_disk_usage);
+  AddProperty(value, "est-total-disk-usage", status.est_total_disk_usage);
+  AddProperty(value, "total-cache-size", status.total_cache_size);
+  AddProperty(value, "use-cache-size", status.use_cache_size);
+}
+
+}  // namespace shannon
@@ -0,0 +1,32 @@
+// Copyright (c) 2018 Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+#ifndef SHANNON_DB_PROPERTIES_H_
+#define SHANNON_DB_PROPERTIES_H_
+
+#include <map>
+#include <string>
+#include "src/venice_kv.h"
+
+namespace shannon {
+
+// Prefixes of the per-field properties, e.g. "shannon.device.host-read-iops"
+// is the "host-read-iops" entry of the "shannon.device-status" map.
+extern const std::string kDevicePropertyPrefix;
+extern const std::string kDBPropertyPrefix;
+extern const std::string kCFPropertyPrefix;
+
+// Convert a status structure returned by the driver to property
+// name/value pairs.  Bandwidths are in KB/s, latencies in microseconds
+// and sizes in bytes, as reported by the device.
+extern void DeviceStatusToMap(const struct uapi_dev_status& status,
+                              std::map<std::string, std::string>* value);
+extern void DBStatusToMap(const struct uapi_db_status& status,
+                          std::map<std::string, std::string>* value);
+extern void CFStatusToMap(const struct uapi_cf_status& status,
+                          std::map<std::string, std::string>* value);
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_PROPERTIES_H_
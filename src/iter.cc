@@ -9,6 +9,8 @@
 #include "swift/iterator.h"
 #include "src/venice_kv.h"
 #include "src/venice_ioctl.h"
+#include "src/perf_context_imp.h"
+#include "util/statistics.h"
 
 namespace shannon {
 
@@ -72,7 +74,7 @@ KVIter::~KVIter() {
   iter.cf_index = cf_index_;
   iter.timestamp = timestamp_;
   iter.iter_index = index_;
-  ret = ioctl(db_->fd_, IOCTL_DESTROY_ITERATOR, &iter);
+  ret = PerfIoctl(kPerfIoctlIterDestroy, db_->fd_, IOCTL_DESTROY_ITERATOR, &iter);
   if (ret < 0) {
     status_ = Status::IOError("ioctl destroy_iterator failed!!!\n");
   }
@@ -89,7 +91,12 @@ void KVIter::Next() {
   move.iter.iter_index = index_;
   move.iter.cf_index = cf_index_;
   move.move_direction = MOVE_NEXT;
-  ret = ioctl(db_->fd_, IOCTL_ITERATOR_MOVE, &move);
+  PERF_COUNTER_ADD(iter_next_count, 1);
+  RecordTick(db_->stats_, NUMBER_DB_NEXT);
+  {
+    StopWatch sw(db_->stats_, DB_ITER_NEXT);
+    ret = PerfIoctl(kPerfIoctlIterMove, db_->fd_, IOCTL_ITERATOR_MOVE, &move);
+  }
   valid_ = move.iter.valid_key == 0 ? false : true;
   if (ret < 0) {
     valid_ = false;
@@ -118,7 +125,12 @@ void KVIter::Prev() {
   move.iter.iter_index = index_;
   move.iter.cf_index = cf_index_;
   move.move_direction = MOVE_PREV;
-  ret = ioctl(db_->fd_, IOCTL_ITERATOR_MOVE, &move);
+  PERF_COUNTER_ADD(iter_prev_count, 1);
+  RecordTick(db_->stats_, NUMBER_DB_PREV);
+  {
+    StopWatch sw(db_->stats_, DB_ITER_PREV);
+    ret = PerfIoctl(kPerfIoctlIterMove, db_->fd_, IOCTL_ITERATOR_MOVE, &move);
+  }
   valid_ = move.iter.valid_key == 0 ? false : true;
   if (ret < 0) {
     valid_ = false;
@@ -150,7 +162,12 @@ void KVIter::Seek(const Slice& target) {
   seek.key_len = target.size();
   memcpy(seek.key, target.data(),
   target.size() < MAX_KEY_SIZE ? target.size() : MAX_KEY_SIZE);
-  ret = ioctl(db_->fd_, IOCTL_ITERATOR_SEEK, &seek);
+  PERF_COUNTER_ADD(iter_seek_count, 1);
+  RecordTick(db_->stats_, NUMBER_DB_SEEK);
+  {
+    StopWatch sw(db_->stats_, DB_ITER_SEEK);
+    ret = PerfIoctl(kPerfIoctlIterSeek, db_->fd_, IOCTL_ITERATOR_SEEK, &seek);
+  }
   valid_ = seek.iter.valid_key == 0 ? false : true;
   if (ret < 0) {
     status_ = Status::IOError("Seek Key Failed", strerror(errno));
@@ -184,7 +201,12 @@ void KVIter::SeekToFirst() {
   seek.iter.iter_index = index_;
   seek.iter.cf_index = cf_index_;
   seek.seek_type = SEEK_FIRST;
-  ret = ioctl(db_->fd_, IOCTL_ITERATOR_SEEK, &seek);
+  PERF_COUNTER_ADD(iter_seek_count, 1);
+  RecordTick(db_->stats_, NUMBER_DB_SEEK);
+  {
+    StopWatch sw(db_->stats_, DB_ITER_SEEK);
+    ret = PerfIoctl(kPerfIoctlIterSeek, db_->fd_, IOCTL_ITERATOR_SEEK, &seek);
+  }
   valid_ = seek.iter.valid_key == 0 ? false : true;
   if (ret < 0) {
     status_ = Status::IOError("Seek Failed", strerror(errno));
@@ -253,7 +275,12 @@ void KVIter::SeekToLast() {
   seek.iter.iter_index = index_;
   seek.iter.cf_index = cf_index_;
   seek.seek_type = SEEK_LAST;
-  ret = ioctl(db_->fd_, IOCTL_ITERATOR_SEEK, &seek);
+  PERF_COUNTER_ADD(iter_seek_count, 1);
+  RecordTick(db_->stats_, NUMBER_DB_SEEK);
+  {
+    StopWatch sw(db_->stats_, DB_ITER_SEEK);
+    ret = PerfIoctl(kPerfIoctlIterSeek, db_->fd_, IOCTL_ITERATOR_SEEK, &seek);
+  }
   valid_ = seek.iter.valid_key == 0 ? false : true;
   if (ret < 0) {
     status_ = Status::IOError("Seek Failed", strerror(errno));
@@ -278,7 +305,12 @@ void KVIter::SeekForPrev(const Slice& target) {
     }
     memcpy(seek.key, target.data(), target.size());
     seek.key_len = target.size();
-    ret = ioctl(db_->fd_, IOCTL_ITERATOR_SEEK, &seek);
+    PERF_COUNTER_ADD(iter_seek_count, 1);
+    RecordTick(db_->stats_, NUMBER_DB_SEEK);
+    {
+      StopWatch sw(db_->stats_, DB_ITER_SEEK);
+      ret = PerfIoctl(kPerfIoctlIterSeek, db_->fd_, IOCTL_ITERATOR_SEEK, &seek);
+    }
     valid_ = seek.iter.valid_key == 0 ? false : true;
     if (ret < 0) {
         status_ = Status::IOError("Seek For Prev Failed.", strerror(errno));
@@ -308,12 +340,19 @@ Slice KVIter::key() {
   get.get_type = ITER_GET_KEY;
   get.key = (char *) malloc(MAX_KEY_SIZE);
   get.key_buf_len = MAX_KEY_SIZE;
-  ret = ioctl(db_->fd_, IOCTL_ITERATOR_GET, &get);
+  PERF_HEAP_ALLOC(MAX_KEY_SIZE);
+  PERF_COUNTER_ADD(iter_get_key_count, 1);
+  {
+    StopWatch sw(db_->stats_, DB_ITER_GET);
+    ret = PerfIoctl(kPerfIoctlIterGet, db_->fd_, IOCTL_ITERATOR_GET, &get);
+  }
   if (ret < 0) {
     status_ = Status::IOError("Iter Get key Failed", strerror(errno));
   }
   else {
     saved_key_.assign(get.key, get.key_len);
+    PERF_COUNTER_ADD(bytes_copied, get.key_len);
+    RecordTick(db_->stats_, ITER_BYTES_READ, get.key_len);
     cur_timestamp_ = get.timestamp;
     has_timestamp = true;
   }
@@ -335,12 +374,19 @@ Slice KVIter::value() {
   get.get_type = ITER_GET_VALUE;
   get.value = (char *) malloc(MAX_VALUE_SIZE);
   get.value_buf_len = MAX_VALUE_SIZE;
-  ret = ioctl(db_->fd_, IOCTL_ITERATOR_GET, &get);
+  PERF_HEAP_ALLOC(MAX_VALUE_SIZE);
+  PERF_COUNTER_ADD(iter_get_value_count, 1);
+  {
+    StopWatch sw(db_->stats_, DB_ITER_GET);
+    ret = PerfIoctl(kPerfIoctlIterGet, db_->fd_, IOCTL_ITERATOR_GET, &get);
+  }
   if (ret < 0) {
     status_ = Status::IOError("Iter Get Value Failed", strerror(errno));
   }
   else {
     saved_value_.assign(get.value, get.value_len);
+    PERF_COUNTER_ADD(bytes_copied, get.value_len);
+    RecordTick(db_->stats_, ITER_BYTES_READ, get.value_len);
     cur_timestamp_ = get.timestamp;
     has_timestamp = true;
   }
@@ -363,7 +409,11 @@ uint64_t KVIter::timestamp() {
   get.get_type = ITER_GET_KEY;
   get.key = (char *) malloc(MAX_KEY_SIZE);
   get.key_buf_len = MAX_KEY_SIZE;
-  ret = ioctl(db_->fd_, IOCTL_ITERATOR_GET, &get);
+  PERF_HEAP_ALLOC(MAX_KEY_SIZE);
+  {
+    StopWatch sw(db_->stats_, DB_ITER_GET);
+    ret = PerfIoctl(kPerfIoctlIterGet, db_->fd_, IOCTL_ITERATOR_GET, &get);
+  }
   if (ret < 0) {
     status_ = Status::IOError("Iter Get timestamp Failed", strerror(errno));
   }
@@ -46,7 +46,7 @@ Status DB::Open(const DBOptions& db_options,
        std::vector<ColumnFamilyHandle*>* handles, DB** dbptr) {
     *dbptr = NULL;
     KVImpl* impl;
-    impl = new KVImpl(Options(), dbname, device);
+    impl = new KVImpl(db_options, dbname, device);
     Status s = impl->Open(db_options, column_family_descriptor, handles);
     if (s.ok()) {
       *dbptr = impl;
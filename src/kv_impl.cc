@@ -15,6 +15,8 @@
 #include <algorithm>
 #include <sstream>
 #include <assert.h>
+#include <thread>
+#include <atomic>
 #include "src/kv_impl.h"
 #include "src/venice_kv.h"
 #include "src/venice_ioctl.h"
@@ -22,22 +24,29 @@
 #include "src/read_batch_internal.h"
 #include "src/iter.h"
 #include "src/snapshot.h"
+#include "src/perf_context_imp.h"
+#include "src/db_properties.h"
+#include "util/statistics.h"
 #include "swift/env.h"
 #include "swift/read_batch.h"
 #include "table/sst_table.h"
+#include "table/sst_ingest.h"
+#include "table/sst_export.h"
 
 using namespace std;
 #define MAX_AIO_REQ_COUNT 8192
 namespace shannon {
   const std::string kDefaultColumnFamilyName("default");
   KVImpl::~KVImpl() {
+    FlushWriteBackBuffers();
     CloseAio();
   }
   KVImpl::KVImpl(const DBOptions& options, const std::string& dbname, const std::string& device)
       :env_(options.env),
        options_(options),
        dbname_(dbname),
-       device_(device) {
+       device_(device),
+       stats_(options.statistics.get()) {
        default_cf_handle_ = NULL;
        is_default_open_ = false;
        req_size_ = MAX_AIO_REQ_COUNT;
@@ -149,6 +158,8 @@ namespace shannon {
         handles->push_back(column_family_handle);
         /* save a copy in the db object */
         handles_.push_back(column_family_handle);
+        SetWriteBackBuffer(column_family_descriptor.options, cfhandle.cf_index,
+                           column_family_descriptor.name);
         /* set cache size */
         if (column_family_descriptor.options.cache_size > 0) {
             cache.db = this->db_;
@@ -197,6 +208,20 @@ namespace shannon {
     if (column_family == NULL) {
         return Status::InvalidArgument(strerror(errno));
     }
+    StopWatch sw(stats_, DB_DELETE_KEY);
+    std::shared_ptr<WriteBackBuffer> buffer = GetWriteBackBuffer(column_family);
+    std::unique_lock<std::mutex> buffer_lock;
+    if (buffer != NULL) {
+        buffer_lock = std::unique_lock<std::mutex>(buffer->mu);
+        if (!options.sync) {
+            return BufferWrite(buffer.get(), kDeleteRecord, key, Slice());
+        }
+        /* the buffered writes go first, then this one is synced */
+        s = FlushWriteBackBufferLocked(buffer.get());
+        if (!s.ok()) {
+            return s;
+        }
+    }
     memset(&kv, 0, sizeof(kv));
     kv.db = db_;
     kv.key = (char *)key.data();
@@ -205,11 +230,12 @@ namespace shannon {
     kv.sync = options.sync ? 1 : 0;
     kv.fill_cache = options.fill_cache ? 1 : 0;
     kv.aio = 0;
-    ret = ioctl(fd_, DEL_KV, &kv);
+    ret = PerfIoctl(kPerfIoctlDelete, fd_, DEL_KV, &kv);
     if (ret < 0) {
         std::cout<<"ioctl del kv failed!"<<std::endl;
         return Status::NotFound(key.data());
     }
+    RecordTick(stats_, NUMBER_KEYS_DELETED);
     return s;
   }
 
@@ -224,6 +250,11 @@ namespace shannon {
       fprintf(stderr, "%s readbatch is not valid\n", __FUNCTION__);
       return Status::Corruption();
     }
+    s = FlushWriteBackBuffers();
+    if (!s.ok()) {
+      return s;
+    }
+    StopWatch sw(stats_, DB_READ);
     ReadBatchInternal::SetHandle(my_batch, db_);
     // set fill cache
     if (options.fill_cache) {
@@ -235,11 +266,15 @@ namespace shannon {
     ReadBatchInternal::SetSnapshot(my_batch, (options.snapshot != NULL
         ? options.snapshot->GetSequenceNumber() : 0));
     ReadBatchInternal::SetFailedCmdCount(my_batch, &failed_cmd_count);
-    int ret = ioctl(fd_, READ_BATCH, ReadBatchInternal::Contents(my_batch).data());
+    int ret = PerfIoctl(kPerfIoctlReadBatch, fd_, READ_BATCH,
+        const_cast<char*>(ReadBatchInternal::Contents(my_batch).data()));
     if (ret < 0) {
+      RecordTick(stats_, NUMBER_IOCTL_ERRORS);
       return Status::IOError(strerror(errno));
     }
     const std::vector<char*> c_values = ReadBatchInternal::GetValues(my_batch);
+    RecordTick(stats_, NUMBER_READ_BATCH);
+    RecordTick(stats_, NUMBER_READ_BATCH_KEYS, c_values.size());
     // get readbatch data
     ReadBatch read_batch;
     std::vector<int> reread_index;
@@ -260,9 +295,12 @@ namespace shannon {
           reread_index.push_back(i);
         } else {
           (*values)[i].second.assign(v, value_len_addrs);
+          PERF_COUNTER_ADD(bytes_copied, value_len_addrs);
+          RecordTick(stats_, BYTES_READ, value_len_addrs);
         }
       } else if (return_status == READBATCH_NO_KEY) {
         (*values)[i].first = shannon::Status::NotFound();
+        RecordTick(stats_, NUMBER_KEYS_NOT_FOUND);
       } else if (return_status == READBATCH_DATA_ERR) {
         (*values)[i].first = shannon::Status::Corruption("data error");
       } else if (return_status == READBATCH_VAL_BUF_ERR) {
@@ -271,6 +309,9 @@ namespace shannon {
     }
     // reread
     if (reread_index.size() > 0) {
+      PERF_COUNTER_ADD(read_reread_count, 1);
+      PERF_COUNTER_ADD(read_reread_keys, reread_index.size());
+      RecordTick(stats_, NUMBER_READ_BATCH_REREAD);
       if (!ReadBatchInternal::Valid(&read_batch)) {
         fprintf(stderr, "%s readbatch is not valid\n", __FUNCTION__);
         return Status::Corruption();
@@ -286,8 +327,10 @@ namespace shannon {
       ReadBatchInternal::SetSnapshot(&read_batch, (options.snapshot != NULL
           ? options.snapshot->GetSequenceNumber() : 0));
       ReadBatchInternal::SetFailedCmdCount(&read_batch, &failed_cmd_count);
-      int ret = ioctl(fd_, READ_BATCH, ReadBatchInternal::Contents(&read_batch).data());
+      int ret = PerfIoctl(kPerfIoctlReadBatch, fd_, READ_BATCH,
+          const_cast<char*>(ReadBatchInternal::Contents(&read_batch).data()));
       if (ret < 0) {
+        RecordTick(stats_, NUMBER_IOCTL_ERRORS);
         return Status::IOError(strerror(errno));
       }
       const std::vector<char*> n_c_values = ReadBatchInternal::GetValues(&read_batch);
@@ -303,12 +346,15 @@ namespace shannon {
         assert(cmd->value_buf_size == value_len_addrs);
         if (return_status == READBATCH_SUCCESS) {
           (*values)[reread_index[i]].second.assign(v, value_len_addrs);
+          PERF_COUNTER_ADD(bytes_copied, value_len_addrs);
+          RecordTick(stats_, BYTES_READ, value_len_addrs);
         } else if (return_status == READBATCH_NO_KEY) {
-          (*values)[i].first = shannon::Status::NotFound();
+          (*values)[reread_index[i]].first = shannon::Status::NotFound();
+          RecordTick(stats_, NUMBER_KEYS_NOT_FOUND);
         } else if (return_status == READBATCH_DATA_ERR) {
-          (*values)[i].first = shannon::Status::Corruption("data error");
+          (*values)[reread_index[i]].first = shannon::Status::Corruption("data error");
         } else if (return_status == READBATCH_VAL_BUF_ERR) {
-          (*values)[i].first = shannon::Status::Corruption("value buffer error");
+          (*values)[reread_index[i]].first = shannon::Status::Corruption("value buffer error");
         }
       }
       read_batch.Clear();
@@ -329,7 +375,12 @@ namespace shannon {
       fprintf(stderr, "%s writebatch is not valid\n", __FUNCTION__);
       return Status::Corruption();
     }
+    Status s = FlushWriteBackBuffers();
+    if (!s.ok()) {
+      return s;
+    }
 
+    StopWatch sw(stats_, DB_WRITE);
     WriteBatchInternal::SetHandle(my_batch, db_);
     if (options.fill_cache) {
       WriteBatchInternal::SetFillCache(my_batch, 1);
@@ -338,15 +389,29 @@ namespace shannon {
     }
 
     my_batch->SetOffset();
-    int ret = ioctl(fd_, WRITE_BATCH, WriteBatchInternal::Contents(my_batch).data());
+    int ret = PerfIoctl(kPerfIoctlWriteBatch, fd_, WRITE_BATCH,
+        const_cast<char*>(WriteBatchInternal::Contents(my_batch).data()));
     if (ret < 0) {
+      RecordTick(stats_, NUMBER_IOCTL_ERRORS);
       return Status::IOError(strerror(errno));
     }
+    RecordTick(stats_, NUMBER_WRITE_BATCH);
+    RecordTick(stats_, NUMBER_WRITE_BATCH_KEYS,
+               WriteBatchInternal::Count(my_batch));
 
     return Status::OK();
   }
 
   Status KVImpl::WriteNonatomic(const WriteOptions& options, WriteBatchNonatomic* my_batch) {
+    Status s = FlushWriteBackBuffers();
+    if (!s.ok()) {
+      return s;
+    }
+    return WriteNonatomicToDevice(options, my_batch);
+  }
+
+  Status KVImpl::WriteNonatomicToDevice(const WriteOptions& options,
+                                        WriteBatchNonatomic* my_batch) {
     if (my_batch == nullptr) {
       return Status::Corruption("Batch is nullptr!");
     }
@@ -359,6 +424,7 @@ namespace shannon {
       fprintf(stderr, "%s writebatch is not valid\n", __FUNCTION__);
       return Status::Corruption();
     }
+    StopWatch sw(stats_, DB_WRITE_NONATOMIC);
     WriteBatchInternalNonatomic::SetHandle(my_batch, db_);
     if (options.fill_cache) {
       WriteBatchInternalNonatomic::SetFillCache(my_batch, 1);
@@ -367,10 +433,15 @@ namespace shannon {
       WriteBatchInternalNonatomic::SetFillCache(my_batch, 0);
     }
     my_batch->SetOffset();
-    int ret = ioctl(fd_, WRITE_BATCH_NONATOMIC, WriteBatchInternalNonatomic::Contents(my_batch).data());
+    int ret = PerfIoctl(kPerfIoctlWriteBatchNonatomic, fd_, WRITE_BATCH_NONATOMIC,
+        const_cast<char*>(WriteBatchInternalNonatomic::Contents(my_batch).data()));
     if (ret < 0) {
+      RecordTick(stats_, NUMBER_IOCTL_ERRORS);
       return Status::IOError(strerror(errno));
     }
+    RecordTick(stats_, NUMBER_WRITE_BATCH_NONATOMIC);
+    RecordTick(stats_, NUMBER_WRITE_BATCH_KEYS,
+               WriteBatchInternalNonatomic::Count(my_batch));
 
     return Status::OK();
   }
@@ -387,6 +458,20 @@ namespace shannon {
     if (column_family == NULL) {
         return Status::InvalidArgument(strerror(errno));
     }
+    StopWatch sw(stats_, DB_PUT);
+    std::shared_ptr<WriteBackBuffer> buffer = GetWriteBackBuffer(column_family);
+    std::unique_lock<std::mutex> buffer_lock;
+    if (buffer != NULL) {
+        buffer_lock = std::unique_lock<std::mutex>(buffer->mu);
+        if (!options.sync) {
+            return BufferWrite(buffer.get(), kPutRecord, key, value);
+        }
+        /* the buffered writes go first, then this one is synced */
+        s = FlushWriteBackBufferLocked(buffer.get());
+        if (!s.ok()) {
+            return s;
+        }
+    }
     memset(&kv, 0, sizeof(kv));
     kv.db = db_;
     kv.cf_index = (reinterpret_cast<const ColumnFamilyHandle* >(column_family))->GetID();
@@ -397,10 +482,13 @@ namespace shannon {
     kv.sync = options.sync ? 1 : 0;
     kv.fill_cache = options.fill_cache ? 1 : 0;
     kv.aio = 0;
-    int ret = ioctl(fd_, PUT_KV, &kv);
+    int ret = PerfIoctl(kPerfIoctlPut, fd_, PUT_KV, &kv);
     if (ret < 0) {
+        RecordTick(stats_, NUMBER_IOCTL_ERRORS);
         return Status::IOError(key.data());
     }
+    RecordTick(stats_, NUMBER_KEYS_WRITTEN);
+    RecordTick(stats_, BYTES_WRITTEN, key.size() + value.size());
     return s;
   }
 
@@ -414,11 +502,27 @@ namespace shannon {
     struct venice_kv kv;
     char *buf;
 
+    StopWatch sw(stats_, DB_GET);
+    std::shared_ptr<WriteBackBuffer> buffer = GetWriteBackBuffer(column_family);
+    if (buffer != NULL && options.snapshot == NULL) {
+        std::lock_guard<std::mutex> lock(buffer->mu);
+        WriteType type;
+        if (buffer->mem->Get(key, &type, value)) {
+            if (type == kDeleteRecord) {
+                RecordTick(stats_, NUMBER_KEYS_NOT_FOUND);
+                return Status::NotFound(key.data());
+            }
+            RecordTick(stats_, NUMBER_KEYS_READ);
+            RecordTick(stats_, BYTES_READ, value->size());
+            return s;
+        }
+    }
     buf = (char *)malloc(MAX_VALUE_SIZE);
     if (buf == NULL) {
         cerr << "malloc mem fail!" <<endl;
         return Status::IOError("malloc mem fail!\n");
     }
+    PERF_HEAP_ALLOC(MAX_VALUE_SIZE);
     memset(&kv, 0, sizeof(kv));
     kv.db = db_;
     kv.cf_index = (reinterpret_cast<const ColumnFamilyHandle* >(column_family))->GetID();
@@ -430,14 +534,20 @@ namespace shannon {
     kv.snapshot_id = options.snapshot != NULL
         ? options.snapshot->GetSequenceNumber() : 0;
     kv.aio = 0;
-    int ret = ioctl(fd_, GET_KV, &kv);
+    int ret = PerfIoctl(kPerfIoctlGet, fd_, GET_KV, &kv);
     if (ret < 0) {
         free(buf);
-        if (ENXIO == errno)
+        if (ENXIO == errno) {
+            RecordTick(stats_, NUMBER_KEYS_NOT_FOUND);
             return Status::NotFound(key.data());
+        }
+        RecordTick(stats_, NUMBER_IOCTL_ERRORS);
         return Status::IOError(key.data());
     }
     value->assign(buf, kv.value_len);
+    PERF_COUNTER_ADD(bytes_copied, kv.value_len);
+    RecordTick(stats_, NUMBER_KEYS_READ);
+    RecordTick(stats_, BYTES_READ, kv.value_len);
     free(buf);
     return s;
   }
@@ -453,6 +563,15 @@ namespace shannon {
 
     if (key.size() > MAX_KEY_SIZE)
       return Status::Corruption("the length of key is invalid !!!");
+    StopWatch sw(stats_, DB_KEY_EXIST);
+    std::shared_ptr<WriteBackBuffer> buffer = GetWriteBackBuffer(column_family);
+    if (buffer != NULL && options.snapshot == NULL) {
+        std::lock_guard<std::mutex> lock(buffer->mu);
+        WriteType type;
+        if (buffer->mem->Get(key, &type, NULL)) {
+            return type == kPutRecord ? s : Status::NotFound(key.data());
+        }
+    }
     memset(&status, 0, sizeof(struct uapi_key_status));
 
     status.db_index = db_;
@@ -462,7 +581,7 @@ namespace shannon {
     status.key_len = key.size();
     status.snapshot_id = options.snapshot != NULL
         ? options.snapshot->GetSequenceNumber() : 0;
-    int ret = ioctl(fd_, IOCTL_KEY_STATUS, &status);
+    int ret = PerfIoctl(kPerfIoctlKeyStatus, fd_, IOCTL_KEY_STATUS, &status);
     if (ret < 0)
       return Status::IOError(key.data());
     if (status.exist == 0)
@@ -479,14 +598,86 @@ namespace shannon {
       cerr << "please use function: IngestExternFile(char *, int)!" <<endl;
       return Status::Corruption("handles is NULL!\n");
     }
+    // the column families of the file are only known once it is read,
+    // so all the buffers go first, lest they overwrite the file's keys
+    Status s = FlushWriteBackBuffers();
+    if (!s.ok()) {
+      return s;
+    }
     return AnalyzeSst(sst_filename, verify, this, handles);
   }
 
   Status KVImpl::IngestExternFile(char *sst_filename, int verify)
   {
+    Status s = FlushWriteBackBuffers();
+    if (!s.ok()) {
+      return s;
+    }
     return AnalyzeSst(sst_filename, verify, this, NULL);
   }
 
+  Status KVImpl::IngestExternalFiles(const std::vector<std::string>& files,
+                   const IngestExternalFileOptions& options,
+                   std::vector<ColumnFamilyHandle*>* handles,
+                   std::vector<IngestExternalFileReport>* reports)
+  {
+    Status flushed = FlushWriteBackBuffers();
+    if (!flushed.ok()) {
+      return flushed;
+    }
+    if (options.merge_files) {
+      std::vector<IngestExternalFileReport> results;
+      Status s = IngestMergedFiles(files, this, handles, options, &results);
+      if (reports != NULL)
+        reports->swap(results);
+      return s;
+    }
+    std::vector<IngestExternalFileReport> results(files.size());
+    IngestExternalFileOptions file_options = options;
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+    int workers = options.max_files_in_parallel > 0
+        ? options.max_files_in_parallel : cores;
+    workers = std::min(workers, (int)files.size());
+    if (file_options.decode_threads <= 0 && workers > 0)
+      file_options.decode_threads = std::max(1, cores / workers);
+
+    // workers take the next file until none is left, or one failed
+    // under fail_fast
+    std::atomic<size_t> next_file(0);
+    std::atomic<bool> failed(false);
+    auto ingest = [&]() {
+      for (size_t i = next_file++; i < files.size(); i = next_file++) {
+        IngestExternalFileReport *report = &results[i];
+        report->filename = files[i];
+        if (options.fail_fast && failed.load()) {
+          report->status = Status::Aborted("an earlier file failed", files[i]);
+          continue;
+        }
+        report->status = AnalyzeSst(const_cast<char *>(files[i].c_str()),
+                                    options.verify_checksums, this, handles,
+                                    file_options, report);
+        if (!report->status.ok()) {
+          cerr << "ingest " << files[i] << " failed: "
+               << report->status.ToString() << endl;
+          failed = true;
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; i++)
+      threads.push_back(std::thread(ingest));
+    ingest();
+    for (size_t i = 0; i < threads.size(); i++)
+      threads[i].join();
+
+    Status s;
+    for (size_t i = 0; i < results.size() && s.ok(); i++)
+      s = results[i].status;
+    if (reports != NULL)
+      reports->swap(results);
+    return s;
+  }
+
   Status KVImpl::BuildTable(const std::string& dirname,
                           std::vector<ColumnFamilyHandle *> &handles,
                           std::vector<Iterator *> &iterators)
@@ -507,12 +698,20 @@ namespace shannon {
     if (!s.ok()) {
       return s;
     }
-    for (int i = 0; i <= handles.size() - 1; i++) {
-		iterators[i]->SeekToFirst();
-		s = BuildSst(dirname, handles[i]->GetName().data(), env_, handles[i],
-					 iterators[i], options_.target_file_size_base, 1);
+    SstExportOptions export_options;
+    export_options.table_options = Options(options_, ColumnFamilyOptions());
+    export_options.target_file_size = options_.target_file_size_base;
+    export_options.statistics = stats_;
+    // Every job runs a reader, an encoder and a writer thread.
+    if (options_.max_background_flushes > 0) {
+      export_options.max_jobs = options_.max_background_flushes;
+    } else {
+      export_options.max_jobs =
+          std::max(1u, std::thread::hardware_concurrency() / 2);
     }
-    return s;
+    // The throughput of each stage is in the SST_EXPORT_* tickers.
+    return ExportColumnFamilies(dirname, env_, export_options, handles,
+                                iterators, NULL);
   }
 
 Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filename,
@@ -540,8 +739,13 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     struct uapi_snapshot snap;
     int ret = 0;
     Status s;
+    s = FlushWriteBackBuffers();
+    if (!s.ok()) {
+      status_ = s;
+      return NULL;
+    }
     snap.db = db_;
-    ret = ioctl(fd_, CREATE_SNAPSHOT, &snap);
+    ret = PerfIoctl(kPerfIoctlSnapshot, fd_, CREATE_SNAPSHOT, &snap);
     if (ret < 0) {
       status_ = Status::IOError("ioctl create_snapshot failed!!!\n");
       return NULL;
@@ -557,7 +761,7 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     Status s;
     snap.db = db_;
     snap.snapshot_id = snapshot->GetSequenceNumber();
-    ret = ioctl(fd_, RELEASE_SNAPSHOT, &snap);
+    ret = PerfIoctl(kPerfIoctlSnapshot, fd_, RELEASE_SNAPSHOT, &snap);
     if (ret < 0) {
       return Status::IOError("ioctl release_snapshot failed!!!\n");
     }
@@ -592,7 +796,9 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     iter->iters[0].timestamp = iter->timestamp;
     iter->iters[0].only_read_key = iter->only_read_key;
     iter->count = 1;
-    ret = ioctl(fd_, IOCTL_CREATE_ITERATOR, iter);
+    std::shared_ptr<WriteBackMemTable> mem =
+        GetWriteBackMem(options, column_family->GetID());
+    ret = PerfIoctl(kPerfIoctlIterCreate, fd_, IOCTL_CREATE_ITERATOR, iter);
     if (ret < 0) {
         status_ = Status::IOError("ioctl create_iterator failed!!!\n");
         delete iter;
@@ -601,7 +807,7 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
 
     Iterator* iterator = NewDBIterator(this, iter->iters[0].iter_index, iter->iters[0].cf_index, iter->timestamp);
     delete iter;
-    return iterator;
+    return MergeWriteBackBuffer(iterator, mem);
   }
 
   Status KVImpl::NewIterators(const ReadOptions& options,
@@ -633,7 +839,11 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
                 (column_families[i]))->GetID();
         iter->iters[i].only_read_key = iter->only_read_key;
     }
-    ret = ioctl(fd_, IOCTL_CREATE_ITERATOR, iter);
+    std::vector<std::shared_ptr<WriteBackMemTable> > mems;
+    for (int i = 0; i < column_families.size(); i ++) {
+        mems.push_back(GetWriteBackMem(options, iter->iters[i].cf_index));
+    }
+    ret = PerfIoctl(kPerfIoctlIterCreate, fd_, IOCTL_CREATE_ITERATOR, iter);
     /* create iterator failed! */
     if (ret < 0) {
         free(iter);
@@ -650,7 +860,7 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
             iterators->clear();
             return status_;
         }
-        iterators->push_back(iterator);
+        iterators->push_back(MergeWriteBackBuffer(iterator, mems[i]));
     }
     return s;
   }
@@ -678,6 +888,7 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     if (*handle == NULL) {
         return Status::IOError("malloc mem failed!\n");
     }
+    SetWriteBackBuffer(options, cfhandle.cf_index, default_name);
     return s;
   }
 
@@ -741,6 +952,8 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     if (ret < 0) {
         return Status::IOError("remove columnfamily failed!");
     }
+    /* buffered writes of the column family are dropped with it */
+    SetWriteBackBuffer(ColumnFamilyOptions(), cfhandle.cf_index, cf_name);
     return s;
   }
 
@@ -780,7 +993,10 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
       cerr << "null mem fail!" << endl;
       return Status::InvalidArgument("null mem fail!\n");
     }
-    Status s;
+    Status s = FlushWriteBackBuffer(column_family);
+    if (!s.ok()) {
+      return s;
+    }
     int32_t requestid = req_id_que_.borrow_id();
     if (requestid < 0) {
       return Status::InvalidArgument("has been close !");
@@ -799,14 +1015,20 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     kv->value_buf_size = buf_len;
     kv->fill_cache = options.fill_cache ? 1 : 0;
     kv->aio = 1;
+    kv->partial = 0;
+    kv->partial_offset = 0;
     kv->snapshot_id =
         options.snapshot != NULL ? options.snapshot->GetSequenceNumber() : 0;
-    int ret = ioctl(fd_, GET_KV, kv);
+    if (stats_ != NULL) {
+      aio_start_micros_[requestid] = StatsNowMicros();
+    }
+    int ret = PerfIoctl(kPerfIoctlGet, fd_, GET_KV, kv);
     if (ret < 0) {
       req_id_que_.give_back_id(requestid);
       if (ENXIO == errno) return Status::NotFound(key.data());
       return Status::IOError(key.data());
     }
+    RecordTick(stats_, NUMBER_AIO_SUBMITTED);
     return Status::OK();
   }
 
@@ -821,6 +1043,10 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     if (column_family == NULL || cb == NULL) {
       return Status::InvalidArgument(strerror(errno));
     }
+    Status s = FlushWriteBackBuffer(column_family);
+    if (!s.ok()) {
+      return s;
+    }
     int32_t requestid = req_id_que_.borrow_id();
     if (requestid < 0) {
       return Status::InvalidArgument("has been close !");
@@ -839,12 +1065,20 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     kv->value_len = value.size();
     kv->sync = options.sync ? 1 : 0;
     kv->aio = 1;
+    kv->partial = 0;
+    kv->partial_offset = 0;
     kv->fill_cache = options.fill_cache ? 1 : 0;
-    int ret = ioctl(fd_, PUT_KV, kv);
+    if (stats_ != NULL) {
+      aio_start_micros_[requestid] = StatsNowMicros();
+    }
+    int ret = PerfIoctl(kPerfIoctlPut, fd_, PUT_KV, kv);
     if (ret < 0) {
       req_id_que_.give_back_id(requestid);
       return Status::IOError(key.data());
     }
+    RecordTick(stats_, NUMBER_AIO_SUBMITTED);
+    RecordTick(stats_, NUMBER_KEYS_WRITTEN);
+    RecordTick(stats_, BYTES_WRITTEN, key.size() + value.size());
     return Status::OK();
   }
 
@@ -859,6 +1093,10 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     if (column_family == NULL || cb == NULL) {
       return Status::InvalidArgument(strerror(errno));
     }
+    Status s = FlushWriteBackBuffer(column_family);
+    if (!s.ok()) {
+      return s;
+    }
     int32_t requestid = req_id_que_.borrow_id();
     if (requestid < 0) {
       return Status::InvalidArgument("has been close !");
@@ -875,13 +1113,254 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     kv->key_len = key.size();
     kv->sync = options.sync ? 1 : 0;
     kv->aio = 1;
+    kv->partial = 0;
+    kv->partial_offset = 0;
     kv->fill_cache = options.fill_cache ? 1 : 0;
-    int ret = ioctl(fd_, DEL_KV, kv);
+    if (stats_ != NULL) {
+      aio_start_micros_[requestid] = StatsNowMicros();
+    }
+    int ret = PerfIoctl(kPerfIoctlDelete, fd_, DEL_KV, kv);
     if (ret < 0) {
       req_id_que_.give_back_id(requestid);
       if (ENXIO == errno) return Status::NotFound(key.data());
       return Status::IOError(key.data());
     }
+    RecordTick(stats_, NUMBER_AIO_SUBMITTED);
+    RecordTick(stats_, NUMBER_KEYS_DELETED);
+    return Status::OK();
+  }
+
+  Status KVImpl::CheckRange(const Slice& key, uint64_t offset, size_t len,
+                            bool need_aligned) {
+    if (key.size() > MAX_KEY_SIZE) {
+      return Status::InvalidArgument("the length of key is invalid !!!");
+    }
+    if (need_aligned && (offset % PARTIAL_OFFSET_ALIGN) != 0) {
+      return Status::InvalidArgument("partial offset must be 4KB aligned");
+    }
+    if (offset > MAX_VALUE_SIZE || len > MAX_VALUE_SIZE - offset) {
+      return Status::InvalidArgument("partial range exceeds max value size");
+    }
+    return Status::OK();
+  }
+
+  // Map the errno of a failed partial GET_KV/PUT_KV to a status.
+  Status KVImpl::PartialError(const Slice& key) {
+    if (ENXIO == errno) {
+      return Status::NotFound(key.data());
+    }
+    if (EINVAL == errno || EOPNOTSUPP == errno || ENOTTY == errno) {
+      return Status::NotSupported("partial value access is not supported "
+                                  "by the device", strerror(errno));
+    }
+    if (ERANGE == errno) {
+      return Status::InvalidArgument("partial offset beyond value end");
+    }
+    RecordTick(stats_, NUMBER_IOCTL_ERRORS);
+    return Status::IOError(key.data(), strerror(errno));
+  }
+
+  Status KVImpl::GetRange(const ReadOptions& options,
+                          ColumnFamilyHandle* column_family, const Slice& key,
+                          uint64_t offset, size_t len, char* buf,
+                          size_t* read_len) {
+    struct venice_kv kv;
+    if (column_family == NULL || buf == NULL || read_len == NULL) {
+      return Status::InvalidArgument("column family, buf or read_len is null");
+    }
+    Status s = CheckRange(key, offset, len, false);
+    if (!s.ok()) {
+      return s;
+    }
+    s = FlushWriteBackBuffer(column_family);
+    if (!s.ok()) {
+      return s;
+    }
+    *read_len = 0;
+    if (len == 0) {
+      return s;
+    }
+    StopWatch sw(stats_, DB_GET_RANGE);
+    /* the device reads from a 4KB boundary, bounce unaligned requests */
+    uint64_t aligned_offset = offset & ~(PARTIAL_OFFSET_ALIGN - 1);
+    size_t head = offset - aligned_offset;
+    char *dst = buf;
+    if (head != 0) {
+      dst = (char *)malloc(head + len);
+      if (dst == NULL) {
+        return Status::IOError("malloc mem fail!\n");
+      }
+      PERF_HEAP_ALLOC(head + len);
+    }
+    memset(&kv, 0, sizeof(kv));
+    kv.db = db_;
+    kv.cf_index = column_family->GetID();
+    kv.key = (char *)key.data();
+    kv.key_len = key.size();
+    kv.value = dst;
+    kv.value_buf_size = head + len;
+    kv.partial = 1;
+    kv.partial_offset = aligned_offset;
+    kv.fill_cache = options.fill_cache ? 1 : 0;
+    kv.snapshot_id = options.snapshot != NULL
+        ? options.snapshot->GetSequenceNumber() : 0;
+    kv.aio = 0;
+    int ret = PerfIoctl(kPerfIoctlGet, fd_, GET_KV, &kv);
+    if (ret < 0) {
+      s = PartialError(key);
+    } else {
+      size_t got = std::min((size_t)kv.value_len, head + len);
+      got = got > head ? got - head : 0;
+      if (head != 0) {
+        memcpy(buf, dst + head, got);
+        PERF_COUNTER_ADD(bytes_copied, got);
+      }
+      *read_len = got;
+      RecordTick(stats_, BYTES_READ, got);
+    }
+    if (head != 0) {
+      free(dst);
+    }
+    return s;
+  }
+
+  Status KVImpl::PutRange(const WriteOptions& options,
+                          ColumnFamilyHandle* column_family, const Slice& key,
+                          uint64_t offset, const Slice& data) {
+    struct venice_kv kv;
+    if (column_family == NULL) {
+      return Status::InvalidArgument("column family is null");
+    }
+    Status s = CheckRange(key, offset, data.size(), true);
+    if (!s.ok()) {
+      return s;
+    }
+    s = FlushWriteBackBuffer(column_family);
+    if (!s.ok()) {
+      return s;
+    }
+    StopWatch sw(stats_, DB_PUT_RANGE);
+    memset(&kv, 0, sizeof(kv));
+    kv.db = db_;
+    kv.cf_index = column_family->GetID();
+    kv.key = (char *)key.data();
+    kv.key_len = key.size();
+    kv.value = (char *)data.data();
+    kv.value_len = data.size();
+    kv.partial = 1;
+    kv.partial_offset = offset;
+    kv.sync = options.sync ? 1 : 0;
+    kv.fill_cache = options.fill_cache ? 1 : 0;
+    kv.aio = 0;
+    int ret = PerfIoctl(kPerfIoctlPut, fd_, PUT_KV, &kv);
+    if (ret < 0) {
+      return PartialError(key);
+    }
+    RecordTick(stats_, BYTES_WRITTEN, data.size());
+    return s;
+  }
+
+  Status KVImpl::GetRangeAsync(const ReadOptions& options,
+                               ColumnFamilyHandle* column_family,
+                               const Slice& key, uint64_t offset,
+                               char* val_buf, const int32_t buf_len,
+                               int32_t* val_len, CallBackPtr* cb) {
+    if (column_family == NULL || val_buf == NULL || cb == NULL ||
+        buf_len < 0) {
+      return Status::InvalidArgument("null mem fail!\n");
+    }
+    Status s = CheckRange(key, offset, buf_len, true);
+    if (!s.ok()) {
+      return s;
+    }
+    s = FlushWriteBackBuffer(column_family);
+    if (!s.ok()) {
+      return s;
+    }
+    int32_t requestid = req_id_que_.borrow_id();
+    if (requestid < 0) {
+      return Status::InvalidArgument("has been close !");
+    }
+    val_lens_[requestid] = val_len;
+    cb_mp_[requestid] = cb;
+    struct venice_kv* kv = &cmds_[requestid];
+    memset(kv, 0, sizeof(*kv));
+    kv->reqid = requestid;
+    kv->ctxid = aioctx_.ctxid;
+    kv->seqnum = aioctx_.seqnum;
+    kv->db = db_;
+    kv->cf_index = column_family->GetID();
+    kv->key = (char*)key.data();
+    kv->key_len = key.size();
+    kv->value = val_buf;
+    kv->value_buf_size = buf_len;
+    kv->partial = 1;
+    kv->partial_offset = offset;
+    kv->fill_cache = options.fill_cache ? 1 : 0;
+    kv->aio = 1;
+    kv->snapshot_id =
+        options.snapshot != NULL ? options.snapshot->GetSequenceNumber() : 0;
+    if (stats_ != NULL) {
+      aio_start_micros_[requestid] = StatsNowMicros();
+    }
+    int ret = PerfIoctl(kPerfIoctlGet, fd_, GET_KV, kv);
+    if (ret < 0) {
+      s = PartialError(key);
+      req_id_que_.give_back_id(requestid);
+      return s;
+    }
+    RecordTick(stats_, NUMBER_AIO_SUBMITTED);
+    return Status::OK();
+  }
+
+  Status KVImpl::PutRangeAsync(const WriteOptions& options,
+                               ColumnFamilyHandle* column_family,
+                               const Slice& key, uint64_t offset,
+                               const Slice& data, CallBackPtr* cb) {
+    if (column_family == NULL || cb == NULL) {
+      return Status::InvalidArgument("column family or callback is null");
+    }
+    Status s = CheckRange(key, offset, data.size(), true);
+    if (!s.ok()) {
+      return s;
+    }
+    s = FlushWriteBackBuffer(column_family);
+    if (!s.ok()) {
+      return s;
+    }
+    int32_t requestid = req_id_que_.borrow_id();
+    if (requestid < 0) {
+      return Status::InvalidArgument("has been close !");
+    }
+    cb_mp_[requestid] = cb;
+    val_lens_[requestid] = nullptr;
+    struct venice_kv* kv = &cmds_[requestid];
+    memset(kv, 0, sizeof(*kv));
+    kv->reqid = requestid;
+    kv->ctxid = aioctx_.ctxid;
+    kv->seqnum = aioctx_.seqnum;
+    kv->db = db_;
+    kv->cf_index = column_family->GetID();
+    kv->key = (char*)key.data();
+    kv->key_len = key.size();
+    kv->value = (char*)data.data();
+    kv->value_len = data.size();
+    kv->partial = 1;
+    kv->partial_offset = offset;
+    kv->sync = options.sync ? 1 : 0;
+    kv->aio = 1;
+    kv->fill_cache = options.fill_cache ? 1 : 0;
+    if (stats_ != NULL) {
+      aio_start_micros_[requestid] = StatsNowMicros();
+    }
+    int ret = PerfIoctl(kPerfIoctlPut, fd_, PUT_KV, kv);
+    if (ret < 0) {
+      s = PartialError(key);
+      req_id_que_.give_back_id(requestid);
+      return s;
+    }
+    RecordTick(stats_, NUMBER_AIO_SUBMITTED);
+    RecordTick(stats_, BYTES_WRITTEN, data.size());
     return Status::OK();
   }
 
@@ -903,6 +1382,8 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
       // std::cerr << "fail to read from eventfd .." << std::endl;
       return Status::InvalidArgument("fail to read from eventfd ..\n");
     }
+    uint64_t reaped = 0;
+    uint64_t now_micros = stats_ != NULL ? StatsNowMicros() : 0;
 
     while (eftd_ctx) {
       struct uapi_aioevents aioevents;
@@ -913,7 +1394,8 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
       aioevents.nr = check_nr;
       aioevents.ctxid = aioctx_.ctxid;
       aioevents.seqnum = aioctx_.seqnum;
-      if (ioctl(fd_, IOCTL_GET_IOEVENTS, &aioevents) < 0) {
+      if (PerfIoctl(kPerfIoctlAioEvents, fd_, IOCTL_GET_IOEVENTS,
+                    &aioevents) < 0) {
         std::cerr << "NVME_IOCTL_GET_AIOEVENT failed" << std::endl;
         return Status::InvalidArgument("NVME_IOCTL_GET_AIOEVENT failed\n");
       }
@@ -927,7 +1409,14 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
         if (val_lens_[event->reqid] != nullptr) {
           *val_lens_[event->reqid] = kv->value_len;
         }
+        if (stats_ != NULL) {
+          MeasureTime(stats_, AIO_SUBMIT_TO_COMPLETION,
+                      now_micros - aio_start_micros_[event->reqid]);
+          RecordTick(stats_, NUMBER_AIO_COMPLETED);
+        }
+        reaped++;
         if (aioevents.events[i].ret != 0) {
+          RecordTick(stats_, NUMBER_AIO_FAILED);
           cb_pt->call_ptr(Status::InvalidArgument("aio submit error"));
         } else {
           cb_pt->call_ptr(Status::OK());
@@ -935,6 +1424,7 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
         req_id_que_.give_back_id(event->reqid);
       }
     }
+    MeasureTime(stats_, POLL_COMPLETION_BATCH_SIZE, reaped);
     return Status::OK();
   }
 
@@ -948,6 +1438,7 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     cb_mp_.resize(req_size_);
     cmds_.resize(req_size_);
     val_lens_.resize(req_size_);
+    aio_start_micros_.resize(req_size_);
     epollfd_dev_ = epoll_create(req_size_);
     if (epollfd_dev_ < 0) {
       std::cout << "Unable to create Epoll FD; error = " << epollfd_dev_
@@ -996,6 +1487,174 @@ Status KVImpl::BuildSstFile(const std::string &dirname, const std::string &filen
     return Status::OK();
   }
 
+  void KVImpl::SetWriteBackBuffer(const ColumnFamilyOptions& options,
+                                  int cf_index, std::string name) {
+    if (cf_index < 0 || cf_index >= MAX_CF_COUNT) {
+      return;
+    }
+    std::shared_ptr<WriteBackBuffer> buffer;
+    if (options.write_back_buffer_size > 0) {
+      buffer = std::make_shared<WriteBackBuffer>(
+          db_, cf_index, name, options.write_back_buffer_size,
+          options.write_back_flush_interval_ms * 1000);
+    }
+    std::shared_ptr<WriteBackBuffer> old;
+    {
+      std::lock_guard<std::mutex> lock(write_back_mu_);
+      old = write_back_buffers_[cf_index];
+      write_back_buffers_[cf_index] = buffer;
+    }
+    if (old != NULL) {
+      /* other threads may still hold the old buffer: empty it, so that
+         it is not written to whatever column family gets cf_index next */
+      std::lock_guard<std::mutex> lock(old->mu);
+      old->mem = std::make_shared<WriteBackMemTable>();
+      old->first_write_micros = 0;
+      old->dropped = true;
+    }
+  }
+
+  std::shared_ptr<WriteBackBuffer> KVImpl::GetWriteBackBuffer(
+      const ColumnFamilyHandle* column_family) const {
+    if (column_family == NULL) {
+      return NULL;
+    }
+    uint32_t cf_index = column_family->GetID();
+    if (cf_index >= MAX_CF_COUNT) {
+      return NULL;
+    }
+    std::lock_guard<std::mutex> lock(write_back_mu_);
+    return write_back_buffers_[cf_index];
+  }
+
+  Status KVImpl::BufferWrite(WriteBackBuffer* buffer, WriteType type,
+                             const Slice& key, const Slice& value) {
+    if (key.size() > MAX_KEY_SIZE || value.size() > MAX_VALUE_SIZE) {
+      return Status::InvalidArgument("key or value is too long");
+    }
+    if (buffer->dropped) {
+      return Status::InvalidArgument("column family is dropped");
+    }
+    buffer->mem->Add(type, key, value);
+    uint64_t now = StatsNowMicros();
+    if (buffer->first_write_micros == 0) {
+      buffer->first_write_micros = now;
+    }
+    if (type == kPutRecord) {
+      RecordTick(stats_, NUMBER_KEYS_WRITTEN);
+      RecordTick(stats_, BYTES_WRITTEN, key.size() + value.size());
+    } else {
+      RecordTick(stats_, NUMBER_KEYS_DELETED);
+    }
+    if (buffer->mem->DataSize() >= buffer->max_bytes ||
+        (buffer->flush_interval_micros > 0 &&
+         now - buffer->first_write_micros >= buffer->flush_interval_micros)) {
+      return FlushWriteBackBufferLocked(buffer);
+    }
+    return Status::OK();
+  }
+
+  Status KVImpl::FlushWriteBackBufferLocked(WriteBackBuffer* buffer) {
+    if (buffer->mem->Empty()) {
+      return Status::OK();
+    }
+    Status s;
+    WriteOptions options;
+    WriteBatchNonatomic batch;
+    std::unique_ptr<WBWIIterator> iter(
+        WriteBackMemTable::NewIterator(buffer->mem));
+    for (iter->SeekToFirst(); iter->Valid(); ) {
+      WriteEntry entry = iter->Entry();
+      s = entry.type == kPutRecord
+          ? batch.Put(&buffer->handle, entry.key, entry.value)
+          : batch.Delete(&buffer->handle, entry.key);
+      if (s.IsBatchFull() &&
+          WriteBatchInternalNonatomic::Count(&batch) > 0) {
+        /* write what the batch holds, then add the entry again */
+        s = WriteNonatomicToDevice(options, &batch);
+        if (!s.ok()) {
+          return s;
+        }
+        batch.Clear();
+        continue;
+      }
+      if (!s.ok()) {
+        return s;
+      }
+      iter->Next();
+    }
+    if (WriteBatchInternalNonatomic::Count(&batch) > 0) {
+      s = WriteNonatomicToDevice(options, &batch);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    iter.reset();
+    buffer->mem = std::make_shared<WriteBackMemTable>();
+    buffer->first_write_micros = 0;
+    return s;
+  }
+
+  Status KVImpl::FlushWriteBackBuffers() {
+    std::shared_ptr<WriteBackBuffer> buffers[MAX_CF_COUNT];
+    {
+      std::lock_guard<std::mutex> lock(write_back_mu_);
+      for (int i = 0; i < MAX_CF_COUNT; i++) {
+        buffers[i] = write_back_buffers_[i];
+      }
+    }
+    for (int i = 0; i < MAX_CF_COUNT; i++) {
+      WriteBackBuffer* buffer = buffers[i].get();
+      if (buffer == NULL) {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(buffer->mu);
+      Status s = FlushWriteBackBufferLocked(buffer);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    return Status::OK();
+  }
+
+  Status KVImpl::FlushWriteBackBuffer(ColumnFamilyHandle* column_family) {
+    std::shared_ptr<WriteBackBuffer> buffer = GetWriteBackBuffer(column_family);
+    if (buffer == NULL) {
+      return Status::OK();
+    }
+    std::lock_guard<std::mutex> lock(buffer->mu);
+    return FlushWriteBackBufferLocked(buffer.get());
+  }
+
+  std::shared_ptr<WriteBackMemTable> KVImpl::GetWriteBackMem(
+      const ReadOptions& options, uint32_t cf_index) {
+    if (options.snapshot != NULL || cf_index >= MAX_CF_COUNT) {
+      return NULL;
+    }
+    std::shared_ptr<WriteBackBuffer> buffer;
+    {
+      std::lock_guard<std::mutex> lock(write_back_mu_);
+      buffer = write_back_buffers_[cf_index];
+    }
+    if (buffer == NULL) {
+      return NULL;
+    }
+    std::lock_guard<std::mutex> lock(buffer->mu);
+    if (buffer->mem->Empty()) {
+      return NULL;
+    }
+    return buffer->mem;
+  }
+
+  Iterator* KVImpl::MergeWriteBackBuffer(
+      Iterator* iterator, const std::shared_ptr<WriteBackMemTable>& mem) {
+    if (iterator == NULL || mem == NULL) {
+      return iterator;
+    }
+    return NewBaseDeltaIterator(iterator, WriteBackMemTable::NewIterator(mem),
+                                BytewiseComparator());
+  }
+
   Env* KVImpl::GetEnv() const {
       return env_;
   }
@@ -1055,22 +1714,149 @@ Status KVImpl::CompactRange(const CompactRangeOptions& options,
     if (column_family == NULL) {
       return false;
     }
-    struct uapi_cf_status cf_status;
-    int ret = -1;
-    cf_status.db_index = db_;
-    cf_status.cf_index = column_family->GetID();
-    ret = ioctl(fd_, IOCTL_CF_STATUS, &cf_status);
-    if (ret < 0) {
-      return false;
-    }
-    if (property.compare("shannon.cur-size-all-mem-tables") == 0) {
+    if (property == DB::Properties::kStats) {
+      if (stats_ == NULL) {
+        return false;
+      }
+      if (value != NULL) {
+        value->assign(stats_->ToString());
+      }
+      return true;
+    }
+    std::map<std::string, std::string> props;
+    if (property == DB::Properties::kDeviceStatus ||
+        property == DB::Properties::kDBStatus ||
+        property == DB::Properties::kCFStatus) {
+      if (!GetMapProperty(column_family, property, &props)) {
+        return false;
+      }
       stringstream ss;
-      ss<<cf_status.total_cache_size;
-      std::string s = ss.str();
+      for (auto& prop : props) {
+        ss<<prop.first<<": "<<prop.second<<"\n";
+      }
+      if (value != NULL) {
+        value->assign(ss.str());
+      }
+      return true;
+    }
+    /* single entry of one of the map properties */
+    Slice map_property;
+    std::string name;
+    if (property.starts_with(kDevicePropertyPrefix)) {
+      map_property = DB::Properties::kDeviceStatus;
+      name.assign(property.data() + kDevicePropertyPrefix.size(),
+                  property.size() - kDevicePropertyPrefix.size());
+    } else if (property.starts_with(kDBPropertyPrefix)) {
+      map_property = DB::Properties::kDBStatus;
+      name.assign(property.data() + kDBPropertyPrefix.size(),
+                  property.size() - kDBPropertyPrefix.size());
+    } else if (property.starts_with(kCFPropertyPrefix)) {
+      map_property = DB::Properties::kCFStatus;
+      name.assign(property.data() + kCFPropertyPrefix.size(),
+                  property.size() - kCFPropertyPrefix.size());
+    } else if (property == DB::Properties::kCurSizeAllMemTables) {
+      map_property = DB::Properties::kCFStatus;
+      name = "total-cache-size";
+    } else if (property == DB::Properties::kEstimateNumKeys) {
+      map_property = DB::Properties::kCFStatus;
+      name = "total-kv-count";
+    } else if (property == DB::Properties::kTotalDiskUsage) {
+      map_property = DB::Properties::kCFStatus;
+      name = "total-disk-usage";
+    } else if (property == DB::Properties::kEstimateDiskUsage) {
+      map_property = DB::Properties::kCFStatus;
+      name = "est-total-disk-usage";
+    } else if (property == DB::Properties::kCacheUsage) {
+      map_property = DB::Properties::kCFStatus;
+      name = "use-cache-size";
+    } else if (property == DB::Properties::kNumCheckpoints) {
+      map_property = DB::Properties::kDBStatus;
+      name = "num-checkpoints";
+    }
+    if (!map_property.empty()) {
+      if (!GetMapProperty(column_family, map_property, &props)) {
+        return false;
+      }
+      auto it = props.find(name);
+      if (it == props.end()) {
+        return false;
+      }
       if (value != NULL) {
-        value->assign(s);
+        value->assign(it->second);
+      }
+      return true;
+    }
+    /* let the device answer the rest, e.g. shannon.version */
+    struct uapi_get_property prop;
+    if (property.size() >= PROPERTY_BUF_SIZE) {
+      return false;
+    }
+    memset(&prop, 0, sizeof(prop));
+    memcpy(prop.prop_name, property.data(), property.size());
+    prop.db_index = db_;
+    prop.cf_index = column_family->GetID();
+    if (PerfIoctl(kPerfIoctlStatus, fd_, IOCTL_GET_PROPERTY, &prop) < 0) {
+      return false;
+    }
+    if (value != NULL) {
+      value->assign(prop.prop_val, strnlen(prop.prop_val, PROPERTY_BUF_SIZE));
+    }
+    return true;
+  }
+
+  bool KVImpl::GetMapProperty(ColumnFamilyHandle* column_family,
+          const Slice& property, std::map<std::string, std::string>* value) {
+    int ret;
+    if (column_family == NULL || value == NULL) {
+      return false;
+    }
+    if (property == DB::Properties::kDeviceStatus) {
+      struct uapi_dev_status dev_status;
+      memset(&dev_status, 0, sizeof(dev_status));
+      ret = PerfIoctl(kPerfIoctlStatus, fd_, DEVICE_STATUS, &dev_status);
+      if (ret < 0) {
+        return false;
+      }
+      DeviceStatusToMap(dev_status, value);
+      return true;
+    } else if (property == DB::Properties::kDBStatus) {
+      struct uapi_db_status db_status;
+      memset(&db_status, 0, sizeof(db_status));
+      db_status.db_index = db_;
+      ret = PerfIoctl(kPerfIoctlStatus, fd_, IOCTL_DB_STATUS, &db_status);
+      if (ret < 0) {
+        return false;
+      }
+      DBStatusToMap(db_status, value);
+      return true;
+    } else if (property == DB::Properties::kCFStatus) {
+      struct uapi_cf_status cf_status;
+      memset(&cf_status, 0, sizeof(cf_status));
+      cf_status.db_index = db_;
+      cf_status.cf_index = column_family->GetID();
+      ret = PerfIoctl(kPerfIoctlStatus, fd_, IOCTL_CF_STATUS, &cf_status);
+      if (ret < 0) {
+        return false;
       }
+      CFStatusToMap(cf_status, value);
+      return true;
+    }
+    return false;
+  }
+
+  bool KVImpl::GetIntProperty(ColumnFamilyHandle* column_family,
+          const Slice& property, uint64_t* value) {
+    std::string str_value;
+    if (value == NULL || !GetProperty(column_family, property, &str_value)) {
+      return false;
+    }
+    char *end = NULL;
+    errno = 0;
+    unsigned long long v = strtoull(str_value.c_str(), &end, 10);
+    if (str_value.empty() || errno != 0 || *end != '\0') {
+      return false;
     }
+    *value = v;
     return true;
   }
 
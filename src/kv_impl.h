@@ -14,6 +14,7 @@
 #include "src/snapshot.h"
 #include "src/column_family.h"
 #include "src/req_id_que.h"
+#include "src/write_back_buffer.h"
 
 namespace shannon {
 class KVImpl : public DB {
@@ -32,6 +33,10 @@ class KVImpl : public DB {
   virtual Status IngestExternFile(char *sst_filename, int verify,
                    std::vector<ColumnFamilyHandle*>* handles) override;
   virtual Status IngestExternFile(char *sst_filename, int verify) override;
+  virtual Status IngestExternalFiles(const std::vector<std::string>& files,
+                   const IngestExternalFileOptions& options,
+                   std::vector<ColumnFamilyHandle*>* handles,
+                   std::vector<IngestExternalFileReport>* reports) override;
   virtual Status BuildTable(const std::string& filename, std::vector<ColumnFamilyHandle*> &handles, std::vector<Iterator*> &iterators);
   virtual Status BuildSstFile(const std::string& dirname, const std::string& filename, ColumnFamilyHandle *handle, Iterator *iter, uint64_t file_size);
   virtual const Snapshot* GetSnapshot();
@@ -66,6 +71,7 @@ class KVImpl : public DB {
   virtual Status NewIterators(const ReadOptions& options,
                    const std::vector<ColumnFamilyHandle*>& column_families,
                    std::vector<Iterator*>* iterators) override;
+  virtual Status FlushWriteBackBuffer(ColumnFamilyHandle* column_family) override;
   virtual ColumnFamilyHandle* DefaultColumnFamily() const override;
 
   virtual Status GetAsync(const ReadOptions& options, const Slice& key,
@@ -86,6 +92,22 @@ class KVImpl : public DB {
                              ColumnFamilyHandle* column_family,
                              const Slice& key, CallBackPtr* cb);
   virtual Status PollCompletion(int32_t* num_events, const uint64_t timeout_us);
+  virtual Status GetRange(const ReadOptions& options,
+                          ColumnFamilyHandle* column_family, const Slice& key,
+                          uint64_t offset, size_t len, char* buf,
+                          size_t* read_len) override;
+  virtual Status PutRange(const WriteOptions& options,
+                          ColumnFamilyHandle* column_family, const Slice& key,
+                          uint64_t offset, const Slice& data) override;
+  virtual Status GetRangeAsync(const ReadOptions& options,
+                               ColumnFamilyHandle* column_family,
+                               const Slice& key, uint64_t offset,
+                               char* val_buf, const int32_t buf_len,
+                               int32_t* val_len, CallBackPtr* cb) override;
+  virtual Status PutRangeAsync(const WriteOptions& options,
+                               ColumnFamilyHandle* column_family,
+                               const Slice& key, uint64_t offset,
+                               const Slice& data, CallBackPtr* cb) override;
 
   virtual Status status() const {
       return status_;
@@ -96,6 +118,11 @@ class KVImpl : public DB {
                               const Slice* begin, const Slice* end) override;
   virtual bool GetProperty(ColumnFamilyHandle* column_family,
                              const Slice& property, std::string* value) override;
+  virtual bool GetMapProperty(ColumnFamilyHandle* column_family,
+                              const Slice& property,
+                              std::map<std::string, std::string>* value) override;
+  virtual bool GetIntProperty(ColumnFamilyHandle* column_family,
+                              const Slice& property, uint64_t* value) override;
   virtual SequenceNumber GetLatestSequenceNumber() const override;
   virtual Status DisableFileDeletions() override;
   virtual Status GetLiveFiles(std::vector<std::string>& vec,
@@ -116,6 +143,7 @@ class KVImpl : public DB {
  private:
   friend class DB;
   friend class KVIter;
+  friend class Checkpoint;
   Status status_;
   int fd_;
   int db_;
@@ -124,6 +152,7 @@ class KVImpl : public DB {
   const DBOptions options_;  // options_.comparator == &internal_comparator_
   const std::string dbname_;
   const std::string device_;
+  Statistics* stats_;  // options_.statistics, may be NULL
   ColumnFamilyHandleImpl* default_cf_handle_; // default column_family handle
   bool is_default_open_;
   std::vector<ColumnFamilyHandle*> handles_;
@@ -135,13 +164,47 @@ class KVImpl : public DB {
   KVImpl(const KVImpl&);
   void operator=(const KVImpl&);
 
+  // write-back buffers, see ColumnFamilyOptions::write_back_buffer_size
+  void SetWriteBackBuffer(const ColumnFamilyOptions& options, int cf_index,
+                          std::string name);
+  std::shared_ptr<WriteBackBuffer> GetWriteBackBuffer(
+      const ColumnFamilyHandle* column_family) const;
+  // Add a write to the buffer, and write the buffer to the device if it
+  // is full or old enough.  REQUIRES: buffer->mu held.
+  Status BufferWrite(WriteBackBuffer* buffer, WriteType type,
+                     const Slice& key, const Slice& value);
+  // REQUIRES: buffer->mu held.
+  Status FlushWriteBackBufferLocked(WriteBackBuffer* buffer);
+  // Flush the buffers of all the column families, before the operations
+  // that go to the device without looking at them.
+  Status FlushWriteBackBuffers();
+  // The buffered writes of cf_index for an iterator made with options,
+  // NULL if none.  Taken before the device iterator is made, so that the
+  // writes flushed in between are still in it, if not in the latter.
+  std::shared_ptr<WriteBackMemTable> GetWriteBackMem(const ReadOptions& options,
+                                                     uint32_t cf_index);
+  // Merge mem, if not NULL, into an iterator of the device.
+  Iterator* MergeWriteBackBuffer(Iterator* iterator,
+                                 const std::shared_ptr<WriteBackMemTable>& mem);
+  // WriteNonatomic() without flushing the buffers first.
+  Status WriteNonatomicToDevice(const WriteOptions& options,
+                                WriteBatchNonatomic* my_batch);
+  // Replaced by CreateColumnFamily() and DropColumnFamily() while other
+  // threads use them, hence shared, and guarded by write_back_mu_.
+  mutable std::mutex write_back_mu_;
+  std::shared_ptr<WriteBackBuffer> write_back_buffers_[MAX_CF_COUNT];
+
   // aio support
+  Status CheckRange(const Slice& key, uint64_t offset, size_t len,
+                    bool need_aligned);
+  Status PartialError(const Slice& key);
   Status OpenAio();
   Status CloseAio();
   int req_size_;
   std::vector<CallBackPtr*> cb_mp_;
   std::vector<venice_kv> cmds_;
   std::vector<int*> val_lens_;
+  std::vector<uint64_t> aio_start_micros_;  // submit time, with stats_ only
   ReqIdQue req_id_que_;
   int epollfd_dev_ = -1;
   struct epoll_event watch_events_;
@@ -2,7 +2,9 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
+#include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <iostream>
 #include <sys/types.h>
@@ -12,17 +14,37 @@
 #include "swift/log_iter.h"
 #include "src/venice_kv.h"
 #include "src/venice_ioctl.h"
+#include "src/perf_context_imp.h"
+#include "util/coding.h"
+#include "util/statistics.h"
 
 namespace shannon {
 
+#define LOG_READED_NONE           (0)
+#define LOG_READED_KEY            (1 << 0)
+#define LOG_READED_VALUE          (1 << 1)
+#define LOG_READED_MASK           (0x00000003)
+
 class LogIteratorImpl : public LogIterator {
  public:
-  LogIteratorImpl(std::string& device, int fd, int idx, uint64_t seq)
+  LogIteratorImpl(std::string& device, int fd, int idx, uint64_t seq,
+                  Statistics* statistics)
     : device_(device),
       fd_(fd),
       iter_index_(idx),
       iter_sequence_(seq),
-      valid_(false) {
+      stats_(statistics),
+      valid_(false),
+      pending_(false),
+      read_flag_(LOG_READED_NONE),
+      db_(0),
+      cf_(0),
+      optype_(UNKNOWN_TYPE),
+      timestamp_(0),
+      key_buf_(NULL),
+      key_len_(0),
+      value_buf_(NULL),
+      value_len_(0) {
   }
 
   virtual ~LogIteratorImpl();
@@ -37,29 +59,34 @@ class LogIteratorImpl : public LogIterator {
   virtual int32_t cf() override;
 
   virtual void Next() override;
+  virtual Status NextBatch(size_t max_records, size_t max_bytes,
+                           LogRecordBatch* batch) override;
  private:
   int fd_;
   std::string device_;
   int iter_index_;
   uint64_t iter_sequence_;
+  Statistics* stats_;
 
   /* only used by next(); and prev() in the future */
   bool valid_;
+  /* NextBatch() stopped at the record without returning it */
+  bool pending_;
   /* will update at each action */
   Status status_;
 
-#define LOG_READED_NONE           (0)
-#define LOG_READED_KEY            (1 << 0)
-#define LOG_READED_VALUE          (1 << 1)
-#define LOG_READED_MASK           (0x00000003)
   uint32_t read_flag_;
   int32_t db_;
   int32_t cf_;
   LogOpType optype_;
   uint64_t timestamp_;
-  std::string saved_key_;
-  std::string saved_value_;
+  /* the key and value of the record, read once for all the records */
+  char *key_buf_;
+  int key_len_;
+  char *value_buf_;
+  int value_len_;
   void set_optype(unsigned char type);
+  bool Fetch(unsigned char get_type);
 
   // No copying allowed
   LogIteratorImpl(const LogIteratorImpl&);
@@ -68,6 +95,11 @@ class LogIteratorImpl : public LogIterator {
 };
 
   Status NewLogIterator(std::string& device, uint64_t timestamp, LogIterator **log_iter) {
+    return NewLogIterator(device, timestamp, log_iter, NULL);
+  }
+
+  Status NewLogIterator(std::string& device, uint64_t timestamp,
+                        LogIterator **log_iter, Statistics* statistics) {
     int fd, ret = 0;
     struct uapi_log_iter_create option;
     Status s;
@@ -90,7 +122,8 @@ class LogIteratorImpl : public LogIterator {
       return Status::IOError("ioctl create_log_iter failed\n");
     }
 
-    *log_iter = new LogIteratorImpl(device, fd, option.iter.iter_index, option.iter.iter_sequence);
+    *log_iter = new LogIteratorImpl(device, fd, option.iter.iter_index,
+                                    option.iter.iter_sequence, statistics);
      return s;
   }
 
@@ -107,6 +140,8 @@ LogIteratorImpl::~LogIteratorImpl() {
   if (fd_) {
     close(fd_);
   }
+  free(key_buf_);
+  free(value_buf_);
 }
 
 void LogIteratorImpl::Next() {
@@ -118,7 +153,13 @@ void LogIteratorImpl::Next() {
   option.iter.valid_iter = 1;
   option.move_direction = LOG_MOVE_NEXT;
   option.valid_key = 0;
-  ret = ioctl(fd_, IOCTL_LOG_ITER_MOVE, &option);
+  pending_ = false;
+  PERF_COUNTER_ADD(log_iter_next_count, 1);
+  RecordTick(stats_, NUMBER_LOG_ITER_NEXT);
+  {
+    StopWatch sw(stats_, LOG_ITER_NEXT);
+    ret = PerfIoctl(kPerfIoctlLogIterMove, fd_, IOCTL_LOG_ITER_MOVE, &option);
+  }
   valid_ = option.valid_key == 0 ? false : true;
   if (ret < 0) {
     if (option.iter.valid_iter == 0) {
@@ -155,104 +196,92 @@ void LogIteratorImpl::set_optype(unsigned char type)
   }
 }
 
-Slice LogIteratorImpl::key() {
+// Read the key or the value of the record, along with its db, cf, optype
+// and timestamp, unless it has been read already.
+bool LogIteratorImpl::Fetch(unsigned char get_type) {
   struct uapi_log_iter_get_option option;
+  const bool get_key = get_type == LOG_ITER_GET_KEY;
+  const uint32_t flag = get_key ? LOG_READED_KEY : LOG_READED_VALUE;
   int ret = 0;
 
-  if (!valid_) {
-    return Slice();
+  if ((read_flag_ & flag)) {
+    return true;
+  }
+  if (get_key && key_buf_ == NULL) {
+    key_buf_ = (char *)malloc(MAX_KEY_SIZE);
+    PERF_HEAP_ALLOC(MAX_KEY_SIZE);
+  } else if (!get_key && value_buf_ == NULL) {
+    value_buf_ = (char *)malloc(MAX_VALUE_SIZE);
+    PERF_HEAP_ALLOC(MAX_VALUE_SIZE);
   }
-  if ((read_flag_ & LOG_READED_KEY)) {
-    return saved_key_;
+  if ((get_key ? key_buf_ : value_buf_) == NULL) {
+    status_ = Status::IOError("malloc mem fail!");
+    return false;
   }
 
+  memset(&option, 0, sizeof(option));
   option.iter.iter_index = iter_index_;
   option.iter.iter_sequence = iter_sequence_;
   option.iter.valid_iter = 1;
-  option.get_type = LOG_ITER_GET_KEY;
+  option.get_type = get_type;
   option.valid_key = 0;
-  option.key = (char *)malloc(MAX_KEY_SIZE);
-  option.key_buf_len = MAX_KEY_SIZE;
-  ret = ioctl(fd_, IOCTL_LOG_ITER_GET, &option);
+  if (get_key) {
+    option.key = key_buf_;
+    option.key_buf_len = MAX_KEY_SIZE;
+  } else {
+    option.value = value_buf_;
+    option.value_buf_len = MAX_VALUE_SIZE;
+  }
+  {
+    StopWatch sw(stats_, LOG_ITER_GET);
+    ret = PerfIoctl(kPerfIoctlLogIterGet, fd_, IOCTL_LOG_ITER_GET, &option);
+  }
   if (ret < 0) {
     if (option.iter.valid_iter == 0) {
       status_ = Status::Corruption("Invalid log iterator!!!");
     } else {
-      status_ = Status::IOError("Iter get key failed", strerror(errno));
+      status_ = Status::IOError(get_key ? "Iter get key failed"
+                                        : "Iter get value failed",
+                                strerror(errno));
     }
-    read_flag_ = (read_flag_ & ~LOG_READED_KEY) & LOG_READED_MASK;
-    free(option.key);
-    return Slice();
+    return false;
   }
 
   if (option.valid_key == 0) {
-    status_ = Status::NotFound("Not found key");
-    read_flag_ = (read_flag_ & ~LOG_READED_KEY) & LOG_READED_MASK;
-    free(option.key);
-    return Slice();
+    status_ = Status::NotFound(get_key ? "Not found key" : "Not found value");
+    return false;
   }
 
-  // set key, db, cf, optype, timestamp, read_flag
+  // set key or value, db, cf, optype, timestamp, read_flag
   status_ = Status::OK();
-  read_flag_ &= LOG_READED_KEY;
-  saved_key_.assign(option.key, option.key_len);
-  free(option.key);
+  read_flag_ |= flag;
+  if (get_key) {
+    key_len_ = option.key_len;
+  } else {
+    value_len_ = option.value_len;
+  }
+  PERF_COUNTER_ADD(bytes_copied, get_key ? option.key_len : option.value_len);
+  RecordTick(stats_, LOG_ITER_BYTES_READ,
+             get_key ? option.key_len : option.value_len);
   db_ = option.db_index;
   cf_ = option.cf_index;
   set_optype(option.optype);
   timestamp_ = option.timestamp;
-
-  return saved_key_;
+  return true;
 }
 
-Slice LogIteratorImpl::value() {
-  struct uapi_log_iter_get_option option;
-  int ret = 0;
-
-  if (!valid_) {
-    return Slice();
-  }
-  if ((read_flag_ & LOG_READED_VALUE)) {
-    return saved_value_;
-  }
-
-  option.iter.iter_index = iter_index_;
-  option.iter.iter_sequence = iter_sequence_;
-  option.iter.valid_iter = 1;
-  option.get_type = LOG_ITER_GET_VALUE;
-  option.valid_key = 0;
-  option.value = (char *)malloc(MAX_VALUE_SIZE);
-  option.value_buf_len = MAX_VALUE_SIZE;
-  ret = ioctl(fd_, IOCTL_LOG_ITER_GET, &option);
-  if (ret < 0) {
-    if (option.iter.valid_iter == 0) {
-      status_ = Status::Corruption("Invalid log iterator!!!");
-    } else {
-      status_ = Status::IOError("Iter get value failed", strerror(errno));
-    }
-    read_flag_ = (read_flag_ & ~LOG_READED_VALUE) & LOG_READED_MASK;
-    free(option.value);
+Slice LogIteratorImpl::key() {
+  if (!valid_ || !Fetch(LOG_ITER_GET_KEY)) {
     return Slice();
   }
+  return Slice(key_buf_, key_len_);
+}
 
-  if (option.valid_key == 0) {
-    status_ = Status::NotFound("Not found value");
-    read_flag_ = (read_flag_ & ~LOG_READED_VALUE) & LOG_READED_MASK;
-    free(option.value);
+Slice LogIteratorImpl::value() {
+  if (!valid_ || !Fetch(LOG_ITER_GET_VALUE)) {
     return Slice();
   }
-
-  // set value, db, cf, optype, timestamp, read_flag
-  status_ = Status::OK();
-  read_flag_ &= LOG_READED_VALUE;
-  saved_value_.assign(option.value, option.value_len);
-  free(option.value);
-  db_ = option.db_index;
-  cf_ = option.cf_index;
-  set_optype(option.optype);
-  timestamp_ = option.timestamp;
-
-  return saved_value_;
+  return Slice(value_buf_, value_len_);
 }
 
 LogOpType LogIteratorImpl::optype() {
@@ -295,4 +324,82 @@ uint64_t LogIteratorImpl::timestamp() {
   return timestamp_;
 }
 
+Status LogIteratorImpl::NextBatch(size_t max_records, size_t max_bytes,
+                                  LogRecordBatch* batch) {
+  if (batch == NULL || max_records == 0) {
+    return Status::InvalidArgument("batch is null or max_records is 0");
+  }
+  batch->Clear();
+  if (!pending_) {
+    Next();
+  }
+  pending_ = false;
+  while (valid_) {
+    // The key read gives the optype; a key delete has no value to read,
+    // a db create or delete has its name as value and no key.
+    Slice key;
+    if (Fetch(LOG_ITER_GET_KEY)) {
+      key = Slice(key_buf_, key_len_);
+    } else if (!status_.IsNotFound()) {
+      pending_ = true;
+      break;
+    }
+    Slice value;
+    if (!(read_flag_ & LOG_READED_KEY) || optype_ != KEY_DELETE) {
+      if (!Fetch(LOG_ITER_GET_VALUE)) {
+        pending_ = true;
+        break;
+      }
+      value = Slice(value_buf_, value_len_);
+    }
+    if (batch->Count() > 0 &&
+        batch->DataSize() + key.size() + value.size() > max_bytes) {
+      pending_ = true;
+      break;
+    }
+    batch->Add(optype_, db_, cf_, timestamp_, key, value);
+    if (batch->Count() >= max_records) {
+      break;
+    }
+    Next();
+  }
+  if (batch->Count() > 0 || status_.ok() || status_.IsNotFound()) {
+    return Status::OK();
+  }
+  return status_;
+}
+
+void LogRecordBatch::Add(LogOpType optype, int32_t db, int32_t cf,
+                         uint64_t timestamp, const Slice& key,
+                         const Slice& value) {
+  offsets_.push_back(rep_.size());
+  rep_.push_back(static_cast<char>(optype));
+  rep_.push_back(static_cast<char>(db));
+  rep_.push_back(static_cast<char>(cf));
+  PutFixed64(&rep_, timestamp);
+  PutLengthPrefixedSlice(&rep_, key);
+  PutLengthPrefixedSlice(&rep_, value);
+  data_size_ += key.size() + value.size();
+}
+
+LogRecord LogRecordBatch::Get(size_t i) const {
+  assert(i < offsets_.size());
+  LogRecord record;
+  const char* p = rep_.data() + offsets_[i];
+  record.optype = static_cast<LogOpType>(p[0]);
+  record.db = static_cast<unsigned char>(p[1]);
+  record.cf = static_cast<unsigned char>(p[2]);
+  record.timestamp = DecodeFixed64(p + 3);
+  Slice input(p + 11, rep_.size() - offsets_[i] - 11);
+  GetLengthPrefixedSlice(&input, &record.key);
+  GetLengthPrefixedSlice(&input, &record.value);
+  return record;
+}
+
+void LogRecordBatch::Clear() {
+  rep_.clear();
+  offsets_.clear();
+  data_size_ = 0;
+}
+
 } // namespace shannon
@@ -0,0 +1,115 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <string.h>
+#include <sstream>
+#include "src/perf_context_imp.h"
+
+namespace shannon {
+
+#if defined(NPERF_CONTEXT)
+PerfLevel perf_level = kDisable;
+PerfContext perf_context;
+#else
+__thread PerfLevel perf_level = kDisable;
+thread_local PerfContext perf_context;
+#endif
+
+void SetPerfLevel(PerfLevel level) {
+  if (level > kUninitialized && level < kOutOfBounds) {
+    perf_level = level;
+  }
+}
+
+PerfLevel GetPerfLevel() {
+  return perf_level;
+}
+
+PerfContext* get_perf_context() {
+  return &perf_context;
+}
+
+static const char* kPerfIoctlNames[kPerfIoctlMax] = {
+  "get",
+  "put",
+  "delete",
+  "key_status",
+  "read_batch",
+  "write_batch",
+  "write_batch_nonatomic",
+  "snapshot",
+  "iter_create",
+  "iter_destroy",
+  "iter_seek",
+  "iter_move",
+  "iter_get",
+  "log_iter_move",
+  "log_iter_get",
+  "status",
+  "aio_events",
+  "other",
+};
+
+const char* PerfIoctlName(PerfIoctlType type) {
+  if (type >= kPerfIoctlMax) {
+    return "unknown";
+  }
+  return kPerfIoctlNames[type];
+}
+
+void PerfContext::Reset() {
+  memset(ioctl_count, 0, sizeof(ioctl_count));
+  memset(ioctl_nanos, 0, sizeof(ioctl_nanos));
+  ioctl_time = 0;
+  bytes_copied = 0;
+  heap_alloc_count = 0;
+  heap_alloc_bytes = 0;
+  read_reread_count = 0;
+  read_reread_keys = 0;
+  iter_seek_count = 0;
+  iter_next_count = 0;
+  iter_prev_count = 0;
+  iter_get_key_count = 0;
+  iter_get_value_count = 0;
+  log_iter_next_count = 0;
+}
+
+#define PERF_CONTEXT_OUTPUT(counter)                       \
+  if (!exclude_zero_counters || (counter > 0)) {           \
+    ss << #counter << " = " << counter << ", ";            \
+  }
+
+std::string PerfContext::ToString(bool exclude_zero_counters) const {
+  std::ostringstream ss;
+  for (int i = 0; i < kPerfIoctlMax; i++) {
+    if (exclude_zero_counters && ioctl_count[i] == 0) {
+      continue;
+    }
+    ss << "ioctl_" << PerfIoctlName(static_cast<PerfIoctlType>(i))
+       << "_count = " << ioctl_count[i] << ", ";
+    ss << "ioctl_" << PerfIoctlName(static_cast<PerfIoctlType>(i))
+       << "_nanos = " << ioctl_nanos[i] << ", ";
+  }
+  PERF_CONTEXT_OUTPUT(ioctl_time);
+  PERF_CONTEXT_OUTPUT(bytes_copied);
+  PERF_CONTEXT_OUTPUT(heap_alloc_count);
+  PERF_CONTEXT_OUTPUT(heap_alloc_bytes);
+  PERF_CONTEXT_OUTPUT(read_reread_count);
+  PERF_CONTEXT_OUTPUT(read_reread_keys);
+  PERF_CONTEXT_OUTPUT(iter_seek_count);
+  PERF_CONTEXT_OUTPUT(iter_next_count);
+  PERF_CONTEXT_OUTPUT(iter_prev_count);
+  PERF_CONTEXT_OUTPUT(iter_get_key_count);
+  PERF_CONTEXT_OUTPUT(iter_get_value_count);
+  PERF_CONTEXT_OUTPUT(log_iter_next_count);
+  std::string str = ss.str();
+  if (str.size() >= 2) {
+    str.erase(str.size() - 2);
+  }
+  return str;
+}
+
+#undef PERF_CONTEXT_OUTPUT
+
+}  // namespace shannon
@@ -0,0 +1,64 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef SHANNON_DB_PERF_CONTEXT_IMP_H_
+#define SHANNON_DB_PERF_CONTEXT_IMP_H_
+
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "swift/perf_context.h"
+
+namespace shannon {
+
+#if defined(NPERF_CONTEXT)
+extern PerfLevel perf_level;
+extern PerfContext perf_context;
+#else
+extern __thread PerfLevel perf_level;
+extern thread_local PerfContext perf_context;
+#endif
+
+inline uint64_t PerfNowNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Issue an ioctl and account it to the given command in the thread's
+// PerfContext.  errno is preserved for the caller.
+inline int PerfIoctl(PerfIoctlType type, int fd, unsigned long request,
+                     void *arg) {
+  if (perf_level < kEnableCount) {
+    return ioctl(fd, request, arg);
+  }
+  perf_context.ioctl_count[type]++;
+  if (perf_level < kEnableTime) {
+    return ioctl(fd, request, arg);
+  }
+  uint64_t start = PerfNowNanos();
+  int ret = ioctl(fd, request, arg);
+  int saved_errno = errno;
+  uint64_t elapsed = PerfNowNanos() - start;
+  perf_context.ioctl_nanos[type] += elapsed;
+  perf_context.ioctl_time += elapsed;
+  errno = saved_errno;
+  return ret;
+}
+
+#define PERF_COUNTER_ADD(metric, value)     \
+  if (perf_level >= kEnableCount) {         \
+    perf_context.metric += (value);         \
+  }
+
+// Account one heap allocation of the given size.
+#define PERF_HEAP_ALLOC(size)               \
+  if (perf_level >= kEnableCount) {         \
+    perf_context.heap_alloc_count++;        \
+    perf_context.heap_alloc_bytes += (size); \
+  }
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_PERF_CONTEXT_IMP_H_
@@ -8,3 +8,4 @@
 #define MAX_VALUE_SIZE                (4UL << 20)
 #define MAX_BATCH_SIZE                (8UL << 20)
 #define MAX_BATCH_NONATOMIC_SIZE      (32UL << 20)
+#define PARTIAL_OFFSET_ALIGN          (4UL << 10)
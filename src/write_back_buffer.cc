@@ -0,0 +1,165 @@
+// Copyright (c) 2018 Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+#include "src/write_back_buffer.h"
+#include "util/coding.h"
+
+namespace shannon {
+
+static const uint64_t kMaxSequenceNumber = (1ull << 56) - 1;
+
+static Slice DecodeKey(const char* entry) {
+  uint32_t key_size;
+  const char* key = GetVarint32Ptr(entry, entry + 5, &key_size);
+  return Slice(key, key_size);
+}
+
+// The entry is a key to seek with: the first write of the key for
+// sequence kMaxSequenceNumber, after its last one for 0.
+static void EncodeLookupKey(const Slice& key, uint64_t sequence,
+                            std::string* entry) {
+  entry->clear();
+  PutVarint32(entry, key.size());
+  entry->append(key.data(), key.size());
+  PutFixed64(entry, sequence << 8);
+}
+
+int WriteBackMemTable::KeyComparator::operator()(const char* a,
+                                                 const char* b) const {
+  // Keys are in the bytewise order of the device iterators.
+  Slice key_a = DecodeKey(a);
+  Slice key_b = DecodeKey(b);
+  int r = key_a.compare(key_b);
+  if (r == 0) {
+    // The newest write of a key first.
+    uint64_t tag_a = DecodeFixed64(key_a.data() + key_a.size());
+    uint64_t tag_b = DecodeFixed64(key_b.data() + key_b.size());
+    if (tag_a > tag_b) {
+      r = -1;
+    } else if (tag_a < tag_b) {
+      r = +1;
+    }
+  }
+  return r;
+}
+
+WriteBackMemTable::WriteBackMemTable()
+    : table_(KeyComparator(), &arena_),
+      sequence_(0),
+      count_(0),
+      data_size_(0) {}
+
+void WriteBackMemTable::Add(WriteType type, const Slice& key,
+                            const Slice& value) {
+  const size_t size = VarintLength(key.size()) + key.size() + 8 +
+                      VarintLength(value.size()) + value.size();
+  char* entry = arena_.Allocate(size);
+  char* p = EncodeVarint32(entry, key.size());
+  memcpy(p, key.data(), key.size());
+  p += key.size();
+  EncodeFixed64(p, (++sequence_ << 8) | type);
+  p += 8;
+  p = EncodeVarint32(p, value.size());
+  memcpy(p, value.data(), value.size());
+  assert(p + value.size() == entry + size);
+  table_.Insert(entry);
+  count_++;
+  data_size_ += key.size() + value.size();
+}
+
+static WriteEntry DecodeEntry(const char* entry) {
+  WriteEntry result;
+  result.key = DecodeKey(entry);
+  const char* p = result.key.data() + result.key.size();
+  result.type = static_cast<WriteType>(DecodeFixed64(p) & 0xff);
+  uint32_t value_size;
+  p = GetVarint32Ptr(p + 8, p + 13, &value_size);
+  result.value = Slice(p, value_size);
+  return result;
+}
+
+bool WriteBackMemTable::Get(const Slice& key, WriteType* type,
+                            std::string* value) const {
+  std::string lookup;
+  EncodeLookupKey(key, kMaxSequenceNumber, &lookup);
+  Table::Iterator iter(&table_);
+  iter.Seek(lookup.data());
+  if (!iter.Valid()) {
+    return false;
+  }
+  WriteEntry entry = DecodeEntry(iter.key());
+  if (entry.key != key) {
+    return false;
+  }
+  *type = entry.type;
+  if (entry.type == kPutRecord && value != NULL) {
+    value->assign(entry.value.data(), entry.value.size());
+  }
+  return true;
+}
+
+// Stops on the first, newest, write of each key.
+class WriteBackMemTable::Iter : public WBWIIterator {
+ public:
+  explicit Iter(const std::shared_ptr<WriteBackMemTable>& table)
+      : table_(table), iter_(&table->table_) {}
+
+  virtual bool Valid() const override { return iter_.Valid(); }
+
+  virtual void SeekToFirst() override { iter_.SeekToFirst(); }
+
+  virtual void SeekToLast() override {
+    iter_.SeekToLast();
+    ToNewest();
+  }
+
+  virtual void Seek(const Slice& key) override {
+    EncodeLookupKey(key, kMaxSequenceNumber, &lookup_);
+    iter_.Seek(lookup_.data());
+  }
+
+  virtual void SeekForPrev(const Slice& key) override {
+    EncodeLookupKey(key, 0, &lookup_);
+    iter_.SeekForPrev(lookup_.data());
+    ToNewest();
+  }
+
+  virtual void Next() override {
+    Slice key = DecodeKey(iter_.key());
+    EncodeLookupKey(key, 0, &lookup_);
+    iter_.Seek(lookup_.data());
+  }
+
+  virtual void Prev() override {
+    iter_.Prev();
+    ToNewest();
+  }
+
+  virtual WriteEntry Entry() const override {
+    return DecodeEntry(iter_.key());
+  }
+
+  virtual Status status() const override { return Status::OK(); }
+
+ private:
+  // From any write of a key to its newest one.
+  void ToNewest() {
+    if (iter_.Valid()) {
+      Slice key = DecodeKey(iter_.key());
+      EncodeLookupKey(key, kMaxSequenceNumber, &lookup_);
+      iter_.Seek(lookup_.data());
+    }
+  }
+
+  std::shared_ptr<WriteBackMemTable> table_;
+  Table::Iterator iter_;
+  std::string lookup_;
+};
+
+WBWIIterator* WriteBackMemTable::NewIterator(
+    const std::shared_ptr<WriteBackMemTable>& table) {
+  return new Iter(table);
+}
+
+}  // namespace shannon
@@ -0,0 +1,95 @@
+// Copyright (c) 2018 Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+#ifndef SHANNON_WRITE_BACK_BUFFER_H_
+#define SHANNON_WRITE_BACK_BUFFER_H_
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "swift/slice.h"
+#include "swift/write_batch_with_index.h"
+#include "src/column_family.h"
+#include "util/arena.h"
+#include "util/skiplist.h"
+
+namespace shannon {
+
+// The Puts and Deletes of a column family not written to the device yet,
+// in key order.  Every write is kept, the newest of a key first, so Add()
+// never looks up the key.  One thread at a time may Add(), others may
+// read at the same time.
+class WriteBackMemTable {
+ public:
+  WriteBackMemTable();
+
+  void Add(WriteType type, const Slice& key, const Slice& value);
+
+  // If the table has a write of key, store its type in *type and, for a
+  // Put, its value in *value if value is not NULL, and return true.
+  bool Get(const Slice& key, WriteType* type, std::string* value) const;
+
+  bool Empty() const { return count_ == 0; }
+  int Count() const { return count_; }
+  // Bytes of keys and values added.
+  size_t DataSize() const { return data_size_; }
+  size_t MemoryUsage() const { return arena_.MemoryUsage(); }
+
+  // An iterator over the newest write of each key of table.  It holds a
+  // reference to table, which is freed with the last iterator when the
+  // buffer has moved on to a new table.  It may or may not see the writes
+  // added after it was made.
+  static WBWIIterator* NewIterator(
+      const std::shared_ptr<WriteBackMemTable>& table);
+
+ private:
+  class Iter;
+
+  // Entries are a varint32 key length, the key, a fixed64 of the sequence
+  // number << 8 | type, a varint32 value length and the value.
+  struct KeyComparator {
+    int operator()(const char* a, const char* b) const;
+  };
+  typedef SkipList<const char*, KeyComparator> Table;
+
+  Arena arena_;
+  Table table_;
+  uint64_t sequence_;
+  int count_;
+  size_t data_size_;
+
+  // No copying allowed
+  WriteBackMemTable(const WriteBackMemTable&);
+  void operator=(const WriteBackMemTable&);
+};
+
+// The write-back buffer of a column family, see
+// ColumnFamilyOptions::write_back_buffer_size.  KVImpl holds mu while it
+// reads or replaces mem, and while it writes mem to the device, so that a
+// key is always either in mem or on the device.
+struct WriteBackBuffer {
+  WriteBackBuffer(int db_index, int cf_index, std::string name,
+                  size_t max_bytes, uint64_t flush_interval_micros)
+      : handle(db_index, cf_index, name),
+        max_bytes(max_bytes),
+        flush_interval_micros(flush_interval_micros),
+        mem(new WriteBackMemTable),
+        first_write_micros(0),
+        dropped(false) {}
+
+  // Used to write mem to the device, whatever the user does with theirs.
+  ColumnFamilyHandleImpl handle;
+  const size_t max_bytes;
+  const uint64_t flush_interval_micros;
+
+  std::mutex mu;
+  std::shared_ptr<WriteBackMemTable> mem;
+  uint64_t first_write_micros;  // of the oldest write in mem
+  bool dropped;  // with the column family, mem stays empty
+};
+
+}  // namespace shannon
+
+#endif  // SHANNON_WRITE_BACK_BUFFER_H_
@@ -7,6 +7,7 @@
 #include "util/likely.h"
 #include "util/coding.h"
 #include "swift/write_batch_with_index.h"
+#include "swift/shannon_db.h"
 #include "src/venice_kv.h"
 namespace shannon {
 
@@ -67,28 +68,28 @@ public:
   void SeekToFirst() override {
     forward_ = true;
     base_iterator_->SeekToFirst();
-    delta_iterator_->SeekToFirst();
+    DeltaSeekToFirst();
     UpdateCurrent();
   }
 
   void SeekToLast() override {
     forward_ = false;
     base_iterator_->SeekToLast();
-    delta_iterator_->SeekToLast();
+    DeltaSeekToLast();
     UpdateCurrent();
   }
 
   void Seek(const Slice &k) override {
     forward_ = true;
     base_iterator_->Seek(k);
-    delta_iterator_->Seek(k);
+    DeltaSeek(k);
     UpdateCurrent();
   }
 
   void SeekForPrev(const Slice &k) override {
     forward_ = false;
     base_iterator_->SeekForPrev(k);
-    delta_iterator_->SeekForPrev(k);
+    DeltaSeekForPrev(k);
     UpdateCurrent();
   }
 
@@ -110,7 +111,7 @@ public:
         assert(DeltaValid());
         base_iterator_->SeekToFirst();
       } else if (!DeltaValid()) {
-        delta_iterator_->SeekToFirst();
+        DeltaSeekToFirst();
       } else if (current_at_base_) {
         // Change delta from larger than base to smaller
         AdvanceDelta();
@@ -146,7 +147,7 @@ public:
         assert(DeltaValid());
         base_iterator_->SeekToLast();
       } else if (!DeltaValid()) {
-        delta_iterator_->SeekToLast();
+        DeltaSeekToLast();
       } else if (current_at_base_) {
         // Change delta from less advanced than base to more advanced
         AdvanceDelta();
@@ -170,8 +171,27 @@ public:
                             : delta_iterator_->Entry().key;
   }
 
-  uint64_t timestamp() { return 0; }
-  void SetPrefix(const Slice &prefix) {}
+  uint64_t timestamp() {
+    return current_at_base_ ? base_iterator_->timestamp() : 0;
+  }
+
+  // The base iterator limits itself to prefix.  The delta is positioned
+  // within the prefix, and its entries outside of it are treated as the
+  // end of the delta.
+  void SetPrefix(const Slice &prefix) {
+    prefix_.assign(prefix.data(), prefix.size());
+    prefix_end_ = prefix_;
+    // The first key after all the keys starting with the prefix, empty if
+    // there is none, i.e. the prefix is all 0xff.
+    while (!prefix_end_.empty() &&
+           static_cast<unsigned char>(prefix_end_.back()) == 0xff) {
+      prefix_end_.pop_back();
+    }
+    if (!prefix_end_.empty()) {
+      prefix_end_.back()++;
+    }
+    base_iterator_->SetPrefix(prefix);
+  }
 
   Slice value() {
     return current_at_base_ ? base_iterator_->value()
@@ -267,8 +287,44 @@ private:
       base_iterator_->Prev();
     }
   }
+  void DeltaSeekToFirst() {
+    if (prefix_.empty()) {
+      delta_iterator_->SeekToFirst();
+    } else {
+      delta_iterator_->Seek(prefix_);
+    }
+  }
+  void DeltaSeekToLast() {
+    if (prefix_end_.empty()) {
+      delta_iterator_->SeekToLast();
+      return;
+    }
+    delta_iterator_->SeekForPrev(prefix_end_);
+    if (delta_iterator_->Valid() &&
+        delta_iterator_->Entry().key == Slice(prefix_end_)) {
+      delta_iterator_->Prev();
+    }
+  }
+  void DeltaSeek(const Slice &k) {
+    if (!prefix_.empty() && k.compare(prefix_) < 0) {
+      delta_iterator_->Seek(prefix_);
+    } else {
+      delta_iterator_->Seek(k);
+    }
+  }
+  void DeltaSeekForPrev(const Slice &k) {
+    if (!prefix_end_.empty() && k.compare(prefix_end_) >= 0) {
+      DeltaSeekToLast();
+    } else {
+      delta_iterator_->SeekForPrev(k);
+    }
+  }
   bool BaseValid() const { return base_iterator_->Valid(); }
-  bool DeltaValid() const { return delta_iterator_->Valid(); }
+  bool DeltaValid() const {
+    return delta_iterator_->Valid() &&
+           (prefix_.empty() ||
+            delta_iterator_->Entry().key.starts_with(prefix_));
+  }
   void UpdateCurrent() {
 // Suppress false positive clang analyzer warnings.
 #ifndef __clang_analyzer__
@@ -341,8 +397,16 @@ private:
   std::unique_ptr<Iterator> base_iterator_;
   std::unique_ptr<WBWIIterator> delta_iterator_;
   const Comparator *comparator_; // not owned
+  std::string prefix_;
+  std::string prefix_end_;
 };
 
+Iterator *NewBaseDeltaIterator(Iterator *base_iterator,
+                               WBWIIterator *delta_iterator,
+                               const Comparator *comparator) {
+  return new BaseDeltaIterator(base_iterator, delta_iterator, comparator);
+}
+
 typedef SkipList<WriteBatchIndexEntry *, const WriteBatchEntryComparator &>
 WriteBatchEntrySkipList;
 
@@ -476,6 +540,12 @@ struct WriteBatchWithIndex::Rep {
   // put it to skip list.
   void AddNewEntry(uint32_t column_family_id);
 
+  // Look up the newest entry of key, a single seek of the skip list.
+  // *found is set if the batch has an entry of key, then returns OK and
+  // the value of a Put or NotFound for a Delete.
+  Status GetFromBatch(uint32_t column_family_id, const Slice &key,
+                      std::string *value, bool *found);
+
   // Clear all updates buffered in this batch.
   void Clear();
   void ClearIndex();
@@ -546,10 +616,34 @@ void WriteBatchWithIndex::Rep::AddNewEntry(uint32_t column_family_id) {
   auto *mem = arena.Allocate(sizeof(WriteBatchIndexEntry));
   auto *index_entry =
       new (mem) WriteBatchIndexEntry(last_entry_offset, column_family_id,
-                                     key.data() - wb_data.data(), key.size());
+                                     key.data() - wb_data.data(), key.size(),
+                                     WriteBatchIndexEntry::KeyPrefix(key));
   skip_list.Insert(index_entry);
 }
 
+Status WriteBatchWithIndex::Rep::GetFromBatch(uint32_t column_family_id,
+                                              const Slice &key,
+                                              std::string *value,
+                                              bool *found) {
+  *found = false;
+  // Entries of a key are ordered by offset, the newest is the last one.
+  WBWIIteratorImpl iter(column_family_id, &skip_list, &write_batch);
+  iter.SeekForPrev(key);
+  if (!iter.Valid()) {
+    return Status::NotFound();
+  }
+  WriteEntry entry = iter.Entry();
+  if (comparator.CompareKey(column_family_id, key, entry.key) != 0) {
+    return Status::NotFound();
+  }
+  *found = true;
+  if (entry.type == kDeleteRecord) {
+    return Status::NotFound();
+  }
+  value->assign(entry.value.data(), entry.value.size());
+  return Status::OK();
+}
+
 void WriteBatchWithIndex::Rep::Clear() {
   write_batch.Clear();
   ClearIndex();
@@ -627,6 +721,10 @@ void WriteBatchWithIndex::Clear() { rep->Clear(); }
 
 int WriteBatchWithIndex::Count() const { return rep->write_batch.Count(); }
 
+size_t WriteBatchWithIndex::GetIndexMemoryUsage() const {
+  return rep->arena.MemoryUsage();
+}
+
 size_t WriteBatchWithIndex::GetDataSize() const {
   return rep->write_batch.GetDataSize();
 }
@@ -651,6 +749,44 @@ Iterator *WriteBatchWithIndex::NewIteratorWithBase(Iterator *base_iterator) {
                                rep->comparator.default_comparator());
 }
 
+Status WriteBatchWithIndex::GetFromBatch(ColumnFamilyHandle *column_family,
+                                         const Slice &key,
+                                         std::string *value) {
+  bool found;
+  return rep->GetFromBatch(column_family->GetID(), key, value, &found);
+}
+
+Status WriteBatchWithIndex::GetFromBatch(const Slice &key,
+                                         std::string *value) {
+  bool found;
+  return rep->GetFromBatch(0, key, value, &found);
+}
+
+Status WriteBatchWithIndex::GetFromBatchAndDB(DB *db,
+                                              const ReadOptions &read_options,
+                                              ColumnFamilyHandle *column_family,
+                                              const Slice &key,
+                                              std::string *value) {
+  bool found;
+  Status s = rep->GetFromBatch(column_family->GetID(), key, value, &found);
+  if (found) {
+    return s;
+  }
+  return db->Get(read_options, column_family, key, value);
+}
+
+Status WriteBatchWithIndex::GetFromBatchAndDB(DB *db,
+                                              const ReadOptions &read_options,
+                                              const Slice &key,
+                                              std::string *value) {
+  bool found;
+  Status s = rep->GetFromBatch(0, key, value, &found);
+  if (found) {
+    return s;
+  }
+  return db->Get(read_options, key, value);
+}
+
 int WriteBatchEntryComparator::
 operator()(const WriteBatchIndexEntry *entry1,
            const WriteBatchIndexEntry *entry2) const {
@@ -667,6 +803,13 @@ operator()(const WriteBatchIndexEntry *entry1,
     return 1;
   }
 
+  int cmp;
+  if (bytewise_) {
+    if (entry1->key_prefix != entry2->key_prefix) {
+      return entry1->key_prefix < entry2->key_prefix ? -1 : 1;
+    }
+  }
+
   Slice key1, key2;
   if (entry1->search_key == nullptr) {
     key1 = Slice(write_batch_->Data().data() + entry1->key_offset,
@@ -681,7 +824,11 @@ operator()(const WriteBatchIndexEntry *entry1,
     key2 = *(entry2->search_key);
   }
 
-  int cmp = CompareKey(entry1->column_family, key1, key2);
+  if (bytewise_) {
+    cmp = key1.compare(key2);
+  } else {
+    cmp = CompareKey(entry1->column_family, key1, key2);
+  }
   if (cmp != 0) {
     return cmp;
   } else if (entry1->offset > entry2->offset) {
@@ -0,0 +1,227 @@
+#include "block.h"
+#include "swift/comparator.h"
+#include "util/coding.h"
+#include <assert.h>
+#include <stdlib.h>
+
+namespace shannon {
+
+inline uint32_t Block::NumRestarts() const {
+  assert(size_ >= sizeof(uint32_t));
+  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+}
+
+Block::Block(const Slice &contents, bool owned)
+    : data_(contents.data()), size_(contents.size()), restart_offset_(0),
+      owned_(owned) {
+  if (size_ < sizeof(uint32_t)) {
+    size_ = 0; // Error marker
+  } else {
+    size_t max_restarts_allowed = (size_ - sizeof(uint32_t)) / sizeof(uint32_t);
+    if (NumRestarts() > max_restarts_allowed) {
+      // The size is too small for NumRestarts().  This also rejects the
+      // data blocks with a hash index, whose count has the top bit set.
+      size_ = 0;
+    } else {
+      restart_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+    }
+  }
+}
+
+Block::~Block() {
+  if (owned_) {
+    free(const_cast<char *>(data_));
+  }
+}
+
+// Helper routine: decode the next block entry starting at "p",
+// storing the number of shared key bytes, non_shared key bytes,
+// and the length of the value in "*shared", "*non_shared", and
+// "*value_length", respectively.  Will not dereference past "limit".
+//
+// If any errors are detected, returns NULL.  Otherwise, returns a
+// pointer to the key delta (just past the three decoded values).
+static inline const char *DecodeEntry(const char *p, const char *limit,
+                                      uint32_t *shared, uint32_t *non_shared,
+                                      uint32_t *value_length) {
+  if (limit - p < 3)
+    return NULL;
+  *shared = reinterpret_cast<const unsigned char *>(p)[0];
+  *non_shared = reinterpret_cast<const unsigned char *>(p)[1];
+  *value_length = reinterpret_cast<const unsigned char *>(p)[2];
+  if ((*shared | *non_shared | *value_length) < 128) {
+    // Fast path: all three values are encoded in one byte each
+    p += 3;
+  } else {
+    if ((p = GetVarint32Ptr(p, limit, shared)) == NULL)
+      return NULL;
+    if ((p = GetVarint32Ptr(p, limit, non_shared)) == NULL)
+      return NULL;
+    if ((p = GetVarint32Ptr(p, limit, value_length)) == NULL)
+      return NULL;
+  }
+
+  if (static_cast<uint32_t>(limit - p) < (*non_shared + *value_length)) {
+    return NULL;
+  }
+  return p;
+}
+
+Block::Iter::Iter(const Block *block, const Comparator *comparator)
+    : comparator_(comparator), data_(block->data_),
+      restarts_(block->restart_offset_),
+      num_restarts_(block->size_ == 0 ? 0 : block->NumRestarts()),
+      current_(block->restart_offset_), restart_index_(num_restarts_) {
+  if (block->size_ == 0) {
+    status_ = Status::Corruption("bad block contents");
+  }
+}
+
+// Return the offset in data_ just past the end of the current entry.
+inline uint32_t Block::Iter::NextEntryOffset() const {
+  return (value_.data() + value_.size()) - data_;
+}
+
+inline uint32_t Block::Iter::GetRestartPoint(uint32_t index) const {
+  assert(index < num_restarts_);
+  return DecodeFixed32(data_ + restarts_ + index * sizeof(uint32_t));
+}
+
+void Block::Iter::SeekToRestartPoint(uint32_t index) {
+  key_.clear();
+  restart_index_ = index;
+  // current_ will be fixed by ParseNextKey();
+
+  // ParseNextKey() starts at the end of value_, so set value_ accordingly
+  uint32_t offset = GetRestartPoint(index);
+  value_ = Slice(data_ + offset, 0);
+}
+
+void Block::Iter::Next() {
+  assert(Valid());
+  ParseNextKey();
+}
+
+void Block::Iter::Prev() {
+  assert(Valid());
+
+  // Scan backwards to a restart point before current_
+  const uint32_t original = current_;
+  while (GetRestartPoint(restart_index_) >= original) {
+    if (restart_index_ == 0) {
+      // No more entries
+      current_ = restarts_;
+      restart_index_ = num_restarts_;
+      return;
+    }
+    restart_index_--;
+  }
+
+  SeekToRestartPoint(restart_index_);
+  do {
+    // Loop until end of current entry hits the start of original entry
+  } while (ParseNextKey() && NextEntryOffset() < original);
+}
+
+void Block::Iter::Seek(const Slice &target) {
+  if (num_restarts_ == 0) {
+    current_ = restarts_;
+    return;
+  }
+  // Binary search in restart array to find the last restart point
+  // with a key < target
+  uint32_t left = 0;
+  uint32_t right = num_restarts_ - 1;
+  while (left < right) {
+    uint32_t mid = (left + right + 1) / 2;
+    uint32_t region_offset = GetRestartPoint(mid);
+    uint32_t shared, non_shared, value_length;
+    const char *key_ptr =
+        DecodeEntry(data_ + region_offset, data_ + restarts_, &shared,
+                    &non_shared, &value_length);
+    if (key_ptr == NULL || (shared != 0)) {
+      CorruptionError();
+      return;
+    }
+    Slice mid_key(key_ptr, non_shared);
+    if (comparator_->Compare(mid_key, target) < 0) {
+      // Key at "mid" is smaller than "target".  Therefore all
+      // blocks before "mid" are uninteresting.
+      left = mid;
+    } else {
+      // Key at "mid" is >= "target".  Therefore all blocks at or
+      // after "mid" are uninteresting.
+      right = mid - 1;
+    }
+  }
+
+  // Linear search (within restart block) for first key >= target
+  SeekToRestartPoint(left);
+  while (true) {
+    if (!ParseNextKey()) {
+      return;
+    }
+    if (comparator_->Compare(Slice(key_), target) >= 0) {
+      return;
+    }
+  }
+}
+
+void Block::Iter::SeekToFirst() {
+  if (num_restarts_ == 0) {
+    current_ = restarts_;
+    return;
+  }
+  SeekToRestartPoint(0);
+  ParseNextKey();
+}
+
+void Block::Iter::SeekToLast() {
+  if (num_restarts_ == 0) {
+    current_ = restarts_;
+    return;
+  }
+  SeekToRestartPoint(num_restarts_ - 1);
+  while (ParseNextKey() && NextEntryOffset() < restarts_) {
+    // Keep skipping
+  }
+}
+
+void Block::Iter::CorruptionError() {
+  current_ = restarts_;
+  restart_index_ = num_restarts_;
+  status_ = Status::Corruption("bad entry in block");
+  key_.clear();
+  value_.clear();
+}
+
+bool Block::Iter::ParseNextKey() {
+  current_ = NextEntryOffset();
+  const char *p = data_ + current_;
+  const char *limit = data_ + restarts_; // Restarts come right after data
+  if (p >= limit) {
+    // No more entries to return.  Mark as invalid.
+    current_ = restarts_;
+    restart_index_ = num_restarts_;
+    return false;
+  }
+
+  // Decode next entry
+  uint32_t shared, non_shared, value_length;
+  p = DecodeEntry(p, limit, &shared, &non_shared, &value_length);
+  if (p == NULL || key_.size() < shared) {
+    CorruptionError();
+    return false;
+  } else {
+    key_.resize(shared);
+    key_.append(p, non_shared);
+    value_ = Slice(p + non_shared, value_length);
+    while (restart_index_ + 1 < num_restarts_ &&
+           GetRestartPoint(restart_index_ + 1) < current_) {
+      ++restart_index_;
+    }
+    return true;
+  }
+}
+
+} // namespace shannon
@@ -0,0 +1,79 @@
+#ifndef STORAGE_SHANNON_TABLE_BLOCK_H_
+#define STORAGE_SHANNON_TABLE_BLOCK_H_
+
+#include "swift/slice.h"
+#include "swift/status.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace shannon {
+
+class Comparator;
+
+// An uncompressed block as BlockBuilder writes it: entries whose keys
+// share a prefix with the previous key, then the restart points, offsets
+// of the entries stored with their whole key.
+class Block {
+public:
+  // If "owned", contents.data() was malloc()ed and is freed with the block.
+  Block(const Slice &contents, bool owned);
+  ~Block();
+
+  size_t size() const { return size_; }
+
+  // Iterates the entries of a block in the order of "comparator".  Seek()
+  // binary searches the restart points, then scans one restart interval.
+  // No allocation is made unless a key is longer than the last one.
+  // REQUIRES: the block and comparator outlive the iterator.
+  class Iter {
+  public:
+    Iter(const Block *block, const Comparator *comparator);
+
+    bool Valid() const { return current_ < restarts_; }
+    Status status() const { return status_; }
+    Slice key() const { return Slice(key_); }
+    Slice value() const { return value_; }
+
+    void Next();
+    void Prev();
+    void Seek(const Slice &target);
+    void SeekToFirst();
+    void SeekToLast();
+
+  private:
+    uint32_t NextEntryOffset() const;
+    uint32_t GetRestartPoint(uint32_t index) const;
+    void SeekToRestartPoint(uint32_t index);
+    void CorruptionError();
+    bool ParseNextKey();
+
+    const Comparator *const comparator_;
+    const char *const data_;   // underlying block contents
+    uint32_t const restarts_;  // Offset of restart array (list of fixed32)
+    uint32_t const num_restarts_;
+
+    // current_ is offset in data_ of current entry.  >= restarts_ if !Valid
+    uint32_t current_;
+    uint32_t restart_index_; // Index of restart block in which current_ falls
+    std::string key_;
+    Slice value_;
+    Status status_;
+  };
+
+private:
+  uint32_t NumRestarts() const;
+
+  const char *data_;
+  size_t size_;
+  uint32_t restart_offset_; // Offset in data_ of restart array
+  bool owned_;
+
+  // No copying allowed
+  Block(const Block &);
+  void operator=(const Block &);
+};
+
+} // namespace shannon
+
+#endif // STORAGE_SHANNON_TABLE_BLOCK_H_
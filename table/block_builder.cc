@@ -37,6 +37,16 @@ Slice BlockBuilder::Finish() {
 }
 
 void BlockBuilder::Add(const Slice &key, const Slice &value) {
+  AddEntry(key, value, NULL);
+}
+
+void BlockBuilder::Add(const Slice &key, const Slice &value,
+                       const Slice &delta_value) {
+  AddEntry(key, value, &delta_value);
+}
+
+void BlockBuilder::AddEntry(const Slice &key, const Slice &value,
+                            const Slice *delta_value) {
   Slice last_key_piece(last_key_);
   assert(!finished_);
   assert(counter_ <= options_->block_restart_interval);
@@ -55,14 +65,22 @@ void BlockBuilder::Add(const Slice &key, const Slice &value) {
     counter_ = 0;
   }
   const size_t non_shared = key.size() - shared;
-  // Add "<shared><non_shared><value_size>" to buffer_
+  // Add "<shared><non_shared><value_size>" to buffer_, without the value
+  // size for delta encoded values
   PutVarint32(&buffer_, shared);
   PutVarint32(&buffer_, non_shared);
-  PutVarint32(&buffer_, value.size());
+  if (delta_value == NULL) {
+    PutVarint32(&buffer_, value.size());
+  }
 
-  // Add string delta to buffer_ followed by value
+  // Add string delta to buffer_ followed by value.  The reader tells a
+  // delta from a full value by the shared key bytes.
   buffer_.append(key.data() + shared, non_shared);
-  buffer_.append(value.data(), value.size());
+  if (delta_value != NULL && shared > 0) {
+    buffer_.append(delta_value->data(), delta_value->size());
+  } else {
+    buffer_.append(value.data(), value.size());
+  }
 
   // Update state
   last_key_.resize(shared);
@@ -22,6 +22,12 @@ public:
   // REQUIRES: key is larger than any previously added key
   void Add(const Slice &key, const Slice &value);
 
+  // Add with delta encoded values, as RocksDB index blocks do: no value
+  // size is stored, and an entry whose key shares a prefix with the
+  // previous one stores delta_value instead of value.  A block is built
+  // with one Add() or the other, not both.
+  void Add(const Slice &key, const Slice &value, const Slice &delta_value);
+
   // Finish building the block and return a slice that refers to the
   // block contents.  The returned slice will remain valid for the
   // lifetime of this builder or until Reset() is called.
@@ -35,6 +41,9 @@ public:
   bool empty() const { return buffer_.empty(); }
 
 private:
+  void AddEntry(const Slice &key, const Slice &value,
+                const Slice *delta_value);
+
   const Options *options_;
   std::string buffer_;             // Destination buffer
   std::vector<uint32_t> restarts_; // Restart points
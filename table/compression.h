@@ -1,8 +1,23 @@
 
+#ifndef STORAGE_SHANNONDB_TABLE_COMPRESSION_H_
+#define STORAGE_SHANNONDB_TABLE_COMPRESSION_H_
+
 #include <algorithm>
 #include <limits>
 #include <string>
+#include <vector>
 #include <iostream>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swift/slice.h"
+#include "util/coding.h"
+
+// The decompressors trace through DEBUG() of sst_table.h when it is
+// included first.
+#ifndef DEBUG
+#define DEBUG(format, arg...)
+#endif
 
 #ifdef ALL_COMPRESS
   #define ZSTD
@@ -123,14 +138,447 @@ inline bool CompressionTypeSupported(char compression_type) {
   }
 }
 
-inline bool zlib_uncompress(Slice* result, Slice* input) {
+// Codec state a thread keeps across the blocks it compresses.  Setting up
+// a zlib stream, an LZ4 state or a ZSTD context costs about as much as
+// compressing a small block, so each is made on first use and reset for
+// every block after.
+class CompressionContext {
+ public:
+  CompressionContext() {
+#ifdef ZLIB
+    zlib_ready_ = false;
+#endif
+#ifdef LZ4
+    lz4_state_ = NULL;
+    lz4hc_state_ = NULL;
+#endif
+#ifdef ZSTD
+    zstd_ = NULL;
+#endif
+  }
+
+  ~CompressionContext() {
+#ifdef ZLIB
+    if (zlib_ready_)
+      deflateEnd(&zlib_);
+#endif
+#ifdef LZ4
+    free(lz4_state_);
+    free(lz4hc_state_);
+#endif
+#ifdef ZSTD
+    ZSTD_freeCCtx(zstd_);
+#endif
+  }
+
+#ifdef ZLIB
+  // A raw deflate stream (windowBits -14) ready for a new block.
+  z_stream *zlib() {
+    if (zlib_ready_) {
+      return deflateReset(&zlib_) == Z_OK ? &zlib_ : NULL;
+    }
+    memset(&zlib_, 0, sizeof(zlib_));
+    if (deflateInit2(&zlib_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -14, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      return NULL;
+    }
+    zlib_ready_ = true;
+    return &zlib_;
+  }
+#endif
+
+#ifdef LZ4
+  // The state for LZ4_compress_fast_extState(), or with "hc" for
+  // LZ4_compress_HC_extStateHC(), which initialize it themselves.
+  void *lz4(bool hc) {
+    if (hc) {
+      if (lz4hc_state_ == NULL)
+        lz4hc_state_ = malloc(LZ4_sizeofStateHC());
+      return lz4hc_state_;
+    }
+    if (lz4_state_ == NULL)
+      lz4_state_ = malloc(LZ4_sizeofState());
+    return lz4_state_;
+  }
+#endif
+
+#ifdef ZSTD
+  ZSTD_CCtx *zstd() {
+    if (zstd_ == NULL)
+      zstd_ = ZSTD_createCCtx();
+    return zstd_;
+  }
+#endif
+
+ private:
+#ifdef ZLIB
+  z_stream zlib_;
+  bool zlib_ready_;
+#endif
+#ifdef LZ4
+  void *lz4_state_;
+  void *lz4hc_state_;
+#endif
+#ifdef ZSTD
+  ZSTD_CCtx *zstd_;
+#endif
+
+  // No copying allowed
+  CompressionContext(const CompressionContext &);
+  void operator=(const CompressionContext &);
+};
+
+// Codec state a thread keeps across the blocks it decompresses, and a
+// buffer the blocks may be decompressed into instead of a malloc() per
+// block.  bzip2 has no way to reset a stream and still sets up one per
+// block.
+class UncompressionContext {
+ public:
+  UncompressionContext() : buffer_(NULL), capacity_(0) {
+#ifdef ZLIB
+    zlib_ready_ = false;
+#endif
+#ifdef LZ4
+    lz4_ = NULL;
+#endif
+#ifdef ZSTD
+    zstd_ = NULL;
+#endif
+  }
+
+  ~UncompressionContext() {
+    free(buffer_);
+#ifdef ZLIB
+    if (zlib_ready_)
+      inflateEnd(&zlib_);
+#endif
+#ifdef LZ4
+    if (lz4_ != NULL)
+      LZ4_freeStreamDecode(lz4_);
+#endif
+#ifdef ZSTD
+    ZSTD_freeDCtx(zstd_);
+#endif
+  }
+
+  // A buffer of at least n bytes which keeps its contents when grown.  It
+  // is valid until the next call, or the thread exits.
+  char *Buffer(size_t n) {
+    if (n > capacity_) {
+      char *grown = static_cast<char *>(realloc(buffer_, n));
+      if (grown == NULL)
+        return NULL;
+      buffer_ = grown;
+      capacity_ = n;
+    }
+    return buffer_;
+  }
+
+#ifdef ZLIB
+  // A raw inflate stream (windowBits -14) ready for a new block.
+  z_stream *zlib() {
+    if (zlib_ready_) {
+      return inflateReset(&zlib_) == Z_OK ? &zlib_ : NULL;
+    }
+    memset(&zlib_, 0, sizeof(zlib_));
+    if (inflateInit2(&zlib_, -14) != Z_OK)
+      return NULL;
+    zlib_ready_ = true;
+    return &zlib_;
+  }
+#endif
+
+#ifdef LZ4
+  // Reset with LZ4_setStreamDecode() before each block.
+  LZ4_streamDecode_t *lz4() {
+    if (lz4_ == NULL)
+      lz4_ = LZ4_createStreamDecode();
+    return lz4_;
+  }
+#endif
+
+#ifdef ZSTD
+  ZSTD_DCtx *zstd() {
+    if (zstd_ == NULL)
+      zstd_ = ZSTD_createDCtx();
+    return zstd_;
+  }
+#endif
+
+ private:
+  char *buffer_;
+  size_t capacity_;
+#ifdef ZLIB
+  z_stream zlib_;
+  bool zlib_ready_;
+#endif
+#ifdef LZ4
+  LZ4_streamDecode_t *lz4_;
+#endif
+#ifdef ZSTD
+  ZSTD_DCtx *zstd_;
+#endif
+
+  // No copying allowed
+  UncompressionContext(const UncompressionContext &);
+  void operator=(const UncompressionContext &);
+};
+
+// The contexts of the calling thread, freed when it exits.
+inline CompressionContext *ThreadCompressionContext() {
+  static thread_local CompressionContext context;
+  return &context;
+}
+
+inline UncompressionContext *ThreadUncompressionContext() {
+  static thread_local UncompressionContext context;
+  return &context;
+}
+
+// A ZSTD dictionary, digested once for all the blocks compressed with it
+// instead of for every block as ZSTD_compress_usingDict() does.
+class CompressionDict {
+ public:
+  CompressionDict(const Slice &dict, int level)
+      : dict_(dict.data(), dict.size()) {
+#ifdef ZSTD
+    zstd_ = ZSTD_createCDict(dict_.data(), dict_.size(), level);
+#else
+    (void)level;
+#endif
+  }
+
+  ~CompressionDict() {
+#ifdef ZSTD
+    ZSTD_freeCDict(zstd_);
+#endif
+  }
+
+  Slice raw() const { return Slice(dict_); }
+#ifdef ZSTD
+  const ZSTD_CDict *zstd() const { return zstd_; }
+#endif
+
+ private:
+  std::string dict_;
+#ifdef ZSTD
+  ZSTD_CDict *zstd_;
+#endif
+
+  // No copying allowed
+  CompressionDict(const CompressionDict &);
+  void operator=(const CompressionDict &);
+};
+
+class UncompressionDict {
+ public:
+  explicit UncompressionDict(const Slice &dict)
+      : dict_(dict.data(), dict.size()) {
+#ifdef ZSTD
+    zstd_ = ZSTD_createDDict(dict_.data(), dict_.size());
+#endif
+  }
+
+  ~UncompressionDict() {
+#ifdef ZSTD
+    ZSTD_freeDDict(zstd_);
+#endif
+  }
+
+  Slice raw() const { return Slice(dict_); }
+#ifdef ZSTD
+  const ZSTD_DDict *zstd() const { return zstd_; }
+#endif
+
+ private:
+  std::string dict_;
+#ifdef ZSTD
+  ZSTD_DDict *zstd_;
+#endif
+
+  // No copying allowed
+  UncompressionDict(const UncompressionDict &);
+  void operator=(const UncompressionDict &);
+};
+
+// The level blocks are compressed at with ZSTD.
+static const int kZSTDCompressionLevel = 3;
+
+// Train a ZSTD dictionary of up to max_dict_bytes into *dict on "samples",
+// the concatenation of blocks of sample_sizes.  Returns false when ZSTD is
+// not compiled in or the samples are too few to train on.
+inline bool zstd_train_dict(const std::string& samples,
+                            const std::vector<size_t>& sample_sizes,
+                            size_t max_dict_bytes, std::string* dict) {
+#ifdef ZSTD
+  if (sample_sizes.empty() || max_dict_bytes == 0) {
+    return false;
+  }
+  dict->resize(max_dict_bytes);
+  size_t size = ZDICT_trainFromBuffer(&(*dict)[0], max_dict_bytes,
+                                      samples.data(), sample_sizes.data(),
+                                      static_cast<unsigned>(sample_sizes.size()));
+  if (ZDICT_isError(size)) {
+    dict->clear();
+    return false;
+  }
+  dict->resize(size);
+  return true;
+#else
+  (void)samples;
+  (void)sample_sizes;
+  (void)max_dict_bytes;
+  (void)dict;
+  return false;
+#endif
+}
+
+// The compressors below write compress_format_version 2, i.e. the
+// varint32 uncompressed length followed by the compressed data, which is
+// what the *_uncompress() functions expect.  They return false when the
+// library is not compiled in or fails, and the block is then stored
+// uncompressed.
+
+inline bool zlib_compress(const Slice& raw, std::string* output,
+                          CompressionContext* context) {
+#ifdef ZLIB
+  if (raw.size() > std::numeric_limits<uint32_t>::max()) {
+    return false;
+  }
+  output->clear();
+  PutVarint32(output, static_cast<uint32_t>(raw.size()));
+  size_t header_size = output->size();
+  // Raw deflate with windowBits -14, as zlib_uncompress().
+  z_stream* _stream = context->zlib();
+  if (_stream == NULL) {
+    return false;
+  }
+  uLong bound = deflateBound(_stream, static_cast<uLong>(raw.size()));
+  output->resize(header_size + bound);
+  _stream->next_in = (Bytef *)raw.data();
+  _stream->avail_in = static_cast<unsigned int>(raw.size());
+  _stream->next_out = (Bytef *)&(*output)[header_size];
+  _stream->avail_out = static_cast<unsigned int>(bound);
+  int st = deflate(_stream, Z_FINISH);
+  if (st != Z_STREAM_END) {
+    return false;
+  }
+  output->resize(header_size + _stream->total_out);
+  return true;
+#else
+  (void)raw;
+  (void)output;
+  (void)context;
+  return false;
+#endif
+}
+
+inline bool lz4_compress(const Slice& raw, std::string* output, bool hc,
+                         CompressionContext* context) {
+#ifdef LZ4
+  if (raw.size() > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+    return false;
+  }
+  void* state = context->lz4(hc);
+  if (state == NULL) {
+    return false;
+  }
+  output->clear();
+  PutVarint32(output, static_cast<uint32_t>(raw.size()));
+  size_t header_size = output->size();
+  int bound = LZ4_compressBound(static_cast<int>(raw.size()));
+  output->resize(header_size + bound);
+  int size;
+  if (hc) {
+    size = LZ4_compress_HC_extStateHC(state, raw.data(),
+                                      &(*output)[header_size],
+                                      static_cast<int>(raw.size()), bound, 0);
+  } else {
+    size = LZ4_compress_fast_extState(state, raw.data(),
+                                      &(*output)[header_size],
+                                      static_cast<int>(raw.size()), bound, 1);
+  }
+  if (size <= 0) {
+    return false;
+  }
+  output->resize(header_size + size);
+  return true;
+#else
+  (void)raw;
+  (void)output;
+  (void)hc;
+  (void)context;
+  return false;
+#endif
+}
+
+// With a dictionary, the blocks must be read with an UncompressionDict of
+// the same content.
+inline bool zstd_compress(const Slice& raw, std::string* output,
+                          CompressionContext* context,
+                          const CompressionDict* dict = NULL) {
+#ifdef ZSTD
+  if (raw.size() > std::numeric_limits<uint32_t>::max()) {
+    return false;
+  }
+  ZSTD_CCtx* cctx = context->zstd();
+  if (cctx == NULL) {
+    return false;
+  }
+  output->clear();
+  PutVarint32(output, static_cast<uint32_t>(raw.size()));
+  size_t header_size = output->size();
+  size_t bound = ZSTD_compressBound(raw.size());
+  output->resize(header_size + bound);
+  size_t size;
+  if (dict != NULL && dict->zstd() != NULL) {
+    size = ZSTD_compress_usingCDict(cctx, &(*output)[header_size], bound,
+                                    raw.data(), raw.size(), dict->zstd());
+  } else {
+    size = ZSTD_compressCCtx(cctx, &(*output)[header_size], bound,
+                             raw.data(), raw.size(), kZSTDCompressionLevel);
+  }
+  if (ZSTD_isError(size)) {
+    return false;
+  }
+  output->resize(header_size + size);
+  return true;
+#else
+  (void)raw;
+  (void)output;
+  (void)context;
+  (void)dict;
+  return false;
+#endif
+}
+
+// The decompressors below store into *result either a malloc()ed block
+// the caller frees, or with "into_buffer" the buffer of context, which
+// the next block the thread decompresses into it overwrites.
+inline char* ResizeUncompressOutput(UncompressionContext* context,
+                                    bool into_buffer, char* output,
+                                    size_t size) {
+  if (into_buffer) {
+    return context->Buffer(size);
+  }
+  return static_cast<char*>(realloc(output, size));
+}
+
+inline void FreeUncompressOutput(bool into_buffer, char* output) {
+  if (!into_buffer) {
+    free(output);
+  }
+}
+
+inline bool zlib_uncompress(Slice* result, Slice* input,
+                            UncompressionContext* context,
+                            bool into_buffer) {
 #ifdef ZLIB
   DEBUG("zlib_uncompress\n");
   int compress_format_version = 2;
   const char* input_data = input->data();
   size_t input_length = input->size();
   uint32_t output_len;
-  int windowBits = -14;
   const Slice& compression_dict = Slice();
   if (!GetDecompressedSizeInfo(&input_data, &input_length, &output_len)) {
     compress_format_version = 1;
@@ -141,35 +589,37 @@ inline bool zlib_uncompress(Slice* result, Slice* input) {
     compress_format_version = 2;
   }
   DEBUG("compress_format_version: %d\n", compress_format_version);
-  z_stream _stream;
-  memset(&_stream, 0, sizeof(z_stream));
-  int st = inflateInit2(&_stream, windowBits > 0 ? windowBits + 32 : windowBits);
+  z_stream* _stream = context->zlib();
   DEBUG("compression_dict size :%d, input size : %d\n", compression_dict.size(), input_length);
-  if (st != Z_OK) {
+  if (_stream == NULL) {
     return false;
   }
 
   if (compression_dict.size()) {
     // Initialize the compression library's dictionary
-    st = inflateSetDictionary(
-        &_stream, reinterpret_cast<const Bytef*>(compression_dict.data()),
+    int st = inflateSetDictionary(
+        _stream, reinterpret_cast<const Bytef*>(compression_dict.data()),
         static_cast<unsigned int>(compression_dict.size()));
     if (st != Z_OK) {
       DEBUG("something error\n");
       return false;
     }
   }
-  _stream.next_in = (Bytef *)input_data;
-  _stream.avail_in = static_cast<unsigned int>(input_length);
+  _stream->next_in = (Bytef *)input_data;
+  _stream->avail_in = static_cast<unsigned int>(input_length);
 
-  char* output = (char*)malloc(output_len);
+  char* output = ResizeUncompressOutput(context, into_buffer, NULL,
+                                        output_len);
+  if (output == NULL) {
+    return false;
+  }
 
-  _stream.next_out = (Bytef *)output;
-  _stream.avail_out = static_cast<unsigned int>(output_len);
+  _stream->next_out = (Bytef *)output;
+  _stream->avail_out = static_cast<unsigned int>(output_len);
 
   bool done = false;
   while (!done) {
-    st = inflate(&_stream, Z_SYNC_FLUSH);
+    int st = inflate(_stream, Z_SYNC_FLUSH);
     DEBUG("st: %d output_len : %d\n", st, output_len);
     switch (st) {
       case Z_STREAM_END:
@@ -180,34 +630,41 @@ inline bool zlib_uncompress(Slice* result, Slice* input) {
         size_t old_sz = output_len;
         uint32_t output_len_delta = output_len / 5;
         output_len += output_len_delta < 10 ? 10 : output_len_delta;
-        char* tmp = (char*) malloc(output_len);
-        memcpy(tmp, output, old_sz);
-        free(output);
+        char* tmp = ResizeUncompressOutput(context, into_buffer, output,
+                                           output_len);
+        if (tmp == NULL) {
+          FreeUncompressOutput(into_buffer, output);
+          return false;
+        }
         output = tmp;
-        _stream.next_out = (Bytef *)(output + old_sz);
-        _stream.avail_out = static_cast<unsigned int>(output_len - old_sz);
+        _stream->next_out = (Bytef *)(output + old_sz);
+        _stream->avail_out = static_cast<unsigned int>(output_len - old_sz);
         break;
       }
       case Z_BUF_ERROR:
       default:
-        free(output);
-        inflateEnd(&_stream);
+        FreeUncompressOutput(into_buffer, output);
         DEBUG("something error\n");
         return false;
     }
   }
   DEBUG("compress_format_version:%d, done:%d\n", compress_format_version, done);
-  assert(compress_format_version != 2 || _stream.avail_out == 0);
-  int size = static_cast<int> (output_len - _stream.avail_out);
-  inflateEnd(&_stream);
+  assert(compress_format_version != 2 || _stream->avail_out == 0);
+  int size = static_cast<int> (output_len - _stream->avail_out);
   *result = Slice(output, size);
   return true;
 #else
+  (void)result;
+  (void)input;
+  (void)context;
+  (void)into_buffer;
   return false;
 #endif
 }
 
-inline bool bzip2_uncompress(Slice *result, Slice *input) {
+inline bool bzip2_uncompress(Slice *result, Slice *input,
+                             UncompressionContext *context,
+                             bool into_buffer) {
   DEBUG("bzlib2_uncompress\n");
 #ifdef BZIP2
   DEBUG("bzlib2_uncompress\n");
@@ -215,8 +672,6 @@ inline bool bzip2_uncompress(Slice *result, Slice *input) {
   const char* input_data = input->data();
   size_t input_length = input->size();
   uint32_t output_len;
-  int windowBits = -14;
-  const Slice& compression_dict = Slice();
   if (!GetDecompressedSizeInfo(&input_data, &input_length, &output_len)) {
     compress_format_version = 1;
     size_t proposed_output_len = ((input_length * 5) & (~(4096 - 1))) + 4096;
@@ -227,7 +682,7 @@ inline bool bzip2_uncompress(Slice *result, Slice *input) {
   }
   DEBUG("compress_format_version: %d\n", compress_format_version);
   bz_stream _stream;
-  memset(&_stream, 0, sizeof(z_stream));
+  memset(&_stream, 0, sizeof(bz_stream));
 
  int st = BZ2_bzDecompressInit(&_stream, 0, 0);
   if (st != BZ_OK) {
@@ -237,7 +692,12 @@ inline bool bzip2_uncompress(Slice *result, Slice *input) {
   _stream.next_in = (char*) input_data;
   _stream.avail_in = static_cast<unsigned int> (input_length);
 
-  char* output = (char*) malloc(output_len);
+  char* output = ResizeUncompressOutput(context, into_buffer, NULL,
+                                        output_len);
+  if (output == NULL) {
+    BZ2_bzDecompressEnd(&_stream);
+    return false;
+  }
 
   _stream.next_out = (char*) output;
   _stream.avail_out = static_cast<unsigned int> (output_len);
@@ -253,16 +713,20 @@ inline bool bzip2_uncompress(Slice *result, Slice *input) {
         assert(compress_format_version != 2);
         uint32_t old_sz = output_len;
         output_len = output_len * 1.2;
-        char* tmp = new char[output_len];
-        memcpy(tmp, output, old_sz);
-        free(output);
+        char* tmp = ResizeUncompressOutput(context, into_buffer, output,
+                                           output_len);
+        if (tmp == NULL) {
+          FreeUncompressOutput(into_buffer, output);
+          BZ2_bzDecompressEnd(&_stream);
+          return false;
+        }
         output = tmp;
         _stream.next_out = (char *) (output + old_sz);
         _stream.avail_out = static_cast<unsigned int>(output_len - old_sz);
         break;
       }
       default:
-        free(output);
+        FreeUncompressOutput(into_buffer, output);
         BZ2_bzDecompressEnd(&_stream);
         return false;
     }
@@ -275,11 +739,16 @@ inline bool bzip2_uncompress(Slice *result, Slice *input) {
   *result = Slice(output, size);
   return true;
 #else
+  (void)result;
+  (void)input;
+  (void)context;
+  (void)into_buffer;
   return false;
 #endif
 }
 
-inline bool lz4_uncompress(Slice *result, Slice *input) {
+inline bool lz4_uncompress(Slice *result, Slice *input,
+                           UncompressionContext *context, bool into_buffer) {
   DEBUG("lz4_uncompress\n");
 #ifdef LZ4
   int compress_format_version = 2;
@@ -301,20 +770,24 @@ inline bool lz4_uncompress(Slice *result, Slice *input) {
   }
   DEBUG("compress_format_version: %d\n", compress_format_version);
 
-  char* output = (char*) malloc(output_len);
-  int size = -1;
-  LZ4_streamDecode_t* stream = LZ4_createStreamDecode();
-  if (compression_dict.size()) {
-    LZ4_setStreamDecode(stream, compression_dict.data(),
-                        static_cast<int>(compression_dict.size()));
+  LZ4_streamDecode_t* stream = context->lz4();
+  if (stream == NULL) {
+    return false;
   }
+  char* output = ResizeUncompressOutput(context, into_buffer, NULL,
+                                        output_len);
+  if (output == NULL) {
+    return false;
+  }
+  int size = -1;
+  LZ4_setStreamDecode(stream, compression_dict.data(),
+                      static_cast<int>(compression_dict.size()));
   size = LZ4_decompress_safe_continue(
       stream, input_data, output, static_cast<int>(input_length),
       static_cast<int>(output_len));
-  LZ4_freeStreamDecode(stream);
   DEBUG("size: %d output_len : %d input size : %d\n", size, output_len, input->size());
   if (size < 0) {
-    free(output);
+    FreeUncompressOutput(into_buffer, output);
     DEBUG("size %d\n", size);
     return false;
   }
@@ -322,48 +795,69 @@ inline bool lz4_uncompress(Slice *result, Slice *input) {
   *result = Slice(output, size);
   return true;
 #else
+  (void)result;
+  (void)input;
+  (void)context;
+  (void)into_buffer;
   return false;
 #endif
 }
 
-inline bool lz4hcc_uncompress(Slice *result, Slice *input) {
+inline bool lz4hcc_uncompress(Slice *result, Slice *input,
+                              UncompressionContext *context,
+                              bool into_buffer) {
   DEBUG("lz4hcc_uncompress\n");
-#ifdef LZ4
-  return lz4_uncompress(result, input);
-#else
-  return false;
-#endif
+  return lz4_uncompress(result, input, context, into_buffer);
 }
 
-inline bool zstd_uncompress(Slice *result, Slice *input) {
+inline bool zstd_uncompress(Slice *result, Slice *input,
+                            UncompressionContext *context, bool into_buffer,
+                            const UncompressionDict *dict = NULL) {
 #ifdef ZSTD
   DEBUG("zstd_uncompress\n");
   const char* input_data = input->data();
   size_t input_length = input->size();
   uint32_t output_len;
-  const Slice& compression_dict = Slice();
   if (!GetDecompressedSizeInfo(&input_data, &input_length, &output_len)) {
     return false;
   }
   DEBUG("inputsize: %d input_size: %d\n", input_length, input->size());
-  char* output = (char*) malloc(output_len);
-  int size = -1;
+  ZSTD_DCtx* dctx = context->zstd();
+  if (dctx == NULL) {
+    return false;
+  }
+  char* output = ResizeUncompressOutput(context, into_buffer, NULL,
+                                        output_len);
+  if (output == NULL) {
+    return false;
+  }
 
   size_t actual_output_length;
-  ZSTD_DCtx* context = ZSTD_createDCtx();
-  actual_output_length = ZSTD_decompress_usingDict(
-      context, output, output_len, input_data, input_length,
-      compression_dict.data(), compression_dict.size());
-  ZSTD_freeDCtx(context);
+  if (dict != NULL && dict->zstd() != NULL) {
+    actual_output_length = ZSTD_decompress_usingDDict(
+        dctx, output, output_len, input_data, input_length, dict->zstd());
+  } else {
+    actual_output_length = ZSTD_decompressDCtx(dctx, output, output_len,
+                                               input_data, input_length);
+  }
   DEBUG("actual_output_length :%d output_len :%d \n", actual_output_length, output_len);
-  assert(actual_output_length == output_len);
-  size = static_cast<int>(actual_output_length);
-  assert(size >= 0);
-  *result = Slice(output, size);
+  if (ZSTD_isError(actual_output_length) ||
+      actual_output_length != output_len) {
+    FreeUncompressOutput(into_buffer, output);
+    return false;
+  }
+  *result = Slice(output, actual_output_length);
   return true;
 #else
+  (void)result;
+  (void)input;
+  (void)context;
+  (void)into_buffer;
+  (void)dict;
   return false;
 #endif
 }
 
-} //namespace shannon
\ No newline at end of file
+} //namespace shannon
+
+#endif  // STORAGE_SHANNONDB_TABLE_COMPRESSION_H_
@@ -85,4 +85,49 @@ bool InternalFilterPolicy::KeyMayMatch(const Slice &key, const Slice &f) const {
   return user_policy_->KeyMayMatch(ExtractUserKey(key), f);
 }
 
+namespace {
+// Full filters hold user keys, as those RocksDB writes.
+class InternalFilterBitsBuilder : public FilterBitsBuilder {
+public:
+  explicit InternalFilterBitsBuilder(FilterBitsBuilder *user_builder)
+      : user_builder_(user_builder) {}
+  virtual ~InternalFilterBitsBuilder() { delete user_builder_; }
+  virtual void AddKey(const Slice &key) {
+    user_builder_->AddKey(ExtractUserKey(key));
+  }
+  virtual void Finish(std::string *dst) { user_builder_->Finish(dst); }
+
+private:
+  FilterBitsBuilder *const user_builder_;
+};
+
+class InternalFilterBitsReader : public FilterBitsReader {
+public:
+  explicit InternalFilterBitsReader(FilterBitsReader *user_reader)
+      : user_reader_(user_reader) {}
+  virtual ~InternalFilterBitsReader() { delete user_reader_; }
+  virtual bool MayMatch(const Slice &key) {
+    return user_reader_->MayMatch(ExtractUserKey(key));
+  }
+
+private:
+  FilterBitsReader *const user_reader_;
+};
+} // namespace
+
+FilterBitsBuilder *InternalFilterPolicy::GetFilterBitsBuilder() const {
+  FilterBitsBuilder *user_builder = user_policy_->GetFilterBitsBuilder();
+  if (user_builder == NULL)
+    return NULL;
+  return new InternalFilterBitsBuilder(user_builder);
+}
+
+FilterBitsReader *
+InternalFilterPolicy::GetFilterBitsReader(const Slice &contents) const {
+  FilterBitsReader *user_reader = user_policy_->GetFilterBitsReader(contents);
+  if (user_reader == NULL)
+    return NULL;
+  return new InternalFilterBitsReader(user_reader);
+}
+
 } // namespace shannon
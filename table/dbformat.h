@@ -101,6 +101,8 @@ public:
   virtual const char *Name() const;
   virtual void CreateFilter(const Slice *keys, int n, std::string *dst) const;
   virtual bool KeyMayMatch(const Slice &key, const Slice &filter) const;
+  virtual FilterBitsBuilder *GetFilterBitsBuilder() const;
+  virtual FilterBitsReader *GetFilterBitsReader(const Slice &contents) const;
 };
 
 // Modules in this directory should keep internal keys wrapped inside
@@ -11,9 +11,14 @@ static const size_t kFilterBaseLg = 11;
 static const size_t kFilterBase = 1 << kFilterBaseLg;
 
 FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy *policy)
-    : policy_(policy) {}
+    : policy_(policy), bits_builder_(policy->GetFilterBitsBuilder()) {}
+
+FilterBlockBuilder::~FilterBlockBuilder() { delete bits_builder_; }
 
 void FilterBlockBuilder::StartBlock(uint64_t block_offset) {
+  if (bits_builder_ != NULL) {
+    return; // A full filter does not care about blocks
+  }
   uint64_t filter_index = (block_offset / kFilterBase);
   assert(filter_index >= filter_offsets_.size());
   while (filter_index > filter_offsets_.size()) {
@@ -22,12 +27,20 @@ void FilterBlockBuilder::StartBlock(uint64_t block_offset) {
 }
 
 void FilterBlockBuilder::AddKey(const Slice &key) {
+  if (bits_builder_ != NULL) {
+    bits_builder_->AddKey(key);
+    return;
+  }
   Slice k = key;
   start_.push_back(keys_.size());
   keys_.append(k.data(), k.size());
 }
 
 Slice FilterBlockBuilder::Finish() {
+  if (bits_builder_ != NULL) {
+    bits_builder_->Finish(&result_);
+    return Slice(result_);
+  }
   if (!start_.empty()) {
     GenerateFilter();
   }
@@ -99,4 +112,17 @@ bool FilterBlockReader::KeyMayMatch(uint64_t block_offset, const Slice &key) {
   }
   return true; // Errors are treated as potential matches
 }
+
+FullFilterBlockReader::FullFilterBlockReader(const FilterPolicy *policy,
+                                             const Slice &contents)
+    : bits_reader_(policy->GetFilterBitsReader(contents)) {}
+
+FullFilterBlockReader::~FullFilterBlockReader() { delete bits_reader_; }
+
+bool FullFilterBlockReader::KeyMayMatch(const Slice &key) {
+  if (bits_reader_ == NULL) {
+    return true; // Errors are treated as potential matches
+  }
+  return bits_reader_->MayMatch(key);
+}
 }
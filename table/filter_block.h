@@ -11,10 +11,18 @@
 namespace shannon {
 
 class FilterPolicy;
+class FilterBitsBuilder;
+class FilterBitsReader;
 
+// Builds a filter block: one filter per 2KB of data, or a single full
+// filter over the table when the policy has a FilterBitsBuilder.
 class FilterBlockBuilder {
 public:
   explicit FilterBlockBuilder(const FilterPolicy *);
+  ~FilterBlockBuilder();
+
+  // Whether the block is a full filter, stored under "fullfilter.<name>".
+  bool is_full() const { return bits_builder_ != NULL; }
 
   void StartBlock(uint64_t block_offset);
   void AddKey(const Slice &key);
@@ -24,6 +32,7 @@ private:
   void GenerateFilter();
 
   const FilterPolicy *policy_;
+  FilterBitsBuilder *bits_builder_; // NULL for per-block filters
   std::string keys_;            // Flattened key contents
   std::vector<size_t> start_;   // Starting index in keys_ of each key
   std::string result_;          // Filter data computed so far
@@ -48,6 +57,21 @@ private:
   size_t num_;         // Number of entries in offset array
   size_t base_lg_;     // Encoding parameter (see kFilterBaseLg in .cc file)
 };
+
+class FullFilterBlockReader {
+public:
+  // REQUIRES: "contents" and *policy must stay live while *this is live.
+  FullFilterBlockReader(const FilterPolicy *policy, const Slice &contents);
+  ~FullFilterBlockReader();
+  bool KeyMayMatch(const Slice &key);
+
+private:
+  FilterBitsReader *bits_reader_; // NULL if the policy has no full filters
+
+  // No copying allowed
+  FullFilterBlockReader(const FullFilterBlockReader &);
+  void operator=(const FullFilterBlockReader &);
+};
 }
 
 #endif // STORAGE_SHANNON_TABLE_FILTER_BLOCK_H_
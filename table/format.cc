@@ -20,7 +20,7 @@ Status BlockHandle::DecodeFrom(Slice *input) {
 
 void Footer::EncodeTo(std::string *dst) const {
   const size_t original_size = dst->size();
-  dst->push_back(static_cast<char>(1));
+  dst->push_back(static_cast<char>(checksum_));
   metaindex_handle_.EncodeTo(dst);
   index_handle_.EncodeTo(dst);
   dst->resize(original_size + kNewVersionsEncodedLength - 12); // Padding
@@ -43,7 +43,7 @@ private:
 // end of every table file.
 class Footer {
 public:
-  Footer() {}
+  Footer() : checksum_(kCRC32c) {}
 
   // The block handle for the metaindex block of the table
   const BlockHandle &metaindex_handle() const { return metaindex_handle_; }
@@ -53,6 +53,10 @@ public:
   const BlockHandle &index_handle() const { return index_handle_; }
   void set_index_handle(const BlockHandle &h) { index_handle_ = h; }
 
+  // The checksum type of every block of the table
+  ChecksumType checksum() const { return checksum_; }
+  void set_checksum(ChecksumType c) { checksum_ = c; }
+
   void EncodeTo(std::string *dst) const;
   Status DecodeFrom(Slice *input);
 
@@ -65,6 +69,7 @@ public:
   };
 
 private:
+  ChecksumType checksum_;
   BlockHandle metaindex_handle_;
   BlockHandle index_handle_;
 };
@@ -87,11 +87,20 @@ void PropertyBlockBuilder::Add(const std::string& name, uint64_t val) {
   Add(name, dst);
 }
 
+void PropertyBlockBuilder::Fixed32Add(const std::string& name, uint32_t val) {
+  std::string dst;
+  PutFixed32(&dst, val);
+  Add(name, dst);
+}
+
 void PropertyBlockBuilder::AddTableProperty(const TableProperties& props) {
   Add(TablePropertiesNames::kColumnFamilyId, props.column_family_id);
   if (!props.column_family_name.empty()) {
     Add(TablePropertiesNames::kColumnFamilyName, props.column_family_name);
   }
+  if (!props.comparator_name.empty()) {
+    Add(TablePropertiesNames::kComparator, props.comparator_name);
+  }
   if (!props.compression_name.empty()) {
     Add(TablePropertiesNames::kCompression, props.compression_name);
   }
@@ -100,12 +109,20 @@ void PropertyBlockBuilder::AddTableProperty(const TableProperties& props) {
   Add(kGlobalSeqno, 0);
   Add(kVersion, 2);
   Add(TablePropertiesNames::kFormatVersion, 0);
+  if (props.index_partitions > 0) {
+    Add(TablePropertiesNames::kIndexPartitions, props.index_partitions);
+  }
   Add(TablePropertiesNames::kIndexSize, props.index_size);
+  Add(TablePropertiesNames::kIndexValueIsDeltaEncoded,
+      props.index_value_is_delta_encoded);
   Add(TablePropertiesNames::kNumDataBlocks, props.num_data_blocks);
   Add(TablePropertiesNames::kNumEntries, props.num_entries);
   Add(TablePropertiesNames::kOldestKeyTime, props.oldest_key_time);
   Add(TablePropertiesNames::kRawKeySize, props.raw_key_size);
   Add(TablePropertiesNames::kRawValueSize, props.raw_value_size);
+  if (props.index_partitions > 0) {
+    Add(TablePropertiesNames::kTopLevelIndexSize, props.top_level_index_size);
+  }
   if (!props.filter_policy_name.empty()) {
     Add(TablePropertiesNames::kFilterPolicy, props.filter_policy_name);
   }
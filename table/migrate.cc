@@ -66,11 +66,24 @@ int main() {
     assert(status.ok());
     cout << "please cin sst file split with a blank" << endl;
     char filepath[100];
+    vector <string> files;
     while (true) {
         scanf("%s%c", filepath, &chr);
-        status = db->IngestExternFile(filepath, verify, &handles);
+        files.push_back(string(filepath));
         if (chr == '\n' || chr == '\r') break;
-        assert(status.ok());
+    }
+    IngestExternalFileOptions ingest_options;
+    ingest_options.verify_checksums = verify;
+    vector <IngestExternalFileReport> reports;
+    status = db->IngestExternalFiles(files, ingest_options, &handles, &reports);
+    for (size_t i = 0; i < reports.size(); i++) {
+        cout << reports[i].filename << " cf=" << reports[i].cf_name
+             << " put=" << reports[i].keys_put
+             << " deleted=" << reports[i].keys_deleted
+             << " dropped=" << reports[i].keys_dropped
+             << " bytes=" << reports[i].bytes
+             << " micros=" << reports[i].micros
+             << " status=" << reports[i].status.ToString() << endl;
     }
     cout << "status : " << status.ToString() << endl;
     cout << "exit...." << endl;
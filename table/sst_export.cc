@@ -0,0 +1,327 @@
+// Copyright (c) 2018 Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+
+#include "sst_export.h"
+#include "dbformat.h"
+#include "table_builder.h"
+#include "util/bounded_queue.h"
+#include "util/filename.h"
+#include "util/pipelined_writable_file.h"
+#include "util/statistics.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+namespace shannon {
+
+void SstExportStats::Merge(const SstExportStats& other) {
+  num_entries += other.num_entries;
+  num_files += other.num_files;
+  read_bytes += other.read_bytes;
+  write_bytes += other.write_bytes;
+  read_micros += other.read_micros;
+  encode_micros += other.encode_micros;
+  write_micros += other.write_micros;
+  if (other.elapsed_micros > elapsed_micros) {
+    elapsed_micros = other.elapsed_micros;
+  }
+}
+
+static double MBPerSecond(uint64_t bytes, uint64_t micros) {
+  if (micros == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(bytes) / 1048576.0 /
+         (static_cast<double>(micros) / 1000000.0);
+}
+
+std::string SstExportStats::ToString() const {
+  char buf[512];
+  snprintf(buf, sizeof(buf),
+           "entries=%lu files=%lu read=%lu bytes write=%lu bytes "
+           "elapsed=%.3fs, read: %.1f MB/s (%.3fs), "
+           "encode: %.1f MB/s (%.3fs), write: %.1f MB/s (%.3fs)",
+           (unsigned long)num_entries, (unsigned long)num_files,
+           (unsigned long)read_bytes, (unsigned long)write_bytes,
+           elapsed_micros / 1000000.0,
+           MBPerSecond(read_bytes, read_micros), read_micros / 1000000.0,
+           MBPerSecond(read_bytes, encode_micros), encode_micros / 1000000.0,
+           MBPerSecond(write_bytes, write_micros), write_micros / 1000000.0);
+  return std::string(buf);
+}
+
+namespace {
+
+// Entries copied out of the device by the reader.  Keys and values are
+// packed into "data" so a batch costs a couple of allocations.
+struct ExportEntry {
+  size_t offset;
+  uint32_t key_size;
+  uint32_t value_size;
+  uint64_t timestamp;
+};
+
+struct ExportBatch {
+  std::string data;
+  std::vector<ExportEntry> entries;
+};
+
+// Reader stage: walk "iter" and queue its entries in batches.
+static void ReadEntries(Iterator* iter, size_t batch_size,
+                        BoundedQueue<ExportBatch>* queue, Status* status,
+                        SstExportStats* stats) {
+  ExportBatch batch;
+  uint64_t start = StatsNowMicros();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    const Slice key = iter->key();
+    const Slice value = iter->value();
+    ExportEntry entry;
+    entry.offset = batch.data.size();
+    entry.key_size = key.size();
+    entry.value_size = value.size();
+    entry.timestamp = iter->timestamp();
+    batch.data.append(key.data(), key.size());
+    batch.data.append(value.data(), value.size());
+    batch.entries.push_back(entry);
+    stats->read_bytes += key.size() + value.size();
+    if (batch.data.size() >= batch_size) {
+      stats->read_micros += StatsNowMicros() - start;
+      if (!queue->Push(std::move(batch))) {
+        // The encoder gave up.
+        return;
+      }
+      batch = ExportBatch();
+      start = StatsNowMicros();
+    }
+  }
+  *status = iter->status();
+  stats->read_micros += StatsNowMicros() - start;
+  if (status->ok() && !batch.entries.empty()) {
+    queue->Push(std::move(batch));
+  }
+  queue->Close();
+}
+
+class ColumnFamilyExporter {
+ public:
+  ColumnFamilyExporter(const std::string& dbname, Env* env,
+                       const SstExportOptions& options,
+                       ColumnFamilyHandle* handle, SstExportStats* stats)
+      : dbname_(dbname),
+        env_(env),
+        options_(options),
+        comparator_(options.table_options.inner_comparator),
+        filter_policy_(options.table_options.filter_policy),
+        table_options_(options.table_options),
+        handle_(handle),
+        stats_(stats),
+        file_(NULL),
+        builder_(NULL),
+        creation_time_(0),
+        last_timestamp_(0) {
+    // The table holds internal keys, its filters the user keys.  Index
+    // keys are shortened as internal keys, so readers can seek them.
+    table_options_.inner_comparator = &comparator_;
+    if (table_options_.filter_policy != NULL) {
+      table_options_.filter_policy = &filter_policy_;
+    }
+  }
+
+  ~ColumnFamilyExporter() {
+    if (builder_ != NULL) {
+      builder_->Abandon();
+      delete builder_;
+    }
+    delete file_;
+  }
+
+  Status Run(Iterator* iter) {
+    uint64_t start = StatsNowMicros();
+    BoundedQueue<ExportBatch> queue(options_.read_queue_depth);
+    Status read_status;
+    std::thread reader(ReadEntries, iter, options_.read_batch_size, &queue,
+                       &read_status, stats_);
+
+    Status s;
+    ExportBatch batch;
+    while (s.ok() && queue.Pop(&batch)) {
+      s = Encode(batch);
+    }
+    // Stops the reader if we bailed out early.
+    queue.Close();
+    reader.join();
+    if (s.ok()) {
+      s = read_status;
+    }
+    if (s.ok() && builder_ != NULL) {
+      s = FinishFile();
+    }
+    if (!s.ok()) {
+      for (size_t i = 0; i < fnames_.size(); i++) {
+        env_->DeleteFile(fnames_[i]);
+      }
+    }
+    stats_->elapsed_micros = StatsNowMicros() - start;
+    return s;
+  }
+
+ private:
+  Status Encode(const ExportBatch& batch) {
+    Status s;
+    uint64_t start = StatsNowMicros();
+    uint64_t wait = file_ != NULL ? file_->wait_micros() : 0;
+    for (size_t i = 0; s.ok() && i < batch.entries.size(); i++) {
+      const ExportEntry& entry = batch.entries[i];
+      if (builder_ == NULL) {
+        stats_->encode_micros += StatsNowMicros() - start;
+        s = NewFile(entry.timestamp);
+        start = StatsNowMicros();
+        wait = file_ != NULL ? file_->wait_micros() : 0;
+        if (!s.ok()) {
+          break;
+        }
+      }
+      const char* p = batch.data.data() + entry.offset;
+      internal_key_.clear();
+      AppendInternalKey(&internal_key_,
+                        ParsedInternalKey(Slice(p, entry.key_size),
+                                          entry.timestamp, kSstTypeValue));
+      builder_->Add(internal_key_,
+                    Slice(p + entry.key_size, entry.value_size));
+      last_timestamp_ = entry.timestamp;
+      stats_->num_entries++;
+      if (builder_->FileSize() >= options_.target_file_size) {
+        stats_->encode_micros +=
+            StatsNowMicros() - start - (file_->wait_micros() - wait);
+        s = FinishFile();
+        start = StatsNowMicros();
+        wait = 0;
+      } else if (!builder_->status().ok()) {
+        s = builder_->status();
+      }
+    }
+    if (file_ != NULL) {
+      stats_->encode_micros +=
+          StatsNowMicros() - start - (file_->wait_micros() - wait);
+    }
+    return s;
+  }
+
+  Status NewFile(uint64_t creation_time) {
+    std::string fname = TableFileName(dbname_, fnames_.size() + 1,
+                                      handle_->GetName().c_str());
+    WritableFile* file;
+    Status s = env_->NewWritableFile(fname, &file);
+    if (!s.ok()) {
+      return s;
+    }
+    fnames_.push_back(fname);
+    file_ = new PipelinedWritableFile(file, options_.write_chunk_size,
+                                      options_.write_queue_depth);
+    builder_ = new TableBuilder(table_options_, file_,
+                                handle_->GetName(), handle_->GetID());
+    creation_time_ = creation_time;
+    return s;
+  }
+
+  Status FinishFile() {
+    uint64_t start = StatsNowMicros();
+    uint64_t wait = file_->wait_micros();
+    Status s = builder_->Finish(creation_time_, last_timestamp_);
+    delete builder_;
+    builder_ = NULL;
+    stats_->encode_micros +=
+        StatsNowMicros() - start - (file_->wait_micros() - wait);
+    if (s.ok()) {
+      s = file_->Sync();
+    }
+    if (s.ok()) {
+      s = file_->Close();
+    }
+    stats_->write_bytes += file_->write_bytes();
+    stats_->write_micros += file_->write_micros();
+    stats_->num_files++;
+    delete file_;
+    file_ = NULL;
+    return s;
+  }
+
+  const std::string dbname_;
+  Env* const env_;
+  const SstExportOptions& options_;
+  InternalKeyComparator comparator_;
+  InternalFilterPolicy filter_policy_;
+  Options table_options_;
+  ColumnFamilyHandle* const handle_;
+  SstExportStats* const stats_;
+
+  PipelinedWritableFile* file_;
+  TableBuilder* builder_;
+  std::vector<std::string> fnames_;
+  std::string internal_key_;
+  uint64_t creation_time_;
+  uint64_t last_timestamp_;
+};
+
+static void RecordExportStats(Statistics* statistics,
+                              const SstExportStats& stats) {
+  RecordTick(statistics, SST_EXPORT_KEYS, stats.num_entries);
+  RecordTick(statistics, SST_EXPORT_FILES, stats.num_files);
+  RecordTick(statistics, SST_EXPORT_READ_BYTES, stats.read_bytes);
+  RecordTick(statistics, SST_EXPORT_WRITE_BYTES, stats.write_bytes);
+  RecordTick(statistics, SST_EXPORT_READ_MICROS, stats.read_micros);
+  RecordTick(statistics, SST_EXPORT_ENCODE_MICROS, stats.encode_micros);
+  RecordTick(statistics, SST_EXPORT_WRITE_MICROS, stats.write_micros);
+}
+
+}  // namespace
+
+Status ExportColumnFamilies(const std::string& dbname, Env* env,
+                            const SstExportOptions& options,
+                            const std::vector<ColumnFamilyHandle*>& handles,
+                            const std::vector<Iterator*>& iterators,
+                            std::vector<SstExportStats>* stats) {
+  if (handles.size() != iterators.size()) {
+    return Status::InvalidArgument("handles and iterators size mismatch");
+  }
+  std::vector<SstExportStats> job_stats(handles.size());
+  std::vector<Status> job_status(handles.size());
+  std::atomic<size_t> next_job(0);
+
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next_job.fetch_add(1)) < handles.size()) {
+      ColumnFamilyExporter exporter(dbname, env, options, handles[i],
+                                    &job_stats[i]);
+      job_status[i] = exporter.Run(iterators[i]);
+      RecordExportStats(options.statistics, job_stats[i]);
+    }
+  };
+
+  size_t num_workers = options.max_jobs > 0 ? options.max_jobs : 1;
+  if (num_workers > handles.size()) {
+    num_workers = handles.size();
+  }
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < num_workers; i++) {
+    workers.push_back(std::thread(worker));
+  }
+  worker();
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+
+  if (stats != NULL) {
+    stats->swap(job_stats);
+  }
+  for (size_t i = 0; i < job_status.size(); i++) {
+    if (!job_status[i].ok()) {
+      return job_status[i];
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace shannon
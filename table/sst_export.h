@@ -0,0 +1,82 @@
+// Copyright (c) 2018 Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Pipelined export of column families to SST files.  Every column family
+// runs three stages connected by bounded queues:
+//
+//   reader:  walks the iterator and copies key, value and timestamp out of
+//            the device in batches;
+//   encoder: builds internal keys and feeds the TableBuilder, which encodes
+//            and compresses the blocks and cuts a new file whenever the
+//            current one reaches the target size;
+//   writer:  appends the finished bytes to the file, in order.
+//
+// Column families are exported concurrently, so the export is bounded by
+// the device rather than by one core.
+
+#ifndef STORAGE_SHANNONDB_TABLE_SST_EXPORT_H_
+#define STORAGE_SHANNONDB_TABLE_SST_EXPORT_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "swift/env.h"
+#include "swift/iterator.h"
+#include "swift/options.h"
+#include "swift/shannon_db.h"
+#include "swift/status.h"
+
+namespace shannon {
+
+// Work done and time spent by each stage.  A stage's time excludes the
+// time it waited on its neighbours, so bytes / micros is the throughput
+// the stage could sustain on its own.
+struct SstExportStats {
+  uint64_t num_entries = 0;
+  uint64_t num_files = 0;
+  uint64_t read_bytes = 0;     // user keys and values read from the device
+  uint64_t write_bytes = 0;    // bytes appended to the SST files
+  uint64_t read_micros = 0;
+  uint64_t encode_micros = 0;
+  uint64_t write_micros = 0;
+  uint64_t elapsed_micros = 0;
+
+  void Merge(const SstExportStats& other);
+  std::string ToString() const;
+};
+
+struct SstExportOptions {
+  // Table options (block size, compression, filter policy) of the files.
+  Options table_options;
+  // A new file is started once the current one reaches this size.
+  uint64_t target_file_size = 64 << 20;
+  // Maximum number of column families exported at the same time.
+  int max_jobs = 1;
+  // Bytes of entries the reader hands to the encoder at a time, and
+  // how many of those batches may wait for it.
+  size_t read_batch_size = 1 << 20;
+  int read_queue_depth = 4;
+  // Bytes the encoder hands to the writer at a time, and how many of
+  // those chunks may wait for it.
+  size_t write_chunk_size = 1 << 20;
+  int write_queue_depth = 4;
+  // If non-null, the SST_EXPORT_* tickers are recorded here.
+  Statistics* statistics = nullptr;
+};
+
+// Export the column family "handles[i]" from "iterators[i]" into files
+// named by TableFileName(dbname, n, handles[i]->GetName()), n = 1, 2, ...
+// The iterators are positioned by this call.  On return stats[i], if
+// "stats" is non-null, holds the report of the i-th column family.
+// Returns the first error hit; the files of a failed column family are
+// deleted.
+extern Status ExportColumnFamilies(const std::string& dbname, Env* env,
+                                   const SstExportOptions& options,
+                                   const std::vector<ColumnFamilyHandle*>& handles,
+                                   const std::vector<Iterator*>& iterators,
+                                   std::vector<SstExportStats>* stats);
+
+}  // namespace shannon
+
+#endif  // STORAGE_SHANNONDB_TABLE_SST_EXPORT_H_
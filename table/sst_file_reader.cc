@@ -0,0 +1,814 @@
+// Copyright (c) 2018 Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+
+#include "swift/sst_file_reader.h"
+#include "block.h"
+#include "dbformat.h"
+#include "filter_block.h"
+#include "sst_table.h"
+#include "compression.h"
+#include "swift/cache.h"
+#include "swift/comparator.h"
+#include "swift/filter_policy.h"
+#include "util/coding.h"
+#include "util/fileoperate.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace shannon {
+
+namespace {
+
+// RocksDB value type of a key deleted with SingleDelete().
+const unsigned char kSstTypeSingleDeletion = 0x7;
+
+const char kIndexKeyIsUserKey[] = "rocksdb.index.key.is.user.key";
+
+// Orders the keys of data and index blocks: by user key, then by
+// decreasing sequence and type.  Index keys shorter than 8 bytes, which
+// tables built with a bytewise comparator may have, are taken as user keys
+// ahead of all the versions of theirs.
+class TableKeyComparator : public Comparator {
+public:
+  explicit TableKeyComparator(const Comparator *user_comparator)
+      : user_comparator_(user_comparator) {}
+
+  virtual const char *Name() const { return "shannon.TableKeyComparator"; }
+
+  virtual int Compare(const Slice &a, const Slice &b) const {
+    int r = user_comparator_->Compare(UserKey(a), UserKey(b));
+    if (r == 0) {
+      const uint64_t anum = Tag(a);
+      const uint64_t bnum = Tag(b);
+      if (anum > bnum) {
+        r = -1;
+      } else if (anum < bnum) {
+        r = +1;
+      }
+    }
+    return r;
+  }
+
+  virtual void FindShortestSeparator(std::string *, const Slice &) const {}
+  virtual void FindShortSuccessor(std::string *) const {}
+
+private:
+  static Slice UserKey(const Slice &key) {
+    return key.size() >= 8 ? Slice(key.data(), key.size() - 8) : key;
+  }
+  static uint64_t Tag(const Slice &key) {
+    return key.size() >= 8 ? DecodeFixed64(key.data() + key.size() - 8)
+                           : ~static_cast<uint64_t>(0);
+  }
+
+  const Comparator *user_comparator_;
+};
+
+// A decoded entry of a data block.
+struct TableEntry {
+  Slice user_key;
+  uint64_t sequence;
+  unsigned char type;
+};
+
+Status ParseTableEntry(const Slice &internal_key, TableEntry *entry) {
+  const size_t n = internal_key.size();
+  if (n < 8) {
+    return Status::Corruption("bad internal key in sst file");
+  }
+  uint64_t num = DecodeFixed64(internal_key.data() + n - 8);
+  entry->user_key = Slice(internal_key.data(), n - 8);
+  entry->sequence = num >> 8;
+  entry->type = num & 0xff;
+  if (entry->type != kSstTypeValue && entry->type != kSstTypeDeletion &&
+      entry->type != kSstTypeSingleDeletion) {
+    return Status::NotSupported("value type of sst entry not supported");
+  }
+  return Status::OK();
+}
+
+inline bool IsDeletion(const TableEntry &entry) {
+  return entry.type != kSstTypeValue;
+}
+
+Status DecodeHandle(const Slice &encoded, BlockHandle *handle) {
+  Slice input = encoded;
+  return BlockHandleDecodeFrom(handle, &input);
+}
+
+void DeleteCachedBlock(const Slice &, void *value) {
+  delete reinterpret_cast<Block *>(value);
+}
+
+} // namespace
+
+struct SstFileReader::Rep {
+  Options options;
+  TableKeyComparator comparator;
+  MappedFile file;
+  bool opened;
+  uint8_t checksum_type; // from the footer, used when verifying
+  BlockHandle metaindex_handle;
+  BlockHandle index_handle;
+  Block *index_block;
+  bool index_key_is_user_key;
+  // The filter block, if the file has one of options.filter_policy, and
+  // the reader of it.
+  Slice filter_data;
+  uint8_t filter_data_copied;
+  FullFilterBlockReader *full_filter;
+  FilterBlockReader *block_filter;
+  // The dictionary data blocks are compressed with, if any.
+  UncompressionDict *compression_dict;
+  uint64_t cache_id;
+
+  explicit Rep(const Options &opt)
+      : options(opt), comparator(opt.inner_comparator), opened(false),
+        checksum_type(kNoChecksum), index_block(NULL),
+        index_key_is_user_key(false), filter_data_copied(0),
+        full_filter(NULL), block_filter(NULL), compression_dict(NULL),
+        cache_id(0) {
+    memset(&file, 0, sizeof(file));
+    memset(&metaindex_handle, 0, sizeof(metaindex_handle));
+    memset(&index_handle, 0, sizeof(index_handle));
+  }
+
+  ~Rep() {
+    delete full_filter;
+    delete block_filter;
+    delete compression_dict;
+    if (filter_data_copied) {
+      free(const_cast<char *>(filter_data.data()));
+    }
+    delete index_block;
+    if (opened) {
+      CloseMappedFile(&file);
+    }
+  }
+
+  uint8_t ChecksumType(const ReadOptions &read_options) const {
+    return read_options.verify_checksums ? checksum_type
+                                         : static_cast<uint8_t>(kNoChecksum);
+  }
+
+  Status ReadBlockContents(const BlockHandle &handle, uint8_t checksum,
+                           Block **block);
+  Status ReadMetaIndex();
+  Status ReadProperties(const BlockHandle &handle);
+
+  // A data block, pinned in the block cache or else owned by the caller.
+  // Either way it is given back with ReleaseDataBlock().
+  Status GetDataBlock(const ReadOptions &read_options,
+                      const BlockHandle &handle, Block **block,
+                      Cache::Handle **cache_handle);
+  void ReleaseDataBlock(Block *block, Cache::Handle *cache_handle);
+
+  // Index keys are internal keys, unless the table says they are user keys.
+  const Comparator *IndexComparator() const {
+    return index_key_is_user_key ? options.inner_comparator : &comparator;
+  }
+
+  // Position "index" at the first data block that may hold "target", an
+  // internal key of user key "user_key".
+  void SeekIndex(Block::Iter *index, const Slice &target,
+                 const Slice &user_key) const {
+    index->Seek(index_key_is_user_key ? user_key : target);
+  }
+};
+
+Status SstFileReader::Rep::ReadBlockContents(const BlockHandle &handle,
+                                             uint8_t checksum, Block **block) {
+  BlockHandle h = handle;
+  Slice contents;
+  uint8_t copied = 0;
+  Status s = ReadBlock(&contents, &file, &h, checksum, &copied);
+  if (s.ok()) {
+    *block = new Block(contents, copied);
+  }
+  return s;
+}
+
+Status SstFileReader::Rep::ReadMetaIndex() {
+  Block *metaindex = NULL;
+  Status s = ReadBlockContents(metaindex_handle, checksum_type, &metaindex);
+  if (!s.ok()) {
+    return s;
+  }
+  std::string full_filter_key, block_filter_key;
+  if (options.filter_policy != NULL) {
+    full_filter_key = std::string("fullfilter.") + options.filter_policy->Name();
+    block_filter_key = std::string("filter.") + options.filter_policy->Name();
+  }
+  BlockHandle handle;
+  Block::Iter iter(metaindex, BytewiseComparator());
+  for (iter.SeekToFirst(); s.ok() && iter.Valid(); iter.Next()) {
+    Slice key = iter.key();
+    if (key == kPropertiesBlock || key == kPropertiesBlockOldName) {
+      s = DecodeHandle(iter.value(), &handle);
+      if (s.ok()) {
+        s = ReadProperties(handle);
+      }
+    } else if (key == kCompressionDictBlock && compression_dict == NULL) {
+      s = DecodeHandle(iter.value(), &handle);
+      if (s.ok()) {
+        s = ReadCompressionDict(&file, &handle, checksum_type,
+                                &compression_dict);
+      }
+    } else if (options.filter_policy != NULL && filter_data.empty() &&
+               (key == full_filter_key || key == block_filter_key)) {
+      s = DecodeHandle(iter.value(), &handle);
+      if (s.ok()) {
+        s = ReadBlock(&filter_data, &file, &handle, checksum_type,
+                      &filter_data_copied);
+      }
+      if (s.ok() && key == full_filter_key) {
+        full_filter = new FullFilterBlockReader(options.filter_policy,
+                                                filter_data);
+      } else if (s.ok()) {
+        block_filter = new FilterBlockReader(options.filter_policy,
+                                             filter_data);
+      }
+    }
+  }
+  if (s.ok()) {
+    s = iter.status();
+  }
+  delete metaindex;
+  return s;
+}
+
+Status SstFileReader::Rep::ReadProperties(const BlockHandle &handle) {
+  Block *properties = NULL;
+  Status s = ReadBlockContents(handle, checksum_type, &properties);
+  if (!s.ok()) {
+    return s;
+  }
+  Block::Iter iter(properties, BytewiseComparator());
+  for (iter.SeekToFirst(); s.ok() && iter.Valid(); iter.Next()) {
+    Slice key = iter.key();
+    Slice value = iter.value();
+    uint64_t flag = 0;
+    if (key == kIndexType) {
+      // A fixed32, the low byte is the type.
+      if (value.empty()) {
+        s = Status::Corruption("bad index type property");
+      } else if (value[0] == kTwoLevelIndexSearch) {
+        s = Status::NotSupported("partitioned index");
+      } else {
+        s = IsIndexTypeSupport(static_cast<IndexType>(value[0]));
+      }
+    } else if (key == kIndexKeyIsUserKey) {
+      if (!GetVarint64(&value, &flag)) {
+        s = Status::Corruption("bad index key property");
+      }
+      index_key_is_user_key = (flag != 0);
+    } else if (key == kIndexValueIsDeltaEncoded) {
+      if (!GetVarint64(&value, &flag)) {
+        s = Status::Corruption("bad index value property");
+      } else if (flag != 0) {
+        s = Status::NotSupported("delta encoded index values");
+      }
+    }
+  }
+  if (s.ok()) {
+    s = iter.status();
+  }
+  delete properties;
+  return s;
+}
+
+Status SstFileReader::Rep::GetDataBlock(const ReadOptions &read_options,
+                                        const BlockHandle &handle,
+                                        Block **block,
+                                        Cache::Handle **cache_handle) {
+  Cache *cache = options.block_cache.get();
+  char cache_key[16];
+  *cache_handle = NULL;
+  if (cache != NULL) {
+    EncodeFixed64(cache_key, cache_id);
+    EncodeFixed64(cache_key + 8, handle.offset);
+    *cache_handle = cache->Lookup(Slice(cache_key, sizeof(cache_key)));
+    if (*cache_handle != NULL) {
+      *block = reinterpret_cast<Block *>(cache->Value(*cache_handle));
+      return Status::OK();
+    }
+  }
+
+  BlockHandle h = handle;
+  Slice contents;
+  uint8_t copied = 0;
+  Status s = ReadBlock(&contents, &file, &h, ChecksumType(read_options),
+                       &copied, false, compression_dict);
+  if (!s.ok()) {
+    return s;
+  }
+  if (cache != NULL && read_options.fill_cache) {
+    // Cached blocks may outlive the mapping, they own their contents.
+    if (!copied) {
+      char *buf = reinterpret_cast<char *>(malloc(contents.size()));
+      memcpy(buf, contents.data(), contents.size());
+      contents = Slice(buf, contents.size());
+    }
+    Block *cached = new Block(contents, true);
+    s = cache->Insert(Slice(cache_key, sizeof(cache_key)), cached,
+                      cached->size(), &DeleteCachedBlock, cache_handle);
+    if (s.ok()) {
+      *block = cached;
+      return s;
+    }
+    // The cache is full of pinned blocks and deleted the block, read it
+    // again for the caller alone.
+    *cache_handle = NULL;
+    s = ReadBlock(&contents, &file, &h, ChecksumType(read_options), &copied,
+                  false, compression_dict);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  *block = new Block(contents, copied);
+  return s;
+}
+
+void SstFileReader::Rep::ReleaseDataBlock(Block *block,
+                                          Cache::Handle *cache_handle) {
+  if (cache_handle != NULL) {
+    options.block_cache->Release(cache_handle);
+  } else {
+    delete block;
+  }
+}
+
+// Iterates the live keys of a table: a data block iterator under an index
+// block iterator, holding one data block at a time.  Whenever the iterator
+// is valid, the entry under it is the newest version of its user key.
+class SstFileIterator : public Iterator {
+public:
+  SstFileIterator(SstFileReader::Rep *rep, const ReadOptions &read_options)
+      : rep_(rep), read_options_(read_options),
+        index_iter_(rep->index_block, rep->IndexComparator()), block_(NULL),
+        cache_handle_(NULL), data_iter_(NULL), valid_(false) {}
+
+  virtual ~SstFileIterator() { SetDataBlock(NULL, NULL); }
+
+  virtual bool Valid() const { return valid_; }
+
+  virtual void SeekToFirst() {
+    if (!prefix_.empty()) {
+      Seek(prefix_);
+      return;
+    }
+    SeekToFirstEntry();
+    FindNextUserEntry();
+  }
+
+  virtual void SeekToLast() {
+    if (!prefix_.empty()) {
+      // The last key before the first one past the prefix.
+      std::string limit = prefix_;
+      while (!limit.empty() && static_cast<uint8_t>(limit.back()) == 0xff) {
+        limit.resize(limit.size() - 1);
+      }
+      if (!limit.empty()) {
+        limit.back()++;
+        SeekEntry(limit);
+        if (EntryValid()) {
+          PrevEntry();
+          FindPrevUserEntry();
+          CheckPrefix();
+          return;
+        }
+      }
+    }
+    SeekToLastEntry();
+    FindPrevUserEntry();
+    CheckPrefix();
+  }
+
+  virtual void Seek(const Slice &target) {
+    SeekEntry(target);
+    FindNextUserEntry();
+  }
+
+  virtual void SeekForPrev(const Slice &target) {
+    Seek(target);
+    if (!valid_) {
+      if (status_.ok()) {
+        SeekToLast();
+      }
+    } else if (rep_->options.inner_comparator->Compare(key(), target) > 0) {
+      Prev();
+    }
+  }
+
+  virtual void Next() {
+    assert(valid_);
+    SkipUserKey();
+    FindNextUserEntry();
+  }
+
+  virtual void Prev() {
+    assert(valid_);
+    // Back to the oldest version of the previous user key.
+    PrevEntry();
+    FindPrevUserEntry();
+    CheckPrefix();
+  }
+
+  virtual Slice key() {
+    assert(valid_);
+    return entry_.user_key;
+  }
+
+  virtual Slice value() {
+    assert(valid_);
+    return data_iter_->value();
+  }
+
+  virtual uint64_t timestamp() {
+    assert(valid_);
+    return entry_.sequence;
+  }
+
+  virtual Status status() const {
+    if (!status_.ok()) {
+      return status_;
+    }
+    if (!index_iter_.status().ok()) {
+      return index_iter_.status();
+    }
+    if (data_iter_ != NULL && !data_iter_->status().ok()) {
+      return data_iter_->status();
+    }
+    return status_;
+  }
+
+  virtual void SetPrefix(const Slice &prefix) {
+    prefix_.assign(prefix.data(), prefix.size());
+  }
+
+private:
+  bool EntryValid() const { return data_iter_ != NULL && data_iter_->Valid(); }
+
+  // Parse the entry under the data iterator into entry_.  Returns false and
+  // invalidates the iterator on a bad entry.
+  bool ParseEntry() {
+    Status s = ParseTableEntry(data_iter_->key(), &entry_);
+    if (!s.ok()) {
+      status_ = s;
+      SetDataBlock(NULL, NULL);
+      return false;
+    }
+    return true;
+  }
+
+  void SetDataBlock(Block *block, Cache::Handle *cache_handle) {
+    delete data_iter_;
+    data_iter_ = NULL;
+    if (block_ != NULL) {
+      rep_->ReleaseDataBlock(block_, cache_handle_);
+    }
+    block_ = block;
+    cache_handle_ = cache_handle;
+    if (block_ != NULL) {
+      data_iter_ = new Block::Iter(block_, &rep_->comparator);
+    }
+  }
+
+  // Load the data block under the index iterator, if it is not loaded.
+  void InitDataBlock() {
+    if (!index_iter_.Valid()) {
+      SetDataBlock(NULL, NULL);
+      return;
+    }
+    BlockHandle handle;
+    Status s = DecodeHandle(index_iter_.value(), &handle);
+    if (s.ok() && block_ != NULL && handle.offset == block_offset_) {
+      return; // data_iter_ is already over this block
+    }
+    Block *block = NULL;
+    Cache::Handle *cache_handle = NULL;
+    if (s.ok()) {
+      s = rep_->GetDataBlock(read_options_, handle, &block, &cache_handle);
+    }
+    if (!s.ok()) {
+      status_ = s;
+      SetDataBlock(NULL, NULL);
+      return;
+    }
+    SetDataBlock(block, cache_handle);
+    block_offset_ = handle.offset;
+  }
+
+  void SkipEmptyDataBlocksForward() {
+    while (status_.ok() && (data_iter_ == NULL || !data_iter_->Valid())) {
+      if (data_iter_ != NULL && !data_iter_->status().ok()) {
+        status_ = data_iter_->status();
+        break;
+      }
+      if (!index_iter_.Valid()) {
+        SetDataBlock(NULL, NULL);
+        return;
+      }
+      index_iter_.Next();
+      InitDataBlock();
+      if (data_iter_ != NULL) {
+        data_iter_->SeekToFirst();
+      }
+    }
+  }
+
+  void SkipEmptyDataBlocksBackward() {
+    while (status_.ok() && (data_iter_ == NULL || !data_iter_->Valid())) {
+      if (data_iter_ != NULL && !data_iter_->status().ok()) {
+        status_ = data_iter_->status();
+        break;
+      }
+      if (!index_iter_.Valid()) {
+        SetDataBlock(NULL, NULL);
+        return;
+      }
+      index_iter_.Prev();
+      InitDataBlock();
+      if (data_iter_ != NULL) {
+        data_iter_->SeekToLast();
+      }
+    }
+  }
+
+  void SeekToFirstEntry() {
+    status_ = Status::OK();
+    index_iter_.SeekToFirst();
+    InitDataBlock();
+    if (data_iter_ != NULL) {
+      data_iter_->SeekToFirst();
+    }
+    SkipEmptyDataBlocksForward();
+  }
+
+  void SeekToLastEntry() {
+    status_ = Status::OK();
+    index_iter_.SeekToLast();
+    InitDataBlock();
+    if (data_iter_ != NULL) {
+      data_iter_->SeekToLast();
+    }
+    SkipEmptyDataBlocksBackward();
+  }
+
+  // Position at the newest version of the first user key >= user_key.
+  void SeekEntry(const Slice &user_key) {
+    status_ = Status::OK();
+    seek_key_.clear();
+    AppendInternalKey(&seek_key_, ParsedInternalKey(user_key,
+                                                    kMaxSequenceNumber,
+                                                    kValueTypeForSeek));
+    rep_->SeekIndex(&index_iter_, seek_key_, user_key);
+    InitDataBlock();
+    if (data_iter_ != NULL) {
+      data_iter_->Seek(seek_key_);
+    }
+    SkipEmptyDataBlocksForward();
+  }
+
+  void NextEntry() {
+    data_iter_->Next();
+    SkipEmptyDataBlocksForward();
+  }
+
+  void PrevEntry() {
+    data_iter_->Prev();
+    SkipEmptyDataBlocksBackward();
+  }
+
+  // Move past all the versions of the current user key.
+  void SkipUserKey() {
+    saved_key_.assign(entry_.user_key.data(), entry_.user_key.size());
+    const Comparator *ucmp = rep_->options.inner_comparator;
+    do {
+      NextEntry();
+    } while (EntryValid() && ParseEntry() &&
+             ucmp->Compare(entry_.user_key, saved_key_) == 0);
+  }
+
+  // From the newest version of a user key, find the first user key whose
+  // newest version is not a deletion.
+  void FindNextUserEntry() {
+    while (EntryValid() && ParseEntry()) {
+      if (!IsDeletion(entry_)) {
+        valid_ = true;
+        CheckPrefix();
+        return;
+      }
+      SkipUserKey();
+    }
+    valid_ = false;
+  }
+
+  // From the oldest version of a user key, find the last user key whose
+  // newest version is not a deletion.  Leaves the entries at its newest
+  // version.
+  void FindPrevUserEntry() {
+    const Comparator *ucmp = rep_->options.inner_comparator;
+    while (EntryValid() && ParseEntry()) {
+      // Walk back over the older versions of the key to the newest one,
+      // one entry too far, then step forward to it.
+      saved_key_.assign(entry_.user_key.data(), entry_.user_key.size());
+      do {
+        PrevEntry();
+      } while (EntryValid() && ParseEntry() &&
+               ucmp->Compare(entry_.user_key, saved_key_) == 0);
+      if (!status_.ok()) {
+        break;
+      }
+      if (EntryValid()) {
+        NextEntry();
+      } else {
+        SeekToFirstEntry();
+      }
+      if (!EntryValid() || !ParseEntry()) {
+        break;
+      }
+      if (!IsDeletion(entry_)) {
+        valid_ = true;
+        return;
+      }
+      PrevEntry();
+    }
+    valid_ = false;
+  }
+
+  void CheckPrefix() {
+    if (valid_ && !prefix_.empty() && !entry_.user_key.starts_with(prefix_)) {
+      valid_ = false;
+    }
+  }
+
+  SstFileReader::Rep *const rep_;
+  const ReadOptions read_options_;
+  Block::Iter index_iter_;
+  Block *block_; // The data block under data_iter_
+  Cache::Handle *cache_handle_;
+  uint64_t block_offset_;
+  Block::Iter *data_iter_;
+  TableEntry entry_;
+  bool valid_;
+  Status status_;
+  std::string prefix_;
+  std::string seek_key_;
+  std::string saved_key_;
+};
+
+SstFileReader::SstFileReader(const Options &options)
+    : rep_(new Rep(options)) {}
+
+SstFileReader::~SstFileReader() { delete rep_; }
+
+Status SstFileReader::Open(const std::string &file_path) {
+  Rep *r = rep_;
+  if (r->opened) {
+    return Status::InvalidArgument("sst file reader already open");
+  }
+  std::string path = file_path;
+  if (OpenMappedFile(&path[0], &r->file) != 0) {
+    return Status::IOError("open sst file error", file_path);
+  }
+  r->opened = true;
+
+  Slice footer_content;
+  uint8_t footer_copied = 0;
+  Status s = ReadFoot(&footer_content, &r->file, &footer_copied);
+  if (s.ok()) {
+    Foot foot;
+    Slice input = footer_content;
+    s = FootDecodeFrom(&foot, &input, 1);
+    r->checksum_type = foot.checksum_type;
+    r->metaindex_handle = foot.metaindex_handle;
+    r->index_handle = foot.index_handle;
+  }
+  if (footer_copied) {
+    free(const_cast<char *>(footer_content.data()));
+  }
+  // Blocks read at open are always verified.
+  if (s.ok()) {
+    s = r->ReadMetaIndex();
+  }
+  if (s.ok()) {
+    s = r->ReadBlockContents(r->index_handle, r->checksum_type,
+                             &r->index_block);
+  }
+  if (s.ok() && r->options.block_cache != nullptr) {
+    r->cache_id = r->options.block_cache->NewId();
+  }
+  if (!s.ok()) {
+    // Only a successful Open() leaves the reader usable.
+    Options options = r->options;
+    delete rep_;
+    rep_ = new Rep(options);
+  }
+  return s;
+}
+
+Status SstFileReader::Get(const ReadOptions &options, const Slice &key,
+                          std::string *value, uint64_t *timestamp) {
+  Rep *r = rep_;
+  if (r->index_block == NULL) {
+    return Status::InvalidArgument("sst file reader not open");
+  }
+  if (r->full_filter != NULL && !r->full_filter->KeyMayMatch(key)) {
+    return Status::NotFound();
+  }
+
+  std::string target;
+  AppendInternalKey(&target, ParsedInternalKey(key, kMaxSequenceNumber,
+                                               kValueTypeForSeek));
+  Block::Iter index(r->index_block, r->IndexComparator());
+  r->SeekIndex(&index, target, key);
+  Status s;
+  // The key is in the block the index points to, unless the index key of
+  // that block is past its last key: then the next block is looked at.
+  for (int blocks = 0; index.Valid() && blocks < 2; index.Next(), blocks++) {
+    BlockHandle handle;
+    s = DecodeHandle(index.value(), &handle);
+    if (!s.ok()) {
+      return s;
+    }
+    if (r->block_filter != NULL &&
+        !r->block_filter->KeyMayMatch(handle.offset, key)) {
+      continue;
+    }
+    Block *block = NULL;
+    Cache::Handle *cache_handle = NULL;
+    s = r->GetDataBlock(options, handle, &block, &cache_handle);
+    if (!s.ok()) {
+      return s;
+    }
+    Block::Iter iter(block, &r->comparator);
+    iter.Seek(target);
+    bool done = true;
+    if (iter.Valid()) {
+      TableEntry entry;
+      s = ParseTableEntry(iter.key(), &entry);
+      if (s.ok() &&
+          r->options.inner_comparator->Compare(entry.user_key, key) != 0) {
+        s = Status::NotFound();
+      } else if (s.ok() && IsDeletion(entry)) {
+        s = Status::NotFound();
+      } else if (s.ok()) {
+        value->assign(iter.value().data(), iter.value().size());
+        if (timestamp != NULL) {
+          *timestamp = entry.sequence;
+        }
+      }
+    } else if (!iter.status().ok()) {
+      s = iter.status();
+    } else {
+      done = false;
+    }
+    r->ReleaseDataBlock(block, cache_handle);
+    if (done) {
+      return s;
+    }
+  }
+  if (!index.status().ok()) {
+    return index.status();
+  }
+  return Status::NotFound();
+}
+
+Iterator *SstFileReader::NewIterator(const ReadOptions &options) {
+  if (rep_->index_block == NULL) {
+    return NULL;
+  }
+  return new SstFileIterator(rep_, options);
+}
+
+Status SstFileReader::VerifyChecksum() {
+  Rep *r = rep_;
+  if (r->index_block == NULL) {
+    return Status::InvalidArgument("sst file reader not open");
+  }
+  // The metaindex, index and meta blocks were verified by Open().
+  Status s;
+  Block::Iter index(r->index_block, r->IndexComparator());
+  for (index.SeekToFirst(); s.ok() && index.Valid(); index.Next()) {
+    BlockHandle handle;
+    s = DecodeHandle(index.value(), &handle);
+    Slice contents;
+    uint8_t copied = 0;
+    if (s.ok()) {
+      s = ReadBlock(&contents, &r->file, &handle, r->checksum_type, &copied,
+                    false, r->compression_dict);
+    }
+    if (s.ok() && copied) {
+      free(const_cast<char *>(contents.data()));
+    }
+  }
+  if (s.ok()) {
+    s = index.status();
+  }
+  return s;
+}
+
+} // namespace shannon
@@ -0,0 +1,661 @@
+// Copyright (c) 2018 Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+
+#include "sst_ingest.h"
+#include "compression.h"
+#include "dbformat.h"
+#include "swift/comparator.h"
+#include "swift/write_batch.h"
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace shannon {
+
+namespace {
+
+// Writes the batches to the device.
+class DBBatchWriter : public BatchWriter {
+ public:
+  explicit DBBatchWriter(DB *db) : db_(db) {}
+
+  virtual Status Write(const WriteOptions &options, WriteBatchNonatomic *wb) {
+    return db_->WriteNonatomic(options, wb);
+  }
+
+ private:
+  DB *const db_;
+};
+
+struct BlockSlot {
+  DecodedBlock block;
+  Status status;
+  uint32_t kv_put_count;
+  uint32_t kv_del_count;
+  bool done;
+};
+
+// Workers take the data block handles one at a time from "handles", so
+// the index partitions of a partitioned index are read as the decoding
+// reaches them.
+class BlockDecoder {
+ public:
+  BlockDecoder(BlockRep *index_rep, DataBlockHandleIter *handles,
+               size_t window)
+      : index_rep_(index_rep), handles_(handles), slots_(window),
+        next_(0), consumed_(0), exhausted_(!handles->Valid()), stop_(false) {
+    for (size_t i = 0; i < slots_.size(); i++) {
+      slots_[i].done = false;
+    }
+  }
+
+  void Start(int threads) {
+    for (int i = 0; i < threads; i++) {
+      workers_.push_back(std::thread(&BlockDecoder::WorkerLoop, this));
+    }
+  }
+
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stop_ = true;
+      cv_.notify_all();
+    }
+    for (size_t i = 0; i < workers_.size(); i++) {
+      workers_[i].join();
+    }
+    workers_.clear();
+  }
+
+  // Wait for the i-th block, which must be the next one not consumed.
+  // Returns NULL past the last block, with the error if the index could
+  // not be read in *status.
+  BlockSlot *Get(size_t i, Status *status) {
+    BlockSlot *slot = &slots_[i % slots_.size()];
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this, slot, i] {
+      return slot->done || (exhausted_ && i >= next_);
+    });
+    if (!slot->done) {
+      *status = index_status_;
+      return NULL;
+    }
+    return slot;
+  }
+
+  // Release the slot of the i-th block for block i + window.
+  void Release(size_t i) {
+    BlockSlot *slot = &slots_[i % slots_.size()];
+    slot->block.data.clear();
+    slot->block.kvs.clear();
+    std::lock_guard<std::mutex> lock(mu_);
+    slot->done = false;
+    consumed_ = i + 1;
+    cv_.notify_all();
+  }
+
+ private:
+  void WorkerLoop() {
+    // restart offsets and key scratch are reused from block to block
+    uint32_t *restart_offset = NULL;
+    uint32_t restart_capacity = 0;
+    KeyScratch key_scratch;
+    memset(&key_scratch, 0, sizeof(KeyScratch));
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+      cv_.wait(lock, [this] {
+        return stop_ || exhausted_ || next_ < consumed_ + slots_.size();
+      });
+      if (stop_ || exhausted_) {
+        break;
+      }
+      size_t i = next_++;
+      BlockSlot *slot = &slots_[i % slots_.size()];
+      BlockHandle handle = handles_->handle();
+      // Under the lock, blocks are numbered in index order.  This may read
+      // the next index partition, which is small next to a data block.
+      Status s = handles_->Next();
+      if (!s.ok() || !handles_->Valid()) {
+        index_status_ = s;
+        exhausted_ = true;
+        cv_.notify_all();
+      }
+      lock.unlock();
+
+      BlockRep rep = BlockRep();
+      rep.filename = index_rep_->filename;
+      rep.file = index_rep_->file;
+      rep.checksum_type = index_rep_->checksum_type;
+      rep.compression_dict = index_rep_->compression_dict;
+      rep.decoded = &slot->block;
+      rep.restart_offset = restart_offset;
+      rep.restart_capacity = restart_capacity;
+      rep.key_scratch = key_scratch;
+      slot->status = ReadBlock(&rep.block, rep.file, &handle,
+                               rep.checksum_type, &rep.block_copied, true,
+                               rep.compression_dict);
+      if (slot->status.ok()) {
+        slot->status = DecodeDataBlock(&rep);
+      }
+      if (rep.block_copied && rep.block.data()) {
+        free((void *)rep.block.data());
+      }
+      restart_offset = rep.restart_offset;
+      restart_capacity = rep.restart_capacity;
+      key_scratch = rep.key_scratch;
+      slot->kv_put_count = rep.kv_put_count;
+      slot->kv_del_count = rep.kv_del_count;
+
+      lock.lock();
+      slot->done = true;
+      cv_.notify_all();
+    }
+    lock.unlock();
+    if (restart_offset) {
+      free(restart_offset);
+    }
+    if (key_scratch.data) {
+      free(key_scratch.data);
+    }
+  }
+
+  BlockRep *const index_rep_;
+  DataBlockHandleIter *const handles_;  // guarded by mu_
+  std::vector<BlockSlot> slots_;
+  std::vector<std::thread> workers_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  size_t next_;      // next block to decode
+  size_t consumed_;  // blocks written to the batches
+  bool exhausted_;   // no block after next_ - 1
+  Status index_status_;
+  bool stop_;
+};
+
+// The merge compares user keys bytewise, the order of BytewiseComparator()
+// and of RocksDB's default comparator.  Tables that do not name their
+// comparator were written bytewise.
+static bool IsBytewiseOrdered(const MetaBlockProperties &props) {
+  return props.comparator_name[0] == '\0' ||
+         strcmp(props.comparator_name, BytewiseComparator()->Name()) == 0 ||
+         strcmp(props.comparator_name, "leveldb.BytewiseComparator") == 0;
+}
+
+// Reads the kvs of one sst file in order, one data block at a time.
+class SstCursor {
+ public:
+  SstCursor(const std::string &filename, int verify)
+      : filename_(filename), verify_(verify), opened_(false), cf_(NULL),
+        compression_dict_(NULL), index_copied_(0), blocks_(NULL), pos_(0),
+        restart_offset_(NULL), restart_capacity_(0) {
+    memset(&props_, 0, sizeof(MetaBlockProperties));
+    memset(&key_scratch_, 0, sizeof(KeyScratch));
+  }
+
+  ~SstCursor() {
+    delete blocks_;
+    delete compression_dict_;
+    if (index_copied_ && index_block_.data())
+      free((void *)index_block_.data());
+    if (restart_offset_)
+      free(restart_offset_);
+    if (key_scratch_.data)
+      free(key_scratch_.data);
+    if (opened_)
+      CloseMappedFile(&file_);
+  }
+
+  // Read the foot, the column family and the index block, and position
+  // at the first kv.
+  Status Open(std::vector<ColumnFamilyHandle *> *handles) {
+    Slice foot_content, tmp_foot_content;
+    uint8_t foot_copied = 0;
+    int cf_handle_index = -1;
+    Status s;
+
+    if (OpenMappedFile(const_cast<char *>(filename_.c_str()), &file_) != 0)
+      return Status::IOError("open sst file error", filename_);
+    opened_ = true;
+    s = ReadFoot(&foot_content, &file_, &foot_copied);
+    if (!s.ok())
+      return s;
+    tmp_foot_content = Slice(foot_content.data(), foot_content.size());
+    s = FootDecodeFrom(&foot_, &tmp_foot_content, verify_);
+    if (foot_copied && foot_content.data())
+      free((void *)foot_content.data());
+    if (!s.ok())
+      return s;
+
+    if (!foot_.legacy_footer_format) {
+      s = ProcessMetaIndex(&file_, &props_, &foot_);
+      // without handles only the index type is needed, a table without
+      // properties has a binary search index
+      if (handles == NULL && s.IsNotFound())
+        s = Status::OK();
+      if (s.ok() && handles != NULL)
+        s = FindCFHandleIndex(handles, props_.cf_name,
+                              strlen(props_.cf_name), &cf_handle_index);
+      if (s.ok())
+        s = IsIndexTypeSupport(IndexType(props_.index_type));
+      if (s.ok() && !IsBytewiseOrdered(props_)) {
+        DEBUG("cannot merge keys ordered by %s\n", props_.comparator_name);
+        s = Status::NotSupported("merge needs bytewise ordered keys",
+                                 props_.comparator_name);
+      }
+      if (!s.ok())
+        return s;
+      if (handles != NULL)
+        cf_ = (*handles)[cf_handle_index];
+      if (props_.has_compression_dict) {
+        s = ReadCompressionDict(&file_, &props_.compression_dict_handle,
+                                foot_.checksum_type, &compression_dict_);
+        if (!s.ok())
+          return s;
+      }
+    }
+
+    s = ReadBlock(&index_block_, &file_, &foot_.index_handle,
+                  foot_.checksum_type, &index_copied_);
+    if (!s.ok())
+      return s;
+    blocks_ = new DataBlockHandleIter(&file_, foot_.checksum_type, &props_);
+    s = blocks_->SeekToFirst(index_block_);
+    if (s.ok())
+      s = NextBlock();
+    return s;
+  }
+
+  bool Valid() const { return pos_ < block_.kvs.size(); }
+
+  Status Next() {
+    if (++pos_ < block_.kvs.size())
+      return Status::OK();
+    return NextBlock();
+  }
+
+  Slice key() const {
+    const DecodedKv &kv = block_.kvs[pos_];
+    return Slice(block_.data.data() + kv.offset, kv.key_len);
+  }
+  uint64_t sequence() const { return block_.kvs[pos_].sequence; }
+  uint32_t type() const { return block_.kvs[pos_].type; }
+  const DecodedBlock &block() const { return block_; }
+  const DecodedKv &kv() const { return block_.kvs[pos_]; }
+
+  ColumnFamilyHandle *cf() const { return cf_; }
+  uint64_t file_size() const { return opened_ ? file_.size : 0; }
+
+ private:
+  // Decode the next data block that has kvs.
+  Status NextBlock() {
+    BlockRep rep;
+    Status s;
+
+    block_.data.clear();
+    block_.kvs.clear();
+    pos_ = 0;
+    while (s.ok() && block_.kvs.empty() && blocks_->Valid()) {
+      BlockHandle handle = blocks_->handle();
+      s = blocks_->Next();
+      if (!s.ok())
+        break;
+      rep = BlockRep();
+      rep.filename = file_.filename;
+      rep.file = &file_;
+      rep.checksum_type = foot_.checksum_type;
+      rep.compression_dict = compression_dict_;
+      rep.decoded = &block_;
+      rep.restart_offset = restart_offset_;
+      rep.restart_capacity = restart_capacity_;
+      rep.key_scratch = key_scratch_;
+      s = ReadBlock(&rep.block, &file_, &handle, foot_.checksum_type,
+                    &rep.block_copied, true, compression_dict_);
+      if (s.ok())
+        s = DecodeDataBlock(&rep);
+      if (rep.block_copied && rep.block.data())
+        free((void *)rep.block.data());
+      restart_offset_ = rep.restart_offset;
+      restart_capacity_ = rep.restart_capacity;
+      key_scratch_ = rep.key_scratch;
+    }
+    return s;
+  }
+
+  const std::string filename_;
+  const int verify_;
+  MappedFile file_;
+  bool opened_;
+  Foot foot_;
+  MetaBlockProperties props_;
+  ColumnFamilyHandle *cf_;
+  UncompressionDict *compression_dict_;
+  Slice index_block_;
+  uint8_t index_copied_;
+  DataBlockHandleIter *blocks_;  // data blocks not decoded yet
+  DecodedBlock block_;
+  size_t pos_;
+  uint32_t *restart_offset_;
+  uint32_t restart_capacity_;
+  KeyScratch key_scratch_;
+};
+
+struct MergeInput {
+  SstCursor *cursor;
+  IngestExternalFileReport *report;
+};
+
+// Orders the heap by internal key: user key ascending, then sequence and
+// type descending, so the newest version of a user key comes out first.
+struct MergeInputGreater {
+  bool operator()(const MergeInput &a, const MergeInput &b) const {
+    int r = a.cursor->key().compare(b.cursor->key());
+    if (r != 0)
+      return r > 0;
+    if (a.cursor->sequence() != b.cursor->sequence())
+      return a.cursor->sequence() < b.cursor->sequence();
+    return a.cursor->type() < b.cursor->type();
+  }
+};
+
+// Merge the files of one column family and write the newest version of
+// every user key.
+static Status MergeColumnFamily(BatchWriter *writer, ColumnFamilyHandle *cf,
+                                const std::vector<MergeInput> &inputs) {
+  std::priority_queue<MergeInput, std::vector<MergeInput>, MergeInputGreater>
+      heap;
+  WriteOptions write_opt;
+  std::string last_key;
+  bool has_last_key = false;
+  Status s;
+
+  write_opt.sync = true;
+  write_opt.fill_cache = true;
+  BatchSubmitter submitter(writer, cf, write_opt);
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (inputs[i].cursor->Valid())
+      heap.push(inputs[i]);
+  }
+  while (s.ok() && !heap.empty()) {
+    MergeInput top = heap.top();
+    heap.pop();
+    SstCursor *cursor = top.cursor;
+    Slice key = cursor->key();
+    if (has_last_key && key == Slice(last_key)) {
+      top.report->keys_dropped++;
+    } else {
+      s = submitter.Add(cursor->block(), cursor->kv());
+      if (!s.ok())
+        break;
+      if (cursor->type() == kSstTypeValue)
+        top.report->keys_put++;
+      else
+        top.report->keys_deleted++;
+      last_key.assign(key.data(), key.size());
+      has_last_key = true;
+    }
+    s = cursor->Next();
+    if (s.ok() && cursor->Valid())
+      heap.push(top);
+  }
+  if (s.ok())
+    s = submitter.Finish();
+  return s;
+}
+
+static uint64_t NowMicros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000ull + now.tv_nsec / 1000;
+}
+
+}  // namespace
+
+BatchSubmitter::BatchSubmitter(BatchWriter *writer, ColumnFamilyHandle *cf,
+                               const WriteOptions &options)
+    : writer_(writer), cf_(cf), options_(options), filling_(0),
+      submitting_(-1), stop_(false) {
+  count_[0] = count_[1] = 0;
+  writer_thread_ = std::thread(&BatchSubmitter::WriterLoop, this);
+}
+
+BatchSubmitter::~BatchSubmitter() { Stop(); }
+
+Status BatchSubmitter::Add(const DecodedBlock &block, const DecodedKv &kv) {
+  Slice key(block.data.data() + kv.offset, kv.key_len);
+  Slice value(block.data.data() + kv.offset + kv.key_len, kv.value_len);
+  Status s;
+  while (true) {
+    WriteBatchNonatomic *wb = &batches_[filling_];
+    if (kv.type == kSstTypeValue) {
+      s = cf_ == NULL ? wb->Put(key, value, kv.sequence)
+                      : wb->Put(cf_, key, value, kv.sequence);
+    } else {
+      s = cf_ == NULL ? wb->Delete(key, kv.sequence)
+                      : wb->Delete(cf_, key, kv.sequence);
+    }
+    if (!s.IsBatchFull()) {
+      break;
+    }
+    if (count_[filling_] == 0) {
+      DEBUG("kv is too large for a write batch\n");
+      return Status::InvalidArgument("kv is too large for a write batch");
+    }
+    s = Submit();
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  if (s.ok()) {
+    count_[filling_]++;
+  }
+  return s;
+}
+
+Status BatchSubmitter::Finish() {
+  Status s = Submit();
+  if (s.ok()) {
+    s = Wait();
+  }
+  Stop();
+  return s;
+}
+
+// Hand the batch being filled to the writer once it is done with the
+// other one, and continue in the other one.
+Status BatchSubmitter::Submit() {
+  Status s = Wait();
+  if (!s.ok() || count_[filling_] == 0) {
+    return s;
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  submitting_ = filling_;
+  filling_ ^= 1;
+  count_[filling_] = 0;
+  cv_.notify_all();
+  return s;
+}
+
+Status BatchSubmitter::Wait() {
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [this] { return submitting_ < 0; });
+  return status_;
+}
+
+void BatchSubmitter::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+    cv_.notify_all();
+  }
+  if (writer_thread_.joinable()) {
+    writer_thread_.join();
+  }
+}
+
+void BatchSubmitter::WriterLoop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    cv_.wait(lock, [this] { return submitting_ >= 0 || stop_; });
+    if (submitting_ < 0) {
+      break;
+    }
+    WriteBatchNonatomic *wb = &batches_[submitting_];
+    lock.unlock();
+    Status s = writer_->Write(options_, wb);
+    wb->Clear();
+    lock.lock();
+    if (!s.ok() && status_.ok()) {
+      DEBUG("write to ssd fail\n");
+      status_ = s;
+    }
+    submitting_ = -1;
+    cv_.notify_all();
+  }
+}
+
+Status IngestMergedFiles(const std::vector<std::string> &files, DB *db,
+                         std::vector<ColumnFamilyHandle *> *handles,
+                         const IngestExternalFileOptions &options,
+                         std::vector<IngestExternalFileReport> *reports,
+                         BatchWriter *writer) {
+  std::vector<SstCursor *> cursors(files.size());
+  std::map<ColumnFamilyHandle *, std::vector<MergeInput> > groups;
+  std::vector<std::vector<MergeInput> *> work;
+  std::atomic<size_t> next_group(0);
+  std::atomic<bool> failed(false);
+  DBBatchWriter db_writer(db);
+  Status s;
+
+  reports->assign(files.size(), IngestExternalFileReport());
+  for (size_t i = 0; i < files.size(); i++) {
+    IngestExternalFileReport *report = &(*reports)[i];
+    uint64_t start = NowMicros();
+    report->filename = files[i];
+    cursors[i] = new SstCursor(files[i], options.verify_checksums);
+    report->status = cursors[i]->Open(handles);
+    report->bytes = cursors[i]->file_size();
+    report->micros = NowMicros() - start;
+    if (!report->status.ok()) {
+      DEBUG("open %s for merge fail\n", files[i].c_str());
+      failed = true;
+      continue;
+    }
+    report->cf_name = cursors[i]->cf() ? cursors[i]->cf()->GetName()
+                                       : "default";
+    MergeInput input = {cursors[i], report};
+    groups[cursors[i]->cf()].push_back(input);
+  }
+  if (options.fail_fast && failed) {
+    for (size_t i = 0; i < files.size(); i++) {
+      if ((*reports)[i].status.ok())
+        (*reports)[i].status = Status::Aborted("another file failed",
+                                               files[i]);
+    }
+    groups.clear();
+  }
+
+  for (auto it = groups.begin(); it != groups.end(); ++it)
+    work.push_back(&it->second);
+  auto merge = [&]() {
+    for (size_t i = next_group++; i < work.size(); i = next_group++) {
+      std::vector<MergeInput> &inputs = *work[i];
+      Status group_status;
+      if (options.fail_fast && failed.load()) {
+        group_status = Status::Aborted("another file failed");
+      } else {
+        uint64_t start = NowMicros();
+        group_status = MergeColumnFamily(writer != NULL ? writer : &db_writer,
+                                         inputs[0].cursor->cf(), inputs);
+        for (size_t k = 0; k < inputs.size(); k++)
+          inputs[k].report->micros += NowMicros() - start;
+        if (!group_status.ok())
+          failed = true;
+      }
+      for (size_t k = 0; k < inputs.size(); k++)
+        inputs[k].report->status = group_status;
+    }
+  };
+  size_t workers = options.max_files_in_parallel > 0
+      ? options.max_files_in_parallel
+      : std::max(1u, std::thread::hardware_concurrency());
+  workers = std::min(workers, work.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < workers; i++)
+    threads.push_back(std::thread(merge));
+  merge();
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+
+  for (size_t i = 0; i < cursors.size(); i++)
+    delete cursors[i];
+  // report the failure that caused the others to be aborted
+  for (size_t i = 0; i < reports->size(); i++) {
+    const Status &file_status = (*reports)[i].status;
+    if (!file_status.ok() && (s.ok() || (s.IsAborted() &&
+                                         !file_status.IsAborted())))
+      s = file_status;
+  }
+  return s;
+}
+
+Status IngestDataBlocks(BlockRep *index_rep, int decode_threads,
+                        int max_pending_blocks) {
+  DatabaseOptions *opt = index_rep->opt;
+  Status s;
+
+  if (opt == NULL || (opt->db == NULL && opt->writer == NULL)) {
+    DEBUG("Error data_block_rep options\n");
+    return Status::Corruption("error data block rep options");
+  }
+  DataBlockHandleIter handles(index_rep->file, index_rep->checksum_type,
+                              index_rep->props);
+  s = handles.SeekToFirst(index_rep->block);
+  if (!s.ok())
+    return s;
+
+  size_t window = max_pending_blocks > 0 ? max_pending_blocks
+                                         : 4 * decode_threads;
+  BlockDecoder decoder(index_rep, &handles, window);
+  DBBatchWriter db_writer(opt->db);
+  BatchSubmitter submitter(opt->writer != NULL ? opt->writer : &db_writer,
+                           opt->cf, opt->write_opt);
+  decoder.Start(decode_threads);
+  for (size_t i = 0; s.ok(); i++) {
+    BlockSlot *slot = decoder.Get(i, &s);
+    if (slot == NULL) {
+      break;
+    }
+    s = slot->status;
+    if (!s.ok()) {
+      DEBUG("decode data_block[%lu] fail\n", (unsigned long)i);
+      break;
+    }
+    const DecodedBlock &block = slot->block;
+    for (size_t k = 0; s.ok() && k < block.kvs.size(); k++) {
+      s = submitter.Add(block, block.kvs[k]);
+    }
+    if (s.ok()) {
+      index_rep->data_block_count++;
+      index_rep->kv_put_count += slot->kv_put_count;
+      index_rep->kv_del_count += slot->kv_del_count;
+    }
+    decoder.Release(i);
+  }
+  decoder.Stop();
+  // Like the sequential path, the last batch is only written on success.
+  if (s.ok()) {
+    s = submitter.Finish();
+  }
+  return s;
+}
+
+}  // namespace shannon
@@ -0,0 +1,88 @@
+// Copyright (c) 2018 Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+#ifndef STORAGE_SHANNONDB_TABLE_SST_INGEST_H_
+#define STORAGE_SHANNONDB_TABLE_SST_INGEST_H_
+
+#include "sst_table.h"
+#include "swift/write_batch.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace shannon {
+
+// Two nonatomic batches: the caller fills one while a writer thread
+// hands the other one to "writer", so decoding and device writes overlap.
+// Batches that were not submitted are dropped when the submitter is
+// deleted without Finish().
+class BatchSubmitter {
+ public:
+  BatchSubmitter(BatchWriter *writer, ColumnFamilyHandle *cf,
+                 const WriteOptions &options);
+  ~BatchSubmitter();
+
+  // Add kv of block to the batch being filled, submitting it when it is
+  // full.  Returns the first write error once the writer reports it.
+  Status Add(const DecodedBlock &block, const DecodedKv &kv);
+
+  // Submit the batch being filled and wait until it is written.
+  Status Finish();
+
+ private:
+  Status Submit();
+  Status Wait();
+  void Stop();
+  void WriterLoop();
+
+  BatchWriter *const writer_;
+  ColumnFamilyHandle *const cf_;
+  const WriteOptions options_;
+  WriteBatchNonatomic batches_[2];
+  int count_[2];    // kvs in each batch, used by the caller only
+  int filling_;     // batch the caller adds to
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  int submitting_;  // batch the writer works on, -1 if idle
+  bool stop_;
+  Status status_;   // first write error
+  std::thread writer_thread_;
+
+  // No copying allowed
+  BatchSubmitter(const BatchSubmitter &);
+  void operator=(const BatchSubmitter &);
+};
+
+// Write the data blocks of the index block "index_rep" to the device,
+// index_rep->props tells its type.  "decode_threads" workers take the
+// block handles in index order, reading index partitions as they reach
+// them, and verify, decompress and decode the blocks, at most
+// "max_pending_blocks" ahead (0 means 4 per worker), while the calling
+// thread adds their kvs, in block order and with their own sequence as
+// timestamp, to one of two nonatomic batches and a writer thread submits
+// the other one.
+// Counts are added to index_rep like DecodeIndexBlock() does.
+extern Status IngestDataBlocks(BlockRep *index_rep, int decode_threads,
+                               int max_pending_blocks);
+
+// Ingest "files" with IngestExternalFileOptions::merge_files: the files of
+// each column family are merged by internal key and only the newest
+// version or tombstone of every user key is written, with its sequence as
+// timestamp.  Each report counts the kvs of its file that were written
+// and the versions dropped; the micros include the merge of the whole
+// column family.  Returns the first failure in the order of files that
+// did not only abort the others under fail_fast.  Files whose properties
+// name a comparator other than a bytewise one are NotSupported.  The
+// batches go to "writer" if it is not NULL, to db otherwise.
+extern Status IngestMergedFiles(const std::vector<std::string> &files,
+                                DB *db,
+                                std::vector<ColumnFamilyHandle *> *handles,
+                                const IngestExternalFileOptions &options,
+                                std::vector<IngestExternalFileReport> *reports,
+                                BatchWriter *writer = NULL);
+
+} // namespace shannon
+
+#endif // STORAGE_SHANNONDB_TABLE_SST_INGEST_H_
@@ -13,6 +13,7 @@
 #include "swift/status.h"
 #include "swift/write_batch.h"
 #include "table_builder.h"
+#include "sst_ingest.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
 #include "util/filename.h"
@@ -24,19 +25,11 @@
 #include <snappy-c.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <thread>
+#include <time.h>
 
 namespace shannon {
 
-static void KvNodeDestroy(KvNode *kv) {
-  if (kv) {
-    if (kv->key)
-      free(kv->key);
-    if (kv->value)
-      free(kv->value);
-    free(kv);
-  }
-}
-
 Status BlockHandleDecodeFrom(BlockHandle *dst, Slice *input) {
   Status s;
   if (GetVarint64(input, &dst->offset) && GetVarint64(input, &dst->size) &&
@@ -61,7 +54,7 @@ Status FootDecodeFrom(Foot *dst, Slice *input, int verify) {
   if (magic == kBasedTableMagicNumber) {
     dst->legacy_footer_format = 0;
     dst->checksum_type = (verify) ? input->data()[0] : kNoChecksum;
-    if (dst->checksum_type > kxxHash) {
+    if (dst->checksum_type > kxxHash && dst->checksum_type != kXXH3) {
       DEBUG("checksum type not support=%d\n", dst->checksum_type);
       return Status::NotSupported("checksum type not support");
     }
@@ -106,6 +99,22 @@ Status ReadFoot(Slice *result, char *filename) {
   return s;
 }
 
+Status ReadFoot(Slice *result, MappedFile *file, uint8_t *copied) {
+  uint64_t size = kNewVersionEncodedLenFoot;
+  bool content_copied = false;
+
+  *copied = 0;
+  if (file->size <= size) {
+    DEBUG("corruption sst file, file len is too small\n");
+    return Status::Corruption("sst file is too small");
+  }
+  if (ReadMappedFile(file, file->size - size, size, result,
+                     &content_copied) != size)
+    return Status::IOError("read sst file foot error");
+  *copied = content_copied;
+  return Status::OK();
+}
+
 static Status CheckBlockChecksum(Slice *input, uint8_t checksum_type) {
   const char *data = input->data();
   size_t n = input->size() - kBlockTrailerSize;
@@ -123,6 +132,10 @@ static Status CheckBlockChecksum(Slice *input, uint8_t checksum_type) {
     value = DecodeFixed32(data + n + 1);
     actual = XXH32(data, n + 1, 0);
     break;
+  case kXXH3:
+    value = DecodeFixed32(data + n + 1);
+    actual = ComputeBlockChecksum(kXXH3, data, n, data[n]);
+    break;
   default:
     DEBUG("unknown checksum type:%u\n", (uint32_t)checksum_type);
     return Status::NotSupported("unknown checksum type");
@@ -136,9 +149,11 @@ static Status CheckBlockChecksum(Slice *input, uint8_t checksum_type) {
   }
 }
 
-static Status UncompressBlock(Slice *result, Slice *input) {
+static Status UncompressBlock(Slice *result, Slice *input, bool into_buffer,
+                              const UncompressionDict *dict) {
   char *data = (char *)input->data(), *ubuf = NULL;
   size_t n = input->size() - kBlockTrailerSize, ulength = 0;
+  UncompressionContext *context = ThreadUncompressionContext();
   Status s;
 
   if(!CompressionTypeSupported(data[n])) {
@@ -156,38 +171,39 @@ static Status UncompressBlock(Slice *result, Slice *input) {
       DEBUG("uncompressed block contents\n");
       return Status::Corruption("uncompressed block fail");
     }
-    ubuf = (char *)malloc(ulength);
+    ubuf = ResizeUncompressOutput(context, into_buffer, NULL, ulength);
+    if (ubuf == NULL)
+      return Status::Corruption("uncompressed block fail");
     if (snappy_uncompress(data, n, ubuf, &ulength) != SNAPPY_OK) {
-      if (ubuf)
-        free(ubuf);
+      FreeUncompressOutput(into_buffer, ubuf);
       DEBUG("corrupted uncompressed block contents\n");
       return Status::Corruption("uncompressed block fail");
     }
     *result = Slice(ubuf, ulength);
     break;
   case kZlibCompression:
-    if (!zlib_uncompress(result, &realdata)) {
+    if (!zlib_uncompress(result, &realdata, context, into_buffer)) {
       return Status::Corruption("Zlib uncompressed block fail");
     }
     break;
   case kBZip2Compression:
-    if (!bzip2_uncompress(result, &realdata)) {
+    if (!bzip2_uncompress(result, &realdata, context, into_buffer)) {
       return Status::Corruption("BZip2 uncompressed block fail");
     }
     break;
   case kLZ4Compression:
-    if (!lz4_uncompress(result, &realdata)) {
+    if (!lz4_uncompress(result, &realdata, context, into_buffer)) {
       return Status::Corruption("LZ4 uncompressed block fail");
     }
     break;
   case kLZ4HCCompression:
-    if (!lz4hcc_uncompress(result, &realdata)) {
+    if (!lz4hcc_uncompress(result, &realdata, context, into_buffer)) {
       return Status::Corruption("LZ4HCC uncompressed block fail");
     }
     break;
   case kZSTD:
   case kZSTDNotFinalCompression:
-    if (!zstd_uncompress(result, &realdata)) {
+    if (!zstd_uncompress(result, &realdata, context, into_buffer, dict)) {
       return Status::Corruption("ZSTD uncompressed block fail");
     }
     break;
@@ -199,11 +215,12 @@ static Status UncompressBlock(Slice *result, Slice *input) {
 }
 
 Status CheckAndUncompressBlock(Slice *result, Slice *input,
-                               uint8_t checksum_type) {
+                               uint8_t checksum_type, bool into_buffer,
+                               const UncompressionDict *dict) {
   Status s;
   s = CheckBlockChecksum(input, checksum_type);
   if (s.ok())
-    s = UncompressBlock(result, input);
+    s = UncompressBlock(result, input, into_buffer, dict);
   return s;
 }
 
@@ -234,6 +251,48 @@ out:
   return s;
 }
 
+Status ReadBlock(Slice *result, MappedFile *file, BlockHandle *handle,
+                 uint8_t checksum_type, uint8_t *copied, bool into_buffer,
+                 const UncompressionDict *dict) {
+  Slice file_content;
+  bool content_copied = false;
+  uint64_t size = handle->size + kBlockTrailerSize;
+  Status s;
+
+  *copied = 0;
+  if (ReadMappedFile(file, handle->offset, size, &file_content,
+                     &content_copied) != size)
+    return Status::IOError("read sst block error");
+  s = CheckAndUncompressBlock(result, &file_content, checksum_type,
+                              into_buffer, dict);
+  if (s.ok() && file_content.data() == result->data()) {
+    // uncompressed, the block is the file content itself
+    *copied = content_copied;
+  } else {
+    if (s.ok() && !into_buffer)
+      *copied = 1;
+    if (content_copied)
+      free((void *)file_content.data());
+  }
+  return s;
+}
+
+Status ReadCompressionDict(MappedFile *file, BlockHandle *handle,
+                           uint8_t checksum_type, UncompressionDict **dict) {
+  Slice contents;
+  uint8_t copied = 0;
+  Status s;
+
+  *dict = NULL;
+  s = ReadBlock(&contents, file, handle, checksum_type, &copied);
+  if (!s.ok())
+    return s;
+  *dict = new UncompressionDict(contents);
+  if (copied)
+    free((void *)contents.data());
+  return s;
+}
+
 static Status GetDataBlockRestartNums(uint32_t *nums, Slice *data_block) {
   const char *data = data_block->data();
   size_t n = data_block->size() - 4;
@@ -270,12 +329,17 @@ Status GetDataBlockRestartOffset(BlockRep *rep) {
     return Status::Corruption("block length is smaller than restarts");
   }
 
-  *restart_offset = (uint32_t *)malloc((*restarts) * sizeof(uint32_t));
-  if (*restart_offset == NULL) {
-    DEBUG("corrupted malloc restart_offset\n");
-    return Status::Corruption("corrupted malloc restart offset");
+  if (*restart_offset == NULL || rep->restart_capacity < *restarts) {
+    if (*restart_offset)
+      free(*restart_offset);
+    rep->restart_capacity = 0;
+    *restart_offset = (uint32_t *)malloc((*restarts) * sizeof(uint32_t));
+    if (*restart_offset == NULL) {
+      DEBUG("corrupted malloc restart_offset\n");
+      return Status::Corruption("corrupted malloc restart offset");
+    }
+    rep->restart_capacity = *restarts;
   }
-  memset(*restart_offset, 0, (*restarts) * sizeof(uint32_t));
   for (i = 0; i < (*restarts); ++i) {
     offset_tmp = DecodeFixed32(data + n + 4 * i);
     if (offset_tmp < 0 || offset_tmp >= n) {
@@ -291,22 +355,54 @@ Status GetDataBlockRestartOffset(BlockRep *rep) {
 free_restart_offset:
   if (*restart_offset)
     free(*restart_offset);
+  *restart_offset = NULL;
+  rep->restart_capacity = 0;
   return s;
 }
 
+// Grow the scratch buffer to hold "size" bytes, keeping its content.
+static Status ReserveKeyScratch(KeyScratch *scratch, uint32_t size) {
+  uint32_t capacity;
+  char *data;
+
+  if (size <= scratch->capacity)
+    return Status::OK();
+  capacity = scratch->capacity ? scratch->capacity : 64;
+  while (capacity < size)
+    capacity *= 2;
+  data = (char *)realloc(scratch->data, capacity);
+  if (data == NULL) {
+    DEBUG("corrupted malloc key scratch\n");
+    return Status::Corruption("malloc key scratch");
+  }
+  scratch->data = data;
+  scratch->capacity = capacity;
+  return Status::OK();
+}
+
+// Decode one record of a block into kv without copying: the value and a key
+// that shares nothing with the previous one point into the block, a key
+// with a shared prefix is expanded in "scratch".  The previous key, if it
+// was expanded, is still in scratch, so only its suffix is overwritten.
+// kv stays valid until the next record is decoded with the same scratch.
 static Status DecodeDataBlockOneRecord(KvNode *kv, Slice *input,
-                                       KvNode *last_kv, bool key_is_user_key) {
+                                       KvNode *last_kv, bool key_is_user_key,
+                                       KeyScratch *scratch) {
   uint32_t internal_shared_key_len, internal_non_shared_key_len;
   uint32_t internal_key_len, value_len;
   char *last_key = (last_kv) ? last_kv->key : NULL;
-  size_t last_key_len = (last_kv) ? last_kv->key_len : 0;
+  size_t last_key_len = (last_kv) ? last_kv->internal_key_len : 0;
   char *internal_key = NULL;
+  bool last_key_in_scratch;
   uint64_t sequence;
   Status s;
 
-  GetVarint32(input, &internal_shared_key_len);
-  GetVarint32(input, &internal_non_shared_key_len);
-  GetVarint32(input, &value_len);
+  if (!GetVarint32(input, &internal_shared_key_len) ||
+      !GetVarint32(input, &internal_non_shared_key_len) ||
+      !GetVarint32(input, &value_len)) {
+    DEBUG("bad record header\n");
+    return Status::Corruption("bad record header");
+  }
 
   // get internal_key
   if (internal_shared_key_len > last_key_len) {
@@ -319,28 +415,35 @@ static Status DecodeDataBlockOneRecord(KvNode *kv, Slice *input,
     DEBUG("key len is too small, key_len=%u\n", (uint32_t)internal_key_len);
     return Status::Corruption("key len is too small");
   }
-
-  internal_key = (char *)malloc(internal_key_len);
-  if (internal_key == NULL) {
-    DEBUG("corrupted malloc internal key\n");
-    return Status::Corruption("malloc internal key");
+  if (internal_non_shared_key_len > input->size()) {
+    DEBUG("non_shared_key_len overstep the boundary\n");
+    return Status::Corruption("key len overstep the boundary");
   }
-  if (internal_shared_key_len > 0) {
-    if (last_key == NULL) {
+
+  if (internal_shared_key_len == 0) {
+    internal_key = (char *)input->data();
+  } else {
+    if (last_key == NULL || scratch == NULL) {
       DEBUG("here shared_key_len must be zero!\n");
-      s = Status::Corruption("here shared_key_len must be zero!");
-      goto free_internal_key;
+      return Status::Corruption("here shared_key_len must be zero!");
     }
-    memcpy(internal_key, last_key, internal_shared_key_len);
+    last_key_in_scratch = (last_key == scratch->data);
+    s = ReserveKeyScratch(scratch, internal_key_len);
+    if (!s.ok())
+      return s;
+    if (!last_key_in_scratch)
+      memcpy(scratch->data, last_key, internal_shared_key_len);
+    memcpy(scratch->data + internal_shared_key_len, input->data(),
+           internal_non_shared_key_len);
+    internal_key = scratch->data;
   }
-  memcpy(internal_key + internal_shared_key_len, input->data(),
-         internal_non_shared_key_len);
 
   // update input
   *input = Slice(input->data() + internal_non_shared_key_len,
                  input->size() - internal_non_shared_key_len);
 
   // decode internal key
+  kv->internal_key_len = internal_key_len;
   if (!key_is_user_key) {
     kv->key_len = internal_key_len - 8;
     sequence = DecodeFixed64(internal_key + kv->key_len);
@@ -348,18 +451,7 @@ static Status DecodeDataBlockOneRecord(KvNode *kv, Slice *input,
     kv->sequence = sequence >> 8;
   } else
     kv->key_len = internal_key_len;
-  kv->key = (char *)malloc(kv->key_len + 1);
-  if (kv->key == NULL) {
-    DEBUG("corrupted malloc kv->key\n");
-    s = Status::Corruption("corrupted malloc kv->key");
-    goto free_internal_key;
-  }
-  memcpy(kv->key, internal_key, kv->key_len);
-  kv->key[kv->key_len] = '\0';
-  if (internal_key) {
-    free(internal_key);
-    internal_key = NULL;
-  }
+  kv->key = internal_key;
 
   // get value
   kv->value_len = value_len;
@@ -367,39 +459,19 @@ static Status DecodeDataBlockOneRecord(KvNode *kv, Slice *input,
     kv->value = NULL;
     if (kv->value_len != 0) { // FIXME
       DEBUG("corrupted value_len for delete type\n");
-      s = Status::Corruption("value_len must be zero for delete type");
-      goto free_kv_key;
+      return Status::Corruption("value_len must be zero for delete type");
     }
   } else {
-    if (kv->value_len < 0 || kv->value_len > input->size()) {
+    if (kv->value_len > input->size()) {
       DEBUG("corrupted value_len for value type\n");
-      s = Status::Corruption("value_len overstep the boundary");
-      goto free_kv_key;
-    }
-    kv->value = (char *)malloc(kv->value_len + 1);
-    if (kv->value == NULL) {
-      DEBUG("corrupted malloc kv->value\n");
-      s = Status::Corruption("corrupted malloc kv->value");
-      goto free_kv_key;
+      return Status::Corruption("value_len overstep the boundary");
     }
-    memcpy(kv->value, input->data(), kv->value_len);
-    kv->value[kv->value_len] = '\0';
+    kv->value = (char *)input->data();
     // update input
     *input =
         Slice(input->data() + kv->value_len, input->size() - kv->value_len);
   }
   return s;
-
-free_kv_key:
-  if (kv->key) {
-    free(kv->key);
-    kv->key = NULL;
-  }
-free_internal_key:
-  if (internal_key)
-    free(internal_key);
-out:
-  return s;
 }
 
 static Status BatchWriteAndClearNonatomic(DatabaseOptions *opt) {
@@ -407,7 +479,10 @@ static Status BatchWriteAndClearNonatomic(DatabaseOptions *opt) {
   DB *db = opt->db;
   WriteBatchNonatomic *wb = opt->wb;
 
-  s = db->WriteNonatomic(opt->write_opt, wb);
+  if (opt->writer != NULL)
+    s = opt->writer->Write(opt->write_opt, wb);
+  else
+    s = db->WriteNonatomic(opt->write_opt, wb);
   wb->Clear();
 
   return s;
@@ -490,28 +565,44 @@ out:
   return s;
 }
 
+// Keep a kv of a data block decoded by an ingest worker, it is written
+// later in block order.
+static Status AppendDecodedKv(BlockRep *rep, KvNode *kv) {
+  DecodedBlock *block = rep->decoded;
+  DecodedKv decoded;
+
+  if (kv->type == kSstTypeValue && kv->key && kv->value) {
+    decoded.value_len = kv->value_len;
+    rep->kv_put_count++;
+  } else if (kv->type == kSstTypeDeletion && kv->key) {
+    decoded.value_len = 0;
+    rep->kv_del_count++;
+  } else {
+    DEBUG("Error do not support kv->type=%d\n", kv->type);
+    return Status::NotSupported("Error kv->type");
+  }
+  decoded.offset = block->data.size();
+  decoded.key_len = kv->key_len;
+  decoded.sequence = kv->sequence;
+  decoded.type = kv->type;
+  block->data.append(kv->key, kv->key_len);
+  if (decoded.value_len > 0)
+    block->data.append(kv->value, decoded.value_len);
+  block->kvs.push_back(decoded);
+  return Status::OK();
+}
+
 Status DecodeDataBlockRestartInterval(BlockRep *rep, int index) {
   Slice interval;
   char *data;
   size_t size;
-  KvNode *kv, *last_kv, *tmp_kv;
+  KvNode kv_nodes[2];
+  KvNode *kv = &kv_nodes[0], *last_kv = &kv_nodes[1], *tmp_kv;
   Status s;
 
-  kv = (KvNode *)malloc(sizeof(KvNode));
-  if (kv == NULL) {
-    DEBUG("corrupted malloc KvNode *kv\n");
-    return Status::Corruption("corrupted malloc KvNode *kv");
-  }
-  memset((void *)kv, 0, sizeof(KvNode));
-
-  last_kv = (KvNode *)malloc(sizeof(KvNode));
-  if (last_kv == NULL) {
-    DEBUG("corrupted malloc KvNode *last_kv\n");
-    s = Status::Corruption("corrupted malloc KvNode *last_kv");
-    goto free_kv;
-  }
-  memset((void *)last_kv, 0, sizeof(KvNode));
-
+  // keys and values point into the block or rep->key_scratch, nothing is
+  // allocated per record
+  memset(kv_nodes, 0, sizeof(kv_nodes));
   data = (char *)rep->block.data() + rep->restart_offset[index];
   if (index + 1 < rep->restart_nums)
     size = rep->restart_offset[index + 1] - rep->restart_offset[index];
@@ -520,26 +611,20 @@ Status DecodeDataBlockRestartInterval(BlockRep *rep, int index) {
   interval = Slice((const char *)data, size);
 
   while (interval.size() > 0) {
-    s = DecodeDataBlockOneRecord(kv, &interval, last_kv, false);
+    s = DecodeDataBlockOneRecord(kv, &interval, last_kv, false,
+                                 &rep->key_scratch);
     if (!s.ok())
-      goto free_last_kv;
-    s = ProcessOneKv(rep, kv);
+      break;
+    if (rep->decoded)
+      s = AppendDecodedKv(rep, kv);
+    else
+      s = ProcessOneKv(rep, kv);
     if (!s.ok())
-      goto free_last_kv;
+      break;
     tmp_kv = last_kv;
     last_kv = kv;
     kv = tmp_kv;
-    if (kv->key)
-      free(kv->key);
-    if (kv->value)
-      free(kv->value);
-    memset(kv, 0, sizeof(KvNode));
   }
-
-free_last_kv:
-  KvNodeDestroy(last_kv);
-free_kv:
-  KvNodeDestroy(kv);
   return s;
 }
 
@@ -565,113 +650,194 @@ Status DecodeDataBlock(BlockRep *rep) {
   return s;
 }
 
-Status GetIndexBlockRestartOffset(BlockRep *rep) {
-  return GetDataBlockRestartOffset(rep);
-}
-
-static Status DecodeIndexBlockOneRecord(KvNode *kv, Slice *input) {
-  // if key is not user key, we do not use sequence
-  // so can force key_is_user_key=true
-  return DecodeDataBlockOneRecord(kv, input, NULL, true);
-}
-
-Status ProcessOneBlockHandle(BlockRep *rep, KvNode *kv) {
-  BlockHandle block_handle;
-  Slice value(kv->value, kv->value_len);
-  BlockRep *data_block_rep;
+Status ProcessOneBlockHandle(BlockRep *rep, BlockHandle *block_handle) {
+  // no per block allocation: the block is a slice of the mapping or, when
+  // compressed, in the buffer of the thread, and the restart offsets are
+  // kept in the index rep
+  BlockRep data_block_rep = BlockRep();
   Status s;
 
-  s = BlockHandleDecodeFrom(&block_handle, &value);
-  if (!s.ok()) {
-    DEBUG("Error decode data block handle\n");
-    return s;
-  }
-
-  data_block_rep = (BlockRep *)malloc(sizeof(BlockRep));
-  if (data_block_rep == NULL) {
-    DEBUG("corrupted malloc data_block_rep\n");
-    return Status::Corruption("corrupted malloc data_block_rep");
-  }
-  memset(data_block_rep, 0, sizeof(BlockRep));
-  data_block_rep->filename = rep->filename;
-  data_block_rep->opt = rep->opt;
-  data_block_rep->checksum_type = rep->checksum_type;
-  data_block_rep->last_data_block = rep->last_data_block;
-  s = ReadBlock(&data_block_rep->block, data_block_rep->filename, &block_handle,
-                data_block_rep->checksum_type);
+  data_block_rep.filename = rep->filename;
+  data_block_rep.file = rep->file;
+  data_block_rep.opt = rep->opt;
+  data_block_rep.checksum_type = rep->checksum_type;
+  data_block_rep.compression_dict = rep->compression_dict;
+  data_block_rep.last_data_block = rep->last_data_block;
+  data_block_rep.restart_offset = rep->data_restart_offset;
+  data_block_rep.restart_capacity = rep->data_restart_capacity;
+  data_block_rep.key_scratch = rep->data_key_scratch;
+  s = ReadBlock(&data_block_rep.block, data_block_rep.file, block_handle,
+                data_block_rep.checksum_type, &data_block_rep.block_copied,
+                true, data_block_rep.compression_dict);
   if (!s.ok())
-    goto free_data_block_rep;
-  s = DecodeDataBlock(data_block_rep);
+    goto out;
+  s = DecodeDataBlock(&data_block_rep);
   if (s.ok()) {
     rep->data_block_count++;
-    rep->kv_put_count += data_block_rep->kv_put_count;
-    rep->kv_del_count += data_block_rep->kv_del_count;
+    rep->kv_put_count += data_block_rep.kv_put_count;
+    rep->kv_del_count += data_block_rep.kv_del_count;
   }
 
-free_block_data:
-  if (data_block_rep && data_block_rep->block.data())
-    free((void *)data_block_rep->block.data());
-free_block_rep_restart:
-  if (data_block_rep && data_block_rep->restart_offset)
-    free(data_block_rep->restart_offset);
-free_data_block_rep:
-  if (data_block_rep)
-    free(data_block_rep);
+  if (data_block_rep.block_copied && data_block_rep.block.data())
+    free((void *)data_block_rep.block.data());
+out:
+  rep->data_restart_offset = data_block_rep.restart_offset;
+  rep->data_restart_capacity = data_block_rep.restart_capacity;
+  rep->data_key_scratch = data_block_rep.key_scratch;
   return s;
 }
 
-Status DecodeIndexBlockRestartInterval(BlockRep *rep, int index) {
-  Slice interval;
-  KvNode kv;
-  Status s;
-  char *data;
-  size_t size;
+DataBlockHandleIter::DataBlockHandleIter(MappedFile *file,
+                                         uint8_t checksum_type,
+                                         const MetaBlockProperties *props)
+    : file_(file), checksum_type_(checksum_type),
+      two_level_(props != NULL && props->index_type == kTwoLevelIndexSearch),
+      value_delta_encoded_(props != NULL &&
+                           props->index_value_is_delta_encoded),
+      top_(), partition_(), partition_copied_(0), handle_(), valid_(false) {}
+
+DataBlockHandleIter::~DataBlockHandleIter() { FreePartition(); }
+
+void DataBlockHandleIter::FreePartition() {
+  if (partition_copied_ && partition_block_.data())
+    free((void *)partition_block_.data());
+  partition_block_ = Slice();
+  partition_copied_ = 0;
+  partition_ = IndexCursor();
+}
 
-  memset(&kv, 0, sizeof(KvNode));
-  data = (char *)rep->block.data() + rep->restart_offset[index];
-  if (index + 1 < rep->restart_nums)
-    size = rep->restart_offset[index + 1] - rep->restart_offset[index];
-  else
-    size = rep->data_size - rep->restart_offset[index];
-  interval = Slice((const char *)data, size);
+// The entries of an index block are the block without its restart array:
+// they are walked in order, the restart points are not needed.
+Status DataBlockHandleIter::InitCursor(const Slice &block,
+                                       IndexCursor *cursor) {
+  uint32_t restarts;
 
-  if (interval.size() > 0) {
-    s = DecodeIndexBlockOneRecord(&kv, &interval);
-    if (!s.ok())
-      goto free_kv;
-    s = ProcessOneBlockHandle(rep, &kv);
-    if (!s.ok())
-      goto free_kv;
+  *cursor = IndexCursor();
+  if (block.size() < 4) {
+    DEBUG("index block is too small\n");
+    return Status::Corruption("index block is too small");
+  }
+  restarts = DecodeFixed32(block.data() + block.size() - 4);
+  if (restarts > (block.size() - 4) / 4) {
+    DEBUG("index block length is smaller than restarts\n");
+    return Status::Corruption("index block length is smaller than restarts");
+  }
+  cursor->entries = Slice(block.data(), block.size() - 4 * (restarts + 1));
+  return Status::OK();
+}
+
+// Decode the handle of the next entry of an index block, the key is not
+// needed.  Without delta encoding the value is a length prefixed block
+// handle.  With it there is no value length: an entry that shares a key
+// prefix with the previous one only stores the size difference of its
+// block, which starts right after the previous block and its trailer.
+Status DataBlockHandleIter::NextEntry(IndexCursor *cursor,
+                                      BlockHandle *handle) {
+  Slice *input = &cursor->entries;
+  uint32_t shared, non_shared, value_len = 0;
+  uint64_t zigzag;
+  int64_t delta;
+  Slice value;
+  Status s;
+
+  if (!GetVarint32(input, &shared) || !GetVarint32(input, &non_shared) ||
+      (!value_delta_encoded_ && !GetVarint32(input, &value_len))) {
+    DEBUG("bad index entry header\n");
+    return Status::Corruption("bad index entry header");
+  }
+  if (non_shared > input->size()) {
+    DEBUG("index key len overstep the boundary\n");
+    return Status::Corruption("index key len overstep the boundary");
+  }
+  input->remove_prefix(non_shared);
+  if (!value_delta_encoded_) {
+    if (value_len > input->size()) {
+      DEBUG("index value len overstep the boundary\n");
+      return Status::Corruption("index value len overstep the boundary");
+    }
+    value = Slice(input->data(), value_len);
+    input->remove_prefix(value_len);
+    s = BlockHandleDecodeFrom(handle, &value);
+  } else if (shared == 0) {
+    s = BlockHandleDecodeFrom(handle, input);
+  } else if (!cursor->has_last || !GetVarint64(input, &zigzag)) {
+    DEBUG("bad delta encoded block handle\n");
+    return Status::Corruption("bad delta encoded block handle");
   } else {
-    DEBUG("Error decode index block\n");
-    s = Status::Corruption("Error decode index block");
+    delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+    handle->offset =
+        cursor->last.offset + cursor->last.size + kBlockTrailerSize;
+    handle->size = cursor->last.size + delta;
   }
+  if (s.ok()) {
+    cursor->last = *handle;
+    cursor->has_last = true;
+  }
+  return s;
+}
+
+Status DataBlockHandleIter::SeekToFirst(const Slice &index) {
+  Status s;
 
-free_kv:
-  if (kv.key)
-    free(kv.key);
-  if (kv.value)
-    free(kv.value);
+  valid_ = false;
+  FreePartition();
+  s = InitCursor(index, &top_);
+  if (s.ok())
+    s = Next();
   return s;
 }
 
-Status DecodeIndexBlock(BlockRep *rep) {
-  int nums = 0, i;
+Status DataBlockHandleIter::Next() {
+  BlockHandle partition_handle;
   Status s;
 
-  s = GetIndexBlockRestartOffset(rep);
-  if (!s.ok())
+  valid_ = false;
+  if (!two_level_) {
+    if (top_.entries.size() == 0)
+      return s;
+    s = NextEntry(&top_, &handle_);
+    valid_ = s.ok();
     return s;
-  nums = rep->restart_nums;
-  for (i = 0; i < nums; i++) {
-    if (i == nums - 1)
-      rep->last_data_block = 1;
-    s = DecodeIndexBlockRestartInterval(rep, i);
+  }
+  // the next handle of the current partition, or of the next partition
+  // that has one
+  while (partition_.entries.size() == 0) {
+    FreePartition();
+    if (top_.entries.size() == 0)
+      return s;
+    s = NextEntry(&top_, &partition_handle);
+    if (s.ok())
+      s = ReadBlock(&partition_block_, file_, &partition_handle,
+                    checksum_type_, &partition_copied_);
+    if (s.ok())
+      s = InitCursor(partition_block_, &partition_);
     if (!s.ok()) {
-      DEBUG("decode data_block[%d] fail\n", i);
+      DEBUG("read index partition fail\n");
       return s;
     }
   }
+  s = NextEntry(&partition_, &handle_);
+  valid_ = s.ok();
+  return s;
+}
+
+Status DecodeIndexBlock(BlockRep *rep) {
+  DataBlockHandleIter iter(rep->file, rep->checksum_type, rep->props);
+  BlockHandle handle;
+  Status s;
+
+  // one handle ahead, to know the last data block
+  s = iter.SeekToFirst(rep->block);
+  while (s.ok() && iter.Valid()) {
+    handle = iter.handle();
+    s = iter.Next();
+    if (!s.ok())
+      break;
+    rep->last_data_block = !iter.Valid();
+    s = ProcessOneBlockHandle(rep, &handle);
+    if (!s.ok())
+      DEBUG("decode data_block[%u] fail\n", rep->data_block_count);
+  }
   return s;
 }
 
@@ -680,8 +846,9 @@ static Status GetPropertyBlockRestartOffset(BlockRep *rep) {
 }
 
 static Status DecodePropertyBlockOneRecord(KvNode *kv, Slice *input,
-                                           KvNode *last_kv) {
-  return DecodeDataBlockOneRecord(kv, input, last_kv, true);
+                                           KvNode *last_kv,
+                                           KeyScratch *scratch) {
+  return DecodeDataBlockOneRecord(kv, input, last_kv, true, scratch);
 }
 
 static Status ProcessOnePropertyKv(BlockRep *rep, KvNode *kv, int *find) {
@@ -706,52 +873,56 @@ static Status ProcessOnePropertyKv(BlockRep *rep, KvNode *kv, int *find) {
     (*find)++;
   }
 
+  // case: comparator name, not counted in find, older tables do not have
+  // it
+  if (strlen(kComparatorName) == kv->key_len &&
+      strncmp(kComparatorName, kv->key, kv->key_len) == 0) {
+    uint32_t len = std::min<uint32_t>(kv->value_len, kComparatorNameLen);
+    memcpy(rep->props->comparator_name, kv->value, len);
+    rep->props->comparator_name[len] = '\0';
+  }
+
+  // case: delta encoded index values, not counted in find, most tables
+  // do not have it
+  if (strlen(kIndexValueIsDeltaEncoded) == kv->key_len &&
+      strncmp(kIndexValueIsDeltaEncoded, kv->key, kv->key_len) == 0) {
+    Slice value(kv->value, kv->value_len);
+    uint64_t flag = 0;
+    if (!GetVarint64(&value, &flag)) {
+      DEBUG("bad index value delta encoding property\n");
+      return Status::Corruption("bad index value delta encoding property");
+    }
+    rep->props->index_value_is_delta_encoded = (flag != 0);
+  }
+
   return s;
 }
 
 Status DecodePropertyBlock(BlockRep *rep) {
   Slice my_block = Slice(rep->block.data(), rep->block.size());
-  KvNode *kv, *last_kv, *tmp_kv;
+  KvNode kv_nodes[2];
+  KvNode *kv = &kv_nodes[0], *last_kv = &kv_nodes[1], *tmp_kv;
+  KeyScratch scratch;
   Status s;
   int find = 0;
 
-  kv = (KvNode *)malloc(sizeof(KvNode));
-  if (kv == NULL) {
-    DEBUG("corrupted malloc KvNode *kv\n");
-    return Status::Corruption("corrupted malloc KvNode *kv");
-  }
-  memset((void *)kv, 0, sizeof(KvNode));
-
-  last_kv = (KvNode *)malloc(sizeof(KvNode));
-  if (last_kv == NULL) {
-    DEBUG("corrupted malloc KvNode *last_kv\n");
-    s = Status::Corruption("corrupted malloc KvNode *last_kv");
-    goto free_kv;
-  }
-  memset((void *)last_kv, 0, sizeof(KvNode));
-
+  memset(kv_nodes, 0, sizeof(kv_nodes));
+  memset(&scratch, 0, sizeof(KeyScratch));
   s = GetPropertyBlockRestartOffset(rep);
   if (!s.ok())
-    goto free_last_kv;
+    return s;
   my_block = Slice(rep->block.data(), rep->data_size);
 
   while (my_block.size() > 0) {
-    s = DecodePropertyBlockOneRecord(kv, &my_block, last_kv);
+    s = DecodePropertyBlockOneRecord(kv, &my_block, last_kv, &scratch);
     if (!s.ok())
-      goto free_last_kv;
+      goto free_scratch;
     s = ProcessOnePropertyKv(rep, kv, &find);
     if (!s.ok())
-      goto free_last_kv;
-    if (find >= kProperties)
-      break;
+      goto free_scratch;
     tmp_kv = last_kv;
     last_kv = kv;
     kv = tmp_kv;
-    if (kv->key)
-      free(kv->key);
-    if (kv->value)
-      free(kv->value);
-    memset(kv, 0, sizeof(KvNode));
   }
 
   if (s.ok() && find < kProperties && strlen(rep->props->cf_name) == 0) {
@@ -759,10 +930,9 @@ Status DecodePropertyBlock(BlockRep *rep) {
     s = Status::NotFound("Can not find cf_name in property meta block");
   }
 
-free_last_kv:
-  KvNodeDestroy(last_kv);
-free_kv:
-  KvNodeDestroy(kv);
+free_scratch:
+  if (scratch.data)
+    free(scratch.data);
   return s;
 }
 
@@ -771,8 +941,9 @@ static Status GetMetaIndexBlockRestartOffset(BlockRep *rep) {
 }
 
 static Status DecodeMetaIndexBlockOneRecord(KvNode *kv, Slice *input,
-                                            KvNode *last_kv) {
-  return DecodeDataBlockOneRecord(kv, input, last_kv, true);
+                                            KvNode *last_kv,
+                                            KeyScratch *scratch) {
+  return DecodeDataBlockOneRecord(kv, input, last_kv, true, scratch);
 }
 
 static bool IsPropertyBlock(char *key, int len) {
@@ -791,7 +962,14 @@ static Status ProcessOneMetaIndexKv(BlockRep *rep, KvNode *kv, int *find) {
   BlockRep *meta_block_rep;
   Status s;
 
-  // now just nead decode property meta block
+  if (strlen(kCompressionDictBlock) == kv->key_len &&
+      strncmp(kCompressionDictBlock, kv->key, kv->key_len) == 0) {
+    s = BlockHandleDecodeFrom(&rep->props->compression_dict_handle, &value);
+    if (s.ok())
+      rep->props->has_compression_dict = 1;
+    return s;
+  }
+  // otherwise just nead decode property meta block
   if (!IsPropertyBlock(kv->key, kv->key_len))
     return s;
   (*find)++; // find property block
@@ -808,17 +986,19 @@ static Status ProcessOneMetaIndexKv(BlockRep *rep, KvNode *kv, int *find) {
   }
   memset(meta_block_rep, 0, sizeof(BlockRep));
   meta_block_rep->filename = rep->filename;
+  meta_block_rep->file = rep->file;
   meta_block_rep->opt = rep->opt;
   meta_block_rep->checksum_type = rep->checksum_type;
   meta_block_rep->props = rep->props;
-  s = ReadBlock(&meta_block_rep->block, meta_block_rep->filename, &block_handle,
-                meta_block_rep->checksum_type);
+  s = ReadBlock(&meta_block_rep->block, meta_block_rep->file, &block_handle,
+                meta_block_rep->checksum_type, &meta_block_rep->block_copied);
   if (!s.ok())
     goto free_meta_block_rep;
   s = DecodePropertyBlock(meta_block_rep);
 
 free_block_data:
-  if (meta_block_rep && meta_block_rep->block.data())
+  if (meta_block_rep && meta_block_rep->block_copied &&
+      meta_block_rep->block.data())
     free((void *)meta_block_rep->block.data());
 free_block_rep_restart:
   if (meta_block_rep && meta_block_rep->restart_offset)
@@ -831,47 +1011,31 @@ free_meta_block_rep:
 
 Status DecodeMetaIndexBlock(BlockRep *rep) {
   Slice my_block = Slice(rep->block.data(), rep->block.size());
-  KvNode *kv, *last_kv, *tmp_kv;
+  KvNode kv_nodes[2];
+  KvNode *kv = &kv_nodes[0], *last_kv = &kv_nodes[1], *tmp_kv;
+  KeyScratch scratch;
   Status s;
   int find = 0;
 
-  kv = (KvNode *)malloc(sizeof(KvNode));
-  if (kv == NULL) {
-    DEBUG("corrupted malloc KvNode *kv\n");
-    return Status::Corruption("corrupted malloc KvNode *kv");
-  }
-  memset((void *)kv, 0, sizeof(KvNode));
-
-  last_kv = (KvNode *)malloc(sizeof(KvNode));
-  if (last_kv == NULL) {
-    DEBUG("corrupted malloc KvNode *last_kv\n");
-    s = Status::Corruption("corrupted malloc KvNode *last_kv");
-    goto free_kv;
-  }
-  memset((void *)last_kv, 0, sizeof(KvNode));
-
+  memset(kv_nodes, 0, sizeof(kv_nodes));
+  memset(&scratch, 0, sizeof(KeyScratch));
   s = GetMetaIndexBlockRestartOffset(rep);
   if (!s.ok())
-    goto free_last_kv;
+    return s;
   my_block = Slice(rep->block.data(), rep->data_size);
 
   while (my_block.size() > 0) {
-    s = DecodeMetaIndexBlockOneRecord(kv, &my_block, last_kv);
+    s = DecodeMetaIndexBlockOneRecord(kv, &my_block, last_kv, &scratch);
     if (!s.ok())
-      goto free_last_kv;
+      goto free_scratch;
     s = ProcessOneMetaIndexKv(rep, kv, &find);
     if (!s.ok())
-      goto free_last_kv;
+      goto free_scratch;
     if (find >= kMetaNums)
       break;
     tmp_kv = last_kv;
     last_kv = kv;
     kv = tmp_kv;
-    if (kv->key)
-      free(kv->key);
-    if (kv->value)
-      free(kv->value);
-    memset(kv, 0, sizeof(KvNode));
   }
 
   if (s.ok() && find < kMetaNums) {
@@ -879,29 +1043,29 @@ Status DecodeMetaIndexBlock(BlockRep *rep) {
     s = Status::NotFound("can not find property meta block");
   }
 
-free_last_kv:
-  KvNodeDestroy(last_kv);
-free_kv:
-  KvNodeDestroy(kv);
+free_scratch:
+  if (scratch.data)
+    free(scratch.data);
   return s;
 }
 
-Status ProcessMetaIndex(char *filename, MetaBlockProperties *props,
+Status ProcessMetaIndex(MappedFile *file, MetaBlockProperties *props,
                         Foot *foot) {
   BlockHandle block_handle;
-  BlockRep meta_index_block_rep;
+  BlockRep meta_index_block_rep = BlockRep();
   Status s;
 
-  meta_index_block_rep.filename = filename;
+  meta_index_block_rep.filename = file->filename;
+  meta_index_block_rep.file = file;
   meta_index_block_rep.props = props;
   meta_index_block_rep.checksum_type = foot->checksum_type;
   // read meta index block and decode property block
-  s = ReadBlock(&meta_index_block_rep.block, filename, &foot->metaindex_handle,
-                foot->checksum_type);
+  s = ReadBlock(&meta_index_block_rep.block, file, &foot->metaindex_handle,
+                foot->checksum_type, &meta_index_block_rep.block_copied);
   if (s.ok())
     s = DecodeMetaIndexBlock(&meta_index_block_rep);
 
-  if (meta_index_block_rep.block.data())
+  if (meta_index_block_rep.block_copied && meta_index_block_rep.block.data())
     free((void *)meta_index_block_rep.block.data());
   if (meta_index_block_rep.restart_offset)
     free(meta_index_block_rep.restart_offset);
@@ -936,11 +1100,13 @@ Status FindCFHandleIndex(std::vector<ColumnFamilyHandle *> *handles, char *name,
   return s;
 }
 
-static Status IsIndexTypeSupport(IndexType index_type) {
+Status IsIndexTypeSupport(IndexType index_type) {
   Status s;
 
   switch (index_type) {
   case kBinarySearch:
+  case kHashSearch:
+  case kTwoLevelIndexSearch:
     return s;
   default:
     DEBUG("index_type=%d is not support.\n", (int)index_type);
@@ -950,27 +1116,46 @@ static Status IsIndexTypeSupport(IndexType index_type) {
 
 Status AnalyzeSst(char *filename, int verify, DB *db,
                   std::vector<ColumnFamilyHandle *> *handles) {
+  return AnalyzeSst(filename, verify, db, handles,
+                    IngestExternalFileOptions(), NULL);
+}
+
+Status AnalyzeSst(char *filename, int verify, DB *db,
+                  std::vector<ColumnFamilyHandle *> *handles,
+                  const IngestExternalFileOptions &options,
+                  IngestExternalFileReport *report) {
   Status s;
   Slice foot_content, tmp_foot_content;
+  uint8_t foot_copied = 0;
   Foot foot;
   BlockRep index_block_rep;
   DatabaseOptions db_opt;
   WriteBatchNonatomic wb;
   MetaBlockProperties props;
+  MappedFile file;
+  UncompressionDict *compression_dict = NULL;
   int cf_handle_index = -1;
+  struct timespec start, end;
+  double seconds;
+  int decode_threads = options.decode_threads;
 
   if (filename == NULL || db == NULL) {
     DEBUG("please provide filename and open db");
     return Status::Corruption("please provide filename and open db");
   }
+  clock_gettime(CLOCK_MONOTONIC, &start);
   memset((void *)&index_block_rep, 0, sizeof(BlockRep));
   memset((void *)&db_opt, 0, sizeof(DatabaseOptions));
   memset((void *)&props, 0, sizeof(MetaBlockProperties));
+  // open and map the file once, blocks are sliced out of the mapping
+  if (OpenMappedFile(filename, &file) != 0)
+    return Status::IOError("open sst file error", filename);
   index_block_rep.filename = filename;
+  index_block_rep.file = &file;
   index_block_rep.opt = &db_opt;
 
   // read foot_content from file and decode to foot
-  s = ReadFoot(&foot_content, filename);
+  s = ReadFoot(&foot_content, &file, &foot_copied);
   if (!s.ok())
     goto out;
   tmp_foot_content = Slice(foot_content.data(), foot_content.size());
@@ -989,9 +1174,20 @@ Status AnalyzeSst(char *filename, int verify, DB *db,
   if (handles == NULL || foot.legacy_footer_format) {
     db_opt.cf = NULL;
     fprintf(stderr, "kv will write to cf_name=default.\n");
+    // the index type is still needed, a table without properties or
+    // column family name has a binary search index
+    if (!foot.legacy_footer_format) {
+      s = ProcessMetaIndex(&file, &props, &foot);
+      if (s.IsNotFound())
+        s = Status::OK();
+      if (s.ok())
+        s = IsIndexTypeSupport(IndexType(props.index_type));
+      if (!s.ok())
+        goto free_foot_content;
+    }
   } else {
     DEBUG("decode meta index block in file=%s\n", filename);
-    s = ProcessMetaIndex(filename, &props, &foot);
+    s = ProcessMetaIndex(&file, &props, &foot);
     if (s.ok())
       s = FindCFHandleIndex(handles, props.cf_name, strlen(props.cf_name),
                             &cf_handle_index);
@@ -1003,27 +1199,59 @@ Status AnalyzeSst(char *filename, int verify, DB *db,
     fprintf(stderr, "decode cf_name=%s, kv will write to it.\n", props.cf_name);
   }
 
+  if (props.has_compression_dict) {
+    s = ReadCompressionDict(&file, &props.compression_dict_handle,
+                            foot.checksum_type, &compression_dict);
+    if (!s.ok())
+      goto free_foot_content;
+    index_block_rep.compression_dict = compression_dict;
+  }
+
   // read index block and decode each data block
   DEBUG("decode index block in file=%s\n", filename);
-  s = ReadBlock(&index_block_rep.block, filename, &foot.index_handle,
-                foot.checksum_type);
+  index_block_rep.props = &props;
+  s = ReadBlock(&index_block_rep.block, &file, &foot.index_handle,
+                foot.checksum_type, &index_block_rep.block_copied);
   if (!s.ok())
     goto free_foot_content;
-  s = DecodeIndexBlock(&index_block_rep);
-  DEBUG("total decode cout: data_block=%u, kv_put=%u, kv_del=%u\n",
+  if (decode_threads <= 0)
+    decode_threads = std::thread::hardware_concurrency();
+  if (decode_threads > 1)
+    s = IngestDataBlocks(&index_block_rep, decode_threads,
+                         options.max_pending_blocks);
+  else
+    s = DecodeIndexBlock(&index_block_rep);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  DEBUG("total decode cout: data_block=%u, kv_put=%u, kv_del=%u, "
+        "%lu bytes in %.3fs, %.1f MB/s\n",
         index_block_rep.data_block_count, index_block_rep.kv_put_count,
-        index_block_rep.kv_del_count);
+        index_block_rep.kv_del_count, (unsigned long)file.size, seconds,
+        seconds > 0 ? file.size / 1048576.0 / seconds : 0.0);
+  if (report) {
+    report->cf_name = db_opt.cf ? db_opt.cf->GetName() : "default";
+    report->keys_put = index_block_rep.kv_put_count;
+    report->keys_deleted = index_block_rep.kv_del_count;
+    report->bytes = file.size;
+    report->micros = (uint64_t)(seconds * 1e6);
+  }
 
 free_rep_restart_offset:
   if (index_block_rep.restart_offset)
     free(index_block_rep.restart_offset);
+  if (index_block_rep.data_restart_offset)
+    free(index_block_rep.data_restart_offset);
+  if (index_block_rep.data_key_scratch.data)
+    free(index_block_rep.data_key_scratch.data);
 free_rep_block_data:
-  if (index_block_rep.block.data())
+  if (index_block_rep.block_copied && index_block_rep.block.data())
     free((void *)index_block_rep.block.data());
 free_foot_content:
-  if (foot_content.data())
+  if (foot_copied && foot_content.data())
     free((void *)foot_content.data());
+  delete compression_dict;
 out:
+  CloseMappedFile(&file);
   return s;
 }
 
@@ -1043,8 +1271,11 @@ build_again:
     if (!s.ok()) {
       return s;
     }
-    TableBuilder *builder =
-        new TableBuilder(Options(), file, handle->GetName(), handle->GetID());
+    Options table_options;
+    InternalKeyComparator comparator(table_options.inner_comparator);
+    table_options.inner_comparator = &comparator;
+    TableBuilder *builder = new TableBuilder(table_options, file,
+                                             handle->GetName(), handle->GetID());
     for (; iter->Valid(); iter->Next()) {
       const Slice key = iter->key();
       const Slice value = iter->value();
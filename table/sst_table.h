@@ -12,6 +12,7 @@
 #include "swift/slice.h"
 #include "swift/status.h"
 #include "swift/table.h"
+#include "util/fileoperate.h"
 #include <stdint.h>
 #include <string.h>
 #include <string>
@@ -27,15 +28,24 @@ namespace shannon {
 #define DEBUG(format, arg...)
 #endif /* end of #ifdef DEBUG_CONFIG */
 
+// A decoded record.  key and value point into the block or a KeyScratch,
+// they are not owned.
 struct KvNode {
   char *key;
   char *value;
   uint32_t key_len;
   uint32_t value_len;
+  uint32_t internal_key_len; // key_len plus the sequence and type, if any
   uint64_t sequence;
   uint32_t type;
 };
 
+// Space to expand keys that share a prefix with the previous key.
+struct KeyScratch {
+  char *data;
+  uint32_t capacity;
+};
+
 /*** footer ***/
 // (64 + (7 - 1)) / 7 = 10
 enum {
@@ -61,52 +71,123 @@ struct Foot {
 };
 
 class ColumnFamilyHandle;
+class UncompressionDict;
 class WriteBatchNonatomic;
 
+// Writes the nonatomic batches of an ingest in place of
+// DB::WriteNonatomic(), so tests can see them without a device.
+class BatchWriter {
+ public:
+  virtual ~BatchWriter() {}
+  virtual Status Write(const WriteOptions &options,
+                       WriteBatchNonatomic *wb) = 0;
+};
+
 struct DatabaseOptions {
   DB *db;
   WriteBatchNonatomic *wb;
   WriteOptions write_opt;
   ColumnFamilyHandle *cf;
   uint8_t end; // write kvs to ssd at last
+  BatchWriter *writer; // if not NULL, batches go here instead of db
 };
 
 #define kPropertiesBlock "rocksdb.properties"
 // Old property block name for backward compatibility
 #define kPropertiesBlockOldName "rocksdb.stats"
+// The ZSTD dictionary the data blocks are compressed with, stored raw
+#define kCompressionDictBlock "rocksdb.compression_dict"
 #define kMetaNums 1
 
 #define kColumnFamilyName "rocksdb.column.family.name"
 #define kIndexType "rocksdb.block.based.table.index.type"
+#define kIndexValueIsDeltaEncoded "rocksdb.index.value.is.delta.encoded"
+#define kComparatorName "rocksdb.comparator"
+#define kComparatorNameLen 64
 #define kProperties 2
 struct MetaBlockProperties {
   char cf_name[CF_NAME_LEN + 1]; // add other property in future
   uint8_t index_type;
+  // Index entries after the first of a restart interval only store the
+  // size difference with the previous block handle.
+  uint8_t index_value_is_delta_encoded;
+  // Set when the meta index has a compression dictionary block, which
+  // comes before the property block.
+  uint8_t has_compression_dict;
+  BlockHandle compression_dict_handle;
+  // Name of the user key comparator, empty if the table does not name it.
+  // Longer names are cut to kComparatorNameLen.
+  char comparator_name[kComparatorNameLen + 1];
+};
+
+// Records of a data block decoded by an ingest worker, in block order.
+// Keys and values are packed into "data".
+struct DecodedKv {
+  size_t offset;
+  uint32_t key_len;
+  uint32_t value_len;
+  uint64_t sequence;
+  uint32_t type;
+};
+
+struct DecodedBlock {
+  std::string data;
+  std::vector<DecodedKv> kvs;
 };
 
 struct BlockRep {
   uint32_t restart_nums;
   uint32_t *restart_offset;
+  uint32_t restart_capacity; // entries allocated in restart_offset
   uint32_t data_size; // except restarts_offset and restart_num
   Slice block;        // uncompressed content
+  uint8_t block_copied; // block is malloc()ed, else points into the mapping
   char *filename;
+  MappedFile *file;
   uint8_t checksum_type;
   uint8_t last_data_block;
   MetaBlockProperties *props; // for property meta block
+  // dictionary of the data blocks, NULL if they have none
+  const UncompressionDict *compression_dict;
 
   DatabaseOptions *opt; // write kv to ssd
+  DecodedBlock *decoded; // if set, kvs are decoded into it instead
   uint32_t kv_put_count;
   uint32_t kv_del_count;
   uint32_t data_block_count; // used by index_block
+  // restart offsets of data blocks, reused from block to block
+  uint32_t *data_restart_offset;
+  uint32_t data_restart_capacity;
+  KeyScratch key_scratch;      // keys of this block
+  KeyScratch data_key_scratch; // keys of data blocks, like restart offsets
 };
 
 extern Status BlockHandleDecodeFrom(BlockHandle *dst, Slice *input);
 extern Status FootDecodeFrom(Foot *dst, Slice *input, int verify);
 extern Status ReadFoot(Slice *result, char *filename);
+// With "into_buffer", a compressed block is decompressed into the buffer
+// of the calling thread, valid until it decompresses the next block that
+// way, instead of a malloc()ed one.  "dict" is only given for data blocks.
 extern Status CheckAndUncompressBlock(Slice *result, Slice *input,
-                                      uint8_t checksum_type);
+                                      uint8_t checksum_type,
+                                      bool into_buffer = false,
+                                      const UncompressionDict *dict = NULL);
 extern Status ReadBlock(Slice *result, char *filename, BlockHandle *handle,
                         uint8_t checksum_type);
+// Read from a mapped file.  *copied is set if *result was malloc()ed and
+// must be freed, otherwise it points into the mapping: uncompressed
+// blocks are not copied.  With "into_buffer", *copied is not set for a
+// compressed block, which is in the buffer of the calling thread as for
+// CheckAndUncompressBlock().
+extern Status ReadFoot(Slice *result, MappedFile *file, uint8_t *copied);
+extern Status ReadBlock(Slice *result, MappedFile *file, BlockHandle *handle,
+                        uint8_t checksum_type, uint8_t *copied,
+                        bool into_buffer = false,
+                        const UncompressionDict *dict = NULL);
+// Read the compression dictionary block at handle into a new *dict.
+extern Status ReadCompressionDict(MappedFile *file, BlockHandle *handle,
+                                  uint8_t checksum_type,
+                                  UncompressionDict **dict);
 
 /*** data block ***/
 extern Status GetDataBlockRestartOffset(BlockRep *rep);
@@ -115,22 +196,78 @@ extern Status DecodeDataBlockRestartInterval(BlockRep *rep, int index);
 extern Status DecodeDataBlock(BlockRep *rep);
 
 /*** index block ***/
-extern Status GetIndexBlockRestartOffset(BlockRep *rep);
-extern Status ProcessOneBlockHandle(BlockRep *rep, KvNode *kv);
-extern Status DecodeIndexBlockRestartInterval(BlockRep *rep, int index);
+// Walks the data block handles of a table in file order.  A partitioned
+// index (kTwoLevelIndexSearch) is a top level block of the handles of
+// index partitions: a partition is read when the walk reaches it and freed
+// when it leaves it, so memory does not grow with the file.  A hash index
+// (kHashSearch) is a binary search index plus meta blocks for lookups,
+// which are not needed here.
+class DataBlockHandleIter {
+public:
+  // props is NULL for a table without properties, which has a binary
+  // search index.
+  DataBlockHandleIter(MappedFile *file, uint8_t checksum_type,
+                      const MetaBlockProperties *props);
+  ~DataBlockHandleIter();
+
+  // Position at the first data block of the index block "index", which
+  // must outlive the iterator.
+  Status SeekToFirst(const Slice &index);
+  bool Valid() const { return valid_; }
+  const BlockHandle &handle() const { return handle_; }
+  Status Next();
+
+private:
+  // The entries of an index block left to walk.
+  struct IndexCursor {
+    Slice entries;
+    BlockHandle last; // base of delta encoded handles
+    bool has_last;
+  };
+
+  Status InitCursor(const Slice &block, IndexCursor *cursor);
+  Status NextEntry(IndexCursor *cursor, BlockHandle *handle);
+  void FreePartition();
+
+  MappedFile *const file_;
+  const uint8_t checksum_type_;
+  const bool two_level_;
+  const bool value_delta_encoded_;
+  IndexCursor top_; // the index block, or its top level
+  IndexCursor partition_;
+  Slice partition_block_;
+  uint8_t partition_copied_;
+  BlockHandle handle_;
+  bool valid_;
+
+  // No copying allowed
+  DataBlockHandleIter(const DataBlockHandleIter &);
+  void operator=(const DataBlockHandleIter &);
+};
+
+extern Status ProcessOneBlockHandle(BlockRep *rep, BlockHandle *handle);
+// Decode the data blocks of the index block in rep->block, rep->props
+// tells its type.
 extern Status DecodeIndexBlock(BlockRep *rep);
 
 /** meata block **/
 extern Status DecodePropertyBlock(BlockRep *rep);
 extern Status DecodeMetaIndexBlock(BlockRep *rep);
-extern Status ProcessMetaIndex(char *filename, MetaBlockProperties *props,
+extern Status ProcessMetaIndex(MappedFile *file, MetaBlockProperties *props,
                                Foot *foot);
 
 extern Status FindCFHandleIndex(std::vector<ColumnFamilyHandle *> *handles,
                                 char *name, int name_len, int *index);
 
+extern Status IsIndexTypeSupport(IndexType index_type);
+
+
 extern Status AnalyzeSst(char *filename, int verify, DB *db,
                          std::vector<ColumnFamilyHandle *> *handles);
+extern Status AnalyzeSst(char *filename, int verify, DB *db,
+                         std::vector<ColumnFamilyHandle *> *handles,
+                         const IngestExternalFileOptions &options,
+                         IngestExternalFileReport *report);
 
 extern Status BuildSst(const std::string& dbname, const char *filename, Env *env,
                    ColumnFamilyHandle *handle, Iterator *iter, uint64_t file_size, bool all_sync);
@@ -3,13 +3,25 @@
 #include "filter_block.h"
 #include "format.h"
 #include "meta_block.h"
+#include "compression.h"
+#include "dbformat.h"
+#include "util/bounded_queue.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
 #include "util/filename.h"
+#include "util/xxh3.h"
+#include "util/xxhash.h"
 #include <assert.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 namespace shannon {
 
 extern const std::string sPropertiesBlock = "rocksdb.properties";
+static const std::string sCompressionDictBlock = "rocksdb.compression_dict";
+// A fixed32 property, as RocksDB writes it.
+static const std::string sIndexType = "rocksdb.block.based.table.index.type";
 inline std::string CompressionTypeToString(CompressionType compression_type) {
   switch (compression_type) {
   case kNoCompression:
@@ -22,6 +34,8 @@ inline std::string CompressionTypeToString(CompressionType compression_type) {
     return "BZip2";
   case kLZ4Compression:
     return "LZ4";
+  case kLZ4HCCompression:
+    return "LZ4HC";
   case kXpressCompression:
     return "Xpress";
   case kZSTD:
@@ -33,6 +47,64 @@ inline std::string CompressionTypeToString(CompressionType compression_type) {
     return "";
   }
 }
+
+static bool IsChecksumTypeSupported(ChecksumType type) {
+  return type == kNoChecksum || type == kCRC32c || type == kxxHash ||
+         type == kXXH3;
+}
+
+static bool IsIndexTypeSupported(IndexType type) {
+  return type == kBinarySearch || type == kHashSearch ||
+         type == kTwoLevelIndexSearch;
+}
+
+uint32_t ComputeBlockChecksum(ChecksumType type, const char *data, size_t n,
+                              char block_type) {
+  switch (type) {
+  case kNoChecksum:
+    return 0;
+  case kxxHash: {
+    XXH32_stateSpace_t state;
+    XXH32_resetState(&state, 0);
+    XXH32_update(&state, data, static_cast<int>(n));
+    XXH32_update(&state, &block_type, 1);
+    return XXH32_intermediateDigest(&state);
+  }
+  case kXXH3: {
+    // The block type is mixed in afterwards rather than hashed, the
+    // streaming form of XXH3 is much slower on whole blocks.
+    const uint32_t kRandomPrime = 0x6b9083d9;
+    uint32_t v = static_cast<uint32_t>(xxh3::Hash64(data, n));
+    return v ^ (static_cast<uint8_t>(block_type) * kRandomPrime);
+  }
+  case kCRC32c:
+  default: {
+    uint32_t crc = crc32c::Value(data, n);
+    crc = crc32c::Extend(crc, &block_type, 1); // Extend crc to cover block type
+    return crc32c::Mask(crc);
+  }
+  }
+}
+
+// A sealed data block waiting to be compressed and written.  Blocks are
+// written in the order they were sealed, whatever order they finish in.
+struct TableBuilder::PendingBlock {
+  std::string raw;
+  std::string compressed;
+  CompressionType type;
+  bool done; // Compressed, guarded by Rep::compress_mu
+
+  // Index key of the block, final once the first key of the next block
+  // is known.
+  std::string index_key;
+  bool has_index_key;
+
+  // Keys of the block, added to the filter when the block is written so
+  // the filter sees the right block offset.
+  std::string keys;
+  std::vector<size_t> key_sizes;
+};
+
 struct TableBuilder::Rep {
   Options options;
   Options index_block_options;
@@ -54,11 +126,40 @@ struct TableBuilder::Rep {
 
   bool pending_index_entry;
   BlockHandle pending_handle; // Handle to add to index block
+  // Base of the next delta encoded handle of index_block.
+  BlockHandle last_index_handle;
+  // Partitioned index: index_block is the partition being built, the
+  // finished ones wait for Finish() with their last key.
+  std::string last_index_key;
+  std::vector<std::pair<std::string, std::string> > index_partitions;
 
   std::string compressed_output;
   std::string columnfamily_name;
   uint64_t columnfamily_id;
 
+  // Parallel compression, NULL queue when blocks are compressed inline.
+  BoundedQueue<PendingBlock *> *compress_queue;
+  // Data blocks go through pending_blocks, with a compress_queue or a
+  // dictionary to train.
+  bool use_pending_blocks;
+  std::vector<std::thread> compress_threads;
+  std::deque<PendingBlock *> pending_blocks;
+  // Written blocks, reused with the capacity of their buffers.
+  std::vector<PendingBlock *> free_blocks;
+  size_t max_pending_blocks;
+  std::mutex compress_mu;
+  std::condition_variable compress_cv;
+
+  // Dictionary compression: the first dict_sample_blocks data blocks stay
+  // in pending_blocks until the dictionary is trained on them.  NULL
+  // compression_dict when there are too few samples.
+  bool sampling_dict;
+  size_t dict_sample_blocks;
+  CompressionDict *compression_dict;
+  // Filter keys of the data block being built.
+  std::string block_keys;
+  std::vector<size_t> block_key_sizes;
+
   Rep(const Options &opt, WritableFile *f)
       : options(opt), index_block_options(opt), file(f), offset(0),
         data_block(&options), index_block(&index_block_options), num_entries(0),
@@ -67,11 +168,86 @@ struct TableBuilder::Rep {
         columnfamily_name("default"), closed(false),
         filter_block(opt.filter_policy == NULL ? NULL : new FilterBlockBuilder(
                                                             opt.filter_policy)),
-        prop_block(new PropertyBlockBuilder()), pending_index_entry(false) {
+        prop_block(new PropertyBlockBuilder()), pending_index_entry(false),
+        compress_queue(NULL), use_pending_blocks(false),
+        max_pending_blocks(0), sampling_dict(false), dict_sample_blocks(0),
+        compression_dict(NULL) {
     index_block_options.block_restart_interval = 1;
+    if (!IsChecksumTypeSupported(opt.checksum)) {
+      status = Status::NotSupported("checksum type not supported");
+    }
+    if (!IsIndexTypeSupported(opt.index_type)) {
+      status = Status::NotSupported("index type not supported");
+    }
+    if (opt.index_block_restart_interval < 1) {
+      status = Status::InvalidArgument("index block restart interval < 1");
+    } else {
+      index_block_options.block_restart_interval =
+          opt.index_block_restart_interval;
+    }
+    if (opt.compression_parallel_threads > 1 &&
+        opt.compression != kNoCompression) {
+      max_pending_blocks = opt.compression_max_pending_blocks > 0
+                               ? opt.compression_max_pending_blocks
+                               : 2 * opt.compression_parallel_threads;
+      // The last block waits for the next key, keep room for one more.
+      if (max_pending_blocks < 2) {
+        max_pending_blocks = 2;
+      }
+      compress_queue = new BoundedQueue<PendingBlock *>(max_pending_blocks);
+    }
+    if (opt.compression_max_dict_bytes > 0 &&
+        (opt.compression == kZSTD ||
+         opt.compression == kZSTDNotFinalCompression) &&
+        ZSTD_Supported()) {
+      sampling_dict = true;
+      dict_sample_blocks = opt.compression_dict_sample_blocks > 0
+                               ? opt.compression_dict_sample_blocks
+                               : 1;
+    }
+    use_pending_blocks = compress_queue != NULL || sampling_dict;
   }
 };
 
+// Compress "raw" with "type" into *compressed.  Returns the type the block
+// is stored with, kNoCompression if the library is not available or the
+// block compressed less than 12.5%.  "context" is the codec state of the
+// calling thread, "dict" the ZSTD dictionary of data blocks, if any.
+static CompressionType CompressBlock(const Slice &raw, CompressionType type,
+                                     std::string *compressed,
+                                     CompressionContext *context,
+                                     const CompressionDict *dict = NULL) {
+  bool ok = false;
+  switch (type) {
+  case kNoCompression:
+    break;
+  case kSnappyCompression:
+    ok = Snappy_Compress(raw.data(), raw.size(), compressed);
+    break;
+  case kZlibCompression:
+    ok = zlib_compress(raw, compressed, context);
+    break;
+  case kLZ4Compression:
+    ok = lz4_compress(raw, compressed, false, context);
+    break;
+  case kLZ4HCCompression:
+    ok = lz4_compress(raw, compressed, true, context);
+    break;
+  case kZSTD:
+  case kZSTDNotFinalCompression:
+    ok = zstd_compress(raw, compressed, context, dict);
+    break;
+  default:
+    // No compressor for this type, store uncompressed.
+    break;
+  }
+  if (ok && compressed->size() < raw.size() - (raw.size() / 8u)) {
+    return type;
+  }
+  compressed->clear();
+  return kNoCompression;
+}
+
 TableBuilder::TableBuilder(const Options &options, WritableFile *file,
                            const string &columnfamily_name,
                            uint32_t columnfamily_id)
@@ -82,6 +258,11 @@ TableBuilder::TableBuilder(const Options &options, WritableFile *file,
   rep_->columnfamily_name.assign(columnfamily_name.data(),
                                  columnfamily_name.size());
   rep_->columnfamily_id = columnfamily_id;
+  for (int i = 0; rep_->compress_queue != NULL &&
+                  i < options.compression_parallel_threads; i++) {
+    rep_->compress_threads.push_back(
+        std::thread(&TableBuilder::CompressBlocks, this));
+  }
 }
 
 TableBuilder::TableBuilder(const Options &options, WritableFile *file)
@@ -89,10 +270,22 @@ TableBuilder::TableBuilder(const Options &options, WritableFile *file)
   if (rep_->filter_block != NULL) {
     rep_->filter_block->StartBlock(0);
   }
+  for (int i = 0; rep_->compress_queue != NULL &&
+                  i < options.compression_parallel_threads; i++) {
+    rep_->compress_threads.push_back(
+        std::thread(&TableBuilder::CompressBlocks, this));
+  }
 }
 
 TableBuilder::~TableBuilder() {
   assert(rep_->closed); // Catch errors where caller forgot to call Finish()
+  StopCompressThreads();
+  assert(rep_->pending_blocks.empty());
+  for (size_t i = 0; i < rep_->free_blocks.size(); i++) {
+    delete rep_->free_blocks[i];
+  }
+  delete rep_->compress_queue;
+  delete rep_->compression_dict;
   delete rep_->filter_block;
   delete rep_->prop_block;
   delete rep_;
@@ -105,12 +298,23 @@ Status TableBuilder::ChangeOptions(const Options &options) {
   if (options.inner_comparator != rep_->options.inner_comparator) {
     return Status::InvalidArgument("changing comparator while building table");
   }
+  if (options.checksum != rep_->options.checksum) {
+    return Status::InvalidArgument("changing checksum while building table");
+  }
+  if (options.index_type != rep_->options.index_type ||
+      options.index_block_restart_interval !=
+          rep_->options.index_block_restart_interval ||
+      options.index_value_delta_encoding !=
+          rep_->options.index_value_delta_encoding) {
+    return Status::InvalidArgument("changing index while building table");
+  }
 
   // Note that any live BlockBuilders point to rep_->options and therefore
   // will automatically pick up the updated options.
   rep_->options = options;
   rep_->index_block_options = options;
-  rep_->index_block_options.block_restart_interval = 1;
+  rep_->index_block_options.block_restart_interval =
+      options.index_block_restart_interval;
   return Status::OK();
 }
 
@@ -126,14 +330,22 @@ void TableBuilder::Add(const Slice &key, const Slice &value) {
   if (r->pending_index_entry) {
     assert(r->data_block.empty());
     r->options.inner_comparator->FindShortestSeparator(&r->last_key, key);
-    std::string handle_encoding;
-    r->pending_handle.EncodeTo(&handle_encoding);
-    r->index_block.Add(r->last_key, Slice(handle_encoding));
+    AddDataBlockIndexEntry(r->last_key, r->pending_handle);
     r->pending_index_entry = false;
   }
+  if (!r->pending_blocks.empty() && !r->pending_blocks.back()->has_index_key) {
+    PendingBlock *last = r->pending_blocks.back();
+    r->options.inner_comparator->FindShortestSeparator(&last->index_key, key);
+    last->has_index_key = true;
+  }
 
   if (r->filter_block != NULL) {
-    r->filter_block->AddKey(key);
+    if (r->use_pending_blocks) {
+      r->block_keys.append(key.data(), key.size());
+      r->block_key_sizes.push_back(key.size());
+    } else {
+      r->filter_block->AddKey(key);
+    }
   }
 
   r->last_key.assign(key.data(), key.size());
@@ -155,6 +367,11 @@ void TableBuilder::Flush() {
   if (r->data_block.empty())
     return;
   assert(!r->pending_index_entry);
+  if (r->use_pending_blocks) {
+    SubmitBlock();
+    ++r->num_data_blocks;
+    return;
+  }
   WriteBlock(&r->data_block, &r->pending_handle);
   if (ok()) {
     r->pending_index_entry = true;
@@ -168,39 +385,23 @@ void TableBuilder::Flush() {
 }
 
 void TableBuilder::WriteBlock(BlockBuilder *block, BlockHandle *handle) {
+  WriteBlock(block->Finish(), handle);
+  block->Reset();
+}
+
+void TableBuilder::WriteBlock(const Slice &raw, BlockHandle *handle) {
   // File format contains a sequence of blocks where each block has:
   //    block_data: uint8[n]
   //    type: uint8
   //    crc: uint32
   assert(ok());
   Rep *r = rep_;
-  Slice raw = block->Finish();
-
-  Slice block_contents;
-  CompressionType type = r->options.compression;
-  // CompressionType type = kNoCompression;
-  // TODO(postrelease): Support more compression options: zlib?
-  switch (type) {
-  case kNoCompression:
-    block_contents = raw;
-    break;
-  case kSnappyCompression: {
-    std::string *compressed = &r->compressed_output;
-    if (Snappy_Compress(raw.data(), raw.size(), compressed) &&
-        compressed->size() < raw.size() - (raw.size() / 8u)) {
-      block_contents = *compressed;
-    } else {
-      // Snappy not supported, or compressed less than 12.5%, so just
-      // store uncompressed form
-      block_contents = raw;
-      type = kNoCompression;
-    }
-    break;
-  }
-  }
+  CompressionType type =
+      CompressBlock(raw, r->options.compression, &r->compressed_output,
+                    ThreadCompressionContext());
+  Slice block_contents = type == kNoCompression ? raw : r->compressed_output;
   WriteRawBlock(block_contents, type, handle);
   r->compressed_output.clear();
-  block->Reset();
 }
 
 void TableBuilder::WriteRawBlock(const Slice &block_contents,
@@ -212,9 +413,10 @@ void TableBuilder::WriteRawBlock(const Slice &block_contents,
   if (r->status.ok()) {
     char trailer[kBlockTrailerSize];
     trailer[0] = type;
-    uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
-    crc = crc32c::Extend(crc, trailer, 1); // Extend crc to cover block type
-    EncodeFixed32(trailer + 1, crc32c::Mask(crc));
+    EncodeFixed32(trailer + 1,
+                  ComputeBlockChecksum(r->options.checksum,
+                                       block_contents.data(),
+                                       block_contents.size(), type));
     r->status = r->file->Append(Slice(trailer, kBlockTrailerSize));
     if (r->status.ok()) {
       r->offset += block_contents.size() + kBlockTrailerSize;
@@ -222,6 +424,206 @@ void TableBuilder::WriteRawBlock(const Slice &block_contents,
   }
 }
 
+// Add the handle of a block to an index block.  A delta encoded handle is
+// the zigzag encoded size difference with *last_handle: the block starts
+// right after it and its trailer.
+void TableBuilder::AddIndexEntry(BlockBuilder *block, const Slice &key,
+                                 const BlockHandle &handle,
+                                 BlockHandle *last_handle) {
+  std::string handle_encoding;
+  handle.EncodeTo(&handle_encoding);
+  if (!rep_->options.index_value_delta_encoding) {
+    block->Add(key, Slice(handle_encoding));
+  } else {
+    assert(block->empty() ||
+           handle.offset() ==
+               last_handle->offset() + last_handle->size() + kBlockTrailerSize);
+    int64_t delta = static_cast<int64_t>(handle.size()) -
+                    static_cast<int64_t>(last_handle->size());
+    std::string delta_encoding;
+    PutVarint64(&delta_encoding, (static_cast<uint64_t>(delta) << 1) ^
+                                     static_cast<uint64_t>(delta >> 63));
+    block->Add(key, Slice(handle_encoding), Slice(delta_encoding));
+  }
+  *last_handle = handle;
+}
+
+// Index a data block, and seal the index partition once it is full.
+void TableBuilder::AddDataBlockIndexEntry(const Slice &key,
+                                          const BlockHandle &handle) {
+  Rep *r = rep_;
+  AddIndexEntry(&r->index_block, key, handle, &r->last_index_handle);
+  if (r->options.index_type != kTwoLevelIndexSearch) {
+    return;
+  }
+  r->last_index_key.assign(key.data(), key.size());
+  if (r->index_block.CurrentSizeEstimate() >= r->options.metadata_block_size) {
+    r->index_partitions.push_back(
+        std::make_pair(r->last_index_key, r->index_block.Finish().ToString()));
+    r->index_block.Reset();
+  }
+}
+
+// Write the index block, or the index partitions and the top level index
+// of their handles, which is then the index block of the footer.
+void TableBuilder::WriteIndex(BlockHandle *handle) {
+  Rep *r = rep_;
+  if (r->options.index_type != kTwoLevelIndexSearch) {
+    WriteBlock(&r->index_block, handle);
+    return;
+  }
+  if (!r->index_block.empty()) {
+    r->index_partitions.push_back(
+        std::make_pair(r->last_index_key, r->index_block.Finish().ToString()));
+    r->index_block.Reset();
+  }
+  BlockBuilder top_level(&r->index_block_options);
+  BlockHandle partition_handle, last_handle;
+  for (size_t i = 0; ok() && i < r->index_partitions.size(); i++) {
+    WriteBlock(Slice(r->index_partitions[i].second), &partition_handle);
+    if (ok()) {
+      AddIndexEntry(&top_level, r->index_partitions[i].first,
+                    partition_handle, &last_handle);
+    }
+  }
+  if (ok()) {
+    WriteBlock(&top_level, handle);
+  }
+}
+
+void TableBuilder::SubmitBlock() {
+  Rep *r = rep_;
+  PendingBlock *block;
+  if (r->free_blocks.empty()) {
+    block = new PendingBlock;
+  } else {
+    block = r->free_blocks.back();
+    r->free_blocks.pop_back();
+  }
+  Slice raw = r->data_block.Finish();
+  block->raw.assign(raw.data(), raw.size());
+  r->data_block.Reset();
+  block->type = r->options.compression;
+  block->done = false;
+  block->index_key = r->last_key;
+  block->has_index_key = false;
+  block->keys.swap(r->block_keys);
+  block->key_sizes.swap(r->block_key_sizes);
+  r->pending_blocks.push_back(block);
+  if (r->sampling_dict) {
+    if (r->pending_blocks.size() < r->dict_sample_blocks) {
+      return;
+    }
+    TrainCompressionDict();
+  } else if (r->compress_queue != NULL) {
+    r->compress_queue->Push(std::move(block));
+  }
+  WritePendingBlocks(r->max_pending_blocks);
+}
+
+// Train the dictionary on the sampled blocks and hand them over to be
+// compressed with it.
+void TableBuilder::TrainCompressionDict() {
+  Rep *r = rep_;
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  for (size_t i = 0; i < r->pending_blocks.size(); i++) {
+    samples.append(r->pending_blocks[i]->raw);
+    sample_sizes.push_back(r->pending_blocks[i]->raw.size());
+  }
+  std::string dict;
+  if (zstd_train_dict(samples, sample_sizes,
+                      r->options.compression_max_dict_bytes, &dict)) {
+    r->compression_dict = new CompressionDict(dict, kZSTDCompressionLevel);
+  }
+  r->sampling_dict = false;
+  for (size_t i = 0; r->compress_queue != NULL &&
+                     i < r->pending_blocks.size(); i++) {
+    PendingBlock *block = r->pending_blocks[i];
+    r->compress_queue->Push(std::move(block));
+  }
+}
+
+// Write the finished blocks at the head of pending_blocks, waiting for
+// the head to finish while more than "max_pending" blocks are pending.
+void TableBuilder::WritePendingBlocks(size_t max_pending) {
+  Rep *r = rep_;
+  while (!r->pending_blocks.empty()) {
+    PendingBlock *block = r->pending_blocks.front();
+    if (!block->has_index_key) {
+      break;
+    }
+    if (r->compress_queue == NULL) {
+      block->type = CompressBlock(block->raw, block->type, &block->compressed,
+                                  ThreadCompressionContext(),
+                                  r->compression_dict);
+    } else {
+      std::unique_lock<std::mutex> lock(r->compress_mu);
+      if (!block->done) {
+        if (r->pending_blocks.size() <= max_pending) {
+          break;
+        }
+        r->compress_cv.wait(lock, [block] { return block->done; });
+      }
+    }
+    r->pending_blocks.pop_front();
+    if (ok()) {
+      if (r->filter_block != NULL) {
+        const char *key = block->keys.data();
+        for (size_t i = 0; i < block->key_sizes.size(); i++) {
+          r->filter_block->AddKey(Slice(key, block->key_sizes[i]));
+          key += block->key_sizes[i];
+        }
+      }
+      BlockHandle handle;
+      WriteRawBlock(block->type == kNoCompression ? Slice(block->raw)
+                                                  : Slice(block->compressed),
+                    block->type, &handle);
+      if (ok()) {
+        AddDataBlockIndexEntry(block->index_key, handle);
+        r->status = r->file->Flush();
+      }
+      if (r->filter_block != NULL) {
+        r->filter_block->StartBlock(r->offset);
+      }
+      r->data_size += r->offset;
+    }
+    // The swap in SubmitBlock() hands the key buffers back empty.
+    block->keys.clear();
+    block->key_sizes.clear();
+    r->free_blocks.push_back(block);
+  }
+}
+
+void TableBuilder::CompressBlocks() {
+  Rep *r = rep_;
+  PendingBlock *block;
+  CompressionContext *context = ThreadCompressionContext();
+  while (r->compress_queue->Pop(&block)) {
+    // raw keeps its buffer for the next block the PendingBlock is reused
+    // for.
+    CompressionType type = CompressBlock(block->raw, block->type,
+                                         &block->compressed, context,
+                                         r->compression_dict);
+    std::lock_guard<std::mutex> lock(r->compress_mu);
+    block->type = type;
+    block->done = true;
+    r->compress_cv.notify_all();
+  }
+}
+
+void TableBuilder::StopCompressThreads() {
+  Rep *r = rep_;
+  if (r->compress_queue == NULL) {
+    return;
+  }
+  r->compress_queue->Close();
+  for (size_t i = 0; i < r->compress_threads.size(); i++) {
+    r->compress_threads[i].join();
+  }
+  r->compress_threads.clear();
+}
+
 Status TableBuilder::status() const { return rep_->status; }
 
 Status TableBuilder::Finish(uint64_t creation_time, uint64_t oldest_key_time) {
@@ -230,21 +632,60 @@ Status TableBuilder::Finish(uint64_t creation_time, uint64_t oldest_key_time) {
   assert(!r->closed);
   r->closed = true;
 
+  if (r->sampling_dict) {
+    // Fewer data blocks than samples wanted, train on them all.
+    TrainCompressionDict();
+  }
+  if (!r->pending_blocks.empty()) {
+    PendingBlock *last = r->pending_blocks.back();
+    if (!last->has_index_key) {
+      r->options.inner_comparator->FindShortSuccessor(&last->index_key);
+      last->has_index_key = true;
+    }
+    WritePendingBlocks(0);
+  }
+  StopCompressThreads();
+
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle,
-      prop_block_handle;
+      prop_block_handle, dict_block_handle;
+  uint64_t index_size = 0;
 
   // Write filter block
   if (ok() && r->filter_block != NULL) {
     WriteRawBlock(r->filter_block->Finish(), kNoCompression,
                   &filter_block_handle);
   }
+  // Write index block, before the properties that record its size
+  if (ok()) {
+    if (r->pending_index_entry) {
+      r->options.inner_comparator->FindShortSuccessor(&r->last_key);
+      AddDataBlockIndexEntry(r->last_key, r->pending_handle);
+      r->pending_index_entry = false;
+    }
+    uint64_t index_offset = r->offset;
+    WriteIndex(&index_block_handle);
+    index_size = r->offset - index_offset;
+  }
+  // Write the dictionary raw, as RocksDB does
+  if (ok() && r->compression_dict != NULL) {
+    WriteRawBlock(r->compression_dict->raw(), kNoCompression,
+                  &dict_block_handle);
+  }
   if (ok() && r->prop_block != NULL) {
     TableProperties props;
     props.column_family_name = r->columnfamily_name;
     props.column_family_id = r->columnfamily_id;
     props.compression_name = CompressionTypeToString(r->options.compression);
     props.merge_operator_name = "nullptr";
-    props.comparator_name = "nullptr";
+    // Name the order of the user keys, so readers that merge tables can
+    // tell how they are sorted.
+    const Comparator *user_comparator = r->options.inner_comparator;
+    const InternalKeyComparator *internal_comparator =
+        dynamic_cast<const InternalKeyComparator *>(user_comparator);
+    if (internal_comparator != NULL) {
+      user_comparator = internal_comparator->user_comparator();
+    }
+    props.comparator_name = user_comparator->Name();
     props.raw_key_size = r->raw_key_size;
     props.raw_value_size = r->raw_value_size;
     props.num_entries = r->num_entries;
@@ -252,6 +693,13 @@ Status TableBuilder::Finish(uint64_t creation_time, uint64_t oldest_key_time) {
     props.data_size = r->data_size;
     props.creation_time = creation_time;
     props.oldest_key_time = oldest_key_time;
+    props.index_size = index_size;
+    if (r->options.index_type == kTwoLevelIndexSearch) {
+      props.index_partitions = r->index_partitions.size();
+      props.top_level_index_size = index_block_handle.size();
+    }
+    props.index_value_is_delta_encoded = r->options.index_value_delta_encoding;
+    r->prop_block->Fixed32Add(sIndexType, r->options.index_type);
     r->prop_block->AddTableProperty(props);
     WriteRawBlock(r->prop_block->ProperityBlockFinish(), kNoCompression,
                   &prop_block_handle);
@@ -260,13 +708,19 @@ Status TableBuilder::Finish(uint64_t creation_time, uint64_t oldest_key_time) {
   if (ok()) {
     BlockBuilder meta_index_block(&r->options);
     if (r->filter_block != NULL) {
-      // Add mapping from "filter.Name" to location of filter data
-      std::string key = "filter.";
+      // Add mapping from "filter.Name" or "fullfilter.Name" to location of
+      // filter data
+      std::string key = r->filter_block->is_full() ? "fullfilter." : "filter.";
       key.append(r->options.filter_policy->Name());
       std::string handle_encoding;
       filter_block_handle.EncodeTo(&handle_encoding);
       meta_index_block.Add(key, handle_encoding);
     }
+    if (r->compression_dict != NULL) {
+      std::string dict_handle_encoding;
+      dict_block_handle.EncodeTo(&dict_handle_encoding);
+      meta_index_block.Add(sCompressionDictBlock, dict_handle_encoding);
+    }
     if (r->prop_block != NULL) {
       std::string prop_handle_encoding;
       prop_block_handle.EncodeTo(&prop_handle_encoding);
@@ -276,21 +730,10 @@ Status TableBuilder::Finish(uint64_t creation_time, uint64_t oldest_key_time) {
     WriteBlock(&meta_index_block, &metaindex_block_handle);
   }
 
-  // Write index block
-  if (ok()) {
-    if (r->pending_index_entry) {
-      r->options.inner_comparator->FindShortSuccessor(&r->last_key);
-      std::string handle_encoding;
-      r->pending_handle.EncodeTo(&handle_encoding);
-      r->index_block.Add(r->last_key, Slice(handle_encoding));
-      r->pending_index_entry = false;
-    }
-    WriteBlock(&r->index_block, &index_block_handle);
-  }
-
   // Write footer
   if (ok()) {
     Footer footer;
+    footer.set_checksum(r->options.checksum);
     footer.set_metaindex_handle(metaindex_block_handle);
     footer.set_index_handle(index_block_handle);
     std::string footer_encoding;
@@ -307,11 +750,16 @@ void TableBuilder::Abandon() {
   Rep *r = rep_;
   assert(!r->closed);
   r->closed = true;
+  StopCompressThreads();
+  while (!r->pending_blocks.empty()) {
+    delete r->pending_blocks.front();
+    r->pending_blocks.pop_front();
+  }
 }
 
 uint64_t TableBuilder::NumEntries() const { return rep_->num_entries; }
 
 uint64_t TableBuilder::FileSize() const { return rep_->offset; }
 
-uint64_t TableBuilder::CurFileSize() const { return rep_->raw_value_size + rep_->raw_value_size;}
+uint64_t TableBuilder::CurFileSize() const { return rep_->raw_key_size + rep_->raw_value_size;}
 } // namespace shannon
@@ -12,6 +12,19 @@ class BlockBuilder;
 class BlockHandle;
 class WritableFile;
 
+// The checksum stored in the trailer of a block of n bytes followed by
+// its compression type, as RocksDB computes it.
+extern uint32_t ComputeBlockChecksum(ChecksumType type, const char *data,
+                                     size_t n, char block_type);
+
+// Builds an SST file from keys added in order.  When
+// options.compression_parallel_threads > 1 and a compression type is set,
+// sealed data blocks are compressed by a pool of threads owned by the
+// builder and written to the file in the order they were sealed; at most
+// options.compression_max_pending_blocks blocks are held in memory.  With
+// options.compression_max_dict_bytes and ZSTD, data blocks are compressed
+// with a dictionary trained on the first ones.  options.index_type
+// selects a binary search, hash or partitioned index.
 class TableBuilder {
 public:
   TableBuilder(const Options &options, WritableFile *file);
@@ -32,15 +45,34 @@ public:
 
   uint64_t NumEntries() const;
 
+  // Bytes written to the file so far.  With parallel compression the
+  // blocks still being compressed are not included.
   uint64_t FileSize() const;
 
+  // Raw size of the keys and values added so far.
   uint64_t CurFileSize() const;
 private:
+  struct PendingBlock;
+
   bool ok() const { return status().ok(); }
   void WriteBlock(BlockBuilder *block, BlockHandle *handle);
+  void WriteBlock(const Slice &raw, BlockHandle *handle);
   void WritePropertiesBlock(BlockBuilder *block, BlockHandle *handle);
   void WriteRawBlock(const Slice &data, CompressionType, BlockHandle *handle);
 
+  // Index, in partitions with a kTwoLevelIndexSearch index_type.
+  void AddIndexEntry(BlockBuilder *block, const Slice &key,
+                     const BlockHandle &handle, BlockHandle *last_handle);
+  void AddDataBlockIndexEntry(const Slice &key, const BlockHandle &handle);
+  void WriteIndex(BlockHandle *handle);
+
+  // Parallel compression.
+  void SubmitBlock();
+  void WritePendingBlocks(size_t max_pending);
+  void CompressBlocks();
+  void StopCompressThreads();
+  void TrainCompressionDict();
+
   struct Rep;
   Rep *rep_;
 
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../util/arena.h"
+#include "../util/concurrent_arena.h"
+#include "../util/random.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+static const size_t kAlign = sizeof(void *) > 8 ? sizeof(void *) : 8;
+
+// Fill each allocation with a byte of its own, and check none was
+// overwritten by another once all are made.
+template <typename A>
+static void FillAndCheck(A *arena, Random *rnd, int n, size_t max_size) {
+  vector<pair<char *, size_t> > allocated;
+  for (int i = 0; i < n; i++) {
+    size_t size = rnd->Uniform(max_size) + 1;
+    bool aligned = rnd->OneIn(2);
+    char *p = aligned ? arena->AllocateAligned(size) : arena->Allocate(size);
+    if (aligned) {
+      CheckCondition(reinterpret_cast<uintptr_t>(p) % kAlign == 0);
+    }
+    memset(p, i % 256, size);
+    allocated.push_back(make_pair(p, size));
+  }
+  for (size_t i = 0; i < allocated.size(); i++) {
+    for (size_t j = 0; j < allocated[i].second; j++) {
+      CheckCondition((allocated[i].first[j] & 0xff) == static_cast<int>(i % 256));
+    }
+  }
+}
+
+static void TestArena(size_t block_size, size_t huge_page_size) {
+  phase = "arena";
+  Random rnd(301);
+  Arena arena(block_size, huge_page_size);
+  CheckCondition(arena.BlockSize() >= Arena::kMinBlockSize);
+  CheckCondition(arena.BlockSize() % kAlign == 0);
+  CheckCondition(arena.MemoryUsage() == 0);
+  size_t bytes = 0;
+  for (int i = 0; i < 10000; i++) {
+    size_t size = rnd.Uniform(100) + 1;
+    arena.Allocate(size);
+    bytes += size;
+    CheckCondition(arena.MemoryUsage() >= bytes + arena.AllocatedAndUnused());
+  }
+  // Blocks are mostly used up, a quarter of a block at most is wasted.
+  CheckCondition(arena.MemoryUsage() <
+                 bytes + bytes / 4 + arena.AllocatedAndUnused() +
+                     arena.BlockSize() + 4096);
+  CheckCondition(arena.HugePageUsage() <= arena.MemoryUsage());
+  if (huge_page_size == 0) {
+    CheckCondition(arena.HugePageUsage() == 0);
+  } else {
+    // Huge pages or not, the blocks are mmap()ed in huge page units.
+    CheckCondition(arena.HugePageUsage() > 0);
+    CheckCondition(arena.HugePageUsage() % huge_page_size == 0);
+  }
+  FillAndCheck(&arena, &rnd, 2000, 3 * arena.BlockSize() / 4);
+}
+
+static void TestConcurrentArena(int num_threads) {
+  phase = "concurrent arena";
+  ConcurrentArena arena;
+  vector<thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.push_back(thread([&arena, t]() {
+      Random rnd(301 + t);
+      FillAndCheck(&arena, &rnd, 5000, 200);
+      FillAndCheck(&arena, &rnd, 50, 20000);
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); t++) {
+    threads[t].join();
+  }
+  CheckCondition(arena.MemoryUsage() > 0);
+  CheckCondition(arena.AllocatedAndUnused() < arena.MemoryUsage());
+  CheckCondition(arena.HugePageUsage() == 0);
+}
+
+int main() {
+  TestArena(0, 0);
+  TestArena(4096, 0);
+  TestArena(100000, 0);
+  TestArena(1 << 20, 2 << 20);
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    TestConcurrentArena(threads);
+  }
+  fprintf(stderr, "PASS\n");
+  return 0;
+}
@@ -0,0 +1,125 @@
+// Build and probe times of the block-based and the full Bloom filter over
+// the same keys, with the per-block filters as the table writes them, one
+// for every 2KB of data.  Keys are probed in random order, as point lookups
+// would.
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include "swift/filter_policy.h"
+#include "swift/slice.h"
+#include "../util/coding.h"
+#include "../util/random.h"
+
+using namespace shannon;
+using namespace std;
+
+static uint64_t NowMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+// Keys are made as they are probed, so the probes do not wait on memory
+// for them.
+static Slice Key(uint64_t i, char *buffer) {
+  EncodeFixed64(buffer, i * 0x9e3779b97f4a7c15ull);
+  EncodeFixed64(buffer + 8, i);
+  return Slice(buffer, 16);
+}
+
+int main(int argc, char **argv) {
+  const int num_keys = argc > 1 ? atoi(argv[1]) : 1000000;
+  const int keys_per_block = 20; // About 2KB of 100 byte values
+  const int bits_per_key = 10;
+  char buffer[16];
+  vector<int> order(num_keys);
+  Random rnd(301);
+  for (int i = 0; i < num_keys; i++) {
+    order[i] = i;
+    swap(order[i], order[rnd.Uniform(i + 1)]);
+  }
+  printf("%d keys, %d bits per key\n", num_keys, bits_per_key);
+  printf("%-12s %12s %12s %12s %10s\n", "filter", "build ns", "hit ns",
+         "miss ns", "fp %");
+
+  // Block-based: one filter per block, each probe reads its own filter.
+  {
+    const FilterPolicy *policy = NewBloomFilterPolicy(bits_per_key);
+    uint64_t start = NowMicros();
+    string filters;
+    vector<uint32_t> offsets;
+    char block_buffer[keys_per_block][16];
+    vector<Slice> block_keys;
+    for (int i = 0; i < num_keys; i += keys_per_block) {
+      block_keys.clear();
+      for (int j = i; j < num_keys && j < i + keys_per_block; j++) {
+        block_keys.push_back(Key(j * 2, block_buffer[j - i]));
+      }
+      offsets.push_back(filters.size());
+      policy->CreateFilter(&block_keys[0], block_keys.size(), &filters);
+    }
+    offsets.push_back(filters.size());
+    uint64_t build = NowMicros() - start;
+
+    int hits = 0;
+    start = NowMicros();
+    for (int n = 0; n < num_keys; n++) {
+      int i = order[n];
+      int b = i / keys_per_block;
+      Slice filter(filters.data() + offsets[b], offsets[b + 1] - offsets[b]);
+      hits += policy->KeyMayMatch(Key(i * 2, buffer), filter);
+    }
+    uint64_t hit = NowMicros() - start;
+    int false_positives = 0;
+    start = NowMicros();
+    for (int n = 0; n < num_keys; n++) {
+      int i = order[n];
+      int b = i / keys_per_block;
+      Slice filter(filters.data() + offsets[b], offsets[b + 1] - offsets[b]);
+      false_positives += policy->KeyMayMatch(Key(i * 2 + 1, buffer), filter);
+    }
+    uint64_t miss = NowMicros() - start;
+    printf("%-12s %12.1f %12.1f %12.1f %10.2f  (%d)\n", "block-based",
+           build * 1000.0 / num_keys, hit * 1000.0 / num_keys,
+           miss * 1000.0 / num_keys, false_positives * 100.0 / num_keys, hits);
+    delete policy;
+  }
+
+  // Full: one filter for all the keys.
+  {
+    const FilterPolicy *policy = NewBloomFilterPolicy(bits_per_key, false);
+    uint64_t start = NowMicros();
+    FilterBitsBuilder *builder = policy->GetFilterBitsBuilder();
+    for (int i = 0; i < num_keys; i++) {
+      builder->AddKey(Key(i * 2, buffer));
+    }
+    string filter;
+    builder->Finish(&filter);
+    delete builder;
+    uint64_t build = NowMicros() - start;
+
+    FilterBitsReader *reader = policy->GetFilterBitsReader(filter);
+    int hits = 0;
+    start = NowMicros();
+    for (int n = 0; n < num_keys; n++) {
+      int i = order[n];
+      hits += reader->MayMatch(Key(i * 2, buffer));
+    }
+    uint64_t hit = NowMicros() - start;
+    int false_positives = 0;
+    start = NowMicros();
+    for (int n = 0; n < num_keys; n++) {
+      int i = order[n];
+      false_positives += reader->MayMatch(Key(i * 2 + 1, buffer));
+    }
+    uint64_t miss = NowMicros() - start;
+    printf("%-12s %12.1f %12.1f %12.1f %10.2f  (%d)\n", "full",
+           build * 1000.0 / num_keys, hit * 1000.0 / num_keys,
+           miss * 1000.0 / num_keys, false_positives * 100.0 / num_keys, hits);
+    delete reader;
+    delete policy;
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "swift/filter_policy.h"
+#include "swift/slice.h"
+#include "../util/coding.h"
+#include "../util/hash.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+static string Key(int i, char *buffer) {
+  EncodeFixed32(buffer, i);
+  return string(buffer, sizeof(uint32_t));
+}
+
+static string BuildFullFilter(const FilterPolicy *policy, int n) {
+  FilterBitsBuilder *builder = policy->GetFilterBitsBuilder();
+  CheckCondition(builder != NULL);
+  char buffer[sizeof(uint32_t)];
+  for (int i = 0; i < n; i++) {
+    builder->AddKey(Key(i, buffer));
+  }
+  string filter;
+  builder->Finish(&filter);
+  delete builder;
+  return filter;
+}
+
+// How RocksDB probes a full filter of format_version < 5, bit by bit.
+static bool RocksDBMayMatch(const string &filter, const Slice &key) {
+  if (filter.size() <= 5) {
+    return false;
+  }
+  const size_t bytes = filter.size() - 5;
+  const int num_probes = filter[bytes];
+  const uint32_t num_lines = DecodeFixed32(filter.data() + bytes + 1);
+  const uint32_t line_bits = bytes / num_lines * 8;
+  uint32_t h = BloomHash(key);
+  const uint32_t delta = (h >> 17) | (h << 15);
+  const char *line = filter.data() + (h % num_lines) * (line_bits / 8);
+  for (int i = 0; i < num_probes; i++) {
+    const uint32_t bitpos = h % line_bits;
+    if ((line[bitpos / 8] & (1 << (bitpos % 8))) == 0) {
+      return false;
+    }
+    h += delta;
+  }
+  return true;
+}
+
+static void TestEmptyFilter() {
+  phase = "empty filter";
+  const FilterPolicy *policy = NewBloomFilterPolicy(10, false);
+  string filter = BuildFullFilter(policy, 0);
+  CheckCondition(filter.size() == 5);
+  FilterBitsReader *reader = policy->GetFilterBitsReader(filter);
+  CheckCondition(!reader->MayMatch("hello"));
+  CheckCondition(!reader->MayMatch(""));
+  delete reader;
+  delete policy;
+}
+
+static void TestFullFilter() {
+  phase = "full filter";
+  const FilterPolicy *policy = NewBloomFilterPolicy(10, false);
+  CheckCondition(string(policy->Name()) == "rocksdb.BuiltinBloomFilter");
+  char buffer[sizeof(uint32_t)];
+  for (int n = 1; n <= 100000; n *= 10) {
+    string filter = BuildFullFilter(policy, n);
+    // Odd number of whole cache lines, then the metadata.
+    CheckCondition((filter.size() - 5) % 64 == 0);
+    CheckCondition(((filter.size() - 5) / 64) % 2 == 1);
+    CheckCondition(filter[filter.size() - 5] == 6);
+    FilterBitsReader *reader = policy->GetFilterBitsReader(filter);
+    for (int i = 0; i < n; i++) {
+      CheckCondition(reader->MayMatch(Key(i, buffer)));
+    }
+    int false_positives = 0;
+    for (int i = 0; i < 10000; i++) {
+      if (reader->MayMatch(Key(i + 1000000000, buffer))) {
+        false_positives++;
+      }
+    }
+    // About 1% for 10 bits per key, more for tables of a few keys.
+    CheckCondition(false_positives < (n < 1000 ? 500 : 200));
+    delete reader;
+  }
+  delete policy;
+}
+
+// Every number of probes, which the SIMD probing handles in chunks of
+// eight, answers as RocksDB would.
+static void TestRocksDBProbes() {
+  phase = "rocksdb probes";
+  char buffer[sizeof(uint32_t)];
+  for (int bits_per_key = 1; bits_per_key <= 45; bits_per_key++) {
+    const FilterPolicy *policy = NewBloomFilterPolicy(bits_per_key, false);
+    string filter = BuildFullFilter(policy, 3000);
+    FilterBitsReader *reader = policy->GetFilterBitsReader(filter);
+    for (int i = 0; i < 20000; i++) {
+      string key = Key(i * 7, buffer);
+      CheckCondition(reader->MayMatch(key) == RocksDBMayMatch(filter, key));
+    }
+    delete reader;
+    delete policy;
+  }
+}
+
+// Lines of another size are read bit by bit, unknown formats match all.
+static void TestOtherLayouts() {
+  phase = "other layouts";
+  const FilterPolicy *policy = NewBloomFilterPolicy(10, false);
+  char buffer[sizeof(uint32_t)];
+  string filter(3 * 128, '\0');
+  FilterBitsReader *reader;
+  for (int i = 0; i < 100; i++) {
+    // Set the probes of key i by hand in lines of 128 bytes.
+    uint32_t h = BloomHash(Key(i, buffer));
+    const uint32_t delta = (h >> 17) | (h << 15);
+    char *line = &filter[(h % 3) * 128];
+    for (int j = 0; j < 6; j++) {
+      line[(h % 1024) / 8] |= 1 << (h % 8);
+      h += delta;
+    }
+  }
+  filter.push_back(6);
+  PutFixed32(&filter, 3);
+  reader = policy->GetFilterBitsReader(filter);
+  for (int i = 0; i < 100; i++) {
+    CheckCondition(reader->MayMatch(Key(i, buffer)));
+  }
+  delete reader;
+
+  filter = BuildFullFilter(policy, 100);
+  filter[filter.size() - 5] = static_cast<char>(-1); // A newer format
+  reader = policy->GetFilterBitsReader(filter);
+  CheckCondition(reader->MayMatch("not added"));
+  delete reader;
+  delete policy;
+}
+
+static void TestBlockBasedPolicy() {
+  phase = "block based policy";
+  const FilterPolicy *policy = NewBloomFilterPolicy(10);
+  CheckCondition(string(policy->Name()) == "leveldb.BuiltinBloomFilter2");
+  CheckCondition(policy->GetFilterBitsBuilder() == NULL);
+  delete policy;
+}
+
+int main() {
+  TestEmptyFilter();
+  TestFullFilter();
+  TestRocksDBProbes();
+  TestOtherLayouts();
+  TestBlockBasedPolicy();
+  std::cout << "bloom test pass." << std::endl;
+  return 0;
+}
@@ -0,0 +1,183 @@
+// The C decoder of shannon_db (shannon_db/sst_table/blocks.c) must read
+// the SST files TableBuilder writes record for record.
+
+extern "C" {
+#include "../shannon_db/sst_table/sst_table.h"
+}
+// util.h of the C library is not meant for C++, drop its macros before
+// any C++ header sees them.
+#undef bool
+#undef true
+#undef false
+#undef max
+#undef min
+#undef DEBUG
+#undef DEBUG_CONFIG
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "swift/comparator.h"
+#include "swift/env.h"
+#include "swift/options.h"
+#include "../table/dbformat.h"
+#include "../table/table_builder.h"
+
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+static char kFileName[] = "/tmp/c_sst_decode_test.sst";
+
+// A record as written, or as decoded with the data block it was in.
+struct Record {
+  string user_key;
+  uint64_t sequence;
+  uint32_t type;
+  string value;
+  uint32_t block;
+};
+
+// Versions of a user key follow each other, newest first, with deletions
+// and empty values among them.  Returns how many blocks were cut right
+// after an empty value.
+static int BuildFile(shannon::CompressionType compression,
+                     vector<Record> *records) {
+  shannon::InternalKeyComparator comparator(shannon::BytewiseComparator());
+  shannon::Options options;
+  options.compression = compression;
+  options.block_size = 512;
+  options.block_restart_interval = 4;
+  options.inner_comparator = &comparator;
+  shannon::Env *env = shannon::Env::Default();
+  env->DeleteFile(kFileName);
+  shannon::WritableFile *file;
+  CheckCondition(env->NewWritableFile(kFileName, &file).ok());
+  shannon::TableBuilder builder(options, file, "default", 0);
+  int empty_block_ends = 0;
+  for (int u = 0; u < 500; u++) {
+    char user_key[32];
+    snprintf(user_key, sizeof(user_key), "user_key_%06d", u);
+    int versions = 1 + u % 5;
+    for (int v = 0; v <= versions; v++) {
+      Record r;
+      r.sequence = 100000 - u * 10 - v;
+      r.type = (u + v) % 7 == 3 ? KTYPE_DELETION : KTYPE_VALUE;
+      if (v == versions) {
+        // End some blocks with an empty value.
+        if (u % 17 != 16) {
+          break;
+        }
+        r.type = KTYPE_VALUE;
+      } else if (r.type == KTYPE_VALUE && (u + v) % 11 != 0) {
+        r.value.assign((u * 13 + v) % 60, 'a' + (u + v) % 26);
+      }
+      r.user_key = user_key;
+      string key;
+      shannon::AppendInternalKey(
+          &key, shannon::ParsedInternalKey(
+                    r.user_key, r.sequence,
+                    static_cast<shannon::ValueType>(r.type)));
+      builder.Add(key, r.value);
+      records->push_back(r);
+      if (v == versions) {
+        builder.Flush();
+        empty_block_ends++;
+      }
+    }
+  }
+  CheckCondition(builder.Finish(1, 2).ok());
+  CheckCondition(file->Sync().ok());
+  CheckCondition(file->Close().ok());
+  delete file;
+  return empty_block_ends;
+}
+
+struct DecodeTarget {
+  block_rep_t *index_rep;
+  vector<Record> records;
+};
+
+static int CollectKv(void *arg, kv_node_t *kv) {
+  DecodeTarget *target = static_cast<DecodeTarget *>(arg);
+  Record r;
+  r.user_key.assign(kv->key, kv->key_len);
+  r.sequence = kv->sequence;
+  r.type = kv->type;
+  if (kv->value != NULL) {
+    r.value.assign(kv->value, kv->value_len);
+  }
+  // Counts the data blocks decoded before this one.
+  r.block = target->index_rep->data_block_count;
+  target->records.push_back(r);
+  return KOK;
+}
+
+static void TestDecode(shannon::CompressionType compression) {
+  phase = compression == shannon::kNoCompression ? "uncompressed"
+                                                  : "snappy";
+  vector<Record> written;
+  int empty_block_ends = BuildFile(compression, &written);
+
+  calculate_little_endian();
+  slice_t foot_content, input;
+  CheckCondition(read_foot(&foot_content, kFileName) == KOK);
+  set_slice(&input, foot_content.data, foot_content.size);
+  foot_t foot;
+  CheckCondition(foot_decode_from(&foot, &input, 1) == KOK);
+  free(foot_content.data);
+  meta_block_properties_t props;
+  memset(&props, 0, sizeof(props));
+  CheckCondition(process_meta_index(kFileName, &props, &foot) == KOK);
+  CheckCondition(string(props.cf_name) == "default");
+  CheckCondition(props.index_type == KBINARY_SEARCH);
+
+  block_rep_t rep;
+  memset(&rep, 0, sizeof(rep));
+  DecodeTarget target;
+  target.index_rep = &rep;
+  rep.filename = kFileName;
+  rep.checksum_type = foot.checksum_type;
+  rep.kv_handler = CollectKv;
+  rep.kv_handler_arg = &target;
+  CheckCondition(read_block(&rep.block, kFileName, &foot.index_handle,
+                            foot.checksum_type) == KOK);
+  CheckCondition(decode_index_block(&rep) == KOK);
+
+  const vector<Record> &decoded = target.records;
+  CheckCondition(decoded.size() == written.size());
+  int empty_at_block_end = 0;
+  for (size_t i = 0; i < decoded.size(); i++) {
+    CheckCondition(decoded[i].user_key == written[i].user_key);
+    CheckCondition(decoded[i].sequence == written[i].sequence);
+    CheckCondition(decoded[i].type == written[i].type);
+    CheckCondition(decoded[i].value == written[i].value);
+    bool block_end = i + 1 == decoded.size() ||
+                     decoded[i + 1].block != decoded[i].block;
+    if (block_end && decoded[i].type == KTYPE_VALUE &&
+        decoded[i].value.empty()) {
+      empty_at_block_end++;
+    }
+  }
+  CheckCondition(rep.data_block_count > (uint32_t)empty_block_ends);
+  CheckCondition(empty_at_block_end >= empty_block_ends);
+
+  free(rep.block.data);
+  free(rep.restart_offset);
+  free(rep.data_key_scratch.data);
+  shannon::Env::Default()->DeleteFile(kFileName);
+}
+
+int main() {
+  TestDecode(shannon::kNoCompression);
+  TestDecode(shannon::kSnappyCompression);
+  std::cout << "c sst decode test pass." << std::endl;
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <assert.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <swift/shannon_db.h>
+#include <swift/checkpoint.h>
+
+using namespace std;
+using namespace shannon;
+
+#define DEBUG(format, arg...) \
+  printf("%s(), line=%d: " format, __FUNCTION__, __LINE__, ##arg)
+
+int main(int argc, char *argv[]) {
+  string device = "/dev/kvdev0";
+  string dbname = "checkpoint_test";
+  DB *db;
+  Checkpoint *checkpoint;
+  Options options;
+  Status s;
+  string value;
+  uint64_t timestamp;
+  vector<uint64_t> timestamps;
+
+  if (argc > 1)
+    device = argv[1];
+  options.create_if_missing = true;
+  s = DB::Open(options, dbname, device, &db);
+  assert(s.ok());
+  s = Checkpoint::Create(db, &checkpoint);
+  assert(s.ok());
+
+  s = db->Put(WriteOptions(), "key", "old");
+  assert(s.ok());
+  s = checkpoint->CreateCheckpoint(&timestamp);
+  assert(s.ok());
+  DEBUG("create checkpoint timestamp=%lu\n", timestamp);
+  s = db->Put(WriteOptions(), "key", "new");
+  assert(s.ok());
+  s = db->Put(WriteOptions(), "key2", "after");
+  assert(s.ok());
+
+  s = checkpoint->ListCheckpoints(&timestamps);
+  assert(s.ok());
+  assert(timestamps.size() >= 1);
+  assert(timestamps.back() == timestamp);
+
+  // read through a view of the checkpoint
+  const Snapshot *view = NULL;
+  ReadOptions read_options;
+  s = checkpoint->GetView(timestamp, &view);
+  assert(s.ok());
+  read_options.snapshot = view;
+  s = db->Get(read_options, "key", &value);
+  assert(s.ok() && value == "old");
+  s = db->Get(read_options, "key2", &value);
+  assert(s.IsNotFound());
+  s = db->Get(ReadOptions(), "key", &value);
+  assert(s.ok() && value == "new");
+  checkpoint->ReleaseView(view);
+
+  // iterate the checkpoint
+  Iterator *iter = NULL;
+  int count = 0;
+  s = checkpoint->NewIterator(ReadOptions(), db->DefaultColumnFamily(),
+                              timestamp, &iter);
+  assert(s.ok());
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    assert(iter->key() != Slice("key2"));
+    count++;
+  }
+  assert(count >= 1);
+  delete iter;
+
+  s = checkpoint->ReleaseCheckpoint(timestamp);
+  assert(s.ok());
+  s = checkpoint->GetView(timestamp, &view);
+  assert(s.IsNotFound());
+
+  delete checkpoint;
+  delete db;
+  s = DestroyDB(device, dbname, options);
+  assert(s.ok());
+  cout << "checkpoint test pass." << endl;
+  return 0;
+}
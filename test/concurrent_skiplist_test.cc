@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+#include "../util/arena.h"
+#include "../util/concurrent_arena.h"
+#include "../util/concurrent_skiplist.h"
+#include "../util/random.h"
+#include "../util/skiplist.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+typedef uint64_t Key;
+
+struct TestComparator {
+  int operator()(const Key &a, const Key &b) const {
+    if (a < b) {
+      return -1;
+    } else if (a > b) {
+      return +1;
+    } else {
+      return 0;
+    }
+  }
+};
+
+typedef ConcurrentSkipList<Key, TestComparator> TestList;
+
+// Keys of thread t, some of them also inserted by other threads.
+static vector<Key> ThreadKeys(int t, int n, uint64_t range) {
+  Random rnd(301 + t);
+  vector<Key> keys(n);
+  for (int i = 0; i < n; i++) {
+    keys[i] = rnd.Next() % range + 1;
+  }
+  return keys;
+}
+
+// The same keys, inserted single threaded into a ConcurrentSkipList and a
+// SkipList, are seen in the same order by every iterator operation.
+static void TestSameAsSkipList() {
+  phase = "same as SkipList";
+  const int n = 5000;
+  Random rnd(1000);
+  TestComparator cmp;
+  Arena arena;
+  SkipList<Key, TestComparator> list(cmp, &arena);
+  ConcurrentArena concurrent_arena;
+  TestList concurrent_list(cmp, &concurrent_arena);
+  set<Key> keys;
+  for (int i = 0; i < n; i++) {
+    Key key = rnd.Next() % 20000 + 1;
+    bool inserted = keys.insert(key).second;
+    if (inserted) {
+      list.Insert(key);
+    }
+    CheckCondition(concurrent_list.Insert(key) == inserted);
+  }
+  CheckCondition(concurrent_arena.MemoryUsage() > 0);
+
+  SkipList<Key, TestComparator>::Iterator iter(&list);
+  TestList::Iterator concurrent_iter(&concurrent_list);
+  iter.SeekToFirst();
+  concurrent_iter.SeekToFirst();
+  while (iter.Valid()) {
+    CheckCondition(concurrent_iter.Valid());
+    CheckCondition(iter.key() == concurrent_iter.key());
+    iter.Next();
+    concurrent_iter.Next();
+  }
+  CheckCondition(!concurrent_iter.Valid());
+
+  iter.SeekToLast();
+  concurrent_iter.SeekToLast();
+  while (iter.Valid()) {
+    CheckCondition(concurrent_iter.Valid());
+    CheckCondition(iter.key() == concurrent_iter.key());
+    iter.Prev();
+    concurrent_iter.Prev();
+  }
+  CheckCondition(!concurrent_iter.Valid());
+
+  for (Key target = 0; target <= 20001; target += 7) {
+    iter.Seek(target);
+    concurrent_iter.Seek(target);
+    CheckCondition(iter.Valid() == concurrent_iter.Valid());
+    if (iter.Valid()) {
+      CheckCondition(iter.key() == concurrent_iter.key());
+    }
+    iter.SeekForPrev(target);
+    concurrent_iter.SeekForPrev(target);
+    CheckCondition(iter.Valid() == concurrent_iter.Valid());
+    if (iter.Valid()) {
+      CheckCondition(iter.key() == concurrent_iter.key());
+    }
+    CheckCondition(list.Contains(target) == concurrent_list.Contains(target));
+  }
+}
+
+// Threads insert overlapping keys at once while readers scan the list.
+// Each key is inserted by exactly one thread, readers always see sorted
+// keys, and afterwards the list holds exactly the union of the keys.
+static void TestConcurrentInsert(int num_threads, uint64_t range) {
+  phase = "concurrent insert";
+  const int n = 20000;
+  TestComparator cmp;
+  ConcurrentArena arena;
+  TestList list(cmp, &arena);
+  atomic<int> inserted(0);
+  atomic<bool> done(false);
+
+  vector<thread> readers;
+  for (int r = 0; r < 2; r++) {
+    readers.push_back(thread([&list, &done]() {
+      while (!done.load()) {
+        TestList::Iterator iter(&list);
+        Key last = 0;
+        for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+          CheckCondition(iter.key() > last);
+          last = iter.key();
+        }
+      }
+    }));
+  }
+  vector<thread> writers;
+  for (int t = 0; t < num_threads; t++) {
+    writers.push_back(thread([&list, &inserted, t, n, range]() {
+      vector<Key> keys = ThreadKeys(t, n, range);
+      int count = 0;
+      for (size_t i = 0; i < keys.size(); i++) {
+        count += list.Insert(keys[i]);
+        CheckCondition(list.Contains(keys[i]));
+      }
+      inserted += count;
+    }));
+  }
+  for (size_t t = 0; t < writers.size(); t++) {
+    writers[t].join();
+  }
+  done = true;
+  for (size_t r = 0; r < readers.size(); r++) {
+    readers[r].join();
+  }
+
+  set<Key> expected;
+  for (int t = 0; t < num_threads; t++) {
+    vector<Key> keys = ThreadKeys(t, n, range);
+    expected.insert(keys.begin(), keys.end());
+  }
+  CheckCondition(static_cast<size_t>(inserted.load()) == expected.size());
+  TestList::Iterator iter(&list);
+  iter.SeekToFirst();
+  for (set<Key>::iterator it = expected.begin(); it != expected.end(); ++it) {
+    CheckCondition(iter.Valid());
+    CheckCondition(iter.key() == *it);
+    iter.Next();
+  }
+  CheckCondition(!iter.Valid());
+  for (set<Key>::reverse_iterator it = expected.rbegin();
+       it != expected.rend(); ++it) {
+    if (it == expected.rbegin()) {
+      iter.SeekToLast();
+    } else {
+      iter.Prev();
+    }
+    CheckCondition(iter.Valid());
+    CheckCondition(iter.key() == *it);
+  }
+}
+
+int main() {
+  TestSameAsSkipList();
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    // Mostly distinct keys, then keys most threads insert.
+    TestConcurrentInsert(threads, 1ull << 40);
+    TestConcurrentInsert(threads, 10000);
+  }
+  fprintf(stderr, "PASS\n");
+  return 0;
+}
@@ -0,0 +1,55 @@
+// Throughput of each crc32c implementation the cpu supports, over buffers
+// of a few block sizes.
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <string>
+#include "../util/crc32c.h"
+#include "../util/random.h"
+
+using namespace shannon;
+using namespace std;
+
+static uint64_t NowMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+int main(int argc, char **argv) {
+  // Bytes hashed per implementation and size.
+  uint64_t total = argc > 1 ? strtoull(argv[1], NULL, 10) : (1ull << 30);
+  Random rnd(301);
+  string data(4 * 1024 * 1024 + 1, '\0');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(rnd.Uniform(256));
+  }
+  const crc32c::Implementation impls[] = {
+      crc32c::kPortable, crc32c::kSse42, crc32c::kSse42Pclmul};
+  const size_t sizes[] = {64, 512, 4096, 16384, 65536, 4 * 1024 * 1024};
+  printf("active: %s\n",
+         crc32c::ImplementationName(crc32c::ActiveImplementation()));
+  printf("%-16s %10s %12s\n", "impl", "size", "MB/s");
+  for (int i = 0; i < 3; i++) {
+    if (!crc32c::IsSupported(impls[i])) {
+      printf("%-16s not supported\n", crc32c::ImplementationName(impls[i]));
+      continue;
+    }
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      uint64_t iters = total / sizes[s];
+      if (iters == 0) iters = 1;
+      uint32_t crc = 0;
+      uint64_t start = NowMicros();
+      for (uint64_t n = 0; n < iters; n++) {
+        // Odd offset so no implementation starts aligned.
+        crc = crc32c::ExtendWith(impls[i], crc, data.data() + 1, sizes[s]);
+      }
+      uint64_t micros = NowMicros() - start;
+      if (micros == 0) micros = 1;
+      printf("%-16s %10zu %12.1f  (%08x)\n",
+             crc32c::ImplementationName(impls[i]), sizes[s],
+             static_cast<double>(iters * sizes[s]) / micros, crc);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "../util/crc32c.h"
+#include "../util/random.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+static const crc32c::Implementation kImpls[] = {
+    crc32c::kPortable, crc32c::kSse42, crc32c::kSse42Pclmul};
+
+// From rfc3720 section B.4.
+static void TestStandardResults() {
+  phase = "standard results";
+  char buf[32];
+  memset(buf, 0, sizeof(buf));
+  CheckCondition(0x8a9136aa == crc32c::Value(buf, sizeof(buf)));
+  memset(buf, 0xff, sizeof(buf));
+  CheckCondition(0x62a8ab43 == crc32c::Value(buf, sizeof(buf)));
+  for (int i = 0; i < 32; i++) {
+    buf[i] = i;
+  }
+  CheckCondition(0x46dd794e == crc32c::Value(buf, sizeof(buf)));
+  for (int i = 0; i < 32; i++) {
+    buf[i] = 31 - i;
+  }
+  CheckCondition(0x113fdb5c == crc32c::Value(buf, sizeof(buf)));
+  unsigned char data[48] = {
+      0x01, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+      0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x18, 0x28, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  };
+  CheckCondition(0xd9963a56 ==
+                 crc32c::Value(reinterpret_cast<char *>(data), sizeof(data)));
+}
+
+// Every implementation the cpu supports must agree with the portable one,
+// whatever the length and alignment of the buffer.
+static void TestImplementationsAgree() {
+  phase = "implementations agree";
+  Random rnd(301);
+  string data(300 * 1024, '\0');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(rnd.Uniform(256));
+  }
+  size_t sizes[] = {0,    1,    7,    8,     9,     15,    63,    64,    255,
+                    767,  768,  769,  1000,  4095,  4096,  24575, 24576, 24577,
+                    32768, 65536, 100000, 250000};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    for (size_t align = 0; align < 16; align++) {
+      const char *p = data.data() + align;
+      uint32_t expected = crc32c::ExtendWith(crc32c::kPortable, 0, p, sizes[s]);
+      CheckCondition(crc32c::Value(p, sizes[s]) == expected);
+      for (int i = 0; i < 3; i++) {
+        if (crc32c::IsSupported(kImpls[i])) {
+          CheckCondition(crc32c::ExtendWith(kImpls[i], 0, p, sizes[s]) ==
+                         expected);
+        }
+      }
+    }
+  }
+  // Random lengths, offsets and initial crcs.
+  for (int n = 0; n < 2000; n++) {
+    size_t off = rnd.Uniform(64);
+    size_t len = rnd.Uniform(data.size() - off);
+    if (n % 2 == 0) len %= 2048;
+    uint32_t init = rnd.Next();
+    const char *p = data.data() + off;
+    uint32_t expected = crc32c::ExtendWith(crc32c::kPortable, init, p, len);
+    for (int i = 0; i < 3; i++) {
+      if (crc32c::IsSupported(kImpls[i])) {
+        CheckCondition(crc32c::ExtendWith(kImpls[i], init, p, len) ==
+                       expected);
+      }
+    }
+  }
+}
+
+static void TestExtend() {
+  phase = "extend";
+  Random rnd(17);
+  string data(100000, '\0');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(rnd.Uniform(256));
+  }
+  uint32_t whole = crc32c::Value(data.data(), data.size());
+  for (int n = 0; n < 200; n++) {
+    size_t split = rnd.Uniform(data.size());
+    uint32_t crc = crc32c::Value(data.data(), split);
+    CheckCondition(crc32c::Extend(crc, data.data() + split,
+                                  data.size() - split) == whole);
+  }
+  CheckCondition(crc32c::Value("hello world", 11) ==
+                 crc32c::Extend(crc32c::Value("hello ", 6), "world", 5));
+}
+
+static void TestMask() {
+  phase = "mask";
+  uint32_t crc = crc32c::Value("foo", 3);
+  CheckCondition(crc != crc32c::Mask(crc));
+  CheckCondition(crc != crc32c::Mask(crc32c::Mask(crc)));
+  CheckCondition(crc == crc32c::Unmask(crc32c::Mask(crc)));
+  CheckCondition(crc ==
+                 crc32c::Unmask(crc32c::Unmask(crc32c::Mask(crc32c::Mask(crc)))));
+}
+
+int main() {
+  TestStandardResults();
+  TestImplementationsAgree();
+  TestExtend();
+  TestMask();
+  std::cout << "crc32c test pass ("
+            << crc32c::ImplementationName(crc32c::ActiveImplementation())
+            << ")." << std::endl;
+  return 0;
+}
@@ -115,6 +115,100 @@ TEST(FDTest, FDLeakDestroyDB) {
   ASSERT_EQ(before_fd_count, after_fd_count);
 }
 
+class RangeTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    shannon::Options options;
+    options.create_if_missing = true;
+    db_ = NULL;
+    ASSERT_TRUE(shannon::DB::Open(options, "rangedb", g_device_name, &db_).ok());
+    // Three 4KB units plus a short tail, each byte derived from its offset.
+    value_.resize(3 * 4096 + 100);
+    for (size_t i = 0; i < value_.size(); i++) {
+      value_[i] = static_cast<char>('a' + i % 26);
+    }
+    ASSERT_TRUE(db_->Put(shannon::WriteOptions(), "key", value_).ok());
+  }
+
+  virtual void TearDown() {
+    delete db_;
+    shannon::DestroyDB(g_device_name, "rangedb", shannon::Options());
+  }
+
+  shannon::DB* db_;
+  std::string value_;
+};
+
+TEST_F(RangeTest, GetRangeInRange) {
+  char buf[4096];
+  size_t read_len = 0;
+  shannon::Status s = db_->GetRange(shannon::ReadOptions(), "key", 4096,
+                                    sizeof(buf), buf, &read_len);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(read_len, sizeof(buf));
+  ASSERT_EQ(std::string(buf, read_len), value_.substr(4096, sizeof(buf)));
+
+  // An unaligned offset goes through the bounce buffer.
+  s = db_->GetRange(shannon::ReadOptions(), "key", 4096 + 123, 1000, buf,
+                    &read_len);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(read_len, 1000);
+  ASSERT_EQ(std::string(buf, read_len), value_.substr(4096 + 123, 1000));
+}
+
+TEST_F(RangeTest, GetRangePastEnd) {
+  char buf[4096];
+  size_t read_len = 0;
+  shannon::Status s = db_->GetRange(shannon::ReadOptions(), "key", 3 * 4096,
+                                    sizeof(buf), buf, &read_len);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(read_len, 100);
+  ASSERT_EQ(std::string(buf, read_len), value_.substr(3 * 4096));
+
+  s = db_->GetRange(shannon::ReadOptions(), "key", value_.size() - 10,
+                    sizeof(buf), buf, &read_len);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(read_len, 10);
+  ASSERT_EQ(std::string(buf, read_len), value_.substr(value_.size() - 10));
+}
+
+TEST_F(RangeTest, GetRangeAtEnd) {
+  char buf[64];
+  size_t read_len = 1;
+  shannon::Status s = db_->GetRange(shannon::ReadOptions(), "key",
+                                    value_.size(), sizeof(buf), buf,
+                                    &read_len);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(read_len, 0);
+}
+
+TEST_F(RangeTest, PutRangeBeyondEnd) {
+  std::string data(4096, 'z');
+  uint64_t offset = 5 * 4096;
+  shannon::Status s = db_->PutRange(shannon::WriteOptions(), "key", offset,
+                                    data);
+  ASSERT_TRUE(s.ok());
+
+  std::string got;
+  s = db_->Get(shannon::ReadOptions(), "key", &got);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(got.size(), offset + data.size());
+  ASSERT_EQ(got.substr(0, value_.size()), value_);
+  ASSERT_EQ(got.substr(offset), data);
+
+  char buf[4096];
+  size_t read_len = 0;
+  s = db_->GetRange(shannon::ReadOptions(), "key", offset, sizeof(buf), buf,
+                    &read_len);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(read_len, data.size());
+  ASSERT_EQ(std::string(buf, read_len), data);
+
+  // Offsets inside a 4KB unit cannot be written in place.
+  s = db_->PutRange(shannon::WriteOptions(), "key", offset + 1, data);
+  ASSERT_TRUE(s.IsInvalidArgument() || s.IsNotSupported());
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   testing::Environment* env = new KVLibCPPTest();
@@ -0,0 +1,97 @@
+// Records per second read from the operation log of a device, one record
+// at a time with Next(), key() and value(), and with NextBatch().  Writes
+// the records first, as Puts to a db of its own, and reads them back from
+// the sequence number before them.
+//
+//   log_iter_bench [device] [records] [value size] [batch records]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <string>
+#include "swift/log_iter.h"
+#include "swift/shannon_db.h"
+
+using namespace shannon;
+using namespace std;
+
+static uint64_t NowMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+static void Report(const char *name, int n, size_t bytes, uint64_t micros) {
+  if (micros == 0) {
+    micros = 1;
+  }
+  fprintf(stdout, "%-16s %8d records %10.0f records/s %8.1f MB/s\n", name, n,
+          n * 1e6 / micros, bytes / 1048576.0 / (micros / 1e6));
+}
+
+static void Check(const Status &s, const char *what) {
+  if (!s.ok()) {
+    fprintf(stderr, "%s: %s\n", what, s.ToString().c_str());
+    exit(1);
+  }
+}
+
+int main(int argc, char **argv) {
+  string device = argc > 1 ? argv[1] : "/dev/kvdev0";
+  int n = argc > 2 ? atoi(argv[2]) : 100000;
+  int value_size = argc > 3 ? atoi(argv[3]) : 100;
+  size_t batch_records = argc > 4 ? atoi(argv[4]) : 1024;
+  string dbname = "log_iter_bench";
+
+  uint64_t timestamp;
+  Check(GetSequenceNumber(device, &timestamp), "get sequence number");
+
+  DB *db;
+  Options options;
+  options.create_if_missing = true;
+  Check(DB::Open(options, dbname, device, &db), "open");
+  string value(value_size, 'v');
+  for (int i = 0; i < n; i++) {
+    char key[32];
+    snprintf(key, sizeof(key), "key%016d", i);
+    Check(db->Put(WriteOptions(), key, value), "put");
+  }
+  delete db;
+
+  LogIterator *iter;
+  Check(NewLogIterator(device, timestamp, &iter), "new log iterator");
+  int count = 0;
+  size_t bytes = 0;
+  uint64_t start = NowMicros();
+  for (iter->Next(); iter->Valid() && count < n; iter->Next()) {
+    Slice key = iter->key();
+    Slice value = iter->value();
+    bytes += key.size() + value.size() + sizeof(iter->timestamp());
+    count++;
+  }
+  Report("next", count, bytes, NowMicros() - start);
+  delete iter;
+
+  Check(NewLogIterator(device, timestamp, &iter), "new log iterator");
+  LogRecordBatch batch;
+  count = 0;
+  bytes = 0;
+  start = NowMicros();
+  while (count < n) {
+    Check(iter->NextBatch(batch_records, 4 << 20, &batch), "next batch");
+    if (batch.Count() == 0) {
+      break;
+    }
+    for (size_t i = 0; i < batch.Count(); i++) {
+      LogRecord record = batch.Get(i);
+      bytes += record.key.size() + record.value.size() +
+               sizeof(record.timestamp);
+    }
+    count += batch.Count();
+  }
+  Report("next batch", count, bytes, NowMicros() - start);
+  delete iter;
+
+  Check(DestroyDB(device, dbname, Options()), "destroy");
+  return 0;
+}
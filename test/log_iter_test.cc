@@ -220,6 +220,33 @@ void check_iter(LogIterator *iter, LogOpType type, int db_idx, uint64_t start_ts
   }
 }
 
+// same as check_iter, with NextBatch() of at most batch_size records
+void check_batch(LogIterator *iter, LogOpType type, int db_idx, uint64_t start_ts, uint32_t start, uint32_t offset, size_t batch_size)
+{
+  LogRecordBatch batch;
+  uint32_t i = start, max = start + offset;
+  Status s;
+
+  DEBUG("start check batch: LogOpType=%d, db=%d, timestamp=%lu, start=%d, offset=%d.\n", type, db_idx, start_ts, start, offset);
+  while (i < max) {
+    s = iter->NextBatch(batch_size, 1 << 20, &batch);
+    assert(s.ok());
+    assert(batch.Count() > 0 && batch.Count() <= batch_size);
+    for (size_t j = 0; j < batch.Count(); ++j, ++i) {
+      LogRecord record = batch.Get(j);
+      assert(record.optype == type);
+      assert(record.db == db_idx);
+      assert(record.timestamp == ++start_ts);
+      assert(match_key(record.key, i) == 0);
+      if (type == KEY_ADD)
+        assert(match_value(record.value, i) == 0);
+      else
+        assert(record.value.size() == 0);
+    }
+  }
+  assert(i == max);
+}
+
 struct record {
   string db_name;
 #define TYPE_CREATE 0
@@ -379,6 +406,14 @@ int test_iter_data(string &device)
   check_iter(iter, KEY_DELETE, db_idx, timestamp, 2, 50);
   timestamp += 50;
 
+  // check batches
+  write_kvs(device, dbname, 1, 1000, &db_idx);
+  check_batch(iter, KEY_ADD, db_idx, timestamp, 1, 1000, 64);
+  timestamp += 1000;
+  delete_kvs(device, dbname, 1, 1000, &db_idx);
+  check_batch(iter, KEY_DELETE, db_idx, timestamp, 1, 1000, 1000);
+  timestamp += 1000;
+
   // check switch super block, write 1G every time
   for (i = 0; i < 4; ++i) {
     write_kvs(device, dbname2, start, offset, &db_idx);
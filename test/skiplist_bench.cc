@@ -0,0 +1,84 @@
+// Insert times of a sorted buffer filled by several threads at once: a
+// SkipList behind a mutex, as writers share one today, against the
+// ConcurrentSkipList, whose writers only contend on the links they change.
+// Every thread inserts its share of random keys, the time is wall clock
+// per key over all threads.
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../util/arena.h"
+#include "../util/concurrent_arena.h"
+#include "../util/concurrent_skiplist.h"
+#include "../util/random.h"
+#include "../util/skiplist.h"
+
+using namespace shannon;
+using namespace std;
+
+static uint64_t NowMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+typedef uint64_t Key;
+
+struct KeyComparator {
+  int operator()(const Key &a, const Key &b) const {
+    return a < b ? -1 : (a > b ? 1 : 0);
+  }
+};
+
+// Distinct random keys, so every insert adds a node.
+static Key MakeKey(int thread, int i) {
+  return ((static_cast<uint64_t>(i) << 8) | thread) * 0x9e3779b97f4a7c15ull;
+}
+
+template <typename Insert>
+static double Run(int num_threads, int num_keys, Insert insert) {
+  vector<thread> threads;
+  uint64_t start = NowMicros();
+  for (int t = 0; t < num_threads; t++) {
+    threads.push_back(thread([&insert, t, num_threads, num_keys]() {
+      for (int i = 0; i < num_keys / num_threads; i++) {
+        insert(MakeKey(t, i));
+      }
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); t++) {
+    threads[t].join();
+  }
+  return (NowMicros() - start) * 1000.0 / num_keys;
+}
+
+int main(int argc, char **argv) {
+  const int num_keys = argc > 1 ? atoi(argv[1]) : 1000000;
+  KeyComparator cmp;
+  printf("%d keys\n", num_keys);
+  printf("%-8s %16s %16s\n", "threads", "locked ns", "concurrent ns");
+  for (int threads = 1; threads <= 16; threads *= 2) {
+    double locked;
+    {
+      Arena arena;
+      SkipList<Key, KeyComparator> list(cmp, &arena);
+      mutex mu;
+      locked = Run(threads, num_keys, [&list, &mu](Key key) {
+        lock_guard<mutex> lock(mu);
+        list.Insert(key);
+      });
+    }
+    double concurrent;
+    {
+      ConcurrentArena arena;
+      ConcurrentSkipList<Key, KeyComparator> list(cmp, &arena);
+      concurrent = Run(threads, num_keys, [&list](Key key) {
+        list.Insert(key);
+      });
+    }
+    printf("%-8d %16.1f %16.1f\n", threads, locked, concurrent);
+  }
+  return 0;
+}
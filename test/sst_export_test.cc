@@ -0,0 +1,583 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "swift/comparator.h"
+#include "swift/env.h"
+#include "swift/iterator.h"
+#include "swift/options.h"
+#include "swift/shannon_db.h"
+#include "swift/sst_file_reader.h"
+#include "table/block.h"
+#include "table/sst_export.h"
+#include "table/sst_table.h"
+#include "util/bounded_queue.h"
+#include "util/coding.h"
+#include "util/filename.h"
+#include "util/pipelined_writable_file.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+static const char *kDBName = "/tmp/sst_export_test";
+
+static void SleepMillis(int ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static void TestBoundedQueue() {
+  phase = "bounded queue";
+  BoundedQueue<int> queue(2);
+  int item = 0;
+  CheckCondition(queue.Push(1));
+  CheckCondition(queue.Push(2));
+
+  // A push to a full queue waits for a pop.
+  std::atomic<bool> pushed(false);
+  std::thread producer([&]() {
+    CheckCondition(queue.Push(3));
+    pushed = true;
+  });
+  SleepMillis(50);
+  CheckCondition(!pushed);
+  CheckCondition(queue.Pop(&item) && item == 1);
+  producer.join();
+  CheckCondition(pushed);
+  CheckCondition(queue.Pop(&item) && item == 2);
+  CheckCondition(queue.Pop(&item) && item == 3);
+
+  // A pop from an empty queue waits for a push.
+  std::atomic<bool> popped(false);
+  std::thread consumer([&]() {
+    int n = 0;
+    CheckCondition(queue.Pop(&n) && n == 4);
+    popped = true;
+  });
+  SleepMillis(50);
+  CheckCondition(!popped);
+  CheckCondition(queue.Push(4));
+  consumer.join();
+  CheckCondition(popped);
+
+  // Close() wakes a waiting pop.
+  BoundedQueue<int> empty(1);
+  std::thread waiter([&]() {
+    int n = 0;
+    CheckCondition(!empty.Pop(&n));
+  });
+  SleepMillis(50);
+  empty.Close();
+  waiter.join();
+
+  // And a waiting push, which leaves its item alone.
+  BoundedQueue<string> full(1);
+  CheckCondition(full.Push(string("queued")));
+  std::thread blocked([&]() {
+    string s = "refused";
+    CheckCondition(!full.Push(std::move(s)));
+    CheckCondition(s == "refused");
+  });
+  SleepMillis(50);
+  full.Close();
+  blocked.join();
+  // Queued items are still popped after Close(), further pushes refused.
+  string s = "late";
+  CheckCondition(!full.Push(std::move(s)));
+  CheckCondition(s == "late");
+  CheckCondition(full.Pop(&s) && s == "queued");
+  CheckCondition(!full.Pop(&s));
+}
+
+// Records what the writer appends.  Appends may be slowed down, and the
+// "fail_at"-th one, counting from 1, fails along with every later one.
+class RecordingFile : public WritableFile {
+ public:
+  RecordingFile(bool *deleted, int delay_ms = 0, int fail_at = 0)
+      : deleted_(deleted), delay_ms_(delay_ms), fail_at_(fail_at),
+        appends_(0), syncs_(0), closed_(false) {}
+  virtual ~RecordingFile() { *deleted_ = true; }
+
+  virtual Status Append(const Slice &data) {
+    if (delay_ms_ > 0) {
+      SleepMillis(delay_ms_);
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    appends_++;
+    if (fail_at_ > 0 && appends_ >= fail_at_) {
+      return Status::IOError("injected append error");
+    }
+    contents_.append(data.data(), data.size());
+    return Status::OK();
+  }
+  virtual Status Close() {
+    closed_ = true;
+    return Status::OK();
+  }
+  virtual Status Flush() { return Status::OK(); }
+  virtual Status Sync() {
+    syncs_++;
+    return Status::OK();
+  }
+
+  string contents() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return contents_;
+  }
+  int appends() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return appends_;
+  }
+  int syncs() const { return syncs_; }
+  bool closed() const { return closed_; }
+
+ private:
+  bool *deleted_;
+  const int delay_ms_;
+  const int fail_at_;
+  std::mutex mu_;
+  string contents_;
+  int appends_;
+  int syncs_;
+  bool closed_;
+};
+
+static string Piece(int i) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "<%d>", i);
+  return string(buf) + string(i % 37, 'a' + i % 26);
+}
+
+static void TestPipelinedWritableFile() {
+  phase = "pipelined file";
+  // Chunks reach the target whole and in order.
+  bool deleted = false;
+  RecordingFile *target = new RecordingFile(&deleted, 0);
+  PipelinedWritableFile *file = new PipelinedWritableFile(target, 100, 2);
+  string expected;
+  for (int i = 0; i < 2000; i++) {
+    string piece = Piece(i);
+    CheckCondition(file->Append(piece).ok());
+    expected += piece;
+    if (i == 1000) {
+      // Sync() drains the pending chunks and the partial one.
+      CheckCondition(file->Sync().ok());
+      CheckCondition(target->contents() == expected);
+      CheckCondition(target->syncs() == 1);
+    }
+  }
+  CheckCondition(file->Close().ok());
+  CheckCondition(target->closed());
+  CheckCondition(target->contents() == expected);
+  CheckCondition(file->write_bytes() == expected.size());
+  CheckCondition(!deleted);
+  delete file;
+  CheckCondition(deleted);
+
+  // An append error of the writer is returned by a later call, and
+  // nothing is written after it.
+  deleted = false;
+  target = new RecordingFile(&deleted, 0, 3);
+  file = new PipelinedWritableFile(target, 100, 2);
+  Status s;
+  for (int i = 0; i < 2000 && s.ok(); i++) {
+    s = file->Append(Piece(i));
+  }
+  if (s.ok()) {
+    s = file->Sync();
+  }
+  CheckCondition(s.IsIOError());
+  CheckCondition(file->Sync().IsIOError());
+  CheckCondition(file->Close().IsIOError());
+  CheckCondition(target->appends() == 3);
+  CheckCondition(target->contents().size() <= 2 * 200);
+  delete file;
+  CheckCondition(deleted);
+
+  // Deleting the file without Close() stops a busy writer.
+  deleted = false;
+  target = new RecordingFile(&deleted, 5);
+  file = new PipelinedWritableFile(target, 100, 4);
+  for (int i = 0; i < 200; i++) {
+    CheckCondition(file->Append(Piece(i)).ok());
+  }
+  delete file;
+  CheckCondition(deleted);
+}
+
+// An in-memory column family: user keys with values and timestamps.
+struct Entry {
+  string key;
+  string value;
+  uint64_t timestamp;
+};
+
+class VectorIterator : public Iterator {
+ public:
+  // Fails with a corruption after "fail_after" entries if it is set.
+  explicit VectorIterator(const vector<Entry> *entries, int fail_after = -1)
+      : entries_(entries), fail_after_(fail_after), pos_(0) {}
+
+  virtual bool Valid() const {
+    return pos_ < entries_->size() && status().ok();
+  }
+  virtual void SeekToFirst() { pos_ = 0; }
+  virtual void SeekToLast() { pos_ = entries_->size() - 1; }
+  virtual void Seek(const Slice &target) {
+    for (pos_ = 0; pos_ < entries_->size(); pos_++) {
+      if (Slice((*entries_)[pos_].key).compare(target) >= 0) {
+        break;
+      }
+    }
+  }
+  virtual void Next() { pos_++; }
+  virtual void Prev() { pos_--; }
+  virtual Slice key() { return (*entries_)[pos_].key; }
+  virtual Slice value() { return (*entries_)[pos_].value; }
+  virtual uint64_t timestamp() { return (*entries_)[pos_].timestamp; }
+  virtual Status status() const {
+    if (fail_after_ >= 0 && pos_ >= (size_t)fail_after_) {
+      return Status::Corruption("injected iterator error");
+    }
+    return Status::OK();
+  }
+  virtual void SeekForPrev(const Slice &) {}
+  virtual void SetPrefix(const Slice &) {}
+
+ private:
+  const vector<Entry> *entries_;
+  const int fail_after_;
+  size_t pos_;
+};
+
+class TestColumnFamilyHandle : public ColumnFamilyHandle {
+ public:
+  TestColumnFamilyHandle(const string &name, uint32_t id)
+      : name_(name), id_(id) {}
+  virtual const string &GetName() const { return name_; }
+  virtual uint32_t GetID() const { return id_; }
+  virtual Status GetDescriptor(ColumnFamilyDescriptor *) {
+    return Status::NotSupported("test handle");
+  }
+  virtual Status SetDescriptor(const ColumnFamilyDescriptor &) {
+    return Status::NotSupported("test handle");
+  }
+
+ private:
+  string name_;
+  uint32_t id_;
+};
+
+// Counts the bytes appended to a file of FaultyEnv, failing appends once
+// "limit" bytes have been written by all its files.
+class FaultyFile : public WritableFile {
+ public:
+  FaultyFile(WritableFile *target, std::atomic<uint64_t> *written,
+             uint64_t limit)
+      : target_(target), written_(written), limit_(limit) {}
+  virtual ~FaultyFile() { delete target_; }
+
+  virtual Status Append(const Slice &data) {
+    if (written_->fetch_add(data.size()) + data.size() > limit_) {
+      return Status::IOError("injected write error");
+    }
+    return target_->Append(data);
+  }
+  virtual Status Close() { return target_->Close(); }
+  virtual Status Flush() { return target_->Flush(); }
+  virtual Status Sync() { return target_->Sync(); }
+
+ private:
+  WritableFile *target_;
+  std::atomic<uint64_t> *written_;
+  const uint64_t limit_;
+};
+
+// Writes files through Env::Default(), optionally failing the appends
+// after "write_limit" bytes or the creation of the "fail_create"-th file.
+class FaultyEnv : public Env {
+ public:
+  FaultyEnv()
+      : base_(Env::Default()), write_limit_(~0ull), fail_create_(0),
+        created_(0), written_(0) {}
+
+  void SetWriteLimit(uint64_t limit) { write_limit_ = limit; }
+  void SetFailCreate(int n) { fail_create_ = n; }
+  int created() const { return created_; }
+
+  virtual Status GetCurrentTime(int64_t *unix_time) {
+    return base_->GetCurrentTime(unix_time);
+  }
+  virtual string TimeToString(uint64_t time) {
+    return base_->TimeToString(time);
+  }
+  virtual Status NewWritableFile(const string &fname, WritableFile **result) {
+    if (++created_ == fail_create_) {
+      return Status::IOError(fname, "injected create error");
+    }
+    WritableFile *file;
+    Status s = base_->NewWritableFile(fname, &file);
+    if (s.ok()) {
+      *result = new FaultyFile(file, &written_, write_limit_);
+    }
+    return s;
+  }
+  virtual Status CreateDir(const string &name) {
+    return base_->CreateDir(name);
+  }
+  virtual bool FileExists(const string &fname) {
+    return base_->FileExists(fname);
+  }
+  virtual Status DeleteFile(const string &fname) {
+    return base_->DeleteFile(fname);
+  }
+
+ private:
+  Env *base_;
+  uint64_t write_limit_;
+  int fail_create_;
+  std::atomic<int> created_;
+  std::atomic<uint64_t> written_;
+};
+
+static vector<Entry> MakeEntries(const string &prefix, int n) {
+  vector<Entry> entries;
+  for (int i = 0; i < n; i++) {
+    Entry e;
+    char key[32];
+    snprintf(key, sizeof(key), "%s%06d", prefix.c_str(), i);
+    e.key = key;
+    // Every 100th value is empty.
+    if (i % 100 != 0) {
+      e.value = "value" + e.key + string(i % 97, 'v');
+    }
+    e.timestamp = 1000 + (i * 7919) % 5000;
+    entries.push_back(e);
+  }
+  return entries;
+}
+
+// The properties block of a table, values as stored.
+static void ReadProperties(const string &fname, map<string, string> *props) {
+  MappedFile file;
+  CheckCondition(OpenMappedFile(const_cast<char *>(fname.c_str()), &file) == 0);
+  Slice foot_slice;
+  uint8_t foot_copied = 0;
+  CheckCondition(ReadFoot(&foot_slice, &file, &foot_copied).ok());
+  Foot foot;
+  Slice input = foot_slice;
+  CheckCondition(FootDecodeFrom(&foot, &input, 1).ok());
+  if (foot_copied) {
+    free((void *)foot_slice.data());
+  }
+
+  Slice contents;
+  uint8_t copied = 0;
+  CheckCondition(ReadBlock(&contents, &file, &foot.metaindex_handle,
+                           foot.checksum_type, &copied).ok());
+  Block metaindex(contents, copied != 0);
+  Block::Iter iter(&metaindex, BytewiseComparator());
+  iter.Seek(kPropertiesBlock);
+  CheckCondition(iter.Valid() && iter.key() == kPropertiesBlock);
+  BlockHandle handle;
+  Slice handle_value = iter.value();
+  CheckCondition(BlockHandleDecodeFrom(&handle, &handle_value).ok());
+
+  CheckCondition(ReadBlock(&contents, &file, &handle, foot.checksum_type,
+                           &copied).ok());
+  Block properties(contents, copied != 0);
+  Block::Iter prop(&properties, BytewiseComparator());
+  for (prop.SeekToFirst(); prop.Valid(); prop.Next()) {
+    (*props)[prop.key().ToString()] = prop.value().ToString();
+  }
+  CheckCondition(prop.status().ok());
+  CloseMappedFile(&file);
+}
+
+static uint64_t IntProperty(const map<string, string> &props,
+                            const string &name) {
+  map<string, string>::const_iterator it = props.find(name);
+  CheckCondition(it != props.end());
+  Slice input(it->second);
+  uint64_t value = 0;
+  CheckCondition(GetVarint64(&input, &value));
+  return value;
+}
+
+// Read the files of "handle" back and compare them with "entries".
+static void CheckExportedFiles(const TestColumnFamilyHandle &handle,
+                               const vector<Entry> &entries,
+                               const SstExportStats &stats) {
+  CheckCondition(stats.num_entries == entries.size());
+  CheckCondition(stats.num_files > 1);
+  size_t pos = 0;
+  for (uint64_t n = 1; n <= stats.num_files; n++) {
+    string fname = TableFileName(kDBName, n, handle.GetName().c_str());
+    SstFileReader reader((Options()));
+    CheckCondition(reader.Open(fname).ok());
+    CheckCondition(reader.VerifyChecksum().ok());
+    Iterator *iter = reader.NewIterator(ReadOptions());
+    size_t first = pos;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      CheckCondition(pos < entries.size());
+      CheckCondition(iter->key() == entries[pos].key);
+      CheckCondition(iter->value() == entries[pos].value);
+      CheckCondition(iter->timestamp() == entries[pos].timestamp);
+      pos++;
+    }
+    CheckCondition(iter->status().ok());
+    delete iter;
+    CheckCondition(pos > first);
+
+    map<string, string> props;
+    ReadProperties(fname, &props);
+    CheckCondition(props["rocksdb.column.family.name"] == handle.GetName());
+    CheckCondition(IntProperty(props, "rocksdb.column.family.id") ==
+                   handle.GetID());
+    CheckCondition(IntProperty(props, "rocksdb.num.entries") == pos - first);
+    CheckCondition(IntProperty(props, "rocksdb.creation.time") ==
+                   entries[first].timestamp);
+    CheckCondition(IntProperty(props, "rocksdb.oldest.key.time") ==
+                   entries[pos - 1].timestamp);
+  }
+  CheckCondition(pos == entries.size());
+  string next = TableFileName(kDBName, stats.num_files + 1,
+                              handle.GetName().c_str());
+  CheckCondition(!Env::Default()->FileExists(next));
+}
+
+static void RemoveFiles(const string &cfname) {
+  for (uint64_t n = 1; n < 1000; n++) {
+    string fname = TableFileName(kDBName, n, cfname.c_str());
+    if (!Env::Default()->FileExists(fname)) {
+      break;
+    }
+    Env::Default()->DeleteFile(fname);
+  }
+}
+
+static SstExportOptions SmallExportOptions() {
+  SstExportOptions options;
+  options.table_options.block_size = 1024;
+  options.target_file_size = 32 << 10;
+  options.max_jobs = 2;
+  options.read_batch_size = 4096;
+  options.read_queue_depth = 2;
+  options.write_chunk_size = 4096;
+  options.write_queue_depth = 2;
+  return options;
+}
+
+static void TestExport() {
+  phase = "export";
+  TestColumnFamilyHandle cf0("default", 0), cf1("cf1", 1), cf2("cf2", 2);
+  RemoveFiles(cf0.GetName());
+  RemoveFiles(cf1.GetName());
+  RemoveFiles(cf2.GetName());
+  vector<Entry> entries0 = MakeEntries("a", 3000);
+  vector<Entry> entries1 = MakeEntries("b", 2000);
+  vector<Entry> entries2 = MakeEntries("c", 1000);
+  VectorIterator it0(&entries0), it1(&entries1), it2(&entries2);
+  vector<ColumnFamilyHandle *> handles = {&cf0, &cf1, &cf2};
+  vector<Iterator *> iterators = {&it0, &it1, &it2};
+
+  FaultyEnv env;
+  vector<SstExportStats> stats;
+  Status s = ExportColumnFamilies(kDBName, &env, SmallExportOptions(),
+                                  handles, iterators, &stats);
+  CheckCondition(s.ok());
+  CheckCondition(stats.size() == 3);
+  CheckExportedFiles(cf0, entries0, stats[0]);
+  CheckExportedFiles(cf1, entries1, stats[1]);
+  CheckExportedFiles(cf2, entries2, stats[2]);
+  CheckCondition((uint64_t)env.created() ==
+                 stats[0].num_files + stats[1].num_files + stats[2].num_files);
+  RemoveFiles(cf0.GetName());
+  RemoveFiles(cf1.GetName());
+  RemoveFiles(cf2.GetName());
+
+  // An empty column family makes no file.
+  vector<Entry> none;
+  VectorIterator empty(&none);
+  handles = {&cf0};
+  iterators = {&empty};
+  s = ExportColumnFamilies(kDBName, &env, SmallExportOptions(), handles,
+                           iterators, &stats);
+  CheckCondition(s.ok());
+  CheckCondition(stats[0].num_files == 0 && stats[0].num_entries == 0);
+  CheckCondition(!env.FileExists(TableFileName(kDBName, 1, "default")));
+}
+
+// The export returns errors instead of hanging, and removes the files of
+// the failed column family.
+static void TestExportErrors() {
+  TestColumnFamilyHandle cf0("default", 0);
+  vector<Entry> entries = MakeEntries("a", 3000);
+  vector<ColumnFamilyHandle *> handles = {&cf0};
+  vector<SstExportStats> stats;
+
+  phase = "write error";
+  for (uint64_t limit = 0; limit < 100000; limit += 20000) {
+    FaultyEnv env;
+    env.SetWriteLimit(limit);
+    VectorIterator iter(&entries);
+    vector<Iterator *> iterators = {&iter};
+    Status s = ExportColumnFamilies(kDBName, &env, SmallExportOptions(),
+                                    handles, iterators, &stats);
+    CheckCondition(s.IsIOError());
+    CheckCondition(env.created() > 0);
+    for (int n = 1; n <= env.created(); n++) {
+      CheckCondition(!env.FileExists(TableFileName(kDBName, n, "default")));
+    }
+  }
+
+  phase = "create error";
+  {
+    FaultyEnv env;
+    env.SetFailCreate(2);
+    VectorIterator iter(&entries);
+    vector<Iterator *> iterators = {&iter};
+    Status s = ExportColumnFamilies(kDBName, &env, SmallExportOptions(),
+                                    handles, iterators, &stats);
+    CheckCondition(s.IsIOError());
+    CheckCondition(!env.FileExists(TableFileName(kDBName, 1, "default")));
+  }
+
+  phase = "iterator error";
+  {
+    FaultyEnv env;
+    VectorIterator iter(&entries, 2500);
+    vector<Iterator *> iterators = {&iter};
+    Status s = ExportColumnFamilies(kDBName, &env, SmallExportOptions(),
+                                    handles, iterators, &stats);
+    CheckCondition(s.IsCorruption());
+    for (int n = 1; n <= env.created(); n++) {
+      CheckCondition(!env.FileExists(TableFileName(kDBName, n, "default")));
+    }
+  }
+}
+
+int main() {
+  // A hang in the pipeline fails the test instead of blocking it.
+  alarm(300);
+  Env::Default()->CreateDir(kDBName);
+  TestBoundedQueue();
+  TestPipelinedWritableFile();
+  TestExport();
+  TestExportErrors();
+  printf("sst export test pass.\n");
+  return 0;
+}
@@ -0,0 +1,496 @@
+#include <iostream>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "swift/cache.h"
+#include "swift/comparator.h"
+#include "swift/env.h"
+#include "swift/filter_policy.h"
+#include "swift/iterator.h"
+#include "swift/options.h"
+#include "swift/sst_file_reader.h"
+#include "../table/compression.h"
+#include "../table/table_builder.h"
+#include "../util/coding.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+static const char *kFileName = "/tmp/sst_file_reader_test.sst";
+static const int kNumKeys = 3000;
+
+static string InternalKey(const Slice &user_key, uint64_t seq, int type) {
+  string key(user_key.data(), user_key.size());
+  PutFixed64(&key, (seq << 8) | type);
+  return key;
+}
+
+static Slice UserKey(const Slice &key) {
+  return Slice(key.data(), key.size() - 8);
+}
+
+// The order of the keys in a table: user key, then newest version first.
+class TestKeyComparator : public Comparator {
+ public:
+  virtual const char *Name() const { return "test.InternalKeyComparator"; }
+  virtual int Compare(const Slice &a, const Slice &b) const {
+    int r = UserKey(a).compare(UserKey(b));
+    if (r == 0) {
+      uint64_t anum = DecodeFixed64(a.data() + a.size() - 8);
+      uint64_t bnum = DecodeFixed64(b.data() + b.size() - 8);
+      r = anum > bnum ? -1 : (anum < bnum ? +1 : 0);
+    }
+    return r;
+  }
+  virtual void FindShortestSeparator(string *start, const Slice &limit) const {}
+  virtual void FindShortSuccessor(string *key) const {}
+};
+
+// Filters the user keys of a table of internal keys.
+class TestBitsBuilder : public FilterBitsBuilder {
+ public:
+  explicit TestBitsBuilder(FilterBitsBuilder *bits) : bits_(bits) {}
+  virtual ~TestBitsBuilder() { delete bits_; }
+  virtual void AddKey(const Slice &key) { bits_->AddKey(UserKey(key)); }
+  virtual void Finish(string *dst) { bits_->Finish(dst); }
+
+ private:
+  FilterBitsBuilder *bits_;
+};
+
+class TestFilterPolicy : public FilterPolicy {
+ public:
+  explicit TestFilterPolicy(const FilterPolicy *policy) : policy_(policy) {}
+  virtual const char *Name() const { return policy_->Name(); }
+  virtual void CreateFilter(const Slice *keys, int n, string *dst) const {
+    vector<Slice> user_keys;
+    for (int i = 0; i < n; i++) {
+      user_keys.push_back(UserKey(keys[i]));
+    }
+    policy_->CreateFilter(user_keys.data(), n, dst);
+  }
+  virtual bool KeyMayMatch(const Slice &key, const Slice &filter) const {
+    return policy_->KeyMayMatch(UserKey(key), filter);
+  }
+  virtual FilterBitsBuilder *GetFilterBitsBuilder() const {
+    FilterBitsBuilder *bits = policy_->GetFilterBitsBuilder();
+    return bits == NULL ? NULL : new TestBitsBuilder(bits);
+  }
+
+ private:
+  const FilterPolicy *policy_;
+};
+
+static string UserKeyOf(int i) {
+  char key[32];
+  snprintf(key, sizeof(key), "key%06d", i * 2);
+  return key;
+}
+
+// Key i has a single value at sequence 100, except:
+//   i % 10 == 3: deleted at sequence 200 over an older value,
+//   i % 10 == 5: a newer value at sequence 200 over an older one,
+//   i % 10 == 7: deleted, nothing older.
+static bool IsLive(int i) { return i % 10 != 3 && i % 10 != 7; }
+
+static string ValueOf(int i) {
+  string value = "value" + UserKeyOf(i);
+  if (i % 10 == 5) {
+    value += "new";
+  }
+  value.append(i % 50, 'v');
+  return value;
+}
+
+static uint64_t SequenceOf(int i) { return i % 10 == 5 ? 200 : 100; }
+
+static void BuildFile(const FilterPolicy *filter_policy,
+                      CompressionType compression = kSnappyCompression,
+                      int compress_threads = 1,
+                      int dict_sample_blocks = 0) {
+  TestKeyComparator comparator;
+  TestFilterPolicy policy(filter_policy);
+  Options options;
+  options.compression = compression;
+  options.compression_parallel_threads = compress_threads;
+  if (dict_sample_blocks > 0) {
+    options.compression_max_dict_bytes = 4096;
+    options.compression_dict_sample_blocks = dict_sample_blocks;
+  }
+  options.block_size = 1024;
+  options.inner_comparator = &comparator;
+  options.filter_policy = filter_policy != NULL ? &policy : NULL;
+  Env *env = Env::Default();
+  env->DeleteFile(kFileName);
+  WritableFile *file;
+  Status s = env->NewWritableFile(kFileName, &file);
+  CheckCondition(s.ok());
+  TableBuilder builder(options, file, "default", 0);
+  for (int i = 0; i < kNumKeys; i++) {
+    string user_key = UserKeyOf(i);
+    switch (i % 10) {
+      case 3:
+        builder.Add(InternalKey(user_key, 200, kSstTypeDeletion), "");
+        builder.Add(InternalKey(user_key, 100, kSstTypeValue), "old");
+        break;
+      case 5:
+        builder.Add(InternalKey(user_key, 200, kSstTypeValue), ValueOf(i));
+        builder.Add(InternalKey(user_key, 100, kSstTypeValue), "old");
+        break;
+      case 7:
+        builder.Add(InternalKey(user_key, 100, kSstTypeDeletion), "");
+        break;
+      default:
+        builder.Add(InternalKey(user_key, 100, kSstTypeValue), ValueOf(i));
+    }
+  }
+  s = builder.Finish(1, 2);
+  CheckCondition(s.ok());
+  CheckCondition(file->Sync().ok());
+  CheckCondition(file->Close().ok());
+  delete file;
+}
+
+static void CheckGets(SstFileReader *reader, const ReadOptions &read_options) {
+  string value;
+  uint64_t timestamp = 0;
+  for (int i = 0; i < kNumKeys; i++) {
+    Status s = reader->Get(read_options, UserKeyOf(i), &value, &timestamp);
+    if (IsLive(i)) {
+      CheckCondition(s.ok());
+      CheckCondition(value == ValueOf(i));
+      CheckCondition(timestamp == SequenceOf(i));
+    } else {
+      CheckCondition(s.IsNotFound());
+    }
+    // Odd keys are not in the file.
+    char key[32];
+    snprintf(key, sizeof(key), "key%06d", i * 2 + 1);
+    CheckCondition(reader->Get(read_options, key, &value).IsNotFound());
+  }
+  CheckCondition(reader->Get(read_options, "a", &value).IsNotFound());
+  CheckCondition(reader->Get(read_options, "key", &value).IsNotFound());
+  CheckCondition(reader->Get(read_options, "z", &value).IsNotFound());
+}
+
+static void TestGet() {
+  phase = "get";
+  BuildFile(NULL);
+  Options options;
+  SstFileReader reader(options);
+  CheckCondition(reader.Open(kFileName).ok());
+  ReadOptions read_options;
+  CheckGets(&reader, read_options);
+  read_options.verify_checksums = true;
+  CheckGets(&reader, read_options);
+  CheckCondition(reader.VerifyChecksum().ok());
+
+  SstFileReader missing(options);
+  CheckCondition(!missing.Open("/tmp/sst_file_reader_test.nonexistent").ok());
+  string value;
+  CheckCondition(!missing.Get(read_options, "key", &value).ok());
+  CheckCondition(missing.NewIterator(read_options) == NULL);
+}
+
+static void TestIterator() {
+  phase = "iterator";
+  BuildFile(NULL);
+  Options options;
+  SstFileReader reader(options);
+  CheckCondition(reader.Open(kFileName).ok());
+  Iterator *iter = reader.NewIterator(ReadOptions());
+
+  // Forward over the live keys.
+  int i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    while (!IsLive(i)) {
+      i++;
+    }
+    CheckCondition(iter->key() == UserKeyOf(i));
+    CheckCondition(iter->value() == ValueOf(i));
+    CheckCondition(iter->timestamp() == SequenceOf(i));
+    i++;
+  }
+  CheckCondition(iter->status().ok());
+  CheckCondition(i == kNumKeys);
+
+  // And backward.
+  i = kNumKeys - 1;
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+    while (!IsLive(i)) {
+      i--;
+    }
+    CheckCondition(iter->key() == UserKeyOf(i));
+    CheckCondition(iter->value() == ValueOf(i));
+    i--;
+  }
+  CheckCondition(iter->status().ok());
+  CheckCondition(i == -1);
+
+  // Changing direction.
+  iter->Seek(UserKeyOf(15));
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(15));
+  iter->Prev();
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(14));
+  iter->Prev();
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(12));
+  iter->Next();
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(14));
+  iter->Next();
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(15));
+
+  // Seeks to deleted and missing keys.
+  iter->Seek(UserKeyOf(13));
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(14));
+  iter->Seek("key000027");
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(14));
+  iter->Seek("a");
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(0));
+  iter->Seek("z");
+  CheckCondition(!iter->Valid() && iter->status().ok());
+  iter->SeekForPrev(UserKeyOf(13));
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(12));
+  iter->SeekForPrev(UserKeyOf(12));
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(12));
+  iter->SeekForPrev("key000035");
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(16));
+  iter->SeekForPrev("z");
+  CheckCondition(iter->Valid() && iter->key() == UserKeyOf(kNumKeys - 1));
+  iter->SeekForPrev("a");
+  CheckCondition(!iter->Valid());
+
+  // Keys with a prefix: key0001xx are 50 to 99.
+  iter->SetPrefix("key0001");
+  int count = 0;
+  i = 50;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    while (!IsLive(i)) {
+      i++;
+    }
+    CheckCondition(iter->key() == UserKeyOf(i));
+    i++;
+    count++;
+  }
+  CheckCondition(count == 40 && i == 100);
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+    i--;
+    while (!IsLive(i)) {
+      i--;
+    }
+    CheckCondition(iter->key() == UserKeyOf(i));
+    count--;
+  }
+  CheckCondition(count == 0 && i == 50);
+  iter->SetPrefix("nokey");
+  iter->SeekToFirst();
+  CheckCondition(!iter->Valid());
+  iter->SeekToLast();
+  CheckCondition(!iter->Valid());
+  delete iter;
+}
+
+static void TestBlockCache() {
+  phase = "block cache";
+  BuildFile(NULL);
+  Options options;
+  options.block_cache = NewLRUCache(1 << 20);
+  SstFileReader reader(options);
+  CheckCondition(reader.Open(kFileName).ok());
+  ReadOptions read_options;
+  read_options.verify_checksums = true;
+  CheckGets(&reader, read_options);
+  size_t usage = options.block_cache->GetUsage();
+  CheckCondition(usage > 0);
+  CheckCondition(options.block_cache->GetPinnedUsage() == 0);
+  CheckGets(&reader, read_options);
+  CheckCondition(options.block_cache->GetUsage() == usage);
+
+  // Several readers share the cache.
+  SstFileReader other(options);
+  CheckCondition(other.Open(kFileName).ok());
+  CheckGets(&other, read_options);
+  CheckCondition(options.block_cache->GetUsage() == 2 * usage);
+
+  // Iterators pin a block at a time.
+  Iterator *iter = reader.NewIterator(read_options);
+  iter->SeekToFirst();
+  CheckCondition(iter->Valid());
+  CheckCondition(options.block_cache->GetPinnedUsage() > 0);
+  delete iter;
+  CheckCondition(options.block_cache->GetPinnedUsage() == 0);
+
+  // Without fill_cache, nothing is added.
+  Options uncached_options;
+  uncached_options.block_cache = NewLRUCache(1 << 20);
+  SstFileReader uncached(uncached_options);
+  CheckCondition(uncached.Open(kFileName).ok());
+  read_options.fill_cache = false;
+  CheckGets(&uncached, read_options);
+  CheckCondition(uncached_options.block_cache->GetUsage() == 0);
+
+  // Blocks that do not fit a strict cache are read anyway.
+  Options tiny_options;
+  tiny_options.block_cache = NewLRUCache(100, 0, true);
+  SstFileReader tiny(tiny_options);
+  CheckCondition(tiny.Open(kFileName).ok());
+  read_options.fill_cache = true;
+  CheckGets(&tiny, read_options);
+  CheckCondition(tiny_options.block_cache->GetUsage() == 0);
+
+  // Concurrent readers.
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.push_back(std::thread([&reader, read_options]() {
+      CheckGets(&reader, read_options);
+      Iterator *it = reader.NewIterator(read_options);
+      int n = 0;
+      for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        n++;
+      }
+      CheckCondition(it->status().ok() && n > 0);
+      delete it;
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); t++) {
+    threads[t].join();
+  }
+  CheckCondition(options.block_cache->GetPinnedUsage() == 0);
+}
+
+static void TestFilter(bool use_block_based_builder) {
+  phase = use_block_based_builder ? "block filter" : "full filter";
+  const FilterPolicy *policy =
+      NewBloomFilterPolicy(10, use_block_based_builder);
+  BuildFile(policy);
+  Options options;
+  options.filter_policy = const_cast<FilterPolicy *>(policy);
+  SstFileReader reader(options);
+  CheckCondition(reader.Open(kFileName).ok());
+  CheckGets(&reader, ReadOptions());
+
+  // A policy the file has no filter of is ignored.
+  const FilterPolicy *other = NewBloomFilterPolicy(10, !use_block_based_builder);
+  options.filter_policy = const_cast<FilterPolicy *>(other);
+  SstFileReader unfiltered(options);
+  CheckCondition(unfiltered.Open(kFileName).ok());
+  CheckGets(&unfiltered, ReadOptions());
+  delete other;
+  delete policy;
+}
+
+static void TestCorruption() {
+  phase = "corruption";
+  BuildFile(NULL);
+  // Flip a byte in the first data block.
+  FILE *f = fopen(kFileName, "r+b");
+  CheckCondition(f != NULL);
+  CheckCondition(fseek(f, 100, SEEK_SET) == 0);
+  int c = fgetc(f);
+  CheckCondition(fseek(f, 100, SEEK_SET) == 0);
+  fputc(c ^ 0x40, f);
+  fclose(f);
+
+  Options options;
+  SstFileReader reader(options);
+  CheckCondition(reader.Open(kFileName).ok());
+  CheckCondition(reader.VerifyChecksum().IsCorruption());
+  ReadOptions read_options;
+  read_options.verify_checksums = true;
+  string value;
+  CheckCondition(reader.Get(read_options, UserKeyOf(0), &value).IsCorruption());
+  Iterator *iter = reader.NewIterator(read_options);
+  iter->SeekToFirst();
+  CheckCondition(!iter->Valid() && iter->status().IsCorruption());
+  delete iter;
+  // A later block is still readable.
+  CheckCondition(reader.Get(read_options, UserKeyOf(kNumKeys - 1), &value).ok());
+}
+
+// The size of the compression dictionary block of the file, -1 if its
+// meta index has none.  The file has no filter, the dictionary is the
+// first meta block and its key is not prefix compressed.
+static int64_t CompressionDictSize() {
+  string contents;
+  FILE *f = fopen(kFileName, "rb");
+  CheckCondition(f != NULL);
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    contents.append(buf, n);
+  }
+  fclose(f);
+  const string key = "rocksdb.compression_dict";
+  size_t pos = contents.find(key);
+  if (pos == string::npos) {
+    return -1;
+  }
+  Slice handle(contents.data() + pos + key.size(),
+               contents.size() - pos - key.size());
+  uint64_t offset = 0, size = 0;
+  CheckCondition(GetVarint64(&handle, &offset));
+  CheckCondition(GetVarint64(&handle, &size));
+  CheckCondition(offset + size <= contents.size());
+  return static_cast<int64_t>(size);
+}
+
+// Blocks compressed and decompressed with the contexts each thread reuses
+// read back the same, whichever thread did it.  Types not compiled in are
+// stored uncompressed.  With dict_sample_blocks, ZSTD blocks are
+// compressed with a dictionary trained on that many blocks, more than
+// the file has when large.
+static void TestCompression(CompressionType type, int dict_sample_blocks) {
+  phase = "compression";
+  for (int compress_threads = 1; compress_threads <= 4;
+       compress_threads += 3) {
+    BuildFile(NULL, type, compress_threads, dict_sample_blocks);
+    if (dict_sample_blocks > 0 && ZSTD_Supported()) {
+      CheckCondition(CompressionDictSize() > 0);
+    } else {
+      CheckCondition(CompressionDictSize() == -1);
+    }
+    Options options;
+    SstFileReader reader(options);
+    CheckCondition(reader.Open(kFileName).ok());
+    ReadOptions read_options;
+    read_options.verify_checksums = true;
+    CheckGets(&reader, read_options);
+    CheckCondition(reader.VerifyChecksum().ok());
+    vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+      threads.push_back(std::thread([&reader, read_options]() {
+        CheckGets(&reader, read_options);
+      }));
+    }
+    for (size_t t = 0; t < threads.size(); t++) {
+      threads[t].join();
+    }
+  }
+}
+
+int main() {
+  TestGet();
+  TestIterator();
+  TestBlockCache();
+  TestFilter(false);
+  TestFilter(true);
+  TestCorruption();
+  TestCompression(kZlibCompression, 0);
+  TestCompression(kLZ4Compression, 0);
+  TestCompression(kLZ4HCCompression, 0);
+  TestCompression(kZSTD, 0);
+  TestCompression(kZSTD, 16);
+  TestCompression(kZSTD, 100000);
+  Env::Default()->DeleteFile(kFileName);
+  std::cout << "sst file reader test pass." << std::endl;
+  return 0;
+}
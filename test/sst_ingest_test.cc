@@ -0,0 +1,575 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "swift/comparator.h"
+#include "swift/env.h"
+#include "swift/options.h"
+#include "swift/write_batch.h"
+#include "src/venice_kv.h"
+#include "src/write_batch_internal.h"
+#include "table/dbformat.h"
+#include "table/sst_ingest.h"
+#include "table/sst_table.h"
+#include "table/table_builder.h"
+#include "util/coding.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+static const char *kDir = "/tmp/sst_ingest_test";
+
+static void SleepMillis(int ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// A kv as it was written to a batch.
+struct Entry {
+  string key;
+  string value;
+  uint64_t timestamp;
+  int type;  // kTypeValue or kTypeDeletion of util/coding.h
+};
+
+// Keeps what would have been written to the device, one vector of
+// entries per batch.  Write number fail_at, counted from 0, fails.
+class RecordingWriter : public BatchWriter {
+ public:
+  explicit RecordingWriter(int fail_at = -1, int delay_ms = 0)
+      : fail_at_(fail_at), delay_ms_(delay_ms), writes_(0) {}
+
+  virtual Status Write(const WriteOptions &options, WriteBatchNonatomic *wb) {
+    if (delay_ms_ > 0) {
+      SleepMillis(delay_ms_);
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    if (writes_++ == fail_at_) {
+      return Status::IOError("injected write error");
+    }
+    // Values are pointed to, repoint them after the batch grew.
+    wb->SetOffset();
+    vector<Entry> entries;
+    Slice input = WriteBatchInternalNonatomic::Contents(wb);
+    CheckCondition(input.size() >= sizeof(struct write_batch_header));
+    input.remove_prefix(sizeof(struct write_batch_header));
+    while (!input.empty()) {
+      const struct writebatch_cmd *cmd =
+          reinterpret_cast<const struct writebatch_cmd *>(input.data());
+      CheckCondition(cmd->watermark == CMD_START_MARK);
+      Entry e;
+      e.key.assign(cmd->key, cmd->key_len);
+      if (cmd->cmd_type == kTypeValue) {
+        e.value.assign(cmd->value, cmd->value_len);
+      }
+      e.timestamp = cmd->timestamp;
+      e.type = cmd->cmd_type;
+      entries.push_back(e);
+      input.remove_prefix(sizeof(*cmd) + cmd->key_len);
+    }
+    CheckCondition((int)entries.size() ==
+                   WriteBatchInternalNonatomic::Count(wb));
+    batches_.push_back(entries);
+    return Status::OK();
+  }
+
+  int writes() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return writes_;
+  }
+
+  // The entries of all batches written, in order.
+  vector<Entry> entries() {
+    std::lock_guard<std::mutex> lock(mu_);
+    vector<Entry> all;
+    for (size_t i = 0; i < batches_.size(); i++) {
+      all.insert(all.end(), batches_[i].begin(), batches_[i].end());
+    }
+    return all;
+  }
+
+  vector<vector<Entry> > batches() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return batches_;
+  }
+
+ private:
+  const int fail_at_;
+  const int delay_ms_;
+  std::mutex mu_;
+  int writes_;
+  vector<vector<Entry> > batches_;
+};
+
+// Kvs of a decoded block, every third one a deletion.
+static void MakeBlock(int first, int n, DecodedBlock *block) {
+  block->data.clear();
+  block->kvs.clear();
+  for (int i = first; i < first + n; i++) {
+    char key[32];
+    snprintf(key, sizeof(key), "key%08d", i);
+    string value(i % 3 == 1 ? 0 : 10 + i % 50, 'a' + i % 26);
+    DecodedKv kv;
+    kv.offset = block->data.size();
+    kv.key_len = strlen(key);
+    kv.value_len = value.size();
+    kv.sequence = 1000000 + i;
+    kv.type = i % 3 == 2 ? kSstTypeDeletion : kSstTypeValue;
+    if (kv.type == kSstTypeDeletion) {
+      kv.value_len = 0;
+      value.clear();
+    }
+    block->data.append(key);
+    block->data.append(value);
+    block->kvs.push_back(kv);
+  }
+}
+
+static void CheckEntries(const vector<Entry> &entries, int first, int n) {
+  DecodedBlock block;
+  MakeBlock(first, n, &block);
+  CheckCondition(entries.size() == (size_t)n);
+  for (int i = 0; i < n; i++) {
+    const DecodedKv &kv = block.kvs[i];
+    const Entry &e = entries[i];
+    CheckCondition(e.key == block.data.substr(kv.offset, kv.key_len));
+    CheckCondition(e.timestamp == kv.sequence);
+    if (kv.type == kSstTypeValue) {
+      CheckCondition(e.type == kTypeValue);
+      CheckCondition(e.value == block.data.substr(kv.offset + kv.key_len,
+                                                  kv.value_len));
+    } else {
+      CheckCondition(e.type == kTypeDeletion);
+    }
+  }
+}
+
+static Status AddAll(BatchSubmitter *submitter, const DecodedBlock &block) {
+  Status s;
+  for (size_t i = 0; s.ok() && i < block.kvs.size(); i++) {
+    s = submitter->Add(block, block.kvs[i]);
+  }
+  return s;
+}
+
+static void TestBatchSubmitter() {
+  WriteOptions write_opt;
+  DecodedBlock block;
+
+  phase = "partial last batch";
+  {
+    // Two full batches and a partial one.
+    int n = 2 * MAX_BATCH_NONATOMIC_COUNT + 7;
+    RecordingWriter writer;
+    BatchSubmitter submitter(&writer, NULL, write_opt);
+    MakeBlock(0, n, &block);
+    CheckCondition(AddAll(&submitter, block).ok());
+    CheckCondition(submitter.Finish().ok());
+    vector<vector<Entry> > batches = writer.batches();
+    CheckCondition(batches.size() == 3);
+    CheckCondition(batches[0].size() == MAX_BATCH_NONATOMIC_COUNT);
+    CheckCondition(batches[1].size() == MAX_BATCH_NONATOMIC_COUNT);
+    CheckCondition(batches[2].size() == 7);
+    CheckEntries(writer.entries(), 0, n);
+  }
+  {
+    // Fewer kvs than a batch holds, and none at all.
+    RecordingWriter writer;
+    BatchSubmitter submitter(&writer, NULL, write_opt);
+    MakeBlock(0, 5, &block);
+    CheckCondition(AddAll(&submitter, block).ok());
+    CheckCondition(submitter.Finish().ok());
+    CheckCondition(writer.writes() == 1);
+    CheckEntries(writer.entries(), 0, 5);
+
+    RecordingWriter empty_writer;
+    BatchSubmitter empty(&empty_writer, NULL, write_opt);
+    CheckCondition(empty.Finish().ok());
+    CheckCondition(empty_writer.writes() == 0);
+  }
+
+  phase = "submit failure";
+  {
+    // The second batch fails while the caller fills the third.  The
+    // caller sees the error at the latest when it submits the third, and
+    // nothing is written after it.
+    RecordingWriter writer(1);
+    BatchSubmitter submitter(&writer, NULL, write_opt);
+    MakeBlock(0, 4 * MAX_BATCH_NONATOMIC_COUNT, &block);
+    Status s = AddAll(&submitter, block);
+    CheckCondition(s.IsIOError());
+    CheckCondition(submitter.Finish().IsIOError());
+    CheckCondition(writer.writes() == 2);
+    CheckEntries(writer.entries(), 0, MAX_BATCH_NONATOMIC_COUNT);
+  }
+  {
+    // The last, partial batch fails: Finish() reports it.
+    RecordingWriter writer(1);
+    BatchSubmitter submitter(&writer, NULL, write_opt);
+    MakeBlock(0, MAX_BATCH_NONATOMIC_COUNT + 3, &block);
+    CheckCondition(AddAll(&submitter, block).ok());
+    CheckCondition(submitter.Finish().IsIOError());
+    CheckCondition(writer.writes() == 2);
+  }
+
+  phase = "early return";
+  {
+    // The producer gives up with one batch at the writer and one being
+    // filled: the submitted batch is still written, the other dropped.
+    RecordingWriter writer(-1, 100);
+    {
+      BatchSubmitter submitter(&writer, NULL, write_opt);
+      MakeBlock(0, MAX_BATCH_NONATOMIC_COUNT + 10, &block);
+      CheckCondition(AddAll(&submitter, block).ok());
+    }
+    CheckCondition(writer.writes() == 1);
+    CheckEntries(writer.entries(), 0, MAX_BATCH_NONATOMIC_COUNT);
+  }
+  {
+    // Nothing submitted.
+    RecordingWriter writer;
+    {
+      BatchSubmitter submitter(&writer, NULL, write_opt);
+      MakeBlock(0, 10, &block);
+      CheckCondition(AddAll(&submitter, block).ok());
+    }
+    CheckCondition(writer.writes() == 0);
+  }
+}
+
+// A version of a user key in a table.
+struct Record {
+  string user_key;
+  uint64_t sequence;
+  ValueType type;
+  string value;
+};
+
+// Orders user keys backwards.
+class ReverseComparator : public Comparator {
+ public:
+  virtual int Compare(const Slice &a, const Slice &b) const {
+    return -a.compare(b);
+  }
+  virtual const char *Name() const { return "sst_ingest_test.Reverse"; }
+  virtual void FindShortestSeparator(std::string *, const Slice &) const {}
+  virtual void FindShortSuccessor(std::string *) const {}
+};
+
+static string UserKey(int i) {
+  char key[32];
+  snprintf(key, sizeof(key), "key%06d", i);
+  return key;
+}
+
+// Write records, sorted by internal key of user_comparator, to a table in
+// small blocks.
+static string BuildTable(const string &name, const vector<Record> &records,
+                         const Comparator *user_comparator,
+                         IndexType index_type = kBinarySearch) {
+  string fname = string(kDir) + "/" + name;
+  InternalKeyComparator comparator(user_comparator);
+  Options options;
+  options.block_size = 256;
+  options.index_type = index_type;
+  options.metadata_block_size = 512;
+  options.inner_comparator = &comparator;
+  Env *env = Env::Default();
+  env->DeleteFile(fname);
+  WritableFile *file;
+  CheckCondition(env->NewWritableFile(fname, &file).ok());
+  TableBuilder builder(options, file, "default", 0);
+  for (size_t i = 0; i < records.size(); i++) {
+    string key;
+    AppendInternalKey(&key, ParsedInternalKey(records[i].user_key,
+                                              records[i].sequence,
+                                              records[i].type));
+    builder.Add(key, records[i].value);
+  }
+  CheckCondition(builder.Finish(1, 2).ok());
+  CheckCondition(file->Close().ok());
+  delete file;
+  return fname;
+}
+
+static Record MakeRecord(int i, uint64_t sequence, bool deletion,
+                         const string &tag) {
+  Record r;
+  r.user_key = UserKey(i);
+  r.sequence = sequence;
+  r.type = deletion ? kSstTypeDeletion : kSstTypeValue;
+  if (!deletion) {
+    char value[64];
+    snprintf(value, sizeof(value), "%s-%d-%lu", tag.c_str(), i,
+             (unsigned long)sequence);
+    r.value = value;
+  }
+  return r;
+}
+
+static void TestMerge() {
+  phase = "merge";
+  // a holds keys 0-199, b keys 100-299 newer than a but every fourth
+  // older, c two versions of keys 150-159, the newer a tombstone for odd
+  // keys, and newer than a and b.
+  vector<vector<Record> > tables(3);
+  for (int i = 0; i < 200; i++) {
+    tables[0].push_back(MakeRecord(i, 1000 + i, i % 10 == 3, "a"));
+  }
+  for (int i = 100; i < 300; i++) {
+    uint64_t sequence = i % 4 == 0 ? 500 + i : 2000 + i;
+    tables[1].push_back(MakeRecord(i, sequence, i % 7 == 0, "b"));
+  }
+  for (int i = 150; i < 160; i++) {
+    tables[2].push_back(MakeRecord(i, 3000 + 2 * i + 1, i % 2 == 1, "c"));
+    tables[2].push_back(MakeRecord(i, 3000 + 2 * i, false, "c"));
+  }
+  vector<string> files;
+  for (size_t t = 0; t < tables.size(); t++) {
+    files.push_back(BuildTable(string(1, 'a' + t) + ".sst", tables[t],
+                               BytewiseComparator()));
+  }
+
+  // The newest version of every user key and the table it is in.
+  map<string, pair<Record, size_t> > newest;
+  vector<IngestExternalFileReport> expected(tables.size());
+  for (size_t t = 0; t < tables.size(); t++) {
+    for (size_t i = 0; i < tables[t].size(); i++) {
+      const Record &r = tables[t][i];
+      auto it = newest.find(r.user_key);
+      if (it == newest.end()) {
+        newest[r.user_key] = make_pair(r, t);
+      } else if (r.sequence > it->second.first.sequence) {
+        expected[it->second.second].keys_dropped++;
+        it->second = make_pair(r, t);
+      } else {
+        expected[t].keys_dropped++;
+      }
+    }
+  }
+  for (auto it = newest.begin(); it != newest.end(); ++it) {
+    if (it->second.first.type == kSstTypeValue) {
+      expected[it->second.second].keys_put++;
+    } else {
+      expected[it->second.second].keys_deleted++;
+    }
+  }
+
+  IngestExternalFileOptions options;
+  options.merge_files = true;
+  RecordingWriter writer;
+  vector<IngestExternalFileReport> reports;
+  Status s = IngestMergedFiles(files, NULL, NULL, options, &reports, &writer);
+  CheckCondition(s.ok());
+  vector<Entry> entries = writer.entries();
+  CheckCondition(entries.size() == newest.size());
+  size_t n = 0;
+  for (auto it = newest.begin(); it != newest.end(); ++it, n++) {
+    const Record &r = it->second.first;
+    CheckCondition(entries[n].key == r.user_key);
+    CheckCondition(entries[n].timestamp == r.sequence);
+    if (r.type == kSstTypeValue) {
+      CheckCondition(entries[n].type == kTypeValue);
+      CheckCondition(entries[n].value == r.value);
+    } else {
+      CheckCondition(entries[n].type == kTypeDeletion);
+    }
+  }
+  CheckCondition(reports.size() == files.size());
+  for (size_t t = 0; t < files.size(); t++) {
+    CheckCondition(reports[t].status.ok());
+    CheckCondition(reports[t].filename == files[t]);
+    CheckCondition(reports[t].cf_name == "default");
+    CheckCondition(reports[t].keys_put == expected[t].keys_put);
+    CheckCondition(reports[t].keys_deleted == expected[t].keys_deleted);
+    CheckCondition(reports[t].keys_dropped == expected[t].keys_dropped);
+    CheckCondition(reports[t].keys_put + reports[t].keys_deleted +
+                       reports[t].keys_dropped == tables[t].size());
+  }
+  // Every table loses versions, and tombstones of each are kept.
+  CheckCondition(expected[0].keys_dropped > 0 && expected[0].keys_deleted > 0);
+  CheckCondition(expected[1].keys_dropped > 0 && expected[1].keys_deleted > 0);
+  CheckCondition(expected[2].keys_dropped > 0 && expected[2].keys_deleted > 0);
+
+  phase = "merge non-bytewise";
+  {
+    ReverseComparator reverse;
+    vector<Record> records;
+    for (int i = 99; i >= 0; i--) {
+      records.push_back(MakeRecord(i, 5000 + i, false, "r"));
+    }
+    vector<string> mixed;
+    mixed.push_back(files[0]);
+    mixed.push_back(BuildTable("reverse.sst", records, &reverse));
+    RecordingWriter reverse_writer;
+    s = IngestMergedFiles(mixed, NULL, NULL, options, &reports,
+                          &reverse_writer);
+    CheckCondition(s.IsNotSupported());
+    CheckCondition(reports[0].status.IsAborted());
+    CheckCondition(reports[1].status.IsNotSupported());
+    CheckCondition(reverse_writer.writes() == 0);
+    Env::Default()->DeleteFile(mixed[1]);
+  }
+  for (size_t t = 0; t < files.size(); t++) {
+    Env::Default()->DeleteFile(files[t]);
+  }
+}
+
+// A table opened the way AnalyzeSst() opens it, with its index block.
+struct OpenedTable {
+  MappedFile file;
+  Foot foot;
+  MetaBlockProperties props;
+  BlockRep index_rep;
+  DatabaseOptions db_opt;
+};
+
+static void OpenTable(const string &fname, BatchWriter *writer,
+                      OpenedTable *t) {
+  memset(&t->props, 0, sizeof(MetaBlockProperties));
+  memset((void *)&t->index_rep, 0, sizeof(BlockRep));
+  memset((void *)&t->db_opt, 0, sizeof(DatabaseOptions));
+  CheckCondition(OpenMappedFile(const_cast<char *>(fname.c_str()),
+                                &t->file) == 0);
+  Slice foot_content;
+  uint8_t foot_copied = 0;
+  CheckCondition(ReadFoot(&foot_content, &t->file, &foot_copied).ok());
+  Slice input = foot_content;
+  CheckCondition(FootDecodeFrom(&t->foot, &input, 1).ok());
+  if (foot_copied) {
+    free((void *)foot_content.data());
+  }
+  CheckCondition(ProcessMetaIndex(&t->file, &t->props, &t->foot).ok());
+  t->db_opt.write_opt.sync = true;
+  t->db_opt.writer = writer;
+  t->index_rep.filename = t->file.filename;
+  t->index_rep.file = &t->file;
+  t->index_rep.checksum_type = t->foot.checksum_type;
+  t->index_rep.props = &t->props;
+  t->index_rep.opt = &t->db_opt;
+  CheckCondition(ReadBlock(&t->index_rep.block, &t->file,
+                           &t->foot.index_handle, t->foot.checksum_type,
+                           &t->index_rep.block_copied).ok());
+}
+
+static void CloseTable(OpenedTable *t) {
+  if (t->index_rep.block_copied) {
+    free((void *)t->index_rep.block.data());
+  }
+  CloseMappedFile(&t->file);
+}
+
+static vector<BlockHandle> DataBlockHandles(OpenedTable *t) {
+  vector<BlockHandle> handles;
+  DataBlockHandleIter iter(&t->file, t->foot.checksum_type, &t->props);
+  CheckCondition(iter.SeekToFirst(t->index_rep.block).ok());
+  while (iter.Valid()) {
+    handles.push_back(iter.handle());
+    CheckCondition(iter.Next().ok());
+  }
+  return handles;
+}
+
+static void CheckRecords(const vector<Entry> &entries,
+                         const vector<Record> &records) {
+  CheckCondition(entries.size() <= records.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    CheckCondition(entries[i].key == records[i].user_key);
+    CheckCondition(entries[i].timestamp == records[i].sequence);
+    if (records[i].type == kSstTypeValue) {
+      CheckCondition(entries[i].type == kTypeValue);
+      CheckCondition(entries[i].value == records[i].value);
+    } else {
+      CheckCondition(entries[i].type == kTypeDeletion);
+    }
+  }
+}
+
+static void TestIngestDataBlocks(IndexType index_type) {
+  phase = index_type == kTwoLevelIndexSearch ? "ingest partitioned"
+                                             : "ingest";
+  // More kvs than two batches hold, in a few hundred blocks.
+  vector<Record> records;
+  uint32_t puts = 0, dels = 0;
+  for (int i = 0; i < 2 * MAX_BATCH_NONATOMIC_COUNT + 500; i++) {
+    records.push_back(MakeRecord(i, 100000 - i, i % 9 == 4, "d"));
+    if (records.back().type == kSstTypeValue) {
+      puts++;
+    } else {
+      dels++;
+    }
+  }
+  string fname = BuildTable("ingest.sst", records, BytewiseComparator(),
+                            index_type);
+
+  {
+    RecordingWriter writer;
+    OpenedTable t;
+    OpenTable(fname, &writer, &t);
+    size_t blocks = DataBlockHandles(&t).size();
+    CheckCondition(blocks > 100);
+    // A small window, so workers wait for the caller.
+    CheckCondition(IngestDataBlocks(&t.index_rep, 4, 3).ok());
+    vector<Entry> entries = writer.entries();
+    CheckCondition(entries.size() == records.size());
+    CheckRecords(entries, records);
+    CheckCondition(writer.batches().size() == 3);
+    CheckCondition(t.index_rep.data_block_count == blocks);
+    CheckCondition(t.index_rep.kv_put_count == puts);
+    CheckCondition(t.index_rep.kv_del_count == dels);
+    CloseTable(&t);
+  }
+
+  phase = index_type == kTwoLevelIndexSearch ? "ingest partitioned corrupt"
+                                             : "ingest corrupt";
+  {
+    // Flip a byte in a data block in the middle of the file.
+    OpenedTable t;
+    OpenTable(fname, NULL, &t);
+    vector<BlockHandle> handles = DataBlockHandles(&t);
+    BlockHandle bad = handles[handles.size() / 2];
+    CloseTable(&t);
+    FILE *f = fopen(fname.c_str(), "r+b");
+    CheckCondition(f != NULL);
+    CheckCondition(fseek(f, bad.offset + bad.size / 2, SEEK_SET) == 0);
+    int c = fgetc(f);
+    CheckCondition(fseek(f, bad.offset + bad.size / 2, SEEK_SET) == 0);
+    fputc(c ^ 0x5a, f);
+    fclose(f);
+
+    RecordingWriter writer;
+    OpenTable(fname, &writer, &t);
+    Status s = IngestDataBlocks(&t.index_rep, 4, 3);
+    CheckCondition(s.IsCorruption());
+    // Only whole batches before the bad block were written.
+    CheckCondition(t.index_rep.data_block_count == handles.size() / 2);
+    vector<Entry> entries = writer.entries();
+    CheckCondition(entries.size() < records.size() / 2 + 100);
+    CheckRecords(entries, records);
+    CloseTable(&t);
+  }
+  Env::Default()->DeleteFile(fname);
+}
+
+int main() {
+  // A hang of the writer threads fails the test instead of blocking it.
+  alarm(300);
+  Env::Default()->CreateDir(kDir);
+  TestBatchSubmitter();
+  TestMerge();
+  TestIngestDataBlocks(kBinarySearch);
+  TestIngestDataBlocks(kTwoLevelIndexSearch);
+  printf("sst ingest test pass.\n");
+  return 0;
+}
@@ -0,0 +1,148 @@
+#include <iostream>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "swift/statistics.h"
+#include "swift/perf_context.h"
+#include "../src/perf_context_imp.h"
+#include "../util/histogram.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+static void TestBucketMapper() {
+  phase = "bucket mapper";
+  for (uint64_t v = 0; v < 100000; v++) {
+    size_t index = HistogramBucketMapper::IndexForValue(v);
+    CheckCondition(index < HistogramBucketMapper::kBucketCount);
+    CheckCondition(HistogramBucketMapper::BucketLowerBound(index) <= v);
+    CheckCondition(HistogramBucketMapper::BucketUpperBound(index) >= v);
+  }
+  size_t last = HistogramBucketMapper::IndexForValue(UINT64_MAX);
+  CheckCondition(last == HistogramBucketMapper::kBucketCount - 1);
+}
+
+static void TestPercentiles() {
+  phase = "percentiles";
+  HistogramImpl histogram;
+  for (uint64_t v = 1; v <= 10000; v++) {
+    histogram.Add(v);
+  }
+  HistogramData data;
+  histogram.Data(&data);
+  CheckCondition(data.count == 10000);
+  CheckCondition(data.min == 1);
+  CheckCondition(data.max == 10000);
+  // one sub-bucket is at most 1/16 of the value wide
+  CheckCondition(data.median > 5000 * 0.93 && data.median < 5000 * 1.07);
+  CheckCondition(data.percentile99 > 9900 * 0.93 &&
+                 data.percentile99 <= 10000);
+  CheckCondition(data.percentile999 >= data.percentile99);
+  CheckCondition(data.average > 5000 && data.average < 5001);
+}
+
+static void TestConcurrentTickers() {
+  phase = "concurrent tickers";
+  std::shared_ptr<Statistics> stats = CreateDBStatistics();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.push_back(std::thread([&stats]() {
+      for (int i = 0; i < 100000; i++) {
+        stats->recordTick(NUMBER_KEYS_WRITTEN);
+        stats->measureTime(DB_PUT, i % 100);
+      }
+    }));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  CheckCondition(stats->getTickerCount(NUMBER_KEYS_WRITTEN) == 400000);
+  HistogramData data;
+  stats->histogramData(DB_PUT, &data);
+  CheckCondition(data.count == 400000);
+  CheckCondition(data.max == 99);
+  CheckCondition(stats->ToString().find("shannon.db.put.micros") !=
+                 std::string::npos);
+  stats->Reset();
+  CheckCondition(stats->getTickerCount(NUMBER_KEYS_WRITTEN) == 0);
+}
+
+static void TestPerfLevel() {
+  phase = "perf level";
+  CheckCondition(GetPerfLevel() == kDisable);
+  SetPerfLevel(kEnableTime);
+  CheckCondition(GetPerfLevel() == kEnableTime);
+  std::thread other([]() { CheckCondition(GetPerfLevel() == kDisable); });
+  other.join();
+  get_perf_context()->Reset();
+  CheckCondition(get_perf_context()->ToString(true).empty());
+  SetPerfLevel(kDisable);
+}
+
+// An ioctl on a pipe and the counter macros, as the request path issues
+// them, at each level.
+static void TestPerfCounters() {
+  phase = "perf counters";
+  int fds[2];
+  CheckCondition(pipe(fds) == 0);
+  PerfContext *context = get_perf_context();
+  PerfLevel levels[] = {kDisable, kEnableCount, kEnableTime};
+  for (int l = 0; l < 3; l++) {
+    SetPerfLevel(levels[l]);
+    context->Reset();
+    int pending = -1;
+    for (int i = 0; i < 3; i++) {
+      CheckCondition(PerfIoctl(kPerfIoctlGet, fds[0], FIONREAD, &pending) == 0);
+    }
+    CheckCondition(pending == 0);
+    // errno of a failed ioctl reaches the caller.
+    CheckCondition(PerfIoctl(kPerfIoctlPut, -1, FIONREAD, &pending) == -1);
+    CheckCondition(errno == EBADF);
+    PERF_COUNTER_ADD(bytes_copied, 100);
+    PERF_HEAP_ALLOC(64);
+
+    bool counted = levels[l] >= kEnableCount;
+    bool timed = levels[l] >= kEnableTime;
+    CheckCondition(context->ioctl_count[kPerfIoctlGet] == (counted ? 3 : 0));
+    CheckCondition(context->ioctl_count[kPerfIoctlPut] == (counted ? 1 : 0));
+    CheckCondition(context->bytes_copied == (counted ? 100 : 0));
+    CheckCondition(context->heap_alloc_count == (counted ? 1 : 0));
+    CheckCondition(context->heap_alloc_bytes == (counted ? 64 : 0));
+    CheckCondition((context->ioctl_nanos[kPerfIoctlGet] > 0) == timed);
+    CheckCondition(context->ioctl_time ==
+                   context->ioctl_nanos[kPerfIoctlGet] +
+                       context->ioctl_nanos[kPerfIoctlPut]);
+    CheckCondition(context->ToString(true).empty() == !counted);
+    if (counted) {
+      CheckCondition(context->ToString(true).find(
+                         PerfIoctlName(kPerfIoctlGet)) != std::string::npos);
+    }
+  }
+  SetPerfLevel(kDisable);
+  context->Reset();
+  close(fds[0]);
+  close(fds[1]);
+}
+
+int main() {
+  TestBucketMapper();
+  TestPercentiles();
+  TestConcurrentTickers();
+  TestPerfLevel();
+  TestPerfCounters();
+  std::cout << "statistics test pass." << std::endl;
+  return 0;
+}
@@ -0,0 +1,507 @@
+#include <iostream>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "swift/comparator.h"
+#include "swift/env.h"
+#include "swift/filter_policy.h"
+#include "swift/options.h"
+#include "../table/block.h"
+#include "../table/dbformat.h"
+#include "../table/sst_table.h"
+#include "../table/table_builder.h"
+#include "../util/coding.h"
+#include "../util/crc32c.h"
+#include "../util/xxh3.h"
+#include "../util/xxhash.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+class StringFile : public WritableFile {
+ public:
+  explicit StringFile(string *contents) : contents_(contents) {}
+  virtual Status Append(const Slice &data) {
+    contents_->append(data.data(), data.size());
+    return Status::OK();
+  }
+  virtual Status Close() { return Status::OK(); }
+  virtual Status Flush() { return Status::OK(); }
+  virtual Status Sync() { return Status::OK(); }
+
+ private:
+  string *contents_;
+};
+
+static string KeyOf(int i) {
+  char key[32];
+  snprintf(key, sizeof(key), "key%010d", i);
+  return key;
+}
+
+static string ValueOf(int i) { return string(100 + i % 300, 'a' + i % 26); }
+
+static string BuildTable(Options options, int num_keys) {
+  string contents;
+  StringFile file(&contents);
+  TableBuilder builder(options, &file, "default", 0);
+  for (int i = 0; i < num_keys; i++) {
+    builder.Add(KeyOf(i), ValueOf(i));
+  }
+  CheckCondition(num_keys == 0 || builder.CurFileSize() > 0);
+  Status s = builder.Finish(1, 2);
+  CheckCondition(s.ok());
+  CheckCondition(builder.FileSize() == contents.size());
+  return contents;
+}
+
+// Parallel compression must produce the same file as inline compression.
+static void TestParallelCompression(CompressionType type, bool filter) {
+  phase = "parallel compression";
+  Options options;
+  options.compression = type;
+  if (filter) {
+    options.filter_policy = const_cast<FilterPolicy *>(NewBloomFilterPolicy(10));
+  }
+  string expected = BuildTable(options, 50000);
+  int threads[] = {2, 4};
+  int pending[] = {0, 2, 16};
+  for (int t = 0; t < 2; t++) {
+    for (int p = 0; p < 3; p++) {
+      options.compression_parallel_threads = threads[t];
+      options.compression_max_pending_blocks = pending[p];
+      CheckCondition(BuildTable(options, 50000) == expected);
+    }
+  }
+  // Tables of a single block or no block at all.
+  options.compression_parallel_threads = 1;
+  string single = BuildTable(options, 1);
+  string empty = BuildTable(options, 0);
+  options.compression_parallel_threads = 4;
+  CheckCondition(BuildTable(options, 1) == single);
+  CheckCondition(BuildTable(options, 0) == empty);
+  delete options.filter_policy;
+}
+
+// The footer records the checksum type and every block trailer holds the
+// checksum RocksDB expects for it.
+static void TestChecksumTypes() {
+  phase = "checksum types";
+  ChecksumType types[] = {kCRC32c, kxxHash, kXXH3};
+  for (int t = 0; t < 3; t++) {
+    Options options;
+    options.checksum = types[t];
+    options.filter_policy = const_cast<FilterPolicy *>(NewBloomFilterPolicy(10));
+    string contents = BuildTable(options, 2000);
+    delete options.filter_policy;
+
+    const size_t kFooterSize = 53;
+    CheckCondition(contents.size() > kFooterSize);
+    Slice footer(contents.data() + contents.size() - kFooterSize, kFooterSize);
+    CheckCondition(footer[0] == types[t]);
+    // Blocks are laid out back to back up to the footer.
+    size_t offset = 0;
+    int blocks = 0;
+    while (offset < contents.size() - kFooterSize) {
+      Slice rest(contents.data() + offset, contents.size() - offset);
+      // Find the block ending here by trying each trailer position.
+      size_t n = 0;
+      bool found = false;
+      for (; offset + n + 5 <= contents.size() - kFooterSize; n++) {
+        const char *data = rest.data();
+        uint32_t stored = DecodeFixed32(data + n + 1);
+        uint32_t expected;
+        if (types[t] == kCRC32c) {
+          expected = crc32c::Mask(crc32c::Value(data, n + 1));
+        } else if (types[t] == kxxHash) {
+          expected = XXH32(data, n + 1, 0);
+        } else {
+          expected = static_cast<uint32_t>(xxh3::Hash64(data, n)) ^
+                     (static_cast<uint8_t>(data[n]) * 0x6b9083d9u);
+        }
+        if (stored == expected &&
+            ComputeBlockChecksum(types[t], data, n, data[n]) == stored) {
+          found = true;
+          break;
+        }
+      }
+      CheckCondition(found);
+      offset += n + 5;
+      blocks++;
+    }
+    CheckCondition(offset == contents.size() - kFooterSize);
+    CheckCondition(blocks > 10);
+  }
+
+  Options options;
+  options.checksum = static_cast<ChecksumType>(3);
+  string contents;
+  StringFile file(&contents);
+  TableBuilder builder(options, &file);
+  CheckCondition(builder.status().IsNotSupported());
+  builder.Abandon();
+}
+
+// A full filter is stored under the key RocksDB looks for, with the
+// metadata of its layout at the end.
+static void TestFullFilter() {
+  phase = "full filter";
+  Options options;
+  options.compression = kSnappyCompression;
+  options.filter_policy =
+      const_cast<FilterPolicy *>(NewBloomFilterPolicy(10, false));
+  string contents = BuildTable(options, 20000);
+  CheckCondition(contents.find("fullfilter.rocksdb.BuiltinBloomFilter") !=
+                 string::npos);
+  CheckCondition(contents.find("filter.leveldb") == string::npos);
+  options.compression_parallel_threads = 4;
+  CheckCondition(BuildTable(options, 20000) == contents);
+
+  // The filter block is the filter of the keys, nothing more.
+  FilterBitsBuilder *bits = options.filter_policy->GetFilterBitsBuilder();
+  char key[32];
+  for (int i = 0; i < 20000; i++) {
+    snprintf(key, sizeof(key), "key%010d", i);
+    bits->AddKey(key);
+  }
+  string filter;
+  bits->Finish(&filter);
+  delete bits;
+  CheckCondition(contents.find(filter) != string::npos);
+  delete options.filter_policy;
+}
+
+static const char *kFileName = "/tmp/table_builder_test.sst";
+
+// The value of a numeric property of a table, found by its name.
+static uint64_t PropertyValue(const string &contents, const string &name) {
+  size_t pos = contents.find(name);
+  CheckCondition(pos != string::npos);
+  Slice input(contents.data() + pos + name.size(),
+              contents.size() - pos - name.size());
+  uint64_t value = 0;
+  CheckCondition(GetVarint64(&input, &value));
+  return value;
+}
+
+// The data block handles of a table, walked with DataBlockHandleIter as
+// an ingest does, and the properties it reads the index type from.  If
+// "num_keys" is not negative, the data blocks are read back through the
+// handles and must hold the keys and values BuildTable() wrote.
+static vector<pair<uint64_t, uint64_t> > ReadBlockHandles(
+    const string &contents, MetaBlockProperties *props, int num_keys = -1) {
+  Env *env = Env::Default();
+  WritableFile *writable;
+  CheckCondition(env->NewWritableFile(kFileName, &writable).ok());
+  CheckCondition(writable->Append(contents).ok());
+  CheckCondition(writable->Close().ok());
+  delete writable;
+
+  MappedFile file;
+  CheckCondition(OpenMappedFile(const_cast<char *>(kFileName), &file) == 0);
+  Slice foot_content;
+  uint8_t foot_copied = 0;
+  CheckCondition(ReadFoot(&foot_content, &file, &foot_copied).ok());
+  Foot foot;
+  Slice input = foot_content;
+  CheckCondition(FootDecodeFrom(&foot, &input, 1).ok());
+  if (foot_copied) {
+    free((void *)foot_content.data());
+  }
+  memset(props, 0, sizeof(MetaBlockProperties));
+  CheckCondition(ProcessMetaIndex(&file, props, &foot).ok());
+
+  Slice index;
+  uint8_t index_copied = 0;
+  CheckCondition(ReadBlock(&index, &file, &foot.index_handle,
+                           foot.checksum_type, &index_copied).ok());
+  vector<pair<uint64_t, uint64_t> > handles;
+  int i = 0;
+  {
+    DataBlockHandleIter iter(&file, foot.checksum_type, props);
+    Status s;
+    for (s = iter.SeekToFirst(index); s.ok() && iter.Valid(); s = iter.Next()) {
+      handles.push_back(make_pair(iter.handle().offset, iter.handle().size));
+      if (num_keys < 0) {
+        continue;
+      }
+      BlockHandle handle = iter.handle();
+      Slice data;
+      uint8_t data_copied = 0;
+      CheckCondition(ReadBlock(&data, &file, &handle, foot.checksum_type,
+                               &data_copied).ok());
+      Block block(data, data_copied != 0);
+      Block::Iter entries(&block, BytewiseComparator());
+      int first = i;
+      for (entries.SeekToFirst(); entries.Valid(); entries.Next()) {
+        CheckCondition(i < num_keys);
+        CheckCondition(entries.key() == KeyOf(i));
+        CheckCondition(entries.value() == ValueOf(i));
+        i++;
+      }
+      CheckCondition(entries.status().ok());
+      CheckCondition(i > first);
+    }
+    CheckCondition(s.ok());
+  }
+  CheckCondition(num_keys < 0 || i == num_keys);
+  if (index_copied) {
+    free((void *)index.data());
+  }
+  CloseMappedFile(&file);
+  env->DeleteFile(kFileName);
+  return handles;
+}
+
+// Hash, partitioned and delta encoded indexes lead to the same data
+// blocks as the binary search index, which hold the keys and values
+// written.
+static void TestIndexTypes() {
+  phase = "index types";
+  Options options;
+  options.compression = kSnappyCompression;
+  MetaBlockProperties props;
+  string binary = BuildTable(options, 20000);
+  vector<pair<uint64_t, uint64_t> > expected =
+      ReadBlockHandles(binary, &props, 20000);
+  CheckCondition(props.index_type == kBinarySearch);
+  CheckCondition(!props.index_value_is_delta_encoded);
+  CheckCondition(expected.size() > 100);
+  // Data blocks are laid out back to back from the start of the file.
+  uint64_t offset = 0;
+  for (size_t i = 0; i < expected.size(); i++) {
+    CheckCondition(expected[i].first == offset);
+    offset += expected[i].second + 5;
+  }
+
+  options.index_type = kHashSearch;
+  CheckCondition(ReadBlockHandles(BuildTable(options, 20000), &props, 20000) ==
+                 expected);
+  CheckCondition(props.index_type == kHashSearch);
+
+  // Delta encoded handles between the restart points of the index.
+  options.index_type = kBinarySearch;
+  options.index_value_delta_encoding = true;
+  options.index_block_restart_interval = 16;
+  string delta = BuildTable(options, 20000);
+  CheckCondition(ReadBlockHandles(delta, &props, 20000) == expected);
+  CheckCondition(props.index_value_is_delta_encoded);
+  CheckCondition(PropertyValue(delta, "rocksdb.index.size") <
+                 PropertyValue(binary, "rocksdb.index.size"));
+
+  // Small partitions, with full and with delta encoded handles.
+  options.index_type = kTwoLevelIndexSearch;
+  options.metadata_block_size = 256;
+  for (int encoded = 0; encoded < 2; encoded++) {
+    options.index_value_delta_encoding = encoded;
+    options.index_block_restart_interval = encoded ? 16 : 1;
+    string contents = BuildTable(options, 20000);
+    CheckCondition(ReadBlockHandles(contents, &props, 20000) == expected);
+    CheckCondition(props.index_type == kTwoLevelIndexSearch);
+    CheckCondition(props.index_value_is_delta_encoded == encoded);
+    CheckCondition(PropertyValue(contents, "rocksdb.index.partitions") > 10);
+    // Blocks written by the compression threads are indexed alike.
+    options.compression_parallel_threads = 4;
+    CheckCondition(BuildTable(options, 20000) == contents);
+    options.compression_parallel_threads = 1;
+  }
+  CheckCondition(ReadBlockHandles(BuildTable(options, 1), &props, 1).size() ==
+                 1);
+  CheckCondition(ReadBlockHandles(BuildTable(options, 0), &props, 0).empty());
+
+  options.index_type = static_cast<IndexType>(3);
+  string contents;
+  StringFile file(&contents);
+  TableBuilder builder(options, &file);
+  CheckCondition(builder.status().IsNotSupported());
+  builder.Abandon();
+}
+
+// A record of TestDecodeDataBlock: versions of a user key, newest first.
+struct Record {
+  string user_key;
+  uint64_t sequence;
+  ValueType type;
+  string value;
+};
+
+// DecodeDataBlock() must return every record as written: keys
+// prefix-compressed between restart points, several versions of a user
+// key in a row, deletions and empty values, also as the last record of a
+// block.
+static void TestDecodeDataBlock(CompressionType compression) {
+  phase = "decode data block";
+  InternalKeyComparator comparator(BytewiseComparator());
+  Options options;
+  options.compression = compression;
+  options.block_size = 512;
+  options.block_restart_interval = 4;
+  options.inner_comparator = &comparator;
+  string contents;
+  StringFile file(&contents);
+  TableBuilder builder(options, &file, "default", 0);
+  vector<Record> records;
+  int block_end_empty_values = 0;
+  for (int u = 0; u < 500; u++) {
+    char user_key[32];
+    snprintf(user_key, sizeof(user_key), "user_key_%06d", u);
+    int versions = 1 + u % 5;
+    for (int v = 0; v < versions; v++) {
+      Record r;
+      r.user_key = user_key;
+      r.sequence = 100000 - u * 10 - v;
+      r.type = (u + v) % 7 == 3 ? kSstTypeDeletion : kSstTypeValue;
+      if (r.type == kSstTypeValue && (u + v) % 11 != 0) {
+        r.value.assign((u * 13 + v) % 60, 'a' + (u + v) % 26);
+      }
+      string key;
+      AppendInternalKey(&key, ParsedInternalKey(r.user_key, r.sequence, r.type));
+      builder.Add(key, r.value);
+      records.push_back(r);
+    }
+    // End some blocks with an empty value.
+    if (u % 17 == 16) {
+      Record r;
+      r.user_key = string(user_key) + "~";
+      r.sequence = 7;
+      r.type = kSstTypeValue;
+      string key;
+      AppendInternalKey(&key, ParsedInternalKey(r.user_key, r.sequence, r.type));
+      builder.Add(key, r.value);
+      records.push_back(r);
+      builder.Flush();
+      block_end_empty_values++;
+    }
+  }
+  CheckCondition(builder.Finish(1, 2).ok());
+
+  Env *env = Env::Default();
+  WritableFile *writable;
+  CheckCondition(env->NewWritableFile(kFileName, &writable).ok());
+  CheckCondition(writable->Append(contents).ok());
+  CheckCondition(writable->Close().ok());
+  delete writable;
+
+  MappedFile mapped;
+  CheckCondition(OpenMappedFile(const_cast<char *>(kFileName), &mapped) == 0);
+  Slice foot_content;
+  uint8_t foot_copied = 0;
+  CheckCondition(ReadFoot(&foot_content, &mapped, &foot_copied).ok());
+  Foot foot;
+  Slice input = foot_content;
+  CheckCondition(FootDecodeFrom(&foot, &input, 1).ok());
+  if (foot_copied) {
+    free((void *)foot_content.data());
+  }
+  MetaBlockProperties props;
+  memset(&props, 0, sizeof(props));
+  CheckCondition(ProcessMetaIndex(&mapped, &props, &foot).ok());
+  Slice index;
+  uint8_t index_copied = 0;
+  CheckCondition(ReadBlock(&index, &mapped, &foot.index_handle,
+                           foot.checksum_type, &index_copied).ok());
+
+  // Restart offsets and key scratch are reused from block to block, as
+  // the ingest workers do.
+  BlockRep rep = BlockRep();
+  size_t i = 0;
+  int blocks = 0, multi_interval_blocks = 0, empty_at_block_end = 0;
+  {
+    DataBlockHandleIter iter(&mapped, foot.checksum_type, &props);
+    Status s;
+    for (s = iter.SeekToFirst(index); s.ok() && iter.Valid(); s = iter.Next()) {
+      BlockHandle handle = iter.handle();
+      DecodedBlock decoded;
+      rep.file = &mapped;
+      rep.checksum_type = foot.checksum_type;
+      rep.decoded = &decoded;
+      rep.kv_put_count = rep.kv_del_count = 0;
+      CheckCondition(ReadBlock(&rep.block, &mapped, &handle, rep.checksum_type,
+                               &rep.block_copied).ok());
+      CheckCondition(DecodeDataBlock(&rep).ok());
+      if (rep.block_copied) {
+        free((void *)rep.block.data());
+      }
+      rep.block_copied = 0;
+      if (decoded.kvs.size() > 2 * (size_t)options.block_restart_interval) {
+        multi_interval_blocks++;
+      }
+      uint32_t puts = 0, dels = 0;
+      for (size_t k = 0; k < decoded.kvs.size(); k++, i++) {
+        const DecodedKv &kv = decoded.kvs[k];
+        CheckCondition(i < records.size());
+        const Record &r = records[i];
+        const char *p = decoded.data.data() + kv.offset;
+        CheckCondition(Slice(p, kv.key_len) == r.user_key);
+        CheckCondition(kv.sequence == r.sequence);
+        CheckCondition(kv.type == (uint32_t)r.type);
+        CheckCondition(Slice(p + kv.key_len, kv.value_len) == r.value);
+        if (kv.type == kSstTypeValue) {
+          puts++;
+        } else {
+          dels++;
+        }
+      }
+      CheckCondition(rep.kv_put_count == puts && rep.kv_del_count == dels);
+      const DecodedKv &last = decoded.kvs.back();
+      if (last.type == kSstTypeValue && last.value_len == 0) {
+        empty_at_block_end++;
+      }
+      blocks++;
+    }
+    CheckCondition(s.ok());
+  }
+  CheckCondition(i == records.size());
+  CheckCondition(blocks > block_end_empty_values);
+  CheckCondition(multi_interval_blocks > blocks / 2);
+  CheckCondition(empty_at_block_end >= block_end_empty_values);
+  free(rep.restart_offset);
+  free(rep.key_scratch.data);
+  if (index_copied) {
+    free((void *)index.data());
+  }
+  CloseMappedFile(&mapped);
+  env->DeleteFile(kFileName);
+}
+
+static void TestAbandon() {
+  phase = "abandon";
+  Options options;
+  options.compression = kSnappyCompression;
+  options.compression_parallel_threads = 4;
+  string contents;
+  StringFile file(&contents);
+  TableBuilder builder(options, &file);
+  string value(1000, 'v');
+  char key[32];
+  for (int i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "key%010d", i);
+    builder.Add(key, value);
+  }
+  builder.Abandon();
+}
+
+int main() {
+  TestParallelCompression(kSnappyCompression, false);
+  TestParallelCompression(kSnappyCompression, true);
+  TestParallelCompression(kZlibCompression, false);
+  TestParallelCompression(kZlibCompression, true);
+  TestChecksumTypes();
+  TestFullFilter();
+  TestIndexTypes();
+  TestDecodeDataBlock(kNoCompression);
+  TestDecodeDataBlock(kSnappyCompression);
+  TestAbandon();
+  std::cout << "table builder test pass." << std::endl;
+  return 0;
+}
@@ -0,0 +1,100 @@
+// Insert and lookup times of the WriteBatchWithIndex index, with the
+// bytewise comparator, whose entries compare by their inline key prefix,
+// and with a comparator that only forwards to it, which compares every
+// pair of keys through the write batch and a virtual call.  A batch holds
+// at most MAX_BATCH_COUNT writes, so the total is spread over full batches,
+// each cleared and refilled.  Keys are random, or share their first 8
+// bytes so the prefixes tie.
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include "swift/comparator.h"
+#include "swift/write_batch_with_index.h"
+#include "../util/coding.h"
+#include "../util/random.h"
+
+using namespace shannon;
+using namespace std;
+
+static uint64_t NowMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+class ForwardingComparator : public Comparator {
+ public:
+  virtual int Compare(const Slice &a, const Slice &b) const {
+    return BytewiseComparator()->Compare(a, b);
+  }
+  virtual const char *Name() const { return "ForwardingComparator"; }
+  virtual void FindShortestSeparator(string *start, const Slice &limit) const {
+    BytewiseComparator()->FindShortestSeparator(start, limit);
+  }
+  virtual void FindShortSuccessor(string *key) const {
+    BytewiseComparator()->FindShortSuccessor(key);
+  }
+};
+
+static Slice Key(uint64_t i, bool shared_prefix, char *buffer) {
+  if (shared_prefix) {
+    memcpy(buffer, "user_key", 8);
+  } else {
+    EncodeFixed64(buffer, i * 0x9e3779b97f4a7c15ull);
+  }
+  EncodeFixed64(buffer + 8, i * 0xc2b2ae3d27d4eb4full);
+  return Slice(buffer, 16);
+}
+
+static void Run(const char *name, const Comparator *comparator,
+                bool shared_prefix, int num_entries, int batch_entries) {
+  WriteBatchWithIndex batch(comparator);
+  char buffer[16];
+  string value;
+  uint64_t insert = 0, get = 0, seek = 0;
+  int found = 0;
+  for (int base = 0; base < num_entries; base += batch_entries) {
+    batch.Clear();
+    uint64_t start = NowMicros();
+    for (int i = base; i < base + batch_entries; i++) {
+      batch.Put(Key(i, shared_prefix, buffer), "value");
+    }
+    insert += NowMicros() - start;
+
+    start = NowMicros();
+    for (int i = base; i < base + batch_entries; i++) {
+      found += batch.GetFromBatch(Key(i, shared_prefix, buffer), &value).ok();
+    }
+    get += NowMicros() - start;
+
+    WBWIIterator *iter = batch.NewIterator();
+    start = NowMicros();
+    for (int i = base; i < base + batch_entries; i++) {
+      iter->Seek(Key(i + num_entries, shared_prefix, buffer));
+      found += iter->Valid();
+    }
+    seek += NowMicros() - start;
+    delete iter;
+  }
+  printf("%-24s %12.1f %12.1f %12.1f  (%d)\n", name,
+         insert * 1000.0 / num_entries, get * 1000.0 / num_entries,
+         seek * 1000.0 / num_entries, found);
+}
+
+int main(int argc, char **argv) {
+  const int num_entries = argc > 1 ? atoi(argv[1]) : 100000;
+  const int batch_entries = 1000;
+  ForwardingComparator forwarding;
+  printf("%d entries in batches of %d\n", num_entries, batch_entries);
+  printf("%-24s %12s %12s %12s\n", "comparator", "insert ns", "get ns",
+         "seek ns");
+  Run("bytewise", BytewiseComparator(), false, num_entries, batch_entries);
+  Run("forwarding", &forwarding, false, num_entries, batch_entries);
+  Run("bytewise shared prefix", BytewiseComparator(), true, num_entries,
+      batch_entries);
+  Run("forwarding shared prefix", &forwarding, true, num_entries,
+      batch_entries);
+  return 0;
+}
@@ -0,0 +1,74 @@
+// Cost of the write-back buffer per small write: adding to it, reading a
+// key back from it, and walking it in key order as a flush does to fill
+// the write batches for the device.  Keys are 16 bytes and values 32,
+// about the size of the counters and index entries that Put() one by one.
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "swift/write_batch_with_index.h"
+#include "../src/write_back_buffer.h"
+#include "../util/random.h"
+
+using namespace shannon;
+using namespace std;
+
+static uint64_t NowMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+static void Report(const char *name, int n, uint64_t micros) {
+  if (micros == 0) {
+    micros = 1;
+  }
+  fprintf(stdout, "%-12s %8.3f us/op %10.0f ops/s\n", name,
+          static_cast<double>(micros) / n, n * 1e6 / micros);
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  Random rnd(301);
+  vector<string> keys(n);
+  for (int i = 0; i < n; i++) {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016u", static_cast<unsigned>(rnd.Next()));
+    keys[i] = buf;
+  }
+  string value(32, 'v');
+
+  shared_ptr<WriteBackMemTable> table(new WriteBackMemTable);
+  uint64_t start = NowMicros();
+  for (int i = 0; i < n; i++) {
+    table->Add(kPutRecord, keys[i], value);
+  }
+  Report("add", n, NowMicros() - start);
+
+  WriteType type;
+  string result;
+  int found = 0;
+  start = NowMicros();
+  for (int i = 0; i < n; i++) {
+    found += table->Get(keys[(static_cast<uint64_t>(i) * 7919) % n], &type,
+                        &result);
+  }
+  Report("get", n, NowMicros() - start);
+
+  int count = 0;
+  size_t bytes = 0;
+  start = NowMicros();
+  unique_ptr<WBWIIterator> iter(WriteBackMemTable::NewIterator(table));
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    WriteEntry entry = iter->Entry();
+    bytes += entry.key.size() + entry.value.size();
+    count++;
+  }
+  Report("flush walk", count, NowMicros() - start);
+
+  fprintf(stdout, "%d found, %d distinct keys, %zu bytes, %zu in memory\n",
+          found, count, bytes, table->MemoryUsage());
+  return 0;
+}
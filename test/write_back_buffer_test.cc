@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <memory>
+#include <string>
+#include "swift/comparator.h"
+#include "swift/iterator.h"
+#include "swift/write_batch_with_index.h"
+#include "../src/write_back_buffer.h"
+#include "../util/random.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+// The newest write of each key: true and the value for a Put, false for a
+// Delete.
+typedef map<string, pair<bool, string> > Model;
+
+// Stands in for a device iterator.
+class MapIterator : public Iterator {
+ public:
+  explicit MapIterator(const map<string, string> &data)
+      : data_(data), iter_(data_.end()) {}
+  virtual bool Valid() const { return iter_ != data_.end(); }
+  virtual void SeekToFirst() { iter_ = data_.begin(); }
+  virtual void SeekToLast() {
+    iter_ = data_.empty() ? data_.end() : --data_.end();
+  }
+  virtual void Seek(const Slice &target) {
+    iter_ = data_.lower_bound(target.ToString());
+  }
+  virtual void SeekForPrev(const Slice &target) {
+    iter_ = data_.upper_bound(target.ToString());
+    Prev();
+  }
+  virtual void Next() { ++iter_; }
+  virtual void Prev() {
+    if (iter_ == data_.begin()) {
+      iter_ = data_.end();
+    } else {
+      --iter_;
+    }
+  }
+  virtual Slice key() { return iter_->first; }
+  virtual Slice value() { return iter_->second; }
+  virtual uint64_t timestamp() { return 0; }
+  virtual Status status() const { return Status::OK(); }
+  // As the device, only keys starting with prefix are seen.
+  virtual void SetPrefix(const Slice &prefix) {
+    for (map<string, string>::iterator it = data_.begin();
+         it != data_.end();) {
+      if (Slice(it->first).starts_with(prefix)) {
+        ++it;
+      } else {
+        data_.erase(it++);
+      }
+    }
+    iter_ = data_.end();
+  }
+
+ private:
+  map<string, string> data_;
+  map<string, string>::const_iterator iter_;
+};
+
+static string RandomKey(Random *rnd) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "key%04d", static_cast<int>(rnd->Uniform(500)));
+  return buf;
+}
+
+static void Fill(WriteBackMemTable *table, Model *model, Random *rnd, int n) {
+  for (int i = 0; i < n; i++) {
+    string key = RandomKey(rnd);
+    if (rnd->OneIn(4)) {
+      table->Add(kDeleteRecord, key, Slice());
+      (*model)[key] = make_pair(false, string());
+    } else {
+      string value = key + "-" + to_string(i);
+      table->Add(kPutRecord, key, value);
+      (*model)[key] = make_pair(true, value);
+    }
+  }
+}
+
+static void TestGet() {
+  phase = "get";
+  Random rnd(301);
+  WriteBackMemTable table;
+  Model model;
+  CheckCondition(table.Empty());
+  Fill(&table, &model, &rnd, 3000);
+  CheckCondition(table.Count() == 3000);
+  CheckCondition(table.DataSize() > 0);
+  CheckCondition(table.MemoryUsage() >= table.DataSize());
+  for (int i = 0; i < 600; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "key%04d", i);
+    WriteType type;
+    string value;
+    Model::iterator it = model.find(key);
+    if (it == model.end()) {
+      CheckCondition(!table.Get(key, &type, &value));
+      continue;
+    }
+    CheckCondition(table.Get(key, &type, &value));
+    CheckCondition(type == (it->second.first ? kPutRecord : kDeleteRecord));
+    if (type == kPutRecord) {
+      CheckCondition(value == it->second.second);
+    }
+    CheckCondition(table.Get(key, &type, NULL));
+  }
+}
+
+static void TestIterator() {
+  phase = "iterator";
+  Random rnd(302);
+  shared_ptr<WriteBackMemTable> table(new WriteBackMemTable);
+  Model model;
+  Fill(table.get(), &model, &rnd, 3000);
+  unique_ptr<WBWIIterator> iter(WriteBackMemTable::NewIterator(table));
+
+  // Each key once, with its newest write.
+  Model::iterator it = model.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++it) {
+    CheckCondition(it != model.end());
+    WriteEntry entry = iter->Entry();
+    CheckCondition(entry.key == it->first);
+    CheckCondition(entry.type ==
+                   (it->second.first ? kPutRecord : kDeleteRecord));
+    if (entry.type == kPutRecord) {
+      CheckCondition(entry.value == it->second.second);
+    }
+  }
+  CheckCondition(it == model.end());
+
+  Model::reverse_iterator rit = model.rbegin();
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev(), ++rit) {
+    CheckCondition(rit != model.rend());
+    CheckCondition(iter->Entry().key == rit->first);
+    if (rit->second.first) {
+      CheckCondition(iter->Entry().value == rit->second.second);
+    }
+  }
+  CheckCondition(rit == model.rend());
+
+  for (int i = 0; i < 200; i++) {
+    string target = RandomKey(&rnd) + (rnd.OneIn(2) ? "x" : "");
+    iter->Seek(target);
+    it = model.lower_bound(target);
+    CheckCondition(iter->Valid() == (it != model.end()));
+    if (iter->Valid()) {
+      CheckCondition(iter->Entry().key == it->first);
+    }
+    iter->SeekForPrev(target);
+    it = model.upper_bound(target);
+    if (it == model.begin()) {
+      CheckCondition(!iter->Valid());
+    } else {
+      --it;
+      CheckCondition(iter->Valid());
+      CheckCondition(iter->Entry().key == it->first);
+      if (it->second.first) {
+        CheckCondition(iter->Entry().value == it->second.second);
+      }
+    }
+  }
+
+  // The iterator keeps the table alive.
+  table.reset();
+  iter->SeekToFirst();
+  CheckCondition(iter->Valid());
+  CheckCondition(iter->Entry().key == model.begin()->first);
+}
+
+static void TestMergedIterator() {
+  phase = "merged iterator";
+  Random rnd(303);
+  map<string, string> base;
+  for (int i = 0; i < 1000; i++) {
+    string key = RandomKey(&rnd);
+    base[key] = "base-" + key;
+  }
+  shared_ptr<WriteBackMemTable> table(new WriteBackMemTable);
+  Model model;
+  Fill(table.get(), &model, &rnd, 500);
+
+  map<string, string> expected = base;
+  for (Model::iterator it = model.begin(); it != model.end(); ++it) {
+    if (it->second.first) {
+      expected[it->first] = it->second.second;
+    } else {
+      expected.erase(it->first);
+    }
+  }
+
+  unique_ptr<Iterator> iter(NewBaseDeltaIterator(
+      new MapIterator(base), WriteBackMemTable::NewIterator(table),
+      BytewiseComparator()));
+  map<string, string>::iterator eit = expected.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++eit) {
+    CheckCondition(eit != expected.end());
+    CheckCondition(iter->key() == eit->first);
+    CheckCondition(iter->value() == eit->second);
+  }
+  CheckCondition(eit == expected.end());
+  map<string, string>::reverse_iterator reit = expected.rbegin();
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev(), ++reit) {
+    CheckCondition(reit != expected.rend());
+    CheckCondition(iter->key() == reit->first);
+    CheckCondition(iter->value() == reit->second);
+  }
+  CheckCondition(reit == expected.rend());
+  CheckCondition(iter->status().ok());
+}
+
+static string Scan(Iterator *iter, bool forward) {
+  string keys;
+  for (forward ? iter->SeekToFirst() : iter->SeekToLast(); iter->Valid();
+       forward ? iter->Next() : iter->Prev()) {
+    keys += iter->key().ToString() + " ";
+  }
+  return keys;
+}
+
+static void TestMergedIteratorPrefix() {
+  phase = "merged iterator prefix";
+  map<string, string> base;
+  base["a1"] = "base";
+  base["b1"] = "base";
+  base["b2"] = "base";
+  base["c1"] = "base";
+  shared_ptr<WriteBackMemTable> table(new WriteBackMemTable);
+  table->Add(kPutRecord, "a0", "delta");
+  table->Add(kPutRecord, "b3", "delta");
+  table->Add(kDeleteRecord, "b2", Slice());
+  table->Add(kPutRecord, "c", "delta");
+  table->Add(kPutRecord, "c9", "delta");
+
+  unique_ptr<Iterator> iter(NewBaseDeltaIterator(
+      new MapIterator(base), WriteBackMemTable::NewIterator(table),
+      BytewiseComparator()));
+  iter->SetPrefix("b");
+  CheckCondition(Scan(iter.get(), true) == "b1 b3 ");
+  CheckCondition(Scan(iter.get(), false) == "b3 b1 ");
+
+  // Targets out of the prefix are clamped to it.
+  iter->Seek("a");
+  CheckCondition(iter->Valid() && iter->key() == "b1");
+  iter->Seek("b2");
+  CheckCondition(iter->Valid() && iter->key() == "b3");
+  iter->SeekForPrev("z");
+  CheckCondition(iter->Valid() && iter->key() == "b3");
+  iter->SeekForPrev("b2");
+  CheckCondition(iter->Valid() && iter->key() == "b1");
+  iter->Seek("c");
+  CheckCondition(!iter->Valid());
+
+  // Changing direction at either end of the prefix.
+  iter->SeekToLast();
+  iter->Prev();
+  CheckCondition(iter->Valid() && iter->key() == "b1");
+  iter->Next();
+  CheckCondition(iter->Valid() && iter->key() == "b3");
+  iter->SeekToFirst();
+  iter->Next();
+  CheckCondition(iter->Valid() && iter->key() == "b3");
+  iter->Prev();
+  CheckCondition(iter->Valid() && iter->key() == "b1");
+  CheckCondition(iter->status().ok());
+}
+
+int main() {
+  TestGet();
+  TestIterator();
+  TestMergedIterator();
+  TestMergedIteratorPrefix();
+  fprintf(stderr, "PASS\n");
+  return 0;
+}
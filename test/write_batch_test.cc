@@ -317,5 +317,47 @@ int main() {
 
   cout << PrintContents(&batch, cf1) << endl;
   cout << batch.Count() << endl;
+
+  {
+    // Point reads see the newest write of the batch, deletes included,
+    // and go to the db for the keys the batch does not have.
+    ReadOptions read_options;
+    WriteOptions write_options;
+    CheckCondition(db->Put(write_options, cf1, "x", "db_x").ok());
+    CheckCondition(db->Put(write_options, cf1, "y", "db_y").ok());
+    CheckCondition(db->Put(write_options, cf1, "z", "db_z").ok());
+    WriteBatchWithIndex dup_batch(cmp, 20, false);
+    dup_batch.Put(cf1, "x", "x1");
+    dup_batch.Put(cf1, "x", "x2");
+    dup_batch.Put(cf1, "y", "y1");
+    dup_batch.Delete(cf1, "y");
+    dup_batch.Put(cf2, "z", "cf2_z");
+    CheckCondition(dup_batch.GetFromBatch(cf1, "x", &value).ok());
+    CheckCondition(value == "x2");
+    CheckCondition(dup_batch.GetFromBatch(cf1, "y", &value).IsNotFound());
+    CheckCondition(dup_batch.GetFromBatch(cf1, "z", &value).IsNotFound());
+    CheckCondition(dup_batch.GetFromBatch(cf2, "z", &value).ok());
+    CheckCondition(value == "cf2_z");
+
+    CheckCondition(
+        dup_batch.GetFromBatchAndDB(db, read_options, cf1, "x", &value).ok());
+    CheckCondition(value == "x2");
+    CheckCondition(dup_batch.GetFromBatchAndDB(db, read_options, cf1, "y",
+                                               &value).IsNotFound());
+    CheckCondition(
+        dup_batch.GetFromBatchAndDB(db, read_options, cf1, "z", &value).ok());
+    CheckCondition(value == "db_z");
+    CheckCondition(dup_batch.GetFromBatchAndDB(db, read_options, cf1, "w",
+                                               &value).IsNotFound());
+
+    // With overwrite_key, a key has a single entry in the index.
+    batch.Put(cf1, "y", "y2");
+    CheckCondition(batch.GetFromBatchAndDB(db, read_options, cf1, "y",
+                                           &value).ok());
+    CheckCondition(value == "y2");
+    CheckCondition(batch.GetFromBatch(cf1, "e", &value).IsNotFound());
+    CheckCondition(batch.GetFromBatch(cf1, "d", &value).ok());
+    CheckCondition(value == "dd");
+  }
   return 0;
 }
@@ -0,0 +1,86 @@
+// Throughput of XXH3 next to Hash() of util/hash.cc, on key sized and
+// block sized inputs.
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <string>
+#include "../util/hash.h"
+#include "../util/random.h"
+#include "../util/xxh3.h"
+
+using namespace shannon;
+using namespace std;
+
+static uint64_t NowMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+static void Report(const char *name, size_t size, uint64_t iters,
+                   uint64_t start, uint64_t sink) {
+  uint64_t micros = NowMicros() - start;
+  if (micros == 0) micros = 1;
+  printf("%-16s %8zu %12.1f %10.2f  (%016llx)\n", name, size,
+         static_cast<double>(iters * size) / micros,
+         micros * 1000.0 / iters, static_cast<unsigned long long>(sink));
+}
+
+int main(int argc, char **argv) {
+  // Bytes hashed per function and size.
+  uint64_t total = argc > 1 ? strtoull(argv[1], NULL, 10) : (1ull << 29);
+  Random rnd(301);
+  string data(1024 * 1024 + 1, '\0');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(rnd.Uniform(256));
+  }
+  const size_t sizes[] = {8, 16, 24, 32, 64, 128, 256, 4096, 1024 * 1024};
+  const xxh3::Implementation impls[] = {xxh3::kScalar, xxh3::kSse2,
+                                        xxh3::kAvx2};
+  printf("active: %s\n", xxh3::ImplementationName(xxh3::ActiveImplementation()));
+  printf("%-16s %8s %12s %10s\n", "hash", "size", "MB/s", "ns/hash");
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    size_t size = sizes[s];
+    uint64_t iters = total / size;
+    if (iters < 16) iters = 16;
+    // Walk the buffer so short keys do not always hit the same bytes.
+    size_t span = data.size() - size;
+    size_t step = size < 64 ? size + 1 : 63;
+
+    uint64_t sink = 0;
+    size_t off = 0;
+    uint64_t start = NowMicros();
+    for (uint64_t n = 0; n < iters; n++) {
+      sink += Hash(data.data() + off, size, 0);
+      off = off + step > span ? 0 : off + step;
+    }
+    Report("Hash", size, iters, start, sink);
+
+    for (int i = 0; i < 3; i++) {
+      if (!xxh3::IsSupported(impls[i])) continue;
+      // Inputs up to 240 bytes do not depend on the implementation.
+      if (size <= 240 && impls[i] != xxh3::kScalar) continue;
+      char name[32];
+      snprintf(name, sizeof(name), "xxh3-64 %s",
+               size <= 240 ? "" : xxh3::ImplementationName(impls[i]));
+      sink = 0;
+      off = 0;
+      start = NowMicros();
+      for (uint64_t n = 0; n < iters; n++) {
+        sink += xxh3::Hash64With(impls[i], data.data() + off, size, 0);
+        off = off + step > span ? 0 : off + step;
+      }
+      Report(name, size, iters, start, sink);
+    }
+
+    sink = 0;
+    off = 0;
+    start = NowMicros();
+    for (uint64_t n = 0; n < iters; n++) {
+      sink += xxh3::Hash128(data.data() + off, size).low64;
+      off = off + step > span ? 0 : off + step;
+    }
+    Report("xxh3-128", size, iters, start, sink);
+  }
+  return 0;
+}
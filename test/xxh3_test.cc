@@ -0,0 +1,135 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "../util/hash.h"
+#include "../util/random.h"
+#include "../util/xxh3.h"
+
+using namespace shannon;
+using namespace std;
+
+const char *phase = "";
+#define CheckCondition(cond)                                                   \
+  if (!(cond)) {                                                               \
+    fprintf(stderr, "%s:%d: %s: %s\n", __FILE__, __LINE__, phase, #cond);      \
+    abort();                                                                   \
+  }
+
+static const xxh3::Implementation kImpls[] = {xxh3::kScalar, xxh3::kSse2,
+                                              xxh3::kAvx2};
+
+struct TestVector {
+  size_t len;
+  uint64_t seed;
+  uint64_t hash64;
+  uint64_t low64;
+  uint64_t high64;
+};
+
+// From the xxHash 0.8 reference implementation, over the bytes of
+// FillSequence().  Lengths cover each of the size classes and their edges.
+static const TestVector kVectors[] = {
+    {0, 0u, 0x2d06800538d394c2ull, 0x6001c324468d497full, 0x99aa06d3014798d8ull},
+    {0, 2654435761u, 0xf702ca3814de2125ull, 0x5444f7869c671ab0ull, 0x92220ae55e14ab50ull},
+    {1, 0u, 0xc44bdff4074eecdbull, 0xc44bdff4074eecdbull, 0xa6cd5e9392000f6aull},
+    {1, 2654435761u, 0xb53d5557e7f76f8dull, 0xb53d5557e7f76f8dull, 0x89b99554ba22467cull},
+    {3, 0u, 0x54247382a8d6b94dull, 0x54247382a8d6b94dull, 0x20efc49ff02422eaull},
+    {3, 2654435761u, 0xf173d14dad53a5dcull, 0xf173d14dad53a5dcull, 0x48f82c2fe0abd468ull},
+    {4, 0u, 0xe5dc74bc51848a51ull, 0x2e7d8d6876a39fe9ull, 0x970d585ac632bf8eull},
+    {4, 2654435761u, 0x6977c7c3ad9421b9ull, 0xef78d5c489cfe10bull, 0x7170492a2aa08992ull},
+    {8, 0u, 0x24ccc9acaa9f65e4ull, 0x64c69cab4bb21dc5ull, 0x47a7f080d82bb456ull},
+    {8, 2654435761u, 0x360073b0548dbd24ull, 0x5f462f3de2e8b940ull, 0xf959013232655ff1ull},
+    {9, 0u, 0x14d5001c15dd3f2bull, 0xed7ccbc501eb7501ull, 0x564ef6078950d457ull},
+    {9, 2654435761u, 0xce394e48812aa7e3ull, 0x07de00b45eee033aull, 0x75fb6d1bd353b45cull},
+    {16, 0u, 0x981b17d36c7498c9ull, 0x562980258a998629ull, 0xc68c368ecf8a9c05ull},
+    {16, 2654435761u, 0xb40f1f6cdb1569ccull, 0xb07eeeab4c56392bull, 0x3767c90d0cdbb93dull},
+    {17, 0u, 0x796f5acd3a60f862ull, 0xabbc12d11973d7dbull, 0x955fa78643ed3669ull},
+    {17, 2654435761u, 0xaf8cb0bc2c230dafull, 0x3cc9ff6cae79accbull, 0x99e7c628e75d6431ull},
+    {128, 0u, 0xfcff24126754d861ull, 0xebb15e34a7fb5ab1ull, 0x39992220e045260aull},
+    {128, 2654435761u, 0xa3ca60447de981d1ull, 0x1453819941d93c1dull, 0x98801187df8d614dull},
+    {129, 0u, 0x98f1b0a679a2ca29ull, 0x86c9e3bc8f0a3b5cull, 0x03815fc91f1b30b6ull},
+    {129, 2654435761u, 0xc861ffc49c2bf14full, 0xb37b716f66b40f02ull, 0xb7f7349a47b39e56ull},
+    {240, 0u, 0x81c3c2b67f568ccfull, 0x5c9aae94c8ebe5a0ull, 0xaa4202daa2769dc8ull},
+    {240, 2654435761u, 0x507820ea74b895b0ull, 0xca19087f1d335daeull, 0xda888104beae5ae0ull},
+    {241, 0u, 0xc5a639ecd2030e5eull, 0xc5a639ecd2030e5eull, 0x99a80ecf0ecfc647ull},
+    {241, 2654435761u, 0x5927e3637bac8149ull, 0x5927e3637bac8149ull, 0x4bf2229c3a8fc3c3ull},
+    {1024, 0u, 0xdd85c9b5c1109c5cull, 0xdd85c9b5c1109c5cull, 0x0d30d24071c64c57ull},
+    {1024, 2654435761u, 0xb8b95c07cd4a75faull, 0xb8b95c07cd4a75faull, 0x885b0b4debe3d2ffull},
+    {1025, 0u, 0xd870c0fa13211c6aull, 0xd870c0fa13211c6aull, 0xfd3ee4fe7f2954c6ull},
+    {1025, 2654435761u, 0x2f15255340ae4f6cull, 0x2f15255340ae4f6cull, 0x3364fad6f5ff1741ull},
+    {2048, 0u, 0xdd59e2c3a5f038e0ull, 0xdd59e2c3a5f038e0ull, 0xf736557fd47073a5ull},
+    {2048, 2654435761u, 0x230d43f30206260bull, 0x230d43f30206260bull, 0x7fb03f7e7186c3eaull},
+};
+
+static void FillSequence(char *buf, size_t n) {
+  uint64_t gen = 2654435761u;
+  for (size_t i = 0; i < n; i++) {
+    buf[i] = static_cast<char>(gen >> 56);
+    gen *= 11400714785074694797ull;
+  }
+}
+
+static void TestVectors() {
+  phase = "vectors";
+  char buf[2048];
+  FillSequence(buf, sizeof(buf));
+  for (size_t i = 0; i < sizeof(kVectors) / sizeof(kVectors[0]); i++) {
+    const TestVector &v = kVectors[i];
+    CheckCondition(xxh3::Hash64(buf, v.len, v.seed) == v.hash64);
+    xxh3::Hash128Value h = xxh3::Hash128(buf, v.len, v.seed);
+    CheckCondition(h.low64 == v.low64 && h.high64 == v.high64);
+    for (int j = 0; j < 3; j++) {
+      if (!xxh3::IsSupported(kImpls[j])) continue;
+      CheckCondition(xxh3::Hash64With(kImpls[j], buf, v.len, v.seed) ==
+                     v.hash64);
+      h = xxh3::Hash128With(kImpls[j], buf, v.len, v.seed);
+      CheckCondition(h.low64 == v.low64 && h.high64 == v.high64);
+    }
+  }
+}
+
+// Every implementation the cpu supports must agree with the scalar one,
+// whatever the length and alignment of the input.
+static void TestImplementationsAgree() {
+  phase = "implementations agree";
+  Random rnd(301);
+  string data(70000, '\0');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(rnd.Uniform(256));
+  }
+  for (int n = 0; n < 3000; n++) {
+    size_t off = rnd.Uniform(32);
+    size_t len = n < 1200 ? n : rnd.Uniform(data.size() - off);
+    uint64_t seed = n % 3 == 0 ? 0 : (static_cast<uint64_t>(rnd.Next()) << 32) |
+                                         rnd.Next();
+    const char *p = data.data() + off;
+    uint64_t expected = xxh3::Hash64With(xxh3::kScalar, p, len, seed);
+    xxh3::Hash128Value expected128 =
+        xxh3::Hash128With(xxh3::kScalar, p, len, seed);
+    for (int j = 0; j < 3; j++) {
+      if (!xxh3::IsSupported(kImpls[j])) continue;
+      CheckCondition(xxh3::Hash64With(kImpls[j], p, len, seed) == expected);
+      xxh3::Hash128Value h = xxh3::Hash128With(kImpls[j], p, len, seed);
+      CheckCondition(h.low64 == expected128.low64 &&
+                     h.high64 == expected128.high64);
+    }
+  }
+}
+
+static void TestSliceHash() {
+  phase = "slice hash";
+  SliceHasher64 hasher;
+  CheckCondition(hasher(Slice("key1")) == xxh3::Hash64("key1", 4));
+  CheckCondition(GetSliceHash64(Slice("key1")) != GetSliceHash64("key2"));
+}
+
+int main() {
+  TestVectors();
+  TestImplementationsAgree();
+  TestSliceHash();
+  std::cout << "xxh3 test pass ("
+            << xxh3::ImplementationName(xxh3::ActiveImplementation()) << ")."
+            << std::endl;
+  return 0;
+}
@@ -1,11 +1,29 @@
 #include "arena.h"
 #include <assert.h>
+#include <sys/mman.h>
 
 namespace shannon {
 
-static const int kBlockSize = 4096;
+const size_t Arena::kMinBlockSize = 4096;
+const size_t Arena::kMaxBlockSize = 2u << 30;
 
-Arena::Arena() : memory_usage_(0) {
+static size_t OptimizeBlockSize(size_t block_size) {
+  const size_t align = sizeof(void*) > 8 ? sizeof(void*) : 8;
+  if (block_size < Arena::kMinBlockSize) {
+    block_size = Arena::kMinBlockSize;
+  } else if (block_size > Arena::kMaxBlockSize) {
+    block_size = Arena::kMaxBlockSize;
+  }
+  // Blocks are multiples of the alignment, so an aligned block ends aligned.
+  return (block_size + align - 1) & ~(align - 1);
+}
+
+Arena::Arena(size_t block_size, size_t huge_page_size)
+    : block_size_(OptimizeBlockSize(block_size)),
+      huge_page_size_(huge_page_size),
+      hugetlb_failed_(false),
+      huge_page_usage_(0),
+      memory_usage_(0) {
   alloc_ptr_ = NULL;  // First allocation will allocate a block
   alloc_bytes_remaining_ = 0;
 }
@@ -14,10 +32,13 @@ Arena::~Arena() {
   for (size_t i = 0; i < blocks_.size(); i++) {
     delete[] blocks_[i];
   }
+  for (size_t i = 0; i < mapped_blocks_.size(); i++) {
+    munmap(mapped_blocks_[i].addr, mapped_blocks_[i].size);
+  }
 }
 
 char* Arena::AllocateFallback(size_t bytes) {
-  if (bytes > kBlockSize / 4) {
+  if (bytes > block_size_ / 4) {
     // Object is more than a quarter of our block size.  Allocate it separately
     // to avoid wasting too much space in leftover bytes.
     char* result = AllocateNewBlock(bytes);
@@ -25,8 +46,21 @@ char* Arena::AllocateFallback(size_t bytes) {
   }
 
   // We waste the remaining space in the current block.
-  alloc_ptr_ = AllocateNewBlock(kBlockSize);
-  alloc_bytes_remaining_ = kBlockSize;
+  size_t size = block_size_;
+  char* block = NULL;
+  if (huge_page_size_ != 0) {
+    size = (block_size_ + huge_page_size_ - 1) / huge_page_size_ *
+           huge_page_size_;
+    block = AllocateFromHugePage(size);
+    if (block == NULL) {
+      size = block_size_;
+    }
+  }
+  if (block == NULL) {
+    block = AllocateNewBlock(size);
+  }
+  alloc_ptr_ = block;
+  alloc_bytes_remaining_ = size;
 
   char* result = alloc_ptr_;
   alloc_ptr_ += bytes;
@@ -61,4 +95,34 @@ char* Arena::AllocateNewBlock(size_t block_bytes) {
   return result;
 }
 
+// Returns NULL if the block could not be mmap()ed at all, then the caller
+// falls back to new[].
+char* Arena::AllocateFromHugePage(size_t bytes) {
+  void* addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (!hugetlb_failed_) {
+    addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    // Usually no huge page is reserved, nor will be while the arena lives.
+    hugetlb_failed_ = addr == MAP_FAILED;
+  }
+#endif
+  if (addr == MAP_FAILED) {
+    addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+      return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(addr, bytes, MADV_HUGEPAGE);
+#endif
+  }
+  MappedBlock block = {addr, bytes};
+  mapped_blocks_.push_back(block);
+  huge_page_usage_ += bytes;
+  memory_usage_.NoBarrier_Store(
+      reinterpret_cast<void*>(MemoryUsage() + bytes + sizeof(MappedBlock)));
+  return reinterpret_cast<char*>(addr);
+}
+
 }  // namespace SHANNON
@@ -11,7 +11,15 @@ namespace shannon {
 
 class Arena {
  public:
-  Arena();
+  static const size_t kMinBlockSize;
+  static const size_t kMaxBlockSize;
+
+  // Blocks are block_size bytes, clamped to [kMinBlockSize, kMaxBlockSize].
+  // If huge_page_size is not 0, e.g. 2MB, blocks are rounded up to it and
+  // mmap()ed from the reserved huge pages (MAP_HUGETLB); when there are
+  // none left, they are mmap()ed and advised to be transparent huge pages,
+  // and if that fails too, allocated with new[].
+  explicit Arena(size_t block_size = kMinBlockSize, size_t huge_page_size = 0);
   ~Arena();
 
   // Return a pointer to a newly allocated memory block of "bytes" bytes.
@@ -21,14 +29,33 @@ class Arena {
   char* AllocateAligned(size_t bytes);
 
   // Returns an estimate of the total memory usage of data allocated
-  // by the arena.
+  // by the arena.  Safe to call while another thread allocates.
   size_t MemoryUsage() const {
     return reinterpret_cast<uintptr_t>(memory_usage_.NoBarrier_Load());
   }
 
+  // Bytes left in the current block, part of MemoryUsage() not handed out.
+  size_t AllocatedAndUnused() const { return alloc_bytes_remaining_; }
+
+  // Bytes of the blocks mmap()ed for huge pages, included in MemoryUsage().
+  size_t HugePageUsage() const { return huge_page_usage_; }
+
+  size_t BlockSize() const { return block_size_; }
+
  private:
+  struct MappedBlock {
+    void* addr;
+    size_t size;
+  };
+
   char* AllocateFallback(size_t bytes);
   char* AllocateNewBlock(size_t block_bytes);
+  char* AllocateFromHugePage(size_t bytes);
+
+  const size_t block_size_;
+  const size_t huge_page_size_;
+  // Set once no huge page is left to MAP_HUGETLB, not to try again.
+  bool hugetlb_failed_;
 
   // Allocation state
   char* alloc_ptr_;
@@ -36,6 +63,9 @@ class Arena {
 
   // Array of new[] allocated memory blocks
   std::vector<char*> blocks_;
+  // Blocks mmap()ed for huge pages
+  std::vector<MappedBlock> mapped_blocks_;
+  size_t huge_page_usage_;
 
   // Total memory usage of the arena.
   port::AtomicPointer memory_usage_;
@@ -2,19 +2,203 @@
 #include "swift/filter_policy.h"
 
 #include "swift/slice.h"
+#include "util/coding.h"
 #include "util/hash.h"
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAVE_X86_BLOOM_PROBE 1
+#include <immintrin.h>
+#endif
 
 namespace shannon {
 
 namespace {
 
+// Full filters: the bits are laid out in cache lines of 64 bytes, the hash
+// of a key picks a line and every probe of the key falls in it.  After the
+// lines come the number of probes (1 byte) and of lines (fixed32).
+const uint32_t kCacheLineBytes = 64;
+const uint32_t kCacheLineBits = kCacheLineBytes * 8;
+const size_t kFullFilterMetadataLen = 5;
+
+inline void FullFilterAddHash(uint32_t h, uint32_t num_lines, int num_probes,
+                              char *data) {
+  char *line = data + (h % num_lines) * kCacheLineBytes;
+  const uint32_t delta = (h >> 17) | (h << 15); // Rotate right 17 bits
+  for (int i = 0; i < num_probes; i++) {
+    const uint32_t bitpos = h & (kCacheLineBits - 1);
+    line[bitpos / 8] |= (1 << (bitpos % 8));
+    h += delta;
+  }
+}
+
+// Lines of any power of two size, for filters written by others.
+bool FullFilterHashMayMatch(uint32_t h, int num_probes, const char *line,
+                            int log2_line_bits) {
+  const uint32_t delta = (h >> 17) | (h << 15);
+  for (int i = 0; i < num_probes; i++) {
+    const uint32_t bitpos = h & ((1u << log2_line_bits) - 1);
+    if ((line[bitpos / 8] & (1 << (bitpos % 8))) == 0)
+      return false;
+    h += delta;
+  }
+  return true;
+}
+
+bool FullFilterHashMayMatchScalar(uint32_t h, int num_probes,
+                                  const char *line) {
+  return FullFilterHashMayMatch(h, num_probes, line, 9);
+}
+
+#ifdef HAVE_X86_BLOOM_PROBE
+// Eight probes at a time: the line is held in two registers and each lane
+// picks its 32-bit word out of them.
+__attribute__((target("avx2")))
+bool FullFilterHashMayMatchAvx2(uint32_t h, int num_probes, const char *line) {
+  const __m256i line_lo =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(line));
+  const __m256i line_hi =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(line + 32));
+  const uint32_t delta = (h >> 17) | (h << 15);
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i step = _mm256_set1_epi32(static_cast<int>(delta * 8));
+  const __m256i bit_mask = _mm256_set1_epi32(kCacheLineBits - 1);
+  const __m256i seven = _mm256_set1_epi32(7);
+  const __m256i thirty_one = _mm256_set1_epi32(31);
+  const __m256i one = _mm256_set1_epi32(1);
+  __m256i hashes = _mm256_add_epi32(
+      _mm256_set1_epi32(static_cast<int>(h)),
+      _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(delta)), lanes));
+  for (int i = 0; i < num_probes; i += 8) {
+    __m256i bitpos = _mm256_and_si256(hashes, bit_mask);
+    __m256i word = _mm256_srli_epi32(bitpos, 5);
+    __m256i lo = _mm256_permutevar8x32_epi32(line_lo, word);
+    __m256i hi = _mm256_permutevar8x32_epi32(line_hi, word);
+    __m256i words =
+        _mm256_blendv_epi8(lo, hi, _mm256_cmpgt_epi32(word, seven));
+    __m256i bits = _mm256_sllv_epi32(one, _mm256_and_si256(bitpos, thirty_one));
+    if (num_probes - i < 8) {
+      // Lanes past the last probe test nothing.
+      bits = _mm256_and_si256(
+          bits, _mm256_cmpgt_epi32(_mm256_set1_epi32(num_probes - i), lanes));
+    }
+    if (!_mm256_testc_si256(words, bits))
+      return false;
+    hashes = _mm256_add_epi32(hashes, step);
+  }
+  return true;
+}
+#endif
+
+typedef bool (*HashMayMatchFunction)(uint32_t, int, const char *);
+
+HashMayMatchFunction ChooseHashMayMatch() {
+#ifdef HAVE_X86_BLOOM_PROBE
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return FullFilterHashMayMatchAvx2;
+#endif
+  return FullFilterHashMayMatchScalar;
+}
+
+class FullFilterBitsBuilder : public FilterBitsBuilder {
+public:
+  FullFilterBitsBuilder(size_t bits_per_key, int num_probes)
+      : bits_per_key_(bits_per_key), num_probes_(num_probes) {}
+
+  virtual void AddKey(const Slice &key) {
+    uint32_t h = BloomHash(key);
+    // The versions of a key are added one after the other.
+    if (hashes_.empty() || hashes_.back() != h)
+      hashes_.push_back(h);
+  }
+
+  virtual void Finish(std::string *dst) {
+    uint32_t num_lines = 0;
+    if (!hashes_.empty()) {
+      uint32_t bits = static_cast<uint32_t>(hashes_.size() * bits_per_key_);
+      num_lines = (bits + kCacheLineBits - 1) / kCacheLineBits;
+      // An odd number of lines involves more bits of the hash in the
+      // choice of the line.
+      if (num_lines % 2 == 0)
+        num_lines++;
+    }
+    const size_t init_size = dst->size();
+    dst->resize(init_size + num_lines * kCacheLineBytes, 0);
+    char *data = &(*dst)[init_size];
+    for (size_t i = 0; i < hashes_.size(); i++) {
+      FullFilterAddHash(hashes_[i], num_lines, num_probes_, data);
+    }
+    dst->push_back(static_cast<char>(num_probes_));
+    PutFixed32(dst, num_lines);
+    hashes_.clear();
+  }
+
+private:
+  size_t bits_per_key_;
+  int num_probes_;
+  std::vector<uint32_t> hashes_;
+};
+
+class FullFilterBitsReader : public FilterBitsReader {
+public:
+  explicit FullFilterBitsReader(const Slice &contents)
+      : data_(contents.data()), num_probes_(0), num_lines_(0),
+        log2_line_bits_(0), match_all_(false) {
+    const size_t len = contents.size();
+    if (len <= kFullFilterMetadataLen) {
+      return; // No keys, nothing matches
+    }
+    const size_t bytes = len - kFullFilterMetadataLen;
+    num_probes_ = static_cast<signed char>(data_[bytes]);
+    num_lines_ = DecodeFixed32(data_ + bytes + 1);
+    if (num_probes_ < 1 || num_probes_ > 30 || num_lines_ == 0 ||
+        bytes % num_lines_ != 0) {
+      // Newer formats or a broken filter, consider everything a match.
+      match_all_ = true;
+      return;
+    }
+    size_t line_bytes = bytes / num_lines_;
+    while ((1u << log2_line_bits_) < line_bytes * 8) {
+      log2_line_bits_++;
+    }
+    if ((1u << log2_line_bits_) != line_bytes * 8) {
+      match_all_ = true;
+    }
+  }
+
+  virtual bool MayMatch(const Slice &key) {
+    if (num_lines_ == 0 || match_all_) {
+      return match_all_;
+    }
+    uint32_t h = BloomHash(key);
+    const char *line = data_ + (h % num_lines_) * (1u << log2_line_bits_) / 8;
+    if (log2_line_bits_ == 9) {
+      static const HashMayMatchFunction hash_may_match = ChooseHashMayMatch();
+      return hash_may_match(h, num_probes_, line);
+    }
+    return FullFilterHashMayMatch(h, num_probes_, line, log2_line_bits_);
+  }
+
+private:
+  const char *data_;
+  int num_probes_;
+  uint32_t num_lines_;
+  int log2_line_bits_;
+  bool match_all_;
+};
+
 class BloomFilterPolicy : public FilterPolicy {
 private:
   size_t bits_per_key_;
   size_t k_;
+  bool use_block_based_builder_;
 
 public:
-  explicit BloomFilterPolicy(int bits_per_key) : bits_per_key_(bits_per_key) {
+  BloomFilterPolicy(int bits_per_key, bool use_block_based_builder)
+      : bits_per_key_(bits_per_key),
+        use_block_based_builder_(use_block_based_builder) {
     // We intentionally round down to reduce probing cost a little bit
     k_ = static_cast<size_t>(bits_per_key * 0.69); // 0.69 =~ ln(2)
     if (k_ < 1)
@@ -23,7 +207,20 @@ public:
       k_ = 30;
   }
 
-  virtual const char *Name() const { return "leveldb.BuiltinBloomFilter2"; }
+  virtual const char *Name() const {
+    return use_block_based_builder_ ? "leveldb.BuiltinBloomFilter2"
+                                    : "rocksdb.BuiltinBloomFilter";
+  }
+
+  virtual FilterBitsBuilder *GetFilterBitsBuilder() const {
+    if (use_block_based_builder_)
+      return NULL;
+    return new FullFilterBitsBuilder(bits_per_key_, static_cast<int>(k_));
+  }
+
+  virtual FilterBitsReader *GetFilterBitsReader(const Slice &contents) const {
+    return new FullFilterBitsReader(contents);
+  }
 
   virtual void CreateFilter(const Slice *keys, int n, std::string *dst) const {
     // Compute bloom filter size (in both bits and bytes)
@@ -86,7 +283,7 @@ public:
 
 const FilterPolicy *NewBloomFilterPolicy(int bits_per_key,
                                         bool use_block_based_builder) {
-  return new BloomFilterPolicy(bits_per_key);
+  return new BloomFilterPolicy(bits_per_key, use_block_based_builder);
 }
 
 } // namespace shannon
@@ -0,0 +1,76 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef SHANNON_DB_UTIL_BOUNDED_QUEUE_H_
+#define SHANNON_DB_UTIL_BOUNDED_QUEUE_H_
+
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace shannon {
+
+// A FIFO queue handing items from producer threads to consumer threads.
+// Push() blocks while "capacity" items are queued, which caps the memory
+// held by a pipeline stage that runs ahead of the next one.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity)
+      : capacity_(capacity > 0 ? capacity : 1), closed_(false) {}
+
+  // Append "item", waiting for room.  Returns false, leaving "item"
+  // untouched, if the queue is or gets closed.
+  bool Push(T&& item) {
+    std::unique_lock<std::mutex> lock(mu_);
+    not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Remove the oldest item into *item, waiting for one.  Returns false
+  // once the queue is closed and every queued item has been popped.
+  bool Pop(T* item) {
+    std::unique_lock<std::mutex> lock(mu_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return false;
+    }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // Refuse further pushes and wake up every waiter.  Items already
+  // queued can still be popped.
+  void Close() {
+    std::lock_guard<std::mutex> lock(mu_);
+    closed_ = true;
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+ private:
+  const size_t capacity_;
+  bool closed_;
+  std::deque<T> items_;
+  std::mutex mu_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+
+  // No copying allowed
+  BoundedQueue(const BoundedQueue&);
+  void operator=(const BoundedQueue&);
+};
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_UTIL_BOUNDED_QUEUE_H_
@@ -0,0 +1,95 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "concurrent_arena.h"
+#include <sched.h>
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace shannon {
+
+static const size_t kMaxShardBlockSize = 128 * 1024;
+static const size_t kCacheLineSize = 64;
+
+struct ConcurrentArena::Shard {
+  Shard() : free_begin(NULL), free_bytes(0) {}
+
+  std::mutex mu;
+  char* free_begin;
+  size_t free_bytes;
+  // Keeps the fields of neighbouring shards on different cache lines.
+  char padding[kCacheLineSize];
+};
+
+ConcurrentArena::ConcurrentArena(size_t block_size, size_t huge_page_size)
+    : shard_block_size_(std::min(
+          kMaxShardBlockSize, std::max(block_size, Arena::kMinBlockSize) / 8)),
+      arena_(block_size, huge_page_size),
+      memory_usage_(0),
+      arena_unused_(0),
+      huge_page_usage_(0),
+      shard_unused_(0) {
+  size_t cpus = std::thread::hardware_concurrency();
+  num_shards_ = 1;
+  while (num_shards_ < cpus) {
+    num_shards_ *= 2;
+  }
+  shards_ = new Shard[num_shards_];
+}
+
+ConcurrentArena::~ConcurrentArena() { delete[] shards_; }
+
+ConcurrentArena::Shard* ConcurrentArena::CurrentShard() {
+  int cpu = sched_getcpu();
+  size_t index = cpu >= 0
+                     ? static_cast<size_t>(cpu)
+                     : std::hash<std::thread::id>()(std::this_thread::get_id());
+  return &shards_[index & (num_shards_ - 1)];
+}
+
+void ConcurrentArena::Fixup() {
+  memory_usage_.store(arena_.MemoryUsage());
+  arena_unused_.store(arena_.AllocatedAndUnused());
+  huge_page_usage_.store(arena_.HugePageUsage());
+}
+
+char* ConcurrentArena::AllocateImpl(size_t bytes, bool aligned) {
+  assert(bytes > 0);
+  if (bytes > shard_block_size_ / 4) {
+    std::lock_guard<std::mutex> lock(arena_mu_);
+    char* result = aligned ? arena_.AllocateAligned(bytes)
+                           : arena_.Allocate(bytes);
+    Fixup();
+    return result;
+  }
+
+  const size_t align = sizeof(void*) > 8 ? sizeof(void*) : 8;
+  Shard* shard = CurrentShard();
+  std::lock_guard<std::mutex> lock(shard->mu);
+  size_t slop = 0;
+  if (aligned) {
+    slop = (align - (reinterpret_cast<uintptr_t>(shard->free_begin) &
+                     (align - 1))) & (align - 1);
+  }
+  if (bytes + slop > shard->free_bytes) {
+    // The rest of the shard's chunk is wasted, as the rest of a block is in
+    // Arena.
+    std::lock_guard<std::mutex> arena_lock(arena_mu_);
+    shard_unused_ -= shard->free_bytes;
+    shard->free_begin = arena_.AllocateAligned(shard_block_size_);
+    shard->free_bytes = shard_block_size_;
+    shard_unused_ += shard_block_size_;
+    Fixup();
+    slop = 0;
+  }
+  char* result = shard->free_begin + slop;
+  shard->free_begin += bytes + slop;
+  shard->free_bytes -= bytes + slop;
+  shard_unused_ -= bytes + slop;
+  return result;
+}
+
+}  // namespace shannon
@@ -0,0 +1,74 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef SHANNON_DB_UTIL_CONCURRENT_ARENA_H_
+#define SHANNON_DB_UTIL_CONCURRENT_ARENA_H_
+
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include "arena.h"
+
+namespace shannon {
+
+// An Arena that several threads may allocate from at once.  Memory is
+// freed all together when the arena is destroyed, as with Arena.
+//
+// Small allocations are carved from per-core shards, each refilled with a
+// chunk of the arena, so threads on different cores do not share a lock or
+// a cache line.  Allocations larger than a quarter of a chunk go to the
+// arena under its lock.
+class ConcurrentArena {
+ public:
+  // block_size and huge_page_size are those of the Arena behind the shards.
+  explicit ConcurrentArena(size_t block_size = Arena::kMinBlockSize,
+                           size_t huge_page_size = 0);
+  ~ConcurrentArena();
+
+  char* Allocate(size_t bytes) { return AllocateImpl(bytes, false); }
+
+  char* AllocateAligned(size_t bytes) { return AllocateImpl(bytes, true); }
+
+  // Memory taken from the system.  Safe to call while other threads
+  // allocate.
+  size_t MemoryUsage() const { return memory_usage_.load(); }
+
+  // The part of MemoryUsage() not handed out yet, in the arena's current
+  // block and in the shards.
+  size_t AllocatedAndUnused() const {
+    return arena_unused_.load() + shard_unused_.load();
+  }
+
+  size_t HugePageUsage() const { return huge_page_usage_.load(); }
+
+  size_t BlockSize() const { return arena_.BlockSize(); }
+
+ private:
+  struct Shard;
+
+  char* AllocateImpl(size_t bytes, bool aligned);
+  Shard* CurrentShard();
+  // Update the counters from the arena.  REQUIRES: arena_mu_ held.
+  void Fixup();
+
+  const size_t shard_block_size_;
+  size_t num_shards_;  // A power of 2
+  Shard* shards_;
+
+  std::mutex arena_mu_;
+  Arena arena_;
+
+  std::atomic<size_t> memory_usage_;
+  std::atomic<size_t> arena_unused_;
+  std::atomic<size_t> huge_page_usage_;
+  std::atomic<size_t> shard_unused_;
+
+  // No copying allowed
+  ConcurrentArena(const ConcurrentArena&);
+  void operator=(const ConcurrentArena&);
+};
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_UTIL_CONCURRENT_ARENA_H_
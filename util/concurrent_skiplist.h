@@ -0,0 +1,431 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef SHANNON_DB_UTIL_CONCURRENT_SKIPLIST_H_
+#define SHANNON_DB_UTIL_CONCURRENT_SKIPLIST_H_
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include "concurrent_arena.h"
+#include "random.h"
+
+namespace shannon {
+
+// A skip list with the ordering and iteration of SkipList that any number
+// of threads may Insert() into at once, while others read it.  A new node
+// is linked in one level at a time, bottom up, each with a compare and
+// swap of its predecessor's link; a failed swap searches that level again
+// from the predecessor.  Nodes are allocated from a ConcurrentArena and
+// never removed.
+template<typename Key, class Comparator>
+class ConcurrentSkipList {
+ private:
+  struct Node;
+
+ public:
+  static const int kMaxPossibleHeight = 32;
+
+  explicit ConcurrentSkipList(Comparator cmp, ConcurrentArena* arena,
+                              int32_t max_height = 12,
+                              int32_t branching_factor = 4);
+
+  // Insert key into the list.  Returns false, leaving the list unchanged,
+  // if an entry that compares equal to key is already in it.
+  // Thread safe.
+  bool Insert(const Key& key);
+
+  // Returns true iff an entry that compares equal to key is in the list.
+  bool Contains(const Key& key) const;
+
+  // Iteration over the contents of a skip list.  An iterator sees every
+  // entry inserted before it was positioned, and may or may not see those
+  // inserted concurrently.
+  class Iterator {
+   public:
+    // Initialize an iterator over the specified list.
+    // The returned iterator is not valid.
+    explicit Iterator(const ConcurrentSkipList* list);
+
+    // Returns true iff the iterator is positioned at a valid node.
+    bool Valid() const;
+
+    // Returns the key at the current position.
+    // REQUIRES: Valid()
+    const Key& key() const;
+
+    // Advances to the next position.
+    // REQUIRES: Valid()
+    void Next();
+
+    // Advances to the previous position.
+    // REQUIRES: Valid()
+    void Prev();
+
+    // Advance to the first entry with a key >= target
+    void Seek(const Key& target);
+
+    // Retreat to the last entry with a key <= target
+    void SeekForPrev(const Key& target);
+
+    // Position at the first entry in list.
+    // Final state of iterator is Valid() iff list is not empty.
+    void SeekToFirst();
+
+    // Position at the last entry in list.
+    // Final state of iterator is Valid() iff list is not empty.
+    void SeekToLast();
+
+   private:
+    const ConcurrentSkipList* list_;
+    Node* node_;
+    // Intentionally copyable
+  };
+
+ private:
+  const uint16_t kMaxHeight_;
+  const uint16_t kBranching_;
+  const uint32_t kScaledInverseBranching_;
+
+  // Immutable after construction
+  Comparator const compare_;
+  ConcurrentArena* const allocator_;  // Allocator used for allocations of nodes
+
+  Node* const head_;
+
+  // Only grows, with a compare and swap in Insert().  Read racily by
+  // readers, but stale values are ok.
+  std::atomic<int> max_height_;  // Height of the entire list
+
+  inline int GetMaxHeight() const {
+    return max_height_.load(std::memory_order_relaxed);
+  }
+
+  Node* NewNode(const Key& key, int height);
+  int RandomHeight();
+  bool Equal(const Key& a, const Key& b) const { return (compare_(a, b) == 0); }
+  bool LessThan(const Key& a, const Key& b) const {
+    return (compare_(a, b) < 0);
+  }
+
+  // Return true if key is greater than the data stored in "n"
+  bool KeyIsAfterNode(const Key& key, Node* n) const;
+
+  // Returns the earliest node with a key >= key.
+  // Return nullptr if there is no such node.
+  Node* FindGreaterOrEqual(const Key& key) const;
+
+  // Return the latest node with a key < key.
+  // Return head_ if there is no such node.
+  Node* FindLessThan(const Key& key) const;
+
+  // Return the last node in the list.
+  // Return head_ if list is empty.
+  Node* FindLast() const;
+
+  // Walk "level" from "before", which must be before key, and store the
+  // last node before key in *prev and the node after it in *next.
+  void FindSpliceForLevel(const Key& key, Node* before, int level,
+                          Node** prev, Node** next) const;
+
+  // No copying allowed
+  ConcurrentSkipList(const ConcurrentSkipList&);
+  void operator=(const ConcurrentSkipList&);
+};
+
+// Implementation details follow
+template<typename Key, class Comparator>
+struct ConcurrentSkipList<Key, Comparator>::Node {
+  explicit Node(const Key& k) : key(k) { }
+
+  Key const key;
+
+  // Accessors/mutators for links.  Wrapped in methods so we can
+  // add the appropriate barriers as necessary.
+  Node* Next(int n) {
+    assert(n >= 0);
+    // Use an 'acquire load' so that we observe a fully initialized
+    // version of the returned Node.
+    return (next_[n].load(std::memory_order_acquire));
+  }
+  void SetNext(int n, Node* x) {
+    assert(n >= 0);
+    next_[n].store(x, std::memory_order_release);
+  }
+
+  // Link x after this node at level n if the link is still "expected".
+  // The swap releases x, so readers following the link see it whole.
+  bool CASNext(int n, Node* expected, Node* x) {
+    assert(n >= 0);
+    return next_[n].compare_exchange_strong(expected, x);
+  }
+
+  // No-barrier variants that can be safely used in a few locations.
+  void NoBarrier_SetNext(int n, Node* x) {
+    assert(n >= 0);
+    next_[n].store(x, std::memory_order_relaxed);
+  }
+
+ private:
+  // Array of length equal to the node height.  next_[0] is lowest level link.
+  std::atomic<Node*> next_[1];
+};
+
+template<typename Key, class Comparator>
+typename ConcurrentSkipList<Key, Comparator>::Node*
+ConcurrentSkipList<Key, Comparator>::NewNode(const Key& key, int height) {
+  char* mem = allocator_->AllocateAligned(
+      sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1));
+  return new (mem) Node(key);
+}
+
+template<typename Key, class Comparator>
+inline ConcurrentSkipList<Key, Comparator>::Iterator::Iterator(
+    const ConcurrentSkipList* list)
+    : list_(list), node_(nullptr) {}
+
+template<typename Key, class Comparator>
+inline bool ConcurrentSkipList<Key, Comparator>::Iterator::Valid() const {
+  return node_ != nullptr;
+}
+
+template<typename Key, class Comparator>
+inline const Key& ConcurrentSkipList<Key, Comparator>::Iterator::key() const {
+  assert(Valid());
+  return node_->key;
+}
+
+template<typename Key, class Comparator>
+inline void ConcurrentSkipList<Key, Comparator>::Iterator::Next() {
+  assert(Valid());
+  node_ = node_->Next(0);
+}
+
+template<typename Key, class Comparator>
+inline void ConcurrentSkipList<Key, Comparator>::Iterator::Prev() {
+  // Instead of using explicit "prev" links, we just search for the
+  // last node that falls before key.
+  assert(Valid());
+  node_ = list_->FindLessThan(node_->key);
+  if (node_ == list_->head_) {
+    node_ = nullptr;
+  }
+}
+
+template<typename Key, class Comparator>
+inline void ConcurrentSkipList<Key, Comparator>::Iterator::Seek(
+    const Key& target) {
+  node_ = list_->FindGreaterOrEqual(target);
+}
+
+template<typename Key, class Comparator>
+inline void ConcurrentSkipList<Key, Comparator>::Iterator::SeekForPrev(
+    const Key& target) {
+  Seek(target);
+  if (!Valid()) {
+    SeekToLast();
+  }
+  while (Valid() && list_->LessThan(target, key())) {
+    Prev();
+  }
+}
+
+template<typename Key, class Comparator>
+inline void ConcurrentSkipList<Key, Comparator>::Iterator::SeekToFirst() {
+  node_ = list_->head_->Next(0);
+}
+
+template<typename Key, class Comparator>
+inline void ConcurrentSkipList<Key, Comparator>::Iterator::SeekToLast() {
+  node_ = list_->FindLast();
+  if (node_ == list_->head_) {
+    node_ = nullptr;
+  }
+}
+
+template<typename Key, class Comparator>
+int ConcurrentSkipList<Key, Comparator>::RandomHeight() {
+  // The instance is per thread, so no locking is needed.
+  auto rnd = Random::GetTLSInstance();
+
+  // Increase height with probability 1 in kBranching
+  int height = 1;
+  while (height < kMaxHeight_ && rnd->Next() < kScaledInverseBranching_) {
+    height++;
+  }
+  assert(height > 0);
+  assert(height <= kMaxHeight_);
+  return height;
+}
+
+template<typename Key, class Comparator>
+bool ConcurrentSkipList<Key, Comparator>::KeyIsAfterNode(const Key& key,
+                                                         Node* n) const {
+  // nullptr n is considered infinite
+  return (n != nullptr) && (compare_(n->key, key) < 0);
+}
+
+template<typename Key, class Comparator>
+typename ConcurrentSkipList<Key, Comparator>::Node*
+ConcurrentSkipList<Key, Comparator>::FindGreaterOrEqual(const Key& key) const {
+  Node* x = head_;
+  int level = GetMaxHeight() - 1;
+  Node* last_bigger = nullptr;
+  while (true) {
+    assert(x != nullptr);
+    Node* next = x->Next(level);
+    int cmp = (next == nullptr || next == last_bigger)
+        ? 1 : compare_(next->key, key);
+    if (cmp == 0 || (cmp > 0 && level == 0)) {
+      return next;
+    } else if (cmp < 0) {
+      // Keep searching in this list
+      x = next;
+    } else {
+      // Switch to next list, reuse compare_() result
+      last_bigger = next;
+      level--;
+    }
+  }
+}
+
+template<typename Key, class Comparator>
+typename ConcurrentSkipList<Key, Comparator>::Node*
+ConcurrentSkipList<Key, Comparator>::FindLessThan(const Key& key) const {
+  Node* x = head_;
+  int level = GetMaxHeight() - 1;
+  // KeyIsAfter(key, last_not_after) is definitely false
+  Node* last_not_after = nullptr;
+  while (true) {
+    assert(x != nullptr);
+    Node* next = x->Next(level);
+    if (next != last_not_after && KeyIsAfterNode(key, next)) {
+      // Keep searching in this list
+      x = next;
+    } else {
+      if (level == 0) {
+        return x;
+      } else {
+        // Switch to next list, reuse KeyIsAfterNode() result
+        last_not_after = next;
+        level--;
+      }
+    }
+  }
+}
+
+template<typename Key, class Comparator>
+typename ConcurrentSkipList<Key, Comparator>::Node*
+ConcurrentSkipList<Key, Comparator>::FindLast() const {
+  Node* x = head_;
+  int level = GetMaxHeight() - 1;
+  while (true) {
+    Node* next = x->Next(level);
+    if (next == nullptr) {
+      if (level == 0) {
+        return x;
+      } else {
+        // Switch to next list
+        level--;
+      }
+    } else {
+      x = next;
+    }
+  }
+}
+
+template<typename Key, class Comparator>
+void ConcurrentSkipList<Key, Comparator>::FindSpliceForLevel(
+    const Key& key, Node* before, int level, Node** prev, Node** next) const {
+  while (true) {
+    Node* after = before->Next(level);
+    if (!KeyIsAfterNode(key, after)) {
+      *prev = before;
+      *next = after;
+      return;
+    }
+    before = after;
+  }
+}
+
+template<typename Key, class Comparator>
+ConcurrentSkipList<Key, Comparator>::ConcurrentSkipList(
+    const Comparator cmp, ConcurrentArena* allocator, int32_t max_height,
+    int32_t branching_factor)
+    : kMaxHeight_(static_cast<uint16_t>(max_height)),
+      kBranching_(static_cast<uint16_t>(branching_factor)),
+      kScaledInverseBranching_((Random::kMaxNext + 1) / kBranching_),
+      compare_(cmp),
+      allocator_(allocator),
+      head_(NewNode(0 /* any key will do */, max_height)),
+      max_height_(1) {
+  assert(max_height > 0 && max_height <= kMaxPossibleHeight);
+  assert(branching_factor > 0 &&
+         kBranching_ == static_cast<uint32_t>(branching_factor));
+  assert(kScaledInverseBranching_ > 0);
+  for (int i = 0; i < kMaxHeight_; i++) {
+    head_->SetNext(i, nullptr);
+  }
+}
+
+template<typename Key, class Comparator>
+bool ConcurrentSkipList<Key, Comparator>::Insert(const Key& key) {
+  int height = RandomHeight();
+  int max_height = GetMaxHeight();
+  while (height > max_height) {
+    // A concurrent reader that observes the new height sees either nullptr
+    // links from head_, and drops to the next level, or new nodes.
+    if (max_height_.compare_exchange_weak(max_height, height)) {
+      max_height = height;
+      break;
+    }
+  }
+
+  // prev[i] < key <= next[i] at every level, found from the top down so
+  // each level starts where the one above stopped.
+  Node* prev[kMaxPossibleHeight];
+  Node* next[kMaxPossibleHeight];
+  Node* before = head_;
+  for (int i = max_height - 1; i >= 0; i--) {
+    FindSpliceForLevel(key, before, i, &prev[i], &next[i]);
+    before = prev[i];
+  }
+  if (next[0] != nullptr && Equal(key, next[0]->key)) {
+    return false;
+  }
+
+  Node* x = NewNode(key, height);
+  for (int i = 0; i < height; i++) {
+    while (true) {
+      x->NoBarrier_SetNext(i, next[i]);
+      if (prev[i]->CASNext(i, next[i], x)) {
+        break;
+      }
+      // Another node was linked after prev[i] at this level.  Nodes are
+      // never removed, so prev[i] is still before key: search on from it.
+      FindSpliceForLevel(key, prev[i], i, &prev[i], &next[i]);
+      if (i == 0 && next[0] != nullptr && Equal(key, next[0]->key)) {
+        // A concurrent insert of an equal key won, x is not reachable and
+        // its memory stays unused in the arena.
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template<typename Key, class Comparator>
+bool ConcurrentSkipList<Key, Comparator>::Contains(const Key& key) const {
+  Node* x = FindGreaterOrEqual(key);
+  if (x != nullptr && Equal(key, x->key)) {
+    return true;
+  } else {
+    return false;
+  }
+}
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_UTIL_CONCURRENT_SKIPLIST_H_
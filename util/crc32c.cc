@@ -4,9 +4,17 @@
 //
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include "crc32c.h"
 #include "coding.h"
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAVE_X86_CRC32C 1
+#include <cpuid.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
 namespace shannon {
 namespace crc32c {
 
@@ -255,7 +263,7 @@ constexpr inline const uint8_t* RoundUp(const uint8_t* pointer) {
 
 }  // namespace
 
-uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
+static uint32_t ExtendPortable(uint32_t crc, const char* buf, size_t size) {
   const uint8_t* p = reinterpret_cast<const uint8_t*>(buf);
   const uint8_t* e = p + size;
   uint32_t l = crc ^ kCRC32Xor;
@@ -347,5 +355,187 @@ uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
   return l ^ kCRC32Xor;
 }
 
+#ifdef HAVE_X86_CRC32C
+namespace {
+
+// The crc32 instruction updates the bit-reflected crc register without
+// the pre- and post-conditioning, 8 bytes at a time.
+__attribute__((target("sse4.2")))
+inline uint64_t Crc32Bytes(uint64_t l, const uint8_t* p, size_t n) {
+  for (; n >= 8; n -= 8, p += 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    l = _mm_crc32_u64(l, v);
+  }
+  for (; n > 0; n--) {
+    l = _mm_crc32_u8(static_cast<uint32_t>(l), *p++);
+  }
+  return l;
+}
+
+// The crc register multiplied by x^(8n), i.e. extended over n zero bytes,
+// can be computed by a carry-less multiplication with x^(8n-33) mod P and
+// a crc32 of the 64-bit product: the crc32 adds x^32 and the reflected
+// product one more x.  Stripes of three streams are computed in parallel
+// to hide the latency of the crc32 instruction and joined that way.
+const size_t kLongStripe = 8192;
+const size_t kShortStripe = 256;
+
+struct StripeConstants {
+  uint64_t shift1;  // x^(8 * stripe - 33) mod P
+  uint64_t shift2;  // x^(16 * stripe - 33) mod P
+};
+
+// Literals rather than computed at startup, so that an Extend() from a
+// static initializer of another translation unit never sees them zero.
+// x^n mod P bit-reflected is x^0 = 0x80000000 shifted right n times,
+// xoring in 0x82f63b78 whenever a one is shifted out.
+constexpr StripeConstants kLongConstants = {0x54a86326u, 0x1dc403ccu};
+constexpr StripeConstants kShortConstants = {0xb9e02b86u, 0xdd7e3b0cu};
+
+__attribute__((target("sse4.2,pclmul")))
+inline uint64_t Crc32ThreeWay(uint64_t l, const uint8_t** pp, size_t* n,
+                              size_t stripe, const StripeConstants& k) {
+  const uint8_t* p = *pp;
+  while (*n >= 3 * stripe) {
+    uint64_t crc0 = l, crc1 = 0, crc2 = 0;
+    for (size_t i = 0; i < stripe; i += 8) {
+      uint64_t v0, v1, v2;
+      memcpy(&v0, p + i, 8);
+      memcpy(&v1, p + stripe + i, 8);
+      memcpy(&v2, p + 2 * stripe + i, 8);
+      crc0 = _mm_crc32_u64(crc0, v0);
+      crc1 = _mm_crc32_u64(crc1, v1);
+      crc2 = _mm_crc32_u64(crc2, v2);
+    }
+    __m128i r0 = _mm_clmulepi64_si128(_mm_cvtsi64_si128(crc0),
+                                      _mm_cvtsi64_si128(k.shift2), 0x00);
+    __m128i r1 = _mm_clmulepi64_si128(_mm_cvtsi64_si128(crc1),
+                                      _mm_cvtsi64_si128(k.shift1), 0x00);
+    uint64_t folded = _mm_cvtsi128_si64(_mm_xor_si128(r0, r1));
+    l = _mm_crc32_u64(0, folded) ^ crc2;
+    p += 3 * stripe;
+    *n -= 3 * stripe;
+  }
+  *pp = p;
+  return l;
+}
+
+}  // namespace
+
+__attribute__((target("sse4.2")))
+static uint32_t ExtendSse42(uint32_t crc, const char* buf, size_t size) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(buf);
+  uint64_t l = crc ^ kCRC32Xor;
+  size_t head = (8 - (reinterpret_cast<uintptr_t>(p) & 7)) & 7;
+  if (head > size) head = size;
+  l = Crc32Bytes(l, p, head);
+  l = Crc32Bytes(l, p + head, size - head);
+  return static_cast<uint32_t>(l) ^ kCRC32Xor;
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static uint32_t ExtendSse42Pclmul(uint32_t crc, const char* buf, size_t size) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(buf);
+  uint64_t l = crc ^ kCRC32Xor;
+  size_t head = (8 - (reinterpret_cast<uintptr_t>(p) & 7)) & 7;
+  if (head > size) head = size;
+  l = Crc32Bytes(l, p, head);
+  p += head;
+  size -= head;
+  l = Crc32ThreeWay(l, &p, &size, kLongStripe, kLongConstants);
+  l = Crc32ThreeWay(l, &p, &size, kShortStripe, kShortConstants);
+  l = Crc32Bytes(l, p, size);
+  return static_cast<uint32_t>(l) ^ kCRC32Xor;
+}
+#endif  // HAVE_X86_CRC32C
+
+bool IsSupported(Implementation impl) {
+#ifdef HAVE_X86_CRC32C
+  unsigned int eax, ebx, ecx, edx;
+  if (impl != kPortable && !__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  switch (impl) {
+    case kPortable:
+      return true;
+    case kSse42:
+      return (ecx & bit_SSE4_2) != 0;
+    case kSse42Pclmul:
+      return (ecx & bit_SSE4_2) != 0 && (ecx & bit_PCLMUL) != 0;
+  }
+  return false;
+#else
+  return impl == kPortable;
+#endif
+}
+
+const char* ImplementationName(Implementation impl) {
+  switch (impl) {
+    case kPortable:
+      return "portable";
+    case kSse42:
+      return "sse4.2";
+    case kSse42Pclmul:
+      return "sse4.2+pclmul";
+  }
+  return "unknown";
+}
+
+uint32_t ExtendWith(Implementation impl, uint32_t crc, const char* buf,
+                    size_t size) {
+  switch (impl) {
+#ifdef HAVE_X86_CRC32C
+    case kSse42:
+      return ExtendSse42(crc, buf, size);
+    case kSse42Pclmul:
+      return ExtendSse42Pclmul(crc, buf, size);
+#endif
+    default:
+      return ExtendPortable(crc, buf, size);
+  }
+}
+
+namespace {
+
+typedef uint32_t (*ExtendFunction)(uint32_t, const char*, size_t);
+
+Implementation ChooseImplementation() {
+  if (IsSupported(kSse42Pclmul)) return kSse42Pclmul;
+  if (IsSupported(kSse42)) return kSse42;
+  return kPortable;
+}
+
+ExtendFunction ChooseExtend() {
+  switch (ChooseImplementation()) {
+#ifdef HAVE_X86_CRC32C
+    case kSse42:
+      return ExtendSse42;
+    case kSse42Pclmul:
+      return ExtendSse42Pclmul;
+#endif
+    default:
+      return ExtendPortable;
+  }
+}
+
+// Picked once, the first call of Extend() may come from a static
+// initializer of another translation unit.
+ExtendFunction ActiveExtend() {
+  static const ExtendFunction extend = ChooseExtend();
+  return extend;
+}
+
+}  // namespace
+
+Implementation ActiveImplementation() {
+  static const Implementation impl = ChooseImplementation();
+  return impl;
+}
+
+uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
+  return ActiveExtend()(crc, buf, size);
+}
+
 }  // namespace crc32c
 }  // namespace shannon
@@ -14,8 +14,25 @@ namespace crc32c {
 // Return the crc32c of concat(A, data[0,n-1]) where init_crc is the
 // crc32c of some string A.  Extend() is often used to maintain the
 // crc32c of a stream of data.
+// Uses the crc32 instruction of the CPU when it has one.
 extern uint32_t Extend(uint32_t init_crc, const char* data, size_t n);
 
+// Implementations of Extend(), picked once from what the CPU supports.
+enum Implementation {
+  kPortable,     // table driven
+  kSse42,        // crc32 instruction
+  kSse42Pclmul,  // crc32 on three streams joined with pclmulqdq
+};
+
+extern bool IsSupported(Implementation impl);
+extern Implementation ActiveImplementation();
+extern const char* ImplementationName(Implementation impl);
+
+// Extend() with the given implementation, which must be supported.
+// For tests and benchmarks.
+extern uint32_t ExtendWith(Implementation impl, uint32_t init_crc,
+                           const char* data, size_t n);
+
 // Return the crc32c of data[0,n-1]
 inline uint32_t Value(const char* data, size_t n) {
   return Extend(0, data, n);
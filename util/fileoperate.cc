@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -80,4 +81,89 @@ free_buf:
   return 0;
 }
 
+int OpenMappedFile(char *filename, MappedFile *file)
+{
+  struct stat statbuf;
+  void *base;
+
+  memset(file, 0, sizeof(MappedFile));
+  file->filename = filename;
+  if ((file->fd = open(filename, O_RDONLY)) == -1) {
+    printf("can not open file:%s, %s\n", filename, strerror(errno));
+    return -1;
+  }
+  if (fstat(file->fd, &statbuf) == -1) {
+    printf("get file size failed: %s\n", strerror(errno));
+    close(file->fd);
+    file->fd = -1;
+    return -1;
+  }
+  file->size = statbuf.st_size;
+  if (file->size == 0)
+    return 0;
+  base = mmap(NULL, file->size, PROT_READ, MAP_SHARED, file->fd, 0);
+  if (base == MAP_FAILED) {
+    printf("file=%s mmap failed, %s, use read instead\n",
+           filename, strerror(errno));
+    return 0;
+  }
+  // Blocks are decoded front to back, so read ahead aggressively and
+  // drop pages behind.
+  madvise(base, file->size, MADV_SEQUENTIAL);
+  madvise(base, file->size, MADV_WILLNEED);
+  file->data = (const char *)base;
+  return 0;
+}
+
+void CloseMappedFile(MappedFile *file)
+{
+  if (file->data)
+    munmap((void *)file->data, file->size);
+  if (file->fd >= 0)
+    close(file->fd);
+  file->data = NULL;
+  file->fd = -1;
+}
+
+size_t ReadMappedFile(MappedFile *file, uint64_t offset, uint64_t size,
+                      Slice *result, bool *copied)
+{
+  char *buf;
+  ssize_t tmp_read;
+  size_t read_size = 0;
+
+  *copied = false;
+  if (size <= 0) {
+    printf("read size must bigger than 0\n");
+    return 0;
+  }
+  if (offset > file->size || size > file->size - offset) {
+    printf("read file too long!\n");
+    return 0;
+  }
+  if (file->data) {
+    *result = Slice(file->data + offset, size);
+    return size;
+  }
+
+  buf = (char *)malloc(size);
+  if (buf == NULL) {
+    printf("read file fail, malloc error\n");
+    return 0;
+  }
+  while (read_size < size) {
+    tmp_read = pread(file->fd, buf + read_size, size - read_size,
+                     (off_t)(offset + read_size));
+    if (tmp_read == -1 || tmp_read == 0) {
+      printf("file=%s read failed, %s\n", file->filename, strerror(errno));
+      free(buf);
+      return 0;
+    }
+    read_size += tmp_read;
+  }
+  *result = Slice((const char *)buf, read_size);
+  *copied = true;
+  return read_size;
+}
+
 } // namespace shannon
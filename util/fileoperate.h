@@ -17,6 +17,27 @@ namespace shannon {
 extern void GetFilesize(char *filename, size_t *file_size);
 extern size_t ReadFile(char *filename, uint64_t offset, uint64_t size, Slice *result);
 
+// A file opened once for random reads.  The whole file is mapped
+// read-only with sequential and willneed hints, so a read is a slice of
+// the mapping.  If the file can not be mapped, reads fall back to pread()
+// into a malloc()ed buffer.
+struct MappedFile {
+  char *filename;
+  int fd;
+  const char *data; // start of the mapping, NULL if not mapped
+  size_t size;
+};
+
+// Return 0 on success, -1 on error.
+extern int OpenMappedFile(char *filename, MappedFile *file);
+extern void CloseMappedFile(MappedFile *file);
+// Store "size" bytes at "offset" in *result and return the number of
+// bytes read, 0 on error.  *copied is set if *result was malloc()ed and
+// must be freed by the caller, otherwise it points into the mapping and
+// stays valid until the file is closed.
+extern size_t ReadMappedFile(MappedFile *file, uint64_t offset, uint64_t size,
+                             Slice *result, bool *copied);
+
 } // namespace shannon
 
 #endif // STORAGE_SHANNONDB_INCLUDE_UTIL_FILEOP_H_
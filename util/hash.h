@@ -10,6 +10,7 @@
 #include <stdint.h>
 
 #include "swift/slice.h"
+#include "xxh3.h"
 
 namespace shannon {
 
@@ -28,6 +29,17 @@ struct SliceHasher {
   uint32_t operator()(const Slice& s) const { return GetSliceHash(s); }
 };
 
+// XXH3 of the slice, much faster than Hash() on short keys.  For caches,
+// filters and hash tables built in memory; what is persisted, like the
+// filter blocks of SST files, keeps using Hash().
+inline uint64_t GetSliceHash64(const Slice& s) {
+  return xxh3::Hash64(s.data(), s.size());
+}
+
+struct SliceHasher64 {
+  uint64_t operator()(const Slice& s) const { return GetSliceHash64(s); }
+};
+
 }  // namespace shannon
 
 #endif  // HASH_H_
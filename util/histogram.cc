@@ -0,0 +1,157 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/histogram.h"
+#include <math.h>
+#include <stdio.h>
+
+namespace shannon {
+
+HistogramImpl::HistogramImpl() {
+  Clear();
+}
+
+void HistogramImpl::Clear() {
+  min_.store(UINT64_MAX, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+  num_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  sum_squares_.store(0, std::memory_order_relaxed);
+  for (size_t b = 0; b < HistogramBucketMapper::kBucketCount; b++) {
+    buckets_[b].store(0, std::memory_order_relaxed);
+  }
+}
+
+void HistogramImpl::Add(uint64_t value) {
+  const size_t index = HistogramBucketMapper::IndexForValue(value);
+  buckets_[index].fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t old_min = min_.load(std::memory_order_relaxed);
+  while (value < old_min &&
+         !min_.compare_exchange_weak(old_min, value,
+                                     std::memory_order_relaxed)) {
+  }
+  uint64_t old_max = max_.load(std::memory_order_relaxed);
+  while (value > old_max &&
+         !max_.compare_exchange_weak(old_max, value,
+                                     std::memory_order_relaxed)) {
+  }
+
+  num_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  sum_squares_.fetch_add(value * value, std::memory_order_relaxed);
+}
+
+void HistogramImpl::Merge(const HistogramImpl& other) {
+  uint64_t other_min = other.min();
+  uint64_t old_min = min();
+  while (other_min < old_min &&
+         !min_.compare_exchange_weak(old_min, other_min,
+                                     std::memory_order_relaxed)) {
+  }
+  uint64_t other_max = other.max();
+  uint64_t old_max = max();
+  while (other_max > old_max &&
+         !max_.compare_exchange_weak(old_max, other_max,
+                                     std::memory_order_relaxed)) {
+  }
+  num_.fetch_add(other.num(), std::memory_order_relaxed);
+  sum_.fetch_add(other.sum(), std::memory_order_relaxed);
+  sum_squares_.fetch_add(
+      other.sum_squares_.load(std::memory_order_relaxed),
+      std::memory_order_relaxed);
+  for (size_t b = 0; b < HistogramBucketMapper::kBucketCount; b++) {
+    buckets_[b].fetch_add(other.buckets_[b].load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+  }
+}
+
+double HistogramImpl::Median() const {
+  return Percentile(50.0);
+}
+
+double HistogramImpl::Percentile(double p) const {
+  const uint64_t total = num();
+  if (total == 0) {
+    return 0;
+  }
+  double threshold = total * (p / 100.0);
+  uint64_t cumulative_sum = 0;
+  for (size_t b = 0; b < HistogramBucketMapper::kBucketCount; b++) {
+    uint64_t bucket_value = buckets_[b].load(std::memory_order_relaxed);
+    cumulative_sum += bucket_value;
+    if (cumulative_sum >= threshold) {
+      // Scale linearly within this bucket
+      uint64_t left_point = HistogramBucketMapper::BucketLowerBound(b);
+      uint64_t right_point = HistogramBucketMapper::BucketUpperBound(b);
+      uint64_t left_sum = cumulative_sum - bucket_value;
+      double pos = 0;
+      if (bucket_value != 0) {
+        pos = (threshold - left_sum) / bucket_value;
+      }
+      double r = left_point + (right_point - left_point) * pos;
+      uint64_t cur_min = min();
+      uint64_t cur_max = max();
+      if (r < cur_min) r = static_cast<double>(cur_min);
+      if (r > cur_max) r = static_cast<double>(cur_max);
+      return r;
+    }
+  }
+  return static_cast<double>(max());
+}
+
+double HistogramImpl::Average() const {
+  uint64_t cur_num = num();
+  if (cur_num == 0) {
+    return 0;
+  }
+  return static_cast<double>(sum()) / static_cast<double>(cur_num);
+}
+
+double HistogramImpl::StandardDeviation() const {
+  double cur_num = static_cast<double>(num());
+  if (cur_num == 0) {
+    return 0;
+  }
+  double cur_sum = static_cast<double>(sum());
+  double cur_sum_squares =
+      static_cast<double>(sum_squares_.load(std::memory_order_relaxed));
+  double variance =
+      (cur_sum_squares * cur_num - cur_sum * cur_sum) / (cur_num * cur_num);
+  return variance > 0 ? sqrt(variance) : 0;
+}
+
+void HistogramImpl::Data(HistogramData* const data) const {
+  data->median = Median();
+  data->percentile95 = Percentile(95);
+  data->percentile99 = Percentile(99);
+  data->percentile999 = Percentile(99.9);
+  data->max = static_cast<double>(max());
+  data->average = Average();
+  data->standard_deviation = StandardDeviation();
+  data->count = num();
+  data->sum = sum();
+  data->min = num() == 0 ? 0 : static_cast<double>(min());
+}
+
+std::string HistogramImpl::ToString() const {
+  char buf[256];
+  uint64_t cur_num = num();
+  snprintf(buf, sizeof(buf),
+           "Count: %lu Average: %.4f  StdDev: %.2f\n",
+           (unsigned long)cur_num, Average(), StandardDeviation());
+  std::string r(buf);
+  snprintf(buf, sizeof(buf),
+           "Min: %lu  Median: %.4f  Max: %lu\n",
+           (unsigned long)(cur_num == 0 ? 0 : min()), Median(),
+           (unsigned long)max());
+  r.append(buf);
+  snprintf(buf, sizeof(buf),
+           "Percentiles: P50: %.2f P95: %.2f P99: %.2f P99.9: %.2f\n",
+           Percentile(50), Percentile(95), Percentile(99), Percentile(99.9));
+  r.append(buf);
+  return r;
+}
+
+}  // namespace shannon
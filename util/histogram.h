@@ -0,0 +1,94 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef SHANNON_DB_UTIL_HISTOGRAM_H_
+#define SHANNON_DB_UTIL_HISTOGRAM_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include "swift/statistics.h"
+
+namespace shannon {
+
+// Log-linear bucketing in the style of HdrHistogram: every power of two
+// is split into kSubBuckets linear buckets, so a recorded value is off by
+// at most 1/kSubBuckets of itself whatever its magnitude.
+class HistogramBucketMapper {
+ public:
+  enum {
+    kSubBucketBits = 4,
+    kSubBuckets = 1 << kSubBucketBits,
+    kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets
+  };
+
+  static size_t IndexForValue(uint64_t value) {
+    if (value < kSubBuckets) {
+      return static_cast<size_t>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - kSubBucketBits;
+    return static_cast<size_t>((msb - kSubBucketBits + 1) * kSubBuckets +
+                               ((value >> shift) & (kSubBuckets - 1)));
+  }
+
+  // Smallest value that maps to bucket "index".
+  static uint64_t BucketLowerBound(size_t index) {
+    if (index < kSubBuckets) {
+      return index;
+    }
+    int group = static_cast<int>(index / kSubBuckets);
+    uint64_t sub = index % kSubBuckets;
+    int shift = group - 1;
+    return (static_cast<uint64_t>(kSubBuckets) + sub) << shift;
+  }
+
+  // Largest value that maps to bucket "index".
+  static uint64_t BucketUpperBound(size_t index) {
+    if (index + 1 >= kBucketCount) {
+      return UINT64_MAX;
+    }
+    return BucketLowerBound(index + 1) - 1;
+  }
+};
+
+// A histogram that may be updated concurrently from several threads.
+// Updates use relaxed atomics; a reader may see a slightly inconsistent
+// snapshot while writers are active, which is fine for reporting.
+class HistogramImpl {
+ public:
+  HistogramImpl();
+
+  void Clear();
+  void Add(uint64_t value);
+  void Merge(const HistogramImpl& other);
+
+  uint64_t num() const { return num_.load(std::memory_order_relaxed); }
+  uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+  uint64_t min() const { return min_.load(std::memory_order_relaxed); }
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+  double Median() const;
+  double Percentile(double p) const;
+  double Average() const;
+  double StandardDeviation() const;
+  void Data(HistogramData* const data) const;
+  std::string ToString() const;
+
+ private:
+  std::atomic<uint64_t> min_;
+  std::atomic<uint64_t> max_;
+  std::atomic<uint64_t> num_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> sum_squares_;
+  std::atomic<uint64_t> buckets_[HistogramBucketMapper::kBucketCount];
+
+  // No copying allowed
+  HistogramImpl(const HistogramImpl&);
+  void operator=(const HistogramImpl&);
+};
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_UTIL_HISTOGRAM_H_
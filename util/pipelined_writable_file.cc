@@ -0,0 +1,114 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "pipelined_writable_file.h"
+#include "util/statistics.h"
+
+namespace shannon {
+
+PipelinedWritableFile::PipelinedWritableFile(WritableFile* target,
+                                             size_t chunk_size, int depth)
+    : target_(target),
+      chunk_size_(chunk_size),
+      queue_(depth),
+      pending_(0),
+      write_bytes_(0),
+      write_micros_(0),
+      wait_micros_(0) {
+  buffer_.reserve(chunk_size_);
+  writer_ = std::thread(&PipelinedWritableFile::WriterLoop, this);
+}
+
+PipelinedWritableFile::~PipelinedWritableFile() {
+  StopWriter();
+  delete target_;
+}
+
+Status PipelinedWritableFile::Append(const Slice& data) {
+  buffer_.append(data.data(), data.size());
+  if (buffer_.size() >= chunk_size_) {
+    Handoff();
+  }
+  return status();
+}
+
+Status PipelinedWritableFile::Flush() { return status(); }
+
+Status PipelinedWritableFile::Sync() {
+  Status s = Drain();
+  if (s.ok()) {
+    uint64_t start = StatsNowMicros();
+    s = target_->Sync();
+    write_micros_ += StatsNowMicros() - start;
+  }
+  return s;
+}
+
+Status PipelinedWritableFile::Close() {
+  Status s = Drain();
+  StopWriter();
+  Status c = target_->Close();
+  return s.ok() ? c : s;
+}
+
+Status PipelinedWritableFile::status() {
+  std::lock_guard<std::mutex> lock(mu_);
+  return status_;
+}
+
+void PipelinedWritableFile::Handoff() {
+  if (buffer_.empty()) {
+    return;
+  }
+  std::string chunk;
+  chunk.reserve(chunk_size_);
+  chunk.swap(buffer_);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    pending_++;
+  }
+  uint64_t start = StatsNowMicros();
+  if (!queue_.Push(std::move(chunk))) {
+    std::lock_guard<std::mutex> lock(mu_);
+    pending_--;
+  }
+  wait_micros_ += StatsNowMicros() - start;
+}
+
+Status PipelinedWritableFile::Drain() {
+  Handoff();
+  uint64_t start = StatsNowMicros();
+  std::unique_lock<std::mutex> lock(mu_);
+  idle_.wait(lock, [this] { return pending_ == 0; });
+  wait_micros_ += StatsNowMicros() - start;
+  return status_;
+}
+
+void PipelinedWritableFile::StopWriter() {
+  queue_.Close();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+}
+
+void PipelinedWritableFile::WriterLoop() {
+  std::string chunk;
+  while (queue_.Pop(&chunk)) {
+    if (status().ok()) {
+      uint64_t start = StatsNowMicros();
+      Status s = target_->Append(chunk);
+      write_micros_ += StatsNowMicros() - start;
+      write_bytes_ += chunk.size();
+      if (!s.ok()) {
+        std::lock_guard<std::mutex> lock(mu_);
+        status_ = s;
+      }
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    pending_--;
+    idle_.notify_all();
+  }
+}
+
+}  // namespace shannon
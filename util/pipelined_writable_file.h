@@ -0,0 +1,68 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef SHANNON_DB_UTIL_PIPELINED_WRITABLE_FILE_H_
+#define SHANNON_DB_UTIL_PIPELINED_WRITABLE_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "swift/env.h"
+#include "swift/status.h"
+#include "util/bounded_queue.h"
+
+namespace shannon {
+
+// A WritableFile whose appends are done by a writer thread.  Appended
+// bytes are collected into chunks that are queued to the writer, so the
+// caller only waits when "depth" chunks are already pending.  Errors of
+// the writer are returned by the next call.  Flush() is left to the
+// writer; Sync() and Close() wait for every pending chunk.  Owns
+// "target", which is deleted with this file.
+class PipelinedWritableFile : public WritableFile {
+ public:
+  PipelinedWritableFile(WritableFile* target, size_t chunk_size, int depth);
+  virtual ~PipelinedWritableFile();
+
+  virtual Status Append(const Slice& data);
+  virtual Status Flush();
+  virtual Status Sync();
+  virtual Status Close();
+
+  uint64_t write_bytes() const { return write_bytes_; }
+  uint64_t write_micros() const { return write_micros_; }
+  // Time the caller spent waiting for the writer.
+  uint64_t wait_micros() const { return wait_micros_; }
+
+ private:
+  Status status();
+  void Handoff();
+  Status Drain();
+  void StopWriter();
+  void WriterLoop();
+
+  WritableFile* target_;
+  const size_t chunk_size_;
+  std::string buffer_;
+  BoundedQueue<std::string> queue_;
+  std::thread writer_;
+
+  std::mutex mu_;
+  std::condition_variable idle_;
+  int pending_;    // chunks queued or being written, guarded by mu_
+  Status status_;  // first error of the writer, guarded by mu_
+
+  // Written by the writer thread, read once it is idle.
+  std::atomic<uint64_t> write_bytes_;
+  std::atomic<uint64_t> write_micros_;
+  uint64_t wait_micros_;
+};
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_UTIL_PIPELINED_WRITABLE_FILE_H_
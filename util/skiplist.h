@@ -278,7 +278,6 @@ typename SkipList<Key, Comparator>::Node* SkipList<Key, Comparator>::
   Node* last_bigger = nullptr;
   while (true) {
     assert(x != nullptr);
-    assert(key != nullptr);
     Node* next = x->Next(level);
     // Make sure the lists are sorted
     assert(x == head_ || next == nullptr || KeyIsAfterNode(next->key, x));
@@ -0,0 +1,143 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/statistics.h"
+#include <stdio.h>
+#include <assert.h>
+
+namespace shannon {
+
+const std::vector<std::pair<Tickers, std::string>> TickersNameMap = {
+    {NUMBER_KEYS_WRITTEN, "shannon.number.keys.written"},
+    {NUMBER_KEYS_DELETED, "shannon.number.keys.deleted"},
+    {NUMBER_KEYS_READ, "shannon.number.keys.read"},
+    {NUMBER_KEYS_NOT_FOUND, "shannon.number.keys.not.found"},
+    {BYTES_WRITTEN, "shannon.bytes.written"},
+    {BYTES_READ, "shannon.bytes.read"},
+    {NUMBER_WRITE_BATCH, "shannon.number.write.batch"},
+    {NUMBER_WRITE_BATCH_NONATOMIC, "shannon.number.write.batch.nonatomic"},
+    {NUMBER_WRITE_BATCH_KEYS, "shannon.number.write.batch.keys"},
+    {NUMBER_READ_BATCH, "shannon.number.read.batch"},
+    {NUMBER_READ_BATCH_KEYS, "shannon.number.read.batch.keys"},
+    {NUMBER_READ_BATCH_REREAD, "shannon.number.read.batch.reread"},
+    {NUMBER_DB_SEEK, "shannon.number.db.seek"},
+    {NUMBER_DB_NEXT, "shannon.number.db.next"},
+    {NUMBER_DB_PREV, "shannon.number.db.prev"},
+    {ITER_BYTES_READ, "shannon.db.iter.bytes.read"},
+    {NUMBER_LOG_ITER_NEXT, "shannon.number.log.iter.next"},
+    {LOG_ITER_BYTES_READ, "shannon.log.iter.bytes.read"},
+    {NUMBER_AIO_SUBMITTED, "shannon.number.aio.submitted"},
+    {NUMBER_AIO_COMPLETED, "shannon.number.aio.completed"},
+    {NUMBER_AIO_FAILED, "shannon.number.aio.failed"},
+    {NUMBER_IOCTL_ERRORS, "shannon.number.ioctl.errors"},
+    {SST_EXPORT_KEYS, "shannon.sst.export.keys"},
+    {SST_EXPORT_FILES, "shannon.sst.export.files"},
+    {SST_EXPORT_READ_BYTES, "shannon.sst.export.read.bytes"},
+    {SST_EXPORT_WRITE_BYTES, "shannon.sst.export.write.bytes"},
+    {SST_EXPORT_READ_MICROS, "shannon.sst.export.read.micros"},
+    {SST_EXPORT_ENCODE_MICROS, "shannon.sst.export.encode.micros"},
+    {SST_EXPORT_WRITE_MICROS, "shannon.sst.export.write.micros"},
+};
+
+const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
+    {DB_GET, "shannon.db.get.micros"},
+    {DB_PUT, "shannon.db.put.micros"},
+    {DB_DELETE_KEY, "shannon.db.delete.micros"},
+    {DB_WRITE, "shannon.db.write.micros"},
+    {DB_WRITE_NONATOMIC, "shannon.db.write.nonatomic.micros"},
+    {DB_READ, "shannon.db.read.micros"},
+    {DB_KEY_EXIST, "shannon.db.key.exist.micros"},
+    {DB_ITER_SEEK, "shannon.db.iter.seek.micros"},
+    {DB_ITER_NEXT, "shannon.db.iter.next.micros"},
+    {DB_ITER_PREV, "shannon.db.iter.prev.micros"},
+    {DB_ITER_GET, "shannon.db.iter.get.micros"},
+    {LOG_ITER_NEXT, "shannon.log.iter.next.micros"},
+    {LOG_ITER_GET, "shannon.log.iter.get.micros"},
+    {AIO_SUBMIT_TO_COMPLETION, "shannon.aio.submit.to.completion.micros"},
+    {POLL_COMPLETION_BATCH_SIZE, "shannon.poll.completion.batch.size"},
+    {DB_GET_RANGE, "shannon.db.get.range.micros"},
+    {DB_PUT_RANGE, "shannon.db.put.range.micros"},
+};
+
+std::shared_ptr<Statistics> CreateDBStatistics() {
+  return std::make_shared<StatisticsImpl>();
+}
+
+StatisticsImpl::StatisticsImpl() {
+  Reset();
+}
+
+StatisticsImpl::~StatisticsImpl() {}
+
+uint64_t StatisticsImpl::getTickerCount(uint32_t ticker_type) const {
+  assert(ticker_type < TICKER_ENUM_MAX);
+  return tickers_[ticker_type].load(std::memory_order_relaxed);
+}
+
+void StatisticsImpl::histogramData(uint32_t histogram_type,
+                                   HistogramData* const data) const {
+  assert(histogram_type < HISTOGRAM_ENUM_MAX);
+  histograms_[histogram_type].Data(data);
+}
+
+std::string StatisticsImpl::getHistogramString(uint32_t histogram_type) const {
+  assert(histogram_type < HISTOGRAM_ENUM_MAX);
+  return histograms_[histogram_type].ToString();
+}
+
+void StatisticsImpl::recordTick(uint32_t ticker_type, uint64_t count) {
+  assert(ticker_type < TICKER_ENUM_MAX);
+  tickers_[ticker_type].fetch_add(count, std::memory_order_relaxed);
+}
+
+void StatisticsImpl::setTickerCount(uint32_t ticker_type, uint64_t count) {
+  assert(ticker_type < TICKER_ENUM_MAX);
+  tickers_[ticker_type].store(count, std::memory_order_relaxed);
+}
+
+uint64_t StatisticsImpl::getAndResetTickerCount(uint32_t ticker_type) {
+  assert(ticker_type < TICKER_ENUM_MAX);
+  return tickers_[ticker_type].exchange(0, std::memory_order_relaxed);
+}
+
+void StatisticsImpl::measureTime(uint32_t histogram_type, uint64_t value) {
+  assert(histogram_type < HISTOGRAM_ENUM_MAX);
+  histograms_[histogram_type].Add(value);
+}
+
+void StatisticsImpl::Reset() {
+  for (uint32_t i = 0; i < TICKER_ENUM_MAX; ++i) {
+    tickers_[i].store(0, std::memory_order_relaxed);
+  }
+  for (uint32_t h = 0; h < HISTOGRAM_ENUM_MAX; ++h) {
+    histograms_[h].Clear();
+  }
+}
+
+std::string StatisticsImpl::ToString() const {
+  std::string res;
+  res.reserve(20000);
+  char buffer[256];
+  for (const auto& t : TickersNameMap) {
+    assert(t.first < TICKER_ENUM_MAX);
+    snprintf(buffer, sizeof(buffer), "%s COUNT : %lu\n", t.second.c_str(),
+             (unsigned long)getTickerCount(t.first));
+    res.append(buffer);
+  }
+  for (const auto& h : HistogramsNameMap) {
+    assert(h.first < HISTOGRAM_ENUM_MAX);
+    HistogramData hData;
+    histogramData(h.first, &hData);
+    snprintf(buffer, sizeof(buffer),
+             "%s P50 : %f P99 : %f P99.9 : %f MAX : %f COUNT : %lu SUM : %lu\n",
+             h.second.c_str(), hData.median, hData.percentile99,
+             hData.percentile999, hData.max, (unsigned long)hData.count,
+             (unsigned long)hData.sum);
+    res.append(buffer);
+  }
+  res.shrink_to_fit();
+  return res;
+}
+
+}  // namespace shannon
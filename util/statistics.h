@@ -0,0 +1,83 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef SHANNON_DB_UTIL_STATISTICS_H_
+#define SHANNON_DB_UTIL_STATISTICS_H_
+
+#include <time.h>
+#include <atomic>
+#include <string>
+#include "swift/statistics.h"
+#include "util/histogram.h"
+
+namespace shannon {
+
+class StatisticsImpl : public Statistics {
+ public:
+  StatisticsImpl();
+  virtual ~StatisticsImpl();
+
+  virtual uint64_t getTickerCount(uint32_t ticker_type) const override;
+  virtual void histogramData(uint32_t histogram_type,
+                             HistogramData* const data) const override;
+  virtual std::string getHistogramString(uint32_t histogram_type) const override;
+  virtual void recordTick(uint32_t ticker_type, uint64_t count) override;
+  virtual void setTickerCount(uint32_t ticker_type, uint64_t count) override;
+  virtual uint64_t getAndResetTickerCount(uint32_t ticker_type) override;
+  virtual void measureTime(uint32_t histogram_type, uint64_t value) override;
+
+  virtual void Reset() override;
+  virtual std::string ToString() const override;
+
+ private:
+  std::atomic<uint64_t> tickers_[TICKER_ENUM_MAX];
+  HistogramImpl histograms_[HISTOGRAM_ENUM_MAX];
+};
+
+// Utility functions
+inline void MeasureTime(Statistics* statistics, uint32_t histogram_type,
+                        uint64_t value) {
+  if (statistics) {
+    statistics->measureTime(histogram_type, value);
+  }
+}
+
+inline void RecordTick(Statistics* statistics, uint32_t ticker_type,
+                       uint64_t count = 1) {
+  if (statistics) {
+    statistics->recordTick(ticker_type, count);
+  }
+}
+
+inline uint64_t StatsNowMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Auto-scoped.
+// Records the elapsed time in microseconds to the histogram "hist_type"
+// when it goes out of scope.  Costs nothing when statistics is NULL.
+class StopWatch {
+ public:
+  StopWatch(Statistics* statistics, const uint32_t hist_type)
+      : statistics_(statistics),
+        hist_type_(hist_type),
+        start_time_(statistics != NULL ? StatsNowMicros() : 0) {}
+
+  ~StopWatch() {
+    if (statistics_) {
+      statistics_->measureTime(hist_type_, StatsNowMicros() - start_time_);
+    }
+  }
+
+ private:
+  Statistics* statistics_;
+  const uint32_t hist_type_;
+  const uint64_t start_time_;
+};
+
+}  // namespace shannon
+
+#endif  // SHANNON_DB_UTIL_STATISTICS_H_
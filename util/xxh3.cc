@@ -0,0 +1,582 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <string.h>
+#include "util/coding.h"
+#include "util/xxh3.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAVE_X86_XXH3 1
+#include <immintrin.h>
+#endif
+
+namespace shannon {
+namespace xxh3 {
+
+namespace {
+
+const uint64_t kPrime32_1 = 0x9e3779b1u;
+const uint64_t kPrime32_2 = 0x85ebca77u;
+const uint64_t kPrime32_3 = 0xc2b2ae3du;
+const uint64_t kPrime64_1 = 0x9e3779b185ebca87ull;
+const uint64_t kPrime64_2 = 0xc2b2ae3d27d4eb4full;
+const uint64_t kPrime64_3 = 0x165667b19e3779f9ull;
+const uint64_t kPrime64_4 = 0x85ebca77c2b2ae63ull;
+const uint64_t kPrime64_5 = 0x27d4eb2f165667c5ull;
+const uint64_t kPrimeMx1 = 0x165667919e3779f9ull;
+const uint64_t kPrimeMx2 = 0x9fb21c651e98df25ull;
+
+const size_t kSecretSize = 192;
+const size_t kSecretSizeMin = 136;
+const size_t kStripeLen = 64;
+const size_t kSecretConsumeRate = 8;
+const size_t kStripesPerBlock = (kSecretSize - kStripeLen) / kSecretConsumeRate;
+const size_t kBlockLen = kStripeLen * kStripesPerBlock;
+const size_t kMidSizeMax = 240;
+const size_t kMidSizeStartOffset = 3;
+const size_t kMidSizeLastOffset = 17;
+const size_t kSecretLastAccStart = 7;
+const size_t kSecretMergeAccsStart = 11;
+
+// Pseudorandom secret taken directly from FARSH.
+alignas(64) const unsigned char kSecret[kSecretSize] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+inline const char* DefaultSecret() {
+  return reinterpret_cast<const char*>(kSecret);
+}
+
+inline uint64_t Read64(const char* p) { return DecodeFixed64(p); }
+inline uint32_t Read32(const char* p) { return DecodeFixed32(p); }
+
+inline uint32_t Swap32(uint32_t x) { return __builtin_bswap32(x); }
+inline uint64_t Swap64(uint64_t x) { return __builtin_bswap64(x); }
+inline uint32_t Rotl32(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+inline uint64_t Rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+inline uint64_t XorShift64(uint64_t v, int shift) { return v ^ (v >> shift); }
+
+inline Hash128Value Mult64To128(uint64_t lhs, uint64_t rhs) {
+  Hash128Value r;
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+  r.low64 = static_cast<uint64_t>(product);
+  r.high64 = static_cast<uint64_t>(product >> 64);
+#else
+  uint64_t lo_lo = (lhs & 0xffffffff) * (rhs & 0xffffffff);
+  uint64_t hi_lo = (lhs >> 32) * (rhs & 0xffffffff);
+  uint64_t lo_hi = (lhs & 0xffffffff) * (rhs >> 32);
+  uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+  uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+  r.high64 = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  r.low64 = (cross << 32) | (lo_lo & 0xffffffff);
+#endif
+  return r;
+}
+
+inline uint64_t Mul128Fold64(uint64_t lhs, uint64_t rhs) {
+  Hash128Value r = Mult64To128(lhs, rhs);
+  return r.low64 ^ r.high64;
+}
+
+// The final mix of XXH64.
+inline uint64_t XXH64Avalanche(uint64_t h) {
+  h ^= h >> 33;
+  h *= kPrime64_2;
+  h ^= h >> 29;
+  h *= kPrime64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+inline uint64_t Avalanche(uint64_t h) {
+  h = XorShift64(h, 37);
+  h *= kPrimeMx1;
+  return XorShift64(h, 32);
+}
+
+inline uint64_t Rrmxmx(uint64_t h, uint64_t len) {
+  h ^= Rotl64(h, 49) ^ Rotl64(h, 24);
+  h *= kPrimeMx2;
+  h ^= (h >> 35) + len;
+  h *= kPrimeMx2;
+  return XorShift64(h, 28);
+}
+
+inline uint64_t Mix16B(const char* p, const char* secret, uint64_t seed) {
+  return Mul128Fold64(Read64(p) ^ (Read64(secret) + seed),
+                      Read64(p + 8) ^ (Read64(secret + 8) - seed));
+}
+
+// Inputs of at most 240 bytes, 64-bit result.
+
+uint64_t Len0To16(const char* p, size_t len, const char* secret,
+                  uint64_t seed) {
+  if (len > 8) {
+    uint64_t bitflip1 = (Read64(secret + 24) ^ Read64(secret + 32)) + seed;
+    uint64_t bitflip2 = (Read64(secret + 40) ^ Read64(secret + 48)) - seed;
+    uint64_t lo = Read64(p) ^ bitflip1;
+    uint64_t hi = Read64(p + len - 8) ^ bitflip2;
+    uint64_t acc = len + Swap64(lo) + hi + Mul128Fold64(lo, hi);
+    return Avalanche(acc);
+  }
+  if (len >= 4) {
+    seed ^= static_cast<uint64_t>(Swap32(static_cast<uint32_t>(seed))) << 32;
+    uint64_t input1 = Read32(p);
+    uint64_t input2 = Read32(p + len - 4);
+    uint64_t bitflip = (Read64(secret + 8) ^ Read64(secret + 16)) - seed;
+    return Rrmxmx((input2 + (input1 << 32)) ^ bitflip, len);
+  }
+  if (len > 0) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    uint32_t combined = (static_cast<uint32_t>(u[0]) << 16) |
+                        (static_cast<uint32_t>(u[len >> 1]) << 24) |
+                        static_cast<uint32_t>(u[len - 1]) |
+                        (static_cast<uint32_t>(len) << 8);
+    uint64_t bitflip = (Read32(secret) ^ Read32(secret + 4)) + seed;
+    return XXH64Avalanche(combined ^ bitflip);
+  }
+  return XXH64Avalanche(seed ^ (Read64(secret + 56) ^ Read64(secret + 64)));
+}
+
+uint64_t Len17To128(const char* p, size_t len, const char* secret,
+                    uint64_t seed) {
+  uint64_t acc = len * kPrime64_1;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        acc += Mix16B(p + 48, secret + 96, seed);
+        acc += Mix16B(p + len - 64, secret + 112, seed);
+      }
+      acc += Mix16B(p + 32, secret + 64, seed);
+      acc += Mix16B(p + len - 48, secret + 80, seed);
+    }
+    acc += Mix16B(p + 16, secret + 32, seed);
+    acc += Mix16B(p + len - 32, secret + 48, seed);
+  }
+  acc += Mix16B(p, secret, seed);
+  acc += Mix16B(p + len - 16, secret + 16, seed);
+  return Avalanche(acc);
+}
+
+uint64_t Len129To240(const char* p, size_t len, const char* secret,
+                     uint64_t seed) {
+  uint64_t acc = len * kPrime64_1;
+  size_t rounds = len / 16;
+  for (size_t i = 0; i < 8; i++) {
+    acc += Mix16B(p + 16 * i, secret + 16 * i, seed);
+  }
+  acc = Avalanche(acc);
+  uint64_t acc_end = Mix16B(p + len - 16,
+                            secret + kSecretSizeMin - kMidSizeLastOffset, seed);
+  for (size_t i = 8; i < rounds; i++) {
+    acc_end += Mix16B(p + 16 * i, secret + 16 * (i - 8) + kMidSizeStartOffset,
+                      seed);
+  }
+  return Avalanche(acc + acc_end);
+}
+
+// Inputs of at most 240 bytes, 128-bit result.
+
+Hash128Value Len0To16_128(const char* p, size_t len, const char* secret,
+                          uint64_t seed) {
+  Hash128Value h;
+  if (len > 8) {
+    uint64_t bitflipl = (Read64(secret + 32) ^ Read64(secret + 40)) - seed;
+    uint64_t bitfliph = (Read64(secret + 48) ^ Read64(secret + 56)) + seed;
+    uint64_t lo = Read64(p);
+    uint64_t hi = Read64(p + len - 8);
+    Hash128Value m = Mult64To128(lo ^ hi ^ bitflipl, kPrime64_1);
+    m.low64 += static_cast<uint64_t>(len - 1) << 54;
+    hi ^= bitfliph;
+    m.high64 += hi + (hi & 0xffffffff) * (kPrime32_2 - 1);
+    m.low64 ^= Swap64(m.high64);
+    h = Mult64To128(m.low64, kPrime64_2);
+    h.high64 += m.high64 * kPrime64_2;
+    h.low64 = Avalanche(h.low64);
+    h.high64 = Avalanche(h.high64);
+    return h;
+  }
+  if (len >= 4) {
+    seed ^= static_cast<uint64_t>(Swap32(static_cast<uint32_t>(seed))) << 32;
+    uint64_t lo = Read32(p);
+    uint64_t hi = Read32(p + len - 4);
+    uint64_t bitflip = (Read64(secret + 16) ^ Read64(secret + 24)) + seed;
+    uint64_t keyed = (lo + (hi << 32)) ^ bitflip;
+    h = Mult64To128(keyed, kPrime64_1 + (len << 2));
+    h.high64 += h.low64 << 1;
+    h.low64 ^= h.high64 >> 3;
+    h.low64 = XorShift64(h.low64, 35);
+    h.low64 *= kPrimeMx2;
+    h.low64 = XorShift64(h.low64, 28);
+    h.high64 = Avalanche(h.high64);
+    return h;
+  }
+  if (len > 0) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    uint32_t combinedl = (static_cast<uint32_t>(u[0]) << 16) |
+                         (static_cast<uint32_t>(u[len >> 1]) << 24) |
+                         static_cast<uint32_t>(u[len - 1]) |
+                         (static_cast<uint32_t>(len) << 8);
+    uint32_t combinedh = Rotl32(Swap32(combinedl), 13);
+    uint64_t bitflipl = (Read32(secret) ^ Read32(secret + 4)) + seed;
+    uint64_t bitfliph = (Read32(secret + 8) ^ Read32(secret + 12)) - seed;
+    h.low64 = XXH64Avalanche(combinedl ^ bitflipl);
+    h.high64 = XXH64Avalanche(combinedh ^ bitfliph);
+    return h;
+  }
+  h.low64 = XXH64Avalanche(seed ^ Read64(secret + 64) ^ Read64(secret + 72));
+  h.high64 = XXH64Avalanche(seed ^ Read64(secret + 80) ^ Read64(secret + 88));
+  return h;
+}
+
+inline void Mix32B(Hash128Value* acc, const char* p1, const char* p2,
+                   const char* secret, uint64_t seed) {
+  acc->low64 += Mix16B(p1, secret, seed);
+  acc->low64 ^= Read64(p2) + Read64(p2 + 8);
+  acc->high64 += Mix16B(p2, secret + 16, seed);
+  acc->high64 ^= Read64(p1) + Read64(p1 + 8);
+}
+
+inline Hash128Value Finish128(const Hash128Value& acc, size_t len,
+                              uint64_t seed) {
+  Hash128Value h;
+  h.low64 = Avalanche(acc.low64 + acc.high64);
+  h.high64 = 0 - Avalanche(acc.low64 * kPrime64_1 + acc.high64 * kPrime64_4 +
+                           (len - seed) * kPrime64_2);
+  return h;
+}
+
+Hash128Value Len17To128_128(const char* p, size_t len, const char* secret,
+                            uint64_t seed) {
+  Hash128Value acc;
+  acc.low64 = len * kPrime64_1;
+  acc.high64 = 0;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        Mix32B(&acc, p + 48, p + len - 64, secret + 96, seed);
+      }
+      Mix32B(&acc, p + 32, p + len - 48, secret + 64, seed);
+    }
+    Mix32B(&acc, p + 16, p + len - 32, secret + 32, seed);
+  }
+  Mix32B(&acc, p, p + len - 16, secret, seed);
+  return Finish128(acc, len, seed);
+}
+
+Hash128Value Len129To240_128(const char* p, size_t len, const char* secret,
+                             uint64_t seed) {
+  Hash128Value acc;
+  acc.low64 = len * kPrime64_1;
+  acc.high64 = 0;
+  for (size_t i = 32; i < 160; i += 32) {
+    Mix32B(&acc, p + i - 32, p + i - 16, secret + i - 32, seed);
+  }
+  acc.low64 = Avalanche(acc.low64);
+  acc.high64 = Avalanche(acc.high64);
+  for (size_t i = 160; i <= len; i += 32) {
+    Mix32B(&acc, p + i - 32, p + i - 16,
+           secret + kMidSizeStartOffset + i - 160, seed);
+  }
+  Mix32B(&acc, p + len - 16, p + len - 32,
+         secret + kSecretSizeMin - kMidSizeLastOffset - 16, 0 - seed);
+  return Finish128(acc, len, seed);
+}
+
+// Inputs longer than 240 bytes are consumed in stripes of 64 bytes by
+// eight 64-bit accumulators, which are scrambled after every block of
+// kStripesPerBlock stripes.  This loop is the only vectorized part.
+
+typedef void (*LongLoop)(uint64_t* acc, const char* p, size_t len,
+                         const char* secret);
+
+inline void Accumulate512Scalar(uint64_t* acc, const char* p,
+                                const char* secret) {
+  for (size_t i = 0; i < 8; i++) {
+    uint64_t data_val = Read64(p + 8 * i);
+    uint64_t data_key = data_val ^ Read64(secret + 8 * i);
+    acc[i ^ 1] += data_val;
+    acc[i] += (data_key & 0xffffffff) * (data_key >> 32);
+  }
+}
+
+inline void ScrambleScalar(uint64_t* acc, const char* secret) {
+  for (size_t i = 0; i < 8; i++) {
+    uint64_t a = XorShift64(acc[i], 47);
+    a ^= Read64(secret + 8 * i);
+    acc[i] = a * kPrime32_1;
+  }
+}
+
+#define XXH3_LONG_LOOP(name, attr, accumulate, scramble)                      \
+  attr void name(uint64_t* acc, const char* p, size_t len,                    \
+                 const char* secret) {                                        \
+    size_t blocks = (len - 1) / kBlockLen;                                    \
+    for (size_t n = 0; n < blocks; n++) {                                     \
+      const char* block = p + n * kBlockLen;                                  \
+      for (size_t s = 0; s < kStripesPerBlock; s++) {                         \
+        accumulate(acc, block + s * kStripeLen,                               \
+                   secret + s * kSecretConsumeRate);                          \
+      }                                                                       \
+      scramble(acc, secret + kSecretSize - kStripeLen);                       \
+    }                                                                         \
+    size_t stripes = ((len - 1) - kBlockLen * blocks) / kStripeLen;           \
+    const char* block = p + blocks * kBlockLen;                               \
+    for (size_t s = 0; s < stripes; s++) {                                    \
+      accumulate(acc, block + s * kStripeLen,                                 \
+                 secret + s * kSecretConsumeRate);                            \
+    }                                                                         \
+    accumulate(acc, p + len - kStripeLen,                                     \
+               secret + kSecretSize - kStripeLen - kSecretLastAccStart);      \
+  }
+
+XXH3_LONG_LOOP(LongLoopScalar, , Accumulate512Scalar, ScrambleScalar)
+
+#ifdef HAVE_X86_XXH3
+__attribute__((target("sse2")))
+inline void Accumulate512Sse2(uint64_t* acc, const char* p,
+                              const char* secret) {
+  __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+  const __m128i* xinput = reinterpret_cast<const __m128i*>(p);
+  const __m128i* xsecret = reinterpret_cast<const __m128i*>(secret);
+  for (size_t i = 0; i < kStripeLen / sizeof(__m128i); i++) {
+    __m128i data_vec = _mm_loadu_si128(xinput + i);
+    __m128i data_key = _mm_xor_si128(data_vec, _mm_loadu_si128(xsecret + i));
+    __m128i data_key_lo = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i product = _mm_mul_epu32(data_key, data_key_lo);
+    __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+    xacc[i] = _mm_add_epi64(product, _mm_add_epi64(xacc[i], data_swap));
+  }
+}
+
+__attribute__((target("sse2")))
+inline void ScrambleSse2(uint64_t* acc, const char* secret) {
+  __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+  const __m128i* xsecret = reinterpret_cast<const __m128i*>(secret);
+  const __m128i prime32 = _mm_set1_epi32(static_cast<int>(kPrime32_1));
+  for (size_t i = 0; i < kStripeLen / sizeof(__m128i); i++) {
+    __m128i a = _mm_xor_si128(xacc[i], _mm_srli_epi64(xacc[i], 47));
+    __m128i data_key = _mm_xor_si128(a, _mm_loadu_si128(xsecret + i));
+    __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i prod_lo = _mm_mul_epu32(data_key, prime32);
+    __m128i prod_hi = _mm_mul_epu32(data_key_hi, prime32);
+    xacc[i] = _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32));
+  }
+}
+
+__attribute__((target("avx2")))
+inline void Accumulate512Avx2(uint64_t* acc, const char* p,
+                              const char* secret) {
+  __m256i* xacc = reinterpret_cast<__m256i*>(acc);
+  const __m256i* xinput = reinterpret_cast<const __m256i*>(p);
+  const __m256i* xsecret = reinterpret_cast<const __m256i*>(secret);
+  for (size_t i = 0; i < kStripeLen / sizeof(__m256i); i++) {
+    __m256i data_vec = _mm256_loadu_si256(xinput + i);
+    __m256i data_key =
+        _mm256_xor_si256(data_vec, _mm256_loadu_si256(xsecret + i));
+    __m256i data_key_lo = _mm256_srli_epi64(data_key, 32);
+    __m256i product = _mm256_mul_epu32(data_key, data_key_lo);
+    __m256i data_swap =
+        _mm256_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+    xacc[i] = _mm256_add_epi64(product, _mm256_add_epi64(xacc[i], data_swap));
+  }
+}
+
+__attribute__((target("avx2")))
+inline void ScrambleAvx2(uint64_t* acc, const char* secret) {
+  __m256i* xacc = reinterpret_cast<__m256i*>(acc);
+  const __m256i* xsecret = reinterpret_cast<const __m256i*>(secret);
+  const __m256i prime32 = _mm256_set1_epi32(static_cast<int>(kPrime32_1));
+  for (size_t i = 0; i < kStripeLen / sizeof(__m256i); i++) {
+    __m256i a = _mm256_xor_si256(xacc[i], _mm256_srli_epi64(xacc[i], 47));
+    __m256i data_key = _mm256_xor_si256(a, _mm256_loadu_si256(xsecret + i));
+    __m256i data_key_hi = _mm256_srli_epi64(data_key, 32);
+    __m256i prod_lo = _mm256_mul_epu32(data_key, prime32);
+    __m256i prod_hi = _mm256_mul_epu32(data_key_hi, prime32);
+    xacc[i] = _mm256_add_epi64(prod_lo, _mm256_slli_epi64(prod_hi, 32));
+  }
+}
+
+XXH3_LONG_LOOP(LongLoopSse2, __attribute__((target("sse2"))),
+               Accumulate512Sse2, ScrambleSse2)
+XXH3_LONG_LOOP(LongLoopAvx2, __attribute__((target("avx2"))),
+               Accumulate512Avx2, ScrambleAvx2)
+#endif  // HAVE_X86_XXH3
+
+#undef XXH3_LONG_LOOP
+
+// The secret of a seeded hash of a long input.
+void InitCustomSecret(char* secret, uint64_t seed) {
+  for (size_t i = 0; i < kSecretSize / 16; i++) {
+    EncodeFixed64(secret + 16 * i, Read64(DefaultSecret() + 16 * i) + seed);
+    EncodeFixed64(secret + 16 * i + 8,
+                  Read64(DefaultSecret() + 16 * i + 8) - seed);
+  }
+}
+
+uint64_t MergeAccs(const uint64_t* acc, const char* secret, uint64_t start) {
+  uint64_t result = start;
+  for (size_t i = 0; i < 4; i++) {
+    result += Mul128Fold64(acc[2 * i] ^ Read64(secret + 16 * i),
+                           acc[2 * i + 1] ^ Read64(secret + 16 * i + 8));
+  }
+  return Avalanche(result);
+}
+
+void HashLong(LongLoop loop, const char* p, size_t len, uint64_t seed,
+              uint64_t* acc, const char** secret, char* custom_secret) {
+  acc[0] = kPrime32_3;
+  acc[1] = kPrime64_1;
+  acc[2] = kPrime64_2;
+  acc[3] = kPrime64_3;
+  acc[4] = kPrime64_4;
+  acc[5] = kPrime32_2;
+  acc[6] = kPrime64_5;
+  acc[7] = kPrime32_1;
+  *secret = DefaultSecret();
+  if (seed != 0) {
+    InitCustomSecret(custom_secret, seed);
+    *secret = custom_secret;
+  }
+  loop(acc, p, len, *secret);
+}
+
+uint64_t Hash64Long(LongLoop loop, const char* p, size_t len, uint64_t seed) {
+  alignas(64) uint64_t acc[8];
+  alignas(64) char custom_secret[kSecretSize];
+  const char* secret;
+  HashLong(loop, p, len, seed, acc, &secret, custom_secret);
+  return MergeAccs(acc, secret + kSecretMergeAccsStart, len * kPrime64_1);
+}
+
+Hash128Value Hash128Long(LongLoop loop, const char* p, size_t len,
+                         uint64_t seed) {
+  alignas(64) uint64_t acc[8];
+  alignas(64) char custom_secret[kSecretSize];
+  const char* secret;
+  HashLong(loop, p, len, seed, acc, &secret, custom_secret);
+  Hash128Value h;
+  h.low64 = MergeAccs(acc, secret + kSecretMergeAccsStart, len * kPrime64_1);
+  h.high64 = MergeAccs(acc,
+                       secret + kSecretSize - sizeof(acc) -
+                           kSecretMergeAccsStart,
+                       ~(len * kPrime64_2));
+  return h;
+}
+
+LongLoop LoopFor(Implementation impl) {
+  switch (impl) {
+#ifdef HAVE_X86_XXH3
+    case kSse2:
+      return LongLoopSse2;
+    case kAvx2:
+      return LongLoopAvx2;
+#endif
+    default:
+      return LongLoopScalar;
+  }
+}
+
+inline uint64_t Hash64Internal(LongLoop loop, const char* p, size_t len,
+                               uint64_t seed) {
+  if (len <= 16) return Len0To16(p, len, DefaultSecret(), seed);
+  if (len <= 128) return Len17To128(p, len, DefaultSecret(), seed);
+  if (len <= kMidSizeMax) return Len129To240(p, len, DefaultSecret(), seed);
+  return Hash64Long(loop, p, len, seed);
+}
+
+inline Hash128Value Hash128Internal(LongLoop loop, const char* p, size_t len,
+                                    uint64_t seed) {
+  if (len <= 16) return Len0To16_128(p, len, DefaultSecret(), seed);
+  if (len <= 128) return Len17To128_128(p, len, DefaultSecret(), seed);
+  if (len <= kMidSizeMax) {
+    return Len129To240_128(p, len, DefaultSecret(), seed);
+  }
+  return Hash128Long(loop, p, len, seed);
+}
+
+Implementation ChooseImplementation() {
+  if (IsSupported(kAvx2)) return kAvx2;
+  if (IsSupported(kSse2)) return kSse2;
+  return kScalar;
+}
+
+// Picked once, the first hash may come from a static initializer of
+// another translation unit.
+LongLoop ActiveLoop() {
+  static const LongLoop loop = LoopFor(ChooseImplementation());
+  return loop;
+}
+
+}  // namespace
+
+bool IsSupported(Implementation impl) {
+  switch (impl) {
+    case kScalar:
+      return true;
+#ifdef HAVE_X86_XXH3
+    case kSse2:
+      return true;  // Part of x86-64.
+    case kAvx2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+Implementation ActiveImplementation() {
+  static const Implementation impl = ChooseImplementation();
+  return impl;
+}
+
+const char* ImplementationName(Implementation impl) {
+  switch (impl) {
+    case kScalar:
+      return "scalar";
+    case kSse2:
+      return "sse2";
+    case kAvx2:
+      return "avx2";
+  }
+  return "unknown";
+}
+
+uint64_t Hash64(const char* data, size_t n, uint64_t seed) {
+  return Hash64Internal(ActiveLoop(), data, n, seed);
+}
+
+Hash128Value Hash128(const char* data, size_t n, uint64_t seed) {
+  return Hash128Internal(ActiveLoop(), data, n, seed);
+}
+
+uint64_t Hash64With(Implementation impl, const char* data, size_t n,
+                    uint64_t seed) {
+  return Hash64Internal(LoopFor(impl), data, n, seed);
+}
+
+Hash128Value Hash128With(Implementation impl, const char* data, size_t n,
+                         uint64_t seed) {
+  return Hash128Internal(LoopFor(impl), data, n, seed);
+}
+
+}  // namespace xxh3
+}  // namespace shannon
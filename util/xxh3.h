@@ -0,0 +1,47 @@
+// Copyright (c) 2018 The Shannon Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_SHANNONDB_INCLUDE_UTIL_XXH3_H_
+#define STORAGE_SHANNONDB_INCLUDE_UTIL_XXH3_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace shannon {
+namespace xxh3 {
+
+// XXH3 from xxHash 0.8, with the default secret.  The results are those of
+// XXH3_64bits_withSeed() and XXH3_128bits_withSeed(), on every platform.
+
+struct Hash128Value {
+  uint64_t low64;
+  uint64_t high64;
+};
+
+extern uint64_t Hash64(const char* data, size_t n, uint64_t seed = 0);
+extern Hash128Value Hash128(const char* data, size_t n, uint64_t seed = 0);
+
+// Implementations of the loop hashing inputs longer than 240 bytes, picked
+// once from what the CPU supports.  Shorter inputs always use scalar code.
+enum Implementation {
+  kScalar,
+  kSse2,
+  kAvx2,
+};
+
+extern bool IsSupported(Implementation impl);
+extern Implementation ActiveImplementation();
+extern const char* ImplementationName(Implementation impl);
+
+// Hash64() and Hash128() with the given implementation, which must be
+// supported.  For tests and benchmarks.
+extern uint64_t Hash64With(Implementation impl, const char* data, size_t n,
+                           uint64_t seed);
+extern Hash128Value Hash128With(Implementation impl, const char* data,
+                                size_t n, uint64_t seed);
+
+}  // namespace xxh3
+}  // namespace shannon
+
+#endif  // STORAGE_SHANNONDB_INCLUDE_UTIL_XXH3_H_